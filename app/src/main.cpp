@@ -48,16 +48,18 @@ int main (int argv, char** args)
 
   QCoreApplication::setApplicationName ("Dilay");
   QCoreApplication::setAttribute (Qt::AA_UseDesktopOpenGL);
-  OpenGL::setDefaultFormat ();
-
-  QApplication app (argv, args);
-  Config       config;
-  Cache        cache;
 
+  // the configuration is loaded before `QApplication` is created because the default surface
+  // format must be set beforehand
+  Config config;
   if (configPath ().isEmpty () == false)
   {
     config.fromFile (configPath ().toStdString ());
   }
+  OpenGL::setDefaultFormat (config.get<bool> ("editor/use-core-profile"));
+
+  QApplication app (argv, args);
+  Cache        cache;
 
   ViewMainWindow mainWindow (config, cache);
   mainWindow.resize (config.get<int> ("window/initial-width"),
@@ -7,16 +7,21 @@ INCLUDEPATH += src
 CONFIG      += staticlib
 
 SOURCES += \
+           src/autosave.cpp \
            src/camera.cpp \
            src/color.cpp \
            src/config.cpp \
            src/configurable.cpp \
            src/dimension.cpp \
            src/distance.cpp \
+           src/dlb.cpp \
            src/dynamic/faces.cpp \
            src/dynamic/mesh.cpp \
            src/dynamic/mesh-intersection.cpp \
            src/dynamic/octree.cpp \
+           src/dynamic/render-chunks.cpp \
+           src/dynamic/stitch.cpp \
+           src/export-job.cpp \
            src/history.cpp \
            src/import-export.cpp \
            src/intersection.cpp \
@@ -25,10 +30,13 @@ SOURCES += \
            src/kvstore.cpp \
            src/log.cpp \
            src/mesh.cpp \
+           src/mesh-instances.cpp \
            src/mesh-util.cpp \
            src/mirror.cpp \
            src/opengl.cpp \
            src/opengl-buffer-id.cpp \
+           src/opengl-vertex-array-id.cpp \
+           src/ply.cpp \
            src/primitive/aabox.cpp \
            src/primitive/cone.cpp \
            src/primitive/cone-sphere.cpp \
@@ -42,12 +50,15 @@ SOURCES += \
            src/scene.cpp \
            src/shader.cpp \
            src/sketch/bone-intersection.cpp \
+           src/sketch/distance-tree.cpp \
            src/sketch/mesh.cpp \
            src/sketch/mesh-intersection.cpp \
            src/sketch/node-intersection.cpp \
            src/sketch/path.cpp \
            src/sketch/path-intersection.cpp \
            src/state.cpp \
+           src/stl.cpp \
+           src/task-pool.cpp \
            src/time-delta.cpp \
            src/tool.cpp \
            src/tool/convert-sketch.cpp \
@@ -74,11 +85,13 @@ SOURCES += \
            src/tool/trim-mesh/action.cpp \
            src/tool/trim-mesh/border.cpp \
            src/tool/trim-mesh/split-mesh.cpp \
+           src/tool/util/extraction.cpp \
            src/tool/util/movement.cpp \
            src/tool/util/rotation.cpp \
            src/tool/util/scaling.cpp \
            src/tool/util/step.cpp \
            src/util.cpp \
+           src/varint.cpp \
            src/view/axis.cpp \
            src/view/color-button.cpp \
            src/view/configuration.cpp \
@@ -105,6 +118,7 @@ SOURCES += \
            src/xml-conversion.cpp \
 
 HEADERS += \
+           src/autosave.hpp \
            src/bitset.hpp \
            src/cache.hpp \
            src/camera.hpp \
@@ -113,10 +127,14 @@ HEADERS += \
            src/configurable.hpp \
            src/dimension.hpp \
            src/distance.hpp \
+           src/dlb.hpp \
            src/dynamic/faces.hpp \
            src/dynamic/mesh.hpp \
            src/dynamic/mesh-intersection.hpp \
            src/dynamic/octree.hpp \
+           src/dynamic/render-chunks.hpp \
+           src/dynamic/stitch.hpp \
+           src/export-job.hpp \
            src/hash.hpp \
            src/history.hpp \
            src/import-export.hpp \
@@ -128,10 +146,13 @@ HEADERS += \
            src/macro.hpp \
            src/maybe.hpp \
            src/mesh.hpp \
+           src/mesh-instances.hpp \
            src/mesh-util.hpp \
            src/mirror.hpp \
            src/opengl.hpp \
            src/opengl-buffer-id.hpp \
+           src/opengl-vertex-array-id.hpp \
+           src/ply.hpp \
            src/primitive/aabox.hpp \
            src/primitive/cone.hpp \
            src/primitive/cone-sphere.hpp \
@@ -145,6 +166,7 @@ HEADERS += \
            src/scene.hpp \
            src/shader.hpp \
            src/sketch/bone-intersection.hpp \
+           src/sketch/distance-tree.hpp \
            src/sketch/fwd.hpp \
            src/sketch/mesh.hpp \
            src/sketch/mesh-intersection.hpp \
@@ -152,6 +174,8 @@ HEADERS += \
            src/sketch/path.hpp \
            src/sketch/path-intersection.hpp \
            src/state.hpp \
+           src/stl.hpp \
+           src/task-pool.hpp \
            src/time-delta.hpp \
            src/tool.hpp \
            src/tool/key.hpp \
@@ -163,6 +187,7 @@ HEADERS += \
            src/tool/trim-mesh/action.hpp \
            src/tool/trim-mesh/border.hpp \
            src/tool/trim-mesh/split-mesh.hpp \
+           src/tool/util/extraction.hpp \
            src/tool/util/movement.hpp \
            src/tool/util/rotation.hpp \
            src/tool/util/scaling.hpp \
@@ -171,6 +196,7 @@ HEADERS += \
            src/tree.hpp \
            src/util.hpp \
            src/variant.hpp \
+           src/varint.hpp \
            src/view/axis.hpp \
            src/view/color-button.hpp \
            src/view/configuration.hpp \
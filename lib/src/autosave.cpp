@@ -0,0 +1,369 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QLockFile>
+#include <QObject>
+#include <QStandardPaths>
+#include <QTimer>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "autosave.hpp"
+#include "config.hpp"
+#include "dlb.hpp"
+#include "dynamic/mesh.hpp"
+#include "import-export.hpp"
+#include "scene.hpp"
+#include "sketch/mesh.hpp"
+#include "sketch/path.hpp"
+#include "util.hpp"
+
+namespace
+{
+  QString autosavePath ()
+  {
+    const QString dataPath = QStandardPaths::writableLocation (QStandardPaths::AppDataLocation);
+    return QDir (dataPath.isEmpty () ? QDir::tempPath () : dataPath).filePath ("autosave");
+  }
+
+  // Lists the files of the latest complete autosave, cf. `Autosave::Impl::run`
+  const std::string manifestFileName = "manifest";
+
+  struct MeshFile
+  {
+    std::string            fileName;
+    ImportExport::MeshCopy mesh;
+  };
+
+  // Files are written under a temporary name and renamed afterwards, i.e. a file with its final
+  // name is always complete.
+  bool writeFile (const QDir& dir, const std::string& fileName,
+                  const std::function<void(std::ostream&)>& write)
+  {
+    const QString tmpFilePath = dir.filePath (QString::fromStdString (fileName + ".tmp"));
+    const QString filePath = dir.filePath (QString::fromStdString (fileName));
+
+    std::ofstream file (tmpFilePath.toStdString (), std::ios::binary);
+    if (file.is_open () == false)
+    {
+      return false;
+    }
+    write (file);
+    file.close ();
+
+    if (file.fail ())
+    {
+      QFile::remove (tmpFilePath);
+      return false;
+    }
+    QFile::remove (filePath);
+    return QFile::rename (tmpFilePath, filePath);
+  }
+
+  std::vector<std::string> readManifest (const QDir& dir)
+  {
+    const QString            filePath = dir.filePath (QString::fromStdString (manifestFileName));
+    std::ifstream            file (filePath.toStdString ());
+    std::vector<std::string> fileNames;
+    std::string              fileName;
+
+    while (std::getline (file, fileName))
+    {
+      if (fileName.empty () == false)
+      {
+        fileNames.push_back (fileName);
+      }
+    }
+    return fileNames;
+  }
+}
+
+struct Autosave::Impl
+{
+  const Scene&      scene;
+  const QString     path;
+  const std::string session;
+  QLockFile         lockFile;
+  bool              isLocked;
+  bool              hasRecoverableFiles;
+  QTimer            timer;
+  std::thread       thread;
+  std::atomic<bool> isFinished;
+  bool              success; // written by `thread`, read after joining it
+
+  // files in the directory after the last autosave (written by `thread`, read after joining it)
+  std::unordered_set<std::string> existingFileNames;
+
+  Impl (const Scene& s, const Config& config)
+    : scene (s)
+    , path (autosavePath ())
+    , session (std::to_string (QDateTime::currentMSecsSinceEpoch ()))
+    , lockFile (this->path + ".lock")
+    , isLocked (false)
+    , hasRecoverableFiles (false)
+    , isFinished (false)
+    , success (true)
+  {
+    if (QDir (this->path).mkpath (".") && this->lockFile.tryLock (0))
+    {
+      for (const QString& n : this->fileNames ())
+      {
+        if (n.toStdString () != manifestFileName)
+        {
+          this->existingFileNames.insert (n.toStdString ());
+        }
+      }
+      this->isLocked = true;
+      this->hasRecoverableFiles = readManifest (QDir (this->path)).empty () == false;
+    }
+    else
+    {
+      DILAY_WARN ("autosave is disabled: could not lock %s", this->path.toStdString ().c_str ())
+    }
+    QObject::connect (&this->timer, &QTimer::timeout, [this]() { this->poll (); });
+
+    this->runFromConfig (config);
+  }
+
+  // Files are only removed if the application exits regularly
+  ~Impl ()
+  {
+    this->wait ();
+
+    if (this->isLocked)
+    {
+      QDir (this->path).removeRecursively ();
+      this->lockFile.unlock ();
+    }
+  }
+
+  bool isRunning () const { return this->thread.joinable (); }
+
+  QStringList fileNames () const
+  {
+    return QDir (this->path).entryList (QDir::Files | QDir::NoDotAndDotDot, QDir::Name);
+  }
+
+  bool canRecover () const { return this->hasRecoverableFiles; }
+
+  // Only files of the manifest are recovered, since other files might be left over from an
+  // incomplete autosave. Recovered files are removed by the next autosave, cf. `run`.
+  bool recover (const Config& config, Scene& scene)
+  {
+    assert (this->hasRecoverableFiles);
+
+    const QDir dir (this->path);
+    bool       success = true;
+
+    for (const std::string& name : readManifest (dir))
+    {
+      const std::string filePath = dir.filePath (QString::fromStdString (name)).toStdString ();
+      success = ImportExport::fromDlyFile (filePath, config, scene) && success;
+    }
+    this->hasRecoverableFiles = false;
+    return success;
+  }
+
+  void discard () { this->hasRecoverableFiles = false; }
+
+  void wait ()
+  {
+    if (this->isRunning ())
+    {
+      this->finish ();
+    }
+  }
+
+  void finish ()
+  {
+    this->thread.join ();
+
+    if (this->success == false)
+    {
+      DILAY_WARN ("could not autosave to %s", this->path.toStdString ().c_str ())
+    }
+  }
+
+  void autosave ()
+  {
+    if (this->isLocked && this->hasRecoverableFiles == false)
+    {
+      this->wait ();
+      this->run ();
+    }
+  }
+
+  std::string directory () const { return this->path.toStdString (); }
+
+  // An autosave is skipped if the previous one is still running
+  void poll ()
+  {
+    if (this->hasRecoverableFiles)
+    {
+      return;
+    }
+    else if (this->isRunning ())
+    {
+      if (this->isFinished)
+      {
+        this->finish ();
+      }
+      else
+      {
+        return;
+      }
+    }
+    this->run ();
+  }
+
+  // Files are named after the session and the revisions of their meshes, since revisions are
+  // only unique within a session. Meshes with equal revisions have equal geometry but are written
+  // separately, since each of them is a mesh of the scene. Only a snapshot of changed meshes and
+  // of all sketches is taken here, whereas they are compacted and encoded by `thread`. The
+  // manifest is written last, i.e. it lists the files of the latest complete autosave.
+  void run ()
+  {
+    std::vector<std::string>                       fileNames;
+    std::vector<MeshFile>                          meshFiles;
+    std::vector<SketchTree>                        sketchTrees;
+    std::vector<SketchPaths>                       sketchPaths;
+    std::unordered_map<unsigned int, unsigned int> numRevisions;
+
+    this->scene.forEachConstMesh (
+      [this, &numRevisions, &fileNames, &meshFiles](const DynamicMesh& mesh) {
+        const unsigned int n = numRevisions[mesh.revision ()]++;
+        const std::string  fileName = "mesh-" + this->session + "-" +
+                                     std::to_string (mesh.revision ()) + "-" + std::to_string (n) +
+                                     ".dlb";
+
+        fileNames.push_back (fileName);
+        if (this->existingFileNames.count (fileName) == 0)
+        {
+          meshFiles.push_back (MeshFile{fileName, ImportExport::copyMesh (mesh)});
+        }
+      });
+
+    this->scene.forEachConstMesh ([&sketchTrees, &sketchPaths](const SketchMesh& mesh) {
+      if (mesh.isEmpty () == false)
+      {
+        sketchTrees.push_back (mesh.tree ());
+        sketchPaths.push_back (mesh.paths ());
+      }
+    });
+
+    // All files of the snapshot exist already, i.e. there are no stale files if their numbers match
+    if (meshFiles.empty () && sketchTrees.empty () &&
+        this->existingFileNames.size () == fileNames.size ())
+    {
+      return;
+    }
+
+    this->isFinished = false;
+    this->success = true;
+    this->thread = std::thread ([
+      this, fileNames = std::move (fileNames), meshFiles = std::move (meshFiles),
+      sketchTrees = std::move (sketchTrees), sketchPaths = std::move (sketchPaths)
+    ]() mutable {
+      const QDir dir (this->path);
+
+      for (const MeshFile& f : meshFiles)
+      {
+        this->success = writeFile (dir, f.fileName, [&f](std::ostream& stream) {
+                          Dlb::writeHeader (stream);
+                          ImportExport::withCompactMesh (
+                            f.mesh, [&stream](const Mesh& m) { Dlb::writeMesh (stream, m); });
+                        }) && this->success;
+      }
+
+      // Sketches are small, i.e. they are encoded at every autosave and named after their hash
+      if (sketchTrees.empty () == false)
+      {
+        std::ostringstream sketches;
+        for (unsigned int i = 0; i < sketchTrees.size (); i++)
+        {
+          Dlb::writeSketch (sketches, sketchTrees[i], sketchPaths[i]);
+        }
+
+        this->success = sketches.fail () == false && this->success;
+
+        const std::string bytes = sketches.str ();
+        const std::string fileName =
+          "sketches-" + std::to_string (std::hash<std::string> () (bytes)) + ".dlb";
+
+        fileNames.push_back (fileName);
+        if (this->existingFileNames.count (fileName) == 0)
+        {
+          this->success = writeFile (dir, fileName, [&bytes](std::ostream& stream) {
+                            Dlb::writeHeader (stream);
+                            stream.write (bytes.data (), bytes.size ());
+                          }) && this->success;
+        }
+      }
+
+      if (this->success)
+      {
+        this->success = writeFile (dir, manifestFileName, [&fileNames](std::ostream& stream) {
+          for (const std::string& n : fileNames)
+          {
+            stream << n << '\n';
+          }
+        });
+      }
+
+      // Stale files are kept if a file could not be written, i.e. the directory always holds the
+      // files of the latest manifest. The next autosave writes all files again in this case.
+      this->existingFileNames.clear ();
+      if (this->success)
+      {
+        for (const QString& name : dir.entryList (QDir::Files | QDir::NoDotAndDotDot))
+        {
+          const std::string n = name.toStdString ();
+
+          if (std::find (fileNames.begin (), fileNames.end (), n) != fileNames.end ())
+          {
+            this->existingFileNames.insert (n);
+          }
+          else if (n != manifestFileName)
+          {
+            QFile::remove (dir.filePath (name));
+          }
+        }
+      }
+      this->isFinished = true;
+    });
+  }
+
+  void runFromConfig (const Config& config)
+  {
+    const int seconds = config.get<int> ("editor/autosave-interval");
+
+    if (this->isLocked && seconds > 0)
+    {
+      this->timer.start (std::min (seconds, Util::maxInt () / 1000) * 1000);
+    }
+    else
+    {
+      this->timer.stop ();
+    }
+  }
+};
+
+DELEGATE2_BIG2 (Autosave, const Scene&, const Config&)
+DELEGATE_CONST (bool, Autosave, canRecover)
+DELEGATE2 (bool, Autosave, recover, const Config&, Scene&)
+DELEGATE (void, Autosave, discard)
+DELEGATE (void, Autosave, wait)
+DELEGATE (void, Autosave, autosave)
+DELEGATE_CONST (std::string, Autosave, directory)
+DELEGATE1 (void, Autosave, runFromConfig, const Config&)
@@ -0,0 +1,46 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_AUTOSAVE
+#define DILAY_AUTOSAVE
+
+#include <string>
+#include "configurable.hpp"
+#include "macro.hpp"
+
+class Scene;
+
+// `Autosave` periodically writes a scene to a directory in a background thread. Each mesh is
+// written to a binary Dilay file of its own that is named after the revision of the mesh, i.e.
+// only meshes that changed since the last autosave are written, and files of changed or deleted
+// meshes are removed. A manifest that is written last lists the files of the latest complete
+// autosave. The directory is removed when `Autosave` is destroyed, so files that are found on
+// startup are left over from a crash.
+class Autosave : public Configurable
+{
+public:
+  DECLARE_BIG2 (Autosave, const Scene&, const Config&)
+
+  // `true` if files of a crashed session can be recovered. They are kept until they are either
+  // recovered or discarded, i.e. no autosave takes place before. Another instance of the
+  // application neither recovers nor writes files.
+  bool canRecover () const;
+  bool recover (const Config&, Scene&);
+  void discard ();
+
+  // blocks until a running autosave is finished
+  void wait ();
+
+  // Meant for tests: starts an autosave immediately unless files can be recovered, and returns
+  // the directory of the files
+  void        autosave ();
+  std::string directory () const;
+
+private:
+  IMPLEMENTATION
+
+  void runFromConfig (const Config&);
+};
+
+#endif
@@ -248,6 +248,7 @@ DELEGATE_CONST (glm::vec3, Camera, realUp)
 GETTER_CONST (const glm::vec3&, Camera, right)
 GETTER_CONST (const glm::mat4x4&, Camera, view)
 GETTER_CONST (const glm::mat4x4&, Camera, viewRotation)
+GETTER_CONST (const glm::mat4x4&, Camera, projection)
 DELEGATE_CONST (glm::vec3, Camera, position)
 DELEGATE_CONST (glm::mat4x4, Camera, world)
 DELEGATE1 (void, Camera, updateResolution, const glm::uvec2&)
@@ -26,6 +26,7 @@ public:
   const glm::vec3&   right () const;
   const glm::mat4x4& view () const;
   const glm::mat4x4& viewRotation () const;
+  const glm::mat4x4& projection () const;
   glm::vec3          position () const;
   glm::mat4x4        world () const;
 
@@ -9,7 +9,7 @@
 
 namespace
 {
-  static constexpr int latestVersion = 10;
+  static constexpr int latestVersion = 12;
 
   template <typename T>
   void updateValue (Config& config, const std::string& path, const T& oldValue, const T& newValue)
@@ -89,10 +89,14 @@ void Config::restoreDefaults ()
   this->set ("editor/tool/sketch-spheres/step-width-factor", 0.3f);
 
   this->set ("editor/undo-depth", 15);
+  this->set ("editor/undo-memory", 512);
+
+  this->set ("editor/autosave-interval", 60);
 
   this->set ("editor/tablet-pressure-intensity", 1.0f);
 
   this->set ("editor/use-geometry-shader", true);
+  this->set ("editor/use-core-profile", false);
 
   this->set ("window/initial-width", 1024);
   this->set ("window/initial-height", 768);
@@ -145,6 +149,14 @@ void Config::update ()
       this->remove ("editor/camera/zoom-in-factor");
       break;
 
+    case 10:
+      this->set ("editor/undo-memory", 512);
+      break;
+
+    case 11:
+      this->set ("editor/autosave-interval", 60);
+      break;
+
     case latestVersion:
       return;
 
@@ -0,0 +1,379 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <limits>
+#include <ostream>
+#include <vector>
+#include "dlb.hpp"
+#include "mesh.hpp"
+#include "sketch/path.hpp"
+#include "util.hpp"
+
+namespace
+{
+  static_assert (sizeof (float) == 4 && sizeof (unsigned int) == 4, "Unexpected type sizes");
+
+  // cf. `Dlb::read`
+  const unsigned char magic[] = {'D', 'L', 'Y', 'B'};
+  const unsigned int  version = 1;
+  const unsigned char meshTag[] = {'M', 'E', 'S', 'H'};
+  const unsigned char sketchTag[] = {'S', 'K', 'C', 'H'};
+  const std::size_t   tagSize = 4;
+  const std::size_t   headerSize = tagSize + 4;
+  const std::size_t   chunkHeaderSize = tagSize + 4;
+  const std::size_t   sphereSize = 16;
+
+  bool hasTag (const unsigned char* data, const unsigned char* tag)
+  {
+    return std::memcmp (data, tag, tagSize) == 0;
+  }
+
+  struct ByteWriter
+  {
+    std::vector<unsigned char> bytes;
+
+    void tag (const unsigned char* t) { this->bytes.insert (this->bytes.end (), t, t + tagSize); }
+
+    void unsignedInt (unsigned int value)
+    {
+      for (unsigned int i = 0; i < 4; i++)
+      {
+        this->bytes.push_back (static_cast<unsigned char> (value >> (8 * i)));
+      }
+    }
+
+    void floating (float value)
+    {
+      unsigned int bits;
+      std::memcpy (&bits, &value, sizeof (float));
+      this->unsignedInt (bits);
+    }
+
+    void vec3 (const glm::vec3& v)
+    {
+      this->floating (v.x);
+      this->floating (v.y);
+      this->floating (v.z);
+    }
+
+    void sphere (const PrimSphere& s)
+    {
+      this->vec3 (s.center ());
+      this->floating (s.radius ());
+    }
+
+    // Chunk sizes are 32-bit, i.e. larger chunks are not written and fail the stream instead
+    void writeChunk (std::ostream& stream, const unsigned char* t) const
+    {
+      if (this->bytes.size () > std::numeric_limits<unsigned int>::max ())
+      {
+        stream.setstate (std::ios::failbit);
+        return;
+      }
+      ByteWriter header;
+      header.tag (t);
+      header.unsignedInt (this->bytes.size ());
+
+      stream.write (reinterpret_cast<const char*> (header.bytes.data ()), header.bytes.size ());
+      stream.write (reinterpret_cast<const char*> (this->bytes.data ()), this->bytes.size ());
+    }
+  };
+
+  struct ByteReader
+  {
+    const unsigned char* it;
+    const unsigned char* end;
+    bool                 isValid;
+
+    ByteReader (const unsigned char* i, const unsigned char* e)
+      : it (i)
+      , end (e)
+      , isValid (true)
+    {
+    }
+
+    std::size_t numBytesLeft () const { return std::size_t (this->end - this->it); }
+
+    unsigned int unsignedInt ()
+    {
+      if (this->numBytesLeft () < 4)
+      {
+        this->isValid = false;
+        return 0;
+      }
+      unsigned int value = 0;
+      for (unsigned int i = 0; i < 4; i++)
+      {
+        value |= static_cast<unsigned int> (this->it[i]) << (8 * i);
+      }
+      this->it += 4;
+      return value;
+    }
+
+    float floating ()
+    {
+      const unsigned int bits = this->unsignedInt ();
+      float              value;
+      std::memcpy (&value, &bits, sizeof (float));
+      return value;
+    }
+
+    glm::vec3 vec3 ()
+    {
+      const float x = this->floating ();
+      const float y = this->floating ();
+      const float z = this->floating ();
+      return glm::vec3 (x, y, z);
+    }
+
+    PrimSphere sphere ()
+    {
+      const glm::vec3 center = this->vec3 ();
+      const float     radius = this->floating ();
+      return PrimSphere (center, radius);
+    }
+  };
+
+  // Preorder, i.e. parents precede their children
+  void writeNode (ByteWriter& writer, const SketchNode& node, unsigned int parentIndex,
+                  unsigned int& numNodes)
+  {
+    const unsigned int nodeIndex = numNodes++;
+
+    writer.unsignedInt (parentIndex);
+    writer.sphere (node.data ());
+
+    node.forEachConstChild ([&writer, nodeIndex, &numNodes](const SketchNode& child) {
+      writeNode (writer, child, nodeIndex, numNodes);
+    });
+  }
+
+  bool readMesh (ByteReader& reader, const Dlb::MeshCallback& callback)
+  {
+    const unsigned int numVertices = reader.unsignedInt ();
+    const unsigned int numIndices = reader.unsignedInt ();
+    const std::size_t  dataSize = (24 * std::size_t (numVertices)) + (4 * std::size_t (numIndices));
+
+    if (reader.isValid == false || numIndices % 3 != 0 || reader.numBytesLeft () != dataSize)
+    {
+      return false;
+    }
+
+    Mesh       mesh;
+    ByteReader normals (reader.it + (12 * std::size_t (numVertices)), reader.end);
+
+    mesh.reserveVertices (numVertices);
+    for (unsigned int i = 0; i < numVertices; i++)
+    {
+      const glm::vec3 vertex = reader.vec3 ();
+      mesh.addVertex (vertex, normals.vec3 ());
+    }
+    reader.it = normals.it;
+
+    mesh.reserveIndices (numIndices);
+    for (unsigned int i = 0; i < numIndices; i++)
+    {
+      const unsigned int index = reader.unsignedInt ();
+
+      if (index >= numVertices)
+      {
+        return false;
+      }
+      mesh.addIndex (index);
+    }
+    callback (std::move (mesh));
+    return true;
+  }
+
+  bool readSketch (ByteReader& reader, const Dlb::SketchCallback& callback)
+  {
+    SketchTree               tree;
+    SketchPaths              paths;
+    std::vector<SketchNode*> nodes;
+
+    const unsigned int numNodes = reader.unsignedInt ();
+    if (reader.numBytesLeft () / (4 + sphereSize) < numNodes)
+    {
+      return false;
+    }
+
+    nodes.reserve (numNodes);
+    for (unsigned int i = 0; i < numNodes; i++)
+    {
+      const unsigned int parentIndex = reader.unsignedInt ();
+      const PrimSphere   sphere = reader.sphere ();
+
+      if (i == 0 && parentIndex == Util::invalidIndex ())
+      {
+        nodes.push_back (&tree.emplaceRoot (sphere));
+      }
+      else if (i > 0 && parentIndex < i)
+      {
+        nodes.push_back (&nodes[parentIndex]->emplaceChild (sphere));
+      }
+      else
+      {
+        return false;
+      }
+    }
+
+    const unsigned int numPaths = reader.unsignedInt ();
+    for (unsigned int i = 0; i < numPaths && reader.isValid; i++)
+    {
+      SketchPath         path;
+      const glm::vec3    intersectionFirst = reader.vec3 ();
+      const glm::vec3    intersectionLast = reader.vec3 ();
+      const unsigned int numSpheres = reader.unsignedInt ();
+
+      for (unsigned int j = 0; j < numSpheres && reader.isValid; j++)
+      {
+        const PrimSphere sphere = reader.sphere ();
+        path.addSphere (intersectionFirst, sphere.center (), sphere.radius ());
+      }
+      path.intersectionFirst (intersectionFirst);
+      path.intersectionLast (intersectionLast);
+      paths.push_back (std::move (path));
+    }
+
+    if (reader.isValid && reader.numBytesLeft () == 0)
+    {
+      callback (tree, paths);
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+}
+
+bool Dlb::isDlb (const unsigned char* data, std::size_t size)
+{
+  return size >= headerSize && hasTag (data, magic);
+}
+
+void Dlb::writeHeader (std::ostream& stream)
+{
+  ByteWriter writer;
+  writer.tag (magic);
+  writer.unsignedInt (version);
+
+  stream.write (reinterpret_cast<const char*> (writer.bytes.data ()), writer.bytes.size ());
+}
+
+void Dlb::writeMesh (std::ostream& stream, const Mesh& mesh)
+{
+  ByteWriter writer;
+  writer.bytes.reserve (8 + (24 * std::size_t (mesh.numVertices ())) +
+                       (4 * std::size_t (mesh.numIndices ())));
+
+  writer.unsignedInt (mesh.numVertices ());
+  writer.unsignedInt (mesh.numIndices ());
+
+  for (unsigned int i = 0; i < mesh.numVertices (); i++)
+  {
+    writer.vec3 (mesh.vertex (i));
+  }
+  for (unsigned int i = 0; i < mesh.numVertices (); i++)
+  {
+    writer.vec3 (mesh.normal (i));
+  }
+  for (unsigned int i = 0; i < mesh.numIndices (); i++)
+  {
+    writer.unsignedInt (mesh.index (i));
+  }
+  writer.writeChunk (stream, meshTag);
+}
+
+void Dlb::writeSketch (std::ostream& stream, const SketchTree& tree, const SketchPaths& paths)
+{
+  ByteWriter writer;
+
+  if (tree.hasRoot ())
+  {
+    unsigned int numNodes = 0;
+
+    writer.unsignedInt (tree.root ().numNodes ());
+    writeNode (writer, tree.root (), Util::invalidIndex (), numNodes);
+  }
+  else
+  {
+    writer.unsignedInt (0);
+  }
+
+  const unsigned int numPaths =
+    std::count_if (paths.begin (), paths.end (), [](const SketchPath& p) { return !p.isEmpty (); });
+  writer.unsignedInt (numPaths);
+
+  for (const SketchPath& p : paths)
+  {
+    if (p.isEmpty () == false)
+    {
+      writer.vec3 (p.intersectionFirst ());
+      writer.vec3 (p.intersectionLast ());
+      writer.unsignedInt (p.spheres ().size ());
+
+      for (const PrimSphere& s : p.spheres ())
+      {
+        writer.sphere (s);
+      }
+    }
+  }
+  writer.writeChunk (stream, sketchTag);
+}
+
+bool Dlb::read (const unsigned char* data, std::size_t size, const MeshCallback& meshCallback,
+                const SketchCallback& sketchCallback)
+{
+  if (Dlb::isDlb (data, size) == false)
+  {
+    DILAY_WARN ("not a binary Dilay file")
+    return false;
+  }
+
+  ByteReader         reader (data + tagSize, data + size);
+  const unsigned int fileVersion = reader.unsignedInt ();
+
+  if (fileVersion > version)
+  {
+    DILAY_WARN ("unsupported version %u of binary Dilay file", fileVersion)
+    return false;
+  }
+
+  while (reader.numBytesLeft () > 0)
+  {
+    if (reader.numBytesLeft () < chunkHeaderSize)
+    {
+      DILAY_WARN ("truncated chunk header at offset %zu", std::size_t (reader.it - data))
+      return false;
+    }
+    const unsigned char* tag = reader.it;
+    reader.it += tagSize;
+
+    const unsigned int chunkSize = reader.unsignedInt ();
+    if (chunkSize > reader.numBytesLeft ())
+    {
+      DILAY_WARN ("truncated chunk at offset %zu", std::size_t (tag - data))
+      return false;
+    }
+
+    ByteReader chunk (reader.it, reader.it + chunkSize);
+    reader.it += chunkSize;
+
+    if (hasTag (tag, meshTag) && readMesh (chunk, meshCallback) == false)
+    {
+      DILAY_WARN ("could not read mesh at offset %zu", std::size_t (tag - data))
+      return false;
+    }
+    else if (hasTag (tag, sketchTag) && readSketch (chunk, sketchCallback) == false)
+    {
+      DILAY_WARN ("could not read sketch at offset %zu", std::size_t (tag - data))
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,34 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_DLB
+#define DILAY_DLB
+
+#include <cstddef>
+#include <functional>
+#include <iosfwd>
+#include "sketch/fwd.hpp"
+
+class Mesh;
+
+// `Dlb` reads and writes binary Dilay files. A file consists of a versioned header and a
+// sequence of chunks, each of which holds raw little-endian arrays. Readers decode these arrays
+// element by element into meshes and sketches, so no text is parsed. Readers skip chunks they do
+// not know. Chunks are limited to 4 GiB: writing a larger mesh sets the stream's `failbit`.
+namespace Dlb
+{
+  typedef std::function<void(Mesh&&)>                                MeshCallback;
+  typedef std::function<void(const SketchTree&, const SketchPaths&)> SketchCallback;
+
+  bool isDlb (const unsigned char*, std::size_t);
+  void writeHeader (std::ostream&);
+  void writeMesh (std::ostream&, const Mesh&);
+  void writeSketch (std::ostream&, const SketchTree&, const SketchPaths&);
+
+  // Calls the callbacks for all meshes and sketches in order of appearance. Returns `false` if
+  // the data is malformed, in which case some callbacks might have been called already.
+  bool read (const unsigned char*, std::size_t, const MeshCallback&, const SketchCallback&);
+}
+
+#endif
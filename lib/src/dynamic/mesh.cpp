@@ -5,6 +5,8 @@
 #include <cstring>
 #include <glm/glm.hpp>
 #include <glm/gtx/norm.hpp>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include "../mesh.hpp"
 #include "config.hpp"
@@ -13,6 +15,7 @@
 #include "dynamic/mesh-intersection.hpp"
 #include "dynamic/mesh.hpp"
 #include "dynamic/octree.hpp"
+#include "dynamic/render-chunks.hpp"
 #include "intersection.hpp"
 #include "mesh-util.hpp"
 #include "primitive/aabox.hpp"
@@ -21,9 +24,22 @@
 #include "primitive/triangle.hpp"
 #include "tool/sculpt/util/action.hpp"
 #include "util.hpp"
+#include "varint.hpp"
 
 namespace
 {
+  // Meshes with fewer faces are rendered without chunking
+  const unsigned int minNumChunkedFaces = 100000;
+
+  // Estimated memory of the octree per face, i.e. a node pointer and a hash set entry
+  const std::size_t octreeSizePerFace = 48;
+
+  unsigned int nextRevision ()
+  {
+    static unsigned int revision = 0;
+    return ++revision;
+  }
+
   struct VertexData
   {
     bool                      isFree;
@@ -59,8 +75,127 @@ namespace
     FaceData () { this->reset (); }
     void reset () { this->isFree = true; }
   };
+
+  struct VertexState
+  {
+    unsigned int index;
+    glm::vec3    position;
+    glm::vec3    normal;
+    VertexData   data;
+  };
+
+  struct FaceState
+  {
+    unsigned int index;
+    unsigned int i1, i2, i3;
+    FaceData     data;
+  };
+
+  // Maps floats to integers of the same order, i.e. close floats have close keys
+  unsigned int floatKey (float f)
+  {
+    unsigned int bits;
+    std::memcpy (&bits, &f, sizeof (float));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+  }
+
+  float keyFloat (unsigned int key)
+  {
+    const unsigned int bits = (key & 0x80000000u) ? (key & 0x7fffffffu) : ~key;
+    float              f;
+    std::memcpy (&f, &bits, sizeof (float));
+    return f;
+  }
+
+  // Encodes the difference to the previous value, which is updated afterwards. Differences are
+  // computed modulo 2^32, i.e. they are lossless for all values.
+  void encodeDelta (std::vector<unsigned char>& bytes, unsigned int& previous, unsigned int value)
+  {
+    Varint::encodeSigned (bytes, static_cast<int> (value - previous));
+    previous = value;
+  }
+
+  // Decodes varints until the first error
+  struct ByteReader
+  {
+    const unsigned char* it;
+    const unsigned char* end;
+    bool                 isValid;
+
+    ByteReader (const std::vector<unsigned char>& bytes)
+      : it (bytes.data ())
+      , end (bytes.data () + bytes.size ())
+      , isValid (true)
+    {
+    }
+
+    std::size_t numBytesLeft () const { return this->end - this->it; }
+
+    unsigned int decode ()
+    {
+      unsigned int value = 0;
+      this->isValid = this->isValid && Varint::decode (this->it, this->end, value);
+      return value;
+    }
+
+    unsigned int decodeDelta (unsigned int& previous)
+    {
+      int delta = 0;
+      this->isValid = this->isValid && Varint::decodeSigned (this->it, this->end, delta);
+      previous += static_cast<unsigned int> (delta);
+      return previous;
+    }
+  };
 }
 
+struct DynamicMeshDelta::Impl
+{
+  // sizes and free indices of the mesh
+  unsigned int              numVertices;
+  unsigned int              numFaces;
+  std::vector<unsigned int> freeVertexIndices;
+  std::vector<unsigned int> freeFaceIndices;
+
+  // states of changed elements that were part of the mesh
+  std::vector<VertexState> vertices;
+  std::vector<FaceState>   faces;
+  bool                     isResized;
+
+  // marks elements whose state is already recorded (only used while recording)
+  std::vector<bool> recordedVertices;
+  std::vector<bool> recordedFaces;
+
+  Impl ()
+    : numVertices (0)
+    , numFaces (0)
+    , isResized (false)
+  {
+  }
+
+  bool isEmpty () const
+  {
+    return this->vertices.empty () && this->faces.empty () && this->isResized == false;
+  }
+
+  std::size_t memorySize () const
+  {
+    std::size_t size = (this->freeVertexIndices.capacity () + this->freeFaceIndices.capacity ()) *
+                         sizeof (unsigned int) +
+                       (this->vertices.capacity () * sizeof (VertexState)) +
+                       (this->faces.capacity () * sizeof (FaceState));
+
+    for (const VertexState& s : this->vertices)
+    {
+      size += s.data.adjacentFaces.capacity () * sizeof (unsigned int);
+    }
+    return size;
+  }
+};
+
+DELEGATE_BIG3 (DynamicMeshDelta)
+DELEGATE_CONST (bool, DynamicMeshDelta, isEmpty)
+DELEGATE_CONST (std::size_t, DynamicMeshDelta, memorySize)
+
 struct DynamicMesh::Impl
 {
   DynamicMesh*               self;
@@ -72,14 +207,41 @@ struct DynamicMesh::Impl
   std::vector<unsigned char> faceVisited;
   std::vector<unsigned int>  freeFaceIndices;
   DynamicOctree              octree;
+  DynamicRenderChunks        renderChunks;
+  mutable unsigned int       currentRevision; // 0 if not yet assigned
+
+  // The recorded delta is not passed on to copies
+  struct Recording
+  {
+    DynamicMeshDelta::Impl* delta;
+
+    Recording ()
+      : delta (nullptr)
+    {
+    }
+
+    Recording (const Recording&)
+      : delta (nullptr)
+    {
+    }
+
+    Recording& operator= (const Recording&)
+    {
+      this->delta = nullptr;
+      return *this;
+    }
+  };
+  Recording recording;
 
   Impl (DynamicMesh* s)
     : self (s)
+    , currentRevision (0)
   {
   }
 
   Impl (DynamicMesh* s, const Mesh& m)
     : self (s)
+    , currentRevision (0)
   {
     this->fromMesh (m);
   }
@@ -99,6 +261,18 @@ struct DynamicMesh::Impl
 
   bool isEmpty () const { return this->numFaces () == 0; }
 
+  // Meshes with equal revisions have equal geometry, i.e. copies keep the revision of their
+  // source and modifications reset it. Revisions are assigned on demand only. Changes of the
+  // model matrix are not tracked since transformations are applied by `normalize` eventually.
+  unsigned int revision () const
+  {
+    if (this->currentRevision == 0)
+    {
+      this->currentRevision = nextRevision ();
+    }
+    return this->currentRevision;
+  }
+
   bool isFreeVertex (unsigned int i) const
   {
     assert (i < this->vertexData.size ());
@@ -479,6 +653,8 @@ struct DynamicMesh::Impl
     assert (this->vertexData.size () == this->mesh.numVertices ());
     assert (this->vertexVisited.size () == this->mesh.numVertices ());
 
+    this->currentRevision = 0;
+
     if (this->freeVertexIndices.empty ())
     {
       this->vertexData.emplace_back ();
@@ -489,6 +665,7 @@ struct DynamicMesh::Impl
     else
     {
       const unsigned int index = this->freeVertexIndices.back ();
+      this->recordVertex (index);
       this->mesh.vertex (index, vertex);
       this->mesh.normal (index, normal);
       this->vertexData[index].reset ();
@@ -508,6 +685,7 @@ struct DynamicMesh::Impl
     assert (this->faceData.size () == this->faceVisited.size ());
 
     unsigned int index = Util::invalidIndex ();
+    this->currentRevision = 0;
 
     if (this->freeFaceIndices.empty ())
     {
@@ -522,6 +700,7 @@ struct DynamicMesh::Impl
     else
     {
       index = this->freeFaceIndices.back ();
+      this->recordFace (index);
       this->faceData[index].reset ();
       this->faceVisited[index] = 0;
       this->freeFaceIndices.pop_back ();
@@ -532,12 +711,20 @@ struct DynamicMesh::Impl
     }
     this->faceData[index].isFree = false;
 
+    this->recordVertex (i1);
+    this->recordVertex (i2);
+    this->recordVertex (i3);
     this->vertexData[i1].addAdjacentFace (index);
     this->vertexData[i2].addAdjacentFace (index);
     this->vertexData[i3].addAdjacentFace (index);
 
     this->addFaceToOctree (index);
 
+    if (this->renderChunks.hasLayout ())
+    {
+      this->renderChunks.addFace (index, this->face (index).center ());
+    }
+
     return index;
   }
 
@@ -558,6 +745,9 @@ struct DynamicMesh::Impl
     assert (i < this->vertexData.size ());
     assert (i < this->vertexVisited.size ());
 
+    this->recordVertex (i);
+    this->currentRevision = 0;
+
     std::vector<unsigned int> adjacentFaces = this->vertexData[i].adjacentFaces;
     for (unsigned int f : adjacentFaces)
     {
@@ -573,14 +763,35 @@ struct DynamicMesh::Impl
     assert (i < this->faceData.size ());
     assert (i < this->faceVisited.size ());
 
-    this->vertexData[this->mesh.index ((3 * i) + 0)].deleteAdjacentFace (i);
-    this->vertexData[this->mesh.index ((3 * i) + 1)].deleteAdjacentFace (i);
-    this->vertexData[this->mesh.index ((3 * i) + 2)].deleteAdjacentFace (i);
+    unsigned int i1, i2, i3;
+    this->vertexIndices (i, i1, i2, i3);
+
+    this->recordFace (i);
+    this->recordVertex (i1);
+    this->recordVertex (i2);
+    this->recordVertex (i3);
+    this->currentRevision = 0;
+    this->vertexData[i1].deleteAdjacentFace (i);
+    this->vertexData[i2].deleteAdjacentFace (i);
+    this->vertexData[i3].deleteAdjacentFace (i);
 
     this->faceData[i].reset ();
     this->faceVisited[i] = 0;
     this->freeFaceIndices.push_back (i);
     this->octree.deleteElement (i);
+    this->renderChunks.deleteFace (i);
+  }
+
+  void vertex (unsigned int i, const glm::vec3& v)
+  {
+    this->recordVertex (i);
+    this->currentRevision = 0;
+    this->mesh.vertex (i, v);
+
+    for (unsigned int f : this->vertexData[i].adjacentFaces)
+    {
+      this->renderChunks.invalidateBounds (f);
+    }
   }
 
   void vertexNormal (unsigned int i, const glm::vec3& n)
@@ -588,6 +799,8 @@ struct DynamicMesh::Impl
     assert (this->isFreeVertex (i) == false);
     assert (this->mesh.numVertices () == this->vertexData.size ());
 
+    this->recordVertex (i);
+    this->currentRevision = 0;
     this->mesh.normal (i, n);
   }
 
@@ -595,6 +808,8 @@ struct DynamicMesh::Impl
   {
     const glm::vec3 avg = this->averageNormal (i);
 
+    this->recordVertex (i);
+    this->currentRevision = 0;
     if (Util::isNaN (avg))
     {
       this->mesh.normal (i, glm::vec3 (0.0f));
@@ -612,6 +827,9 @@ struct DynamicMesh::Impl
 
   void reset ()
   {
+    assert (this->recording.delta == nullptr);
+
+    this->currentRevision = 0;
     this->mesh.reset ();
     this->vertexData.clear ();
     this->vertexVisited.clear ();
@@ -620,6 +838,7 @@ struct DynamicMesh::Impl
     this->faceVisited.clear ();
     this->freeFaceIndices.clear ();
     this->octree.reset ();
+    this->renderChunks.reset ();
   }
 
   void fromMesh (const Mesh& mesh)
@@ -640,7 +859,7 @@ struct DynamicMesh::Impl
       this->addFace (mesh.index (i), mesh.index (i + 1), mesh.index (i + 2));
     }
     this->setAllNormals ();
-    this->mesh.bufferData ();
+    this->bufferData ();
   }
 
   void realignFace (unsigned int i)
@@ -671,10 +890,405 @@ struct DynamicMesh::Impl
     this->octree.shrinkRoot ();
   }
 
+  VertexState vertexState (unsigned int i) const
+  {
+    return VertexState{i, this->mesh.vertex (i), this->mesh.normal (i), this->vertexData[i]};
+  }
+
+  FaceState faceState (unsigned int i) const
+  {
+    return FaceState{i, this->mesh.index ((3 * i) + 0), this->mesh.index ((3 * i) + 1),
+                     this->mesh.index ((3 * i) + 2), this->faceData[i]};
+  }
+
+  void record (DynamicMeshDelta::Impl& delta)
+  {
+    assert (this->recording.delta == nullptr);
+    assert (delta.isEmpty ());
+
+    delta.numVertices = this->vertexData.size ();
+    delta.numFaces = this->faceData.size ();
+    delta.freeVertexIndices = this->freeVertexIndices;
+    delta.freeFaceIndices = this->freeFaceIndices;
+    delta.recordedVertices.assign (delta.numVertices, false);
+    delta.recordedFaces.assign (delta.numFaces, false);
+
+    this->recording.delta = &delta;
+  }
+
+  void stopRecording ()
+  {
+    assert (this->recording.delta);
+
+    DynamicMeshDelta::Impl& delta = *this->recording.delta;
+
+    delta.isResized =
+      delta.numVertices != this->vertexData.size () || delta.numFaces != this->faceData.size ();
+    delta.recordedVertices = std::vector<bool> ();
+    delta.recordedFaces = std::vector<bool> ();
+
+    this->recording.delta = nullptr;
+  }
+
+  // Elements that are appended while recording are not recorded since they are removed by
+  // shrinking the mesh to its recorded size.
+  void recordVertex (unsigned int i)
+  {
+    DynamicMeshDelta::Impl* delta = this->recording.delta;
+
+    if (delta && i < delta->numVertices && delta->recordedVertices[i] == false)
+    {
+      delta->recordedVertices[i] = true;
+      delta->vertices.push_back (this->vertexState (i));
+    }
+  }
+
+  void recordFace (unsigned int i)
+  {
+    DynamicMeshDelta::Impl* delta = this->recording.delta;
+
+    if (delta && i < delta->numFaces && delta->recordedFaces[i] == false)
+    {
+      delta->recordedFaces[i] = true;
+      delta->faces.push_back (this->faceState (i));
+    }
+  }
+
+  void resize (unsigned int numVertices, unsigned int numFaces)
+  {
+    if (numVertices < this->mesh.numVertices ())
+    {
+      this->mesh.shrinkVertices (numVertices);
+    }
+    while (this->mesh.numVertices () < numVertices)
+    {
+      this->mesh.addVertex (glm::vec3 (0.0f), glm::vec3 (0.0f));
+    }
+    this->vertexData.resize (numVertices);
+    this->vertexVisited.resize (numVertices, 0);
+
+    if (3 * numFaces < this->mesh.numIndices ())
+    {
+      this->mesh.shrinkIndices (3 * numFaces);
+    }
+    while (this->mesh.numIndices () < 3 * numFaces)
+    {
+      this->mesh.addIndex (0);
+    }
+    this->faceData.resize (numFaces);
+    this->faceVisited.resize (numFaces, 0);
+  }
+
+  // The current states of all elements that are affected by the delta are moved into its
+  // inverse before they are overwritten, i.e. the octree is only updated locally.
+  void applyDelta (DynamicMeshDelta::Impl& delta)
+  {
+    assert (this->recording.delta == nullptr);
+
+    this->currentRevision = 0;
+
+    const unsigned int numVertices = this->vertexData.size ();
+    const unsigned int numFaces = this->faceData.size ();
+
+    DynamicMeshDelta::Impl inverse;
+    inverse.numVertices = numVertices;
+    inverse.numFaces = numFaces;
+    inverse.isResized = numVertices != delta.numVertices || numFaces != delta.numFaces;
+    inverse.freeVertexIndices = std::move (this->freeVertexIndices);
+    inverse.freeFaceIndices = std::move (this->freeFaceIndices);
+
+    const auto takeVertex = [this, &inverse](unsigned int i) {
+      inverse.vertices.push_back (VertexState{i, this->mesh.vertex (i), this->mesh.normal (i),
+                                              std::move (this->vertexData[i])});
+    };
+    const auto takeFace = [this, &inverse](unsigned int i) {
+      if (this->isFreeFace (i) == false)
+      {
+        this->octree.deleteElement (i);
+        this->renderChunks.deleteFace (i);
+      }
+      inverse.faces.push_back (this->faceState (i));
+    };
+
+    for (const VertexState& s : delta.vertices)
+    {
+      if (s.index < numVertices)
+      {
+        takeVertex (s.index);
+      }
+    }
+    for (unsigned int i = delta.numVertices; i < numVertices; i++)
+    {
+      takeVertex (i);
+    }
+    for (const FaceState& s : delta.faces)
+    {
+      if (s.index < numFaces)
+      {
+        takeFace (s.index);
+      }
+    }
+    for (unsigned int i = delta.numFaces; i < numFaces; i++)
+    {
+      takeFace (i);
+    }
+
+    this->resize (delta.numVertices, delta.numFaces);
+
+    for (VertexState& s : delta.vertices)
+    {
+      this->mesh.vertex (s.index, s.position);
+      this->mesh.normal (s.index, s.normal);
+      this->vertexData[s.index] = std::move (s.data);
+    }
+    for (const FaceState& s : delta.faces)
+    {
+      this->mesh.index ((3 * s.index) + 0, s.i1);
+      this->mesh.index ((3 * s.index) + 1, s.i2);
+      this->mesh.index ((3 * s.index) + 2, s.i3);
+      this->faceData[s.index] = s.data;
+    }
+    this->freeVertexIndices = std::move (delta.freeVertexIndices);
+    this->freeFaceIndices = std::move (delta.freeFaceIndices);
+
+    for (const FaceState& s : delta.faces)
+    {
+      if (s.data.isFree == false)
+      {
+        this->addFaceToOctree (s.index);
+
+        if (this->renderChunks.hasLayout ())
+        {
+          this->renderChunks.addFace (s.index, this->face (s.index).center ());
+        }
+      }
+    }
+    for (const VertexState& s : delta.vertices)
+    {
+      for (unsigned int f : this->vertexData[s.index].adjacentFaces)
+      {
+        this->realignFace (f);
+        this->renderChunks.invalidateBounds (f);
+      }
+    }
+    this->sanitize ();
+
+    delta = std::move (inverse);
+  }
+
+  // Positions are encoded as differences of order-preserving keys of their components, indices
+  // as differences of successive indices. Free elements and the order of the free lists are
+  // kept, i.e. positions, indices, free lists and the revision of a decoded mesh equal those of
+  // the encoded mesh. Normals are not encoded but recomputed when decoding, so they may differ
+  // from normals that were set explicitly.
+  void toBytes (std::vector<unsigned char>& bytes) const
+  {
+    const unsigned int numVertices = this->vertexData.size ();
+    const unsigned int numFaces = this->faceData.size ();
+    unsigned int       previous;
+
+    bytes.clear ();
+    bytes.reserve ((3 * numVertices) + (3 * numFaces));
+
+    Varint::encode (bytes, this->revision ());
+    Varint::encode (bytes, numVertices);
+    Varint::encode (bytes, numFaces);
+
+    const auto encodeIndices = [&bytes, &previous](const std::vector<unsigned int>& indices) {
+      Varint::encode (bytes, indices.size ());
+      previous = 0;
+      for (unsigned int i : indices)
+      {
+        encodeDelta (bytes, previous, i);
+      }
+    };
+    encodeIndices (this->freeVertexIndices);
+    encodeIndices (this->freeFaceIndices);
+
+    for (unsigned int c = 0; c < 3; c++)
+    {
+      previous = floatKey (0.0f);
+      for (unsigned int i = 0; i < numVertices; i++)
+      {
+        encodeDelta (bytes, previous, floatKey (this->mesh.vertex (i)[c]));
+      }
+    }
+
+    previous = 0;
+    for (unsigned int i = 0; i < 3 * numFaces; i++)
+    {
+      encodeDelta (bytes, previous, this->mesh.index (i));
+    }
+
+    const glm::vec3    scaling = this->mesh.scaling ();
+    const glm::mat4x4& rotation = this->mesh.rotationMatrix ();
+    const glm::vec3    position = this->mesh.position ();
+
+    for (unsigned int c = 0; c < 3; c++)
+    {
+      Varint::encode (bytes, floatKey (scaling[c]));
+      Varint::encode (bytes, floatKey (position[c]));
+    }
+    for (unsigned int c = 0; c < 4; c++)
+    {
+      for (unsigned int r = 0; r < 4; r++)
+      {
+        Varint::encode (bytes, floatKey (rotation[c][r]));
+      }
+    }
+  }
+
+  bool fromBytes (const std::vector<unsigned char>& bytes)
+  {
+    this->reset ();
+
+    ByteReader         reader (bytes);
+    const unsigned int revision = reader.decode ();
+    const unsigned int numVertices = reader.decode ();
+    const unsigned int numFaces = reader.decode ();
+    unsigned int       previous;
+
+    // every encoded value takes at least one byte
+    if (reader.isValid == false ||
+        (3 * std::size_t (numVertices)) + (3 * std::size_t (numFaces)) > reader.numBytesLeft ())
+    {
+      return false;
+    }
+    this->mesh.reserveVertices (numVertices);
+    this->mesh.reserveIndices (3 * numFaces);
+    this->resize (numVertices, numFaces);
+
+    const auto decodeIndices = [&reader, &previous](std::vector<unsigned int>& indices,
+                                                    unsigned int                size) {
+      const unsigned int n = reader.decode ();
+
+      previous = 0;
+      for (unsigned int i = 0; i < n && reader.isValid; i++)
+      {
+        indices.push_back (reader.decodeDelta (previous));
+        reader.isValid = reader.isValid && indices.back () < size;
+      }
+    };
+    decodeIndices (this->freeVertexIndices, numVertices);
+    decodeIndices (this->freeFaceIndices, numFaces);
+
+    for (unsigned int c = 0; c < 3 && reader.isValid; c++)
+    {
+      previous = floatKey (0.0f);
+      for (unsigned int i = 0; i < numVertices; i++)
+      {
+        glm::vec3 v = this->mesh.vertex (i);
+        v[c] = keyFloat (reader.decodeDelta (previous));
+        this->mesh.vertex (i, v);
+      }
+    }
+
+    previous = 0;
+    for (unsigned int i = 0; i < 3 * numFaces && reader.isValid; i++)
+    {
+      this->mesh.index (i, reader.decodeDelta (previous));
+    }
+
+    glm::vec3   scaling, position;
+    glm::mat4x4 rotation;
+
+    for (unsigned int c = 0; c < 3; c++)
+    {
+      scaling[c] = keyFloat (reader.decode ());
+      position[c] = keyFloat (reader.decode ());
+    }
+    for (unsigned int c = 0; c < 4; c++)
+    {
+      for (unsigned int r = 0; r < 4; r++)
+      {
+        rotation[c][r] = keyFloat (reader.decode ());
+      }
+    }
+
+    if (reader.isValid == false || reader.numBytesLeft () > 0)
+    {
+      this->reset ();
+      return false;
+    }
+    this->mesh.scaling (scaling);
+    this->mesh.rotationMatrix (rotation);
+    this->mesh.position (position);
+
+    for (unsigned int i = 0; i < numVertices; i++)
+    {
+      this->vertexData[i].isFree = false;
+    }
+    for (unsigned int i = 0; i < numFaces; i++)
+    {
+      this->faceData[i].isFree = false;
+    }
+    for (unsigned int i : this->freeVertexIndices)
+    {
+      reader.isValid = reader.isValid && this->vertexData[i].isFree == false;
+      this->vertexData[i].isFree = true;
+    }
+    for (unsigned int i : this->freeFaceIndices)
+    {
+      reader.isValid = reader.isValid && this->faceData[i].isFree == false;
+      this->faceData[i].isFree = true;
+    }
+
+    for (unsigned int i = 0; i < numFaces && reader.isValid; i++)
+    {
+      if (this->isFreeFace (i) == false)
+      {
+        unsigned int i1, i2, i3;
+        this->vertexIndices (i, i1, i2, i3);
+
+        reader.isValid = i1 < numVertices && i2 < numVertices && i3 < numVertices &&
+                         this->isFreeVertex (i1) == false && this->isFreeVertex (i2) == false &&
+                         this->isFreeVertex (i3) == false;
+        if (reader.isValid == false)
+        {
+          break;
+        }
+        this->vertexData[i1].addAdjacentFace (i);
+        this->vertexData[i2].addAdjacentFace (i);
+        this->vertexData[i3].addAdjacentFace (i);
+        this->addFaceToOctree (i);
+      }
+    }
+
+    if (reader.isValid == false)
+    {
+      this->reset ();
+      return false;
+    }
+    this->setAllNormals ();
+    this->currentRevision = revision;
+    return true;
+  }
+
+  // The size of the octree is estimated
+  std::size_t memorySize () const
+  {
+    std::size_t size =
+      (2 * this->mesh.numVertices () * sizeof (glm::vec3)) +
+      (this->mesh.numIndices () * sizeof (unsigned int)) +
+      (this->vertexData.capacity () * sizeof (VertexData)) + this->vertexVisited.capacity () +
+      (this->faceData.capacity () * sizeof (FaceData)) + this->faceVisited.capacity () +
+      ((this->freeVertexIndices.capacity () + this->freeFaceIndices.capacity ()) *
+       sizeof (unsigned int));
+
+    // every face is adjacent to three vertices
+    size += 3 * this->numFaces () * sizeof (unsigned int);
+    size += this->numFaces () * octreeSizePerFace;
+    return size;
+  }
+
   void prune (std::vector<unsigned int>* pVertexIndexMap, std::vector<unsigned int>* pFaceIndexMap)
   {
+    assert (this->recording.delta == nullptr);
+
     if (this->isPruned () == false)
     {
+      this->currentRevision = 0;
+
       std::vector<unsigned int> defaultVertexIndexMap;
       std::vector<unsigned int> defaultFaceIndexMap;
 
@@ -755,6 +1369,23 @@ struct DynamicMesh::Impl
       assert (this->numFaces () == newNumFaces);
 
       this->octree.updateIndices (*pFaceIndexMap);
+
+      if (this->renderChunks.hasLayout ())
+      {
+        this->renderChunks.updateIndices (*pFaceIndexMap);
+
+        for (unsigned int i = 0; i < pVertexIndexMap->size (); i++)
+        {
+          const unsigned int newV = pVertexIndexMap->at (i);
+          if (newV != Util::invalidIndex () && newV != i)
+          {
+            for (unsigned int f : this->vertexData[newV].adjacentFaces)
+            {
+              this->renderChunks.invalidateIndices (f);
+            }
+          }
+        }
+      }
     }
   }
 
@@ -785,6 +1416,80 @@ struct DynamicMesh::Impl
     }
   }
 
+  // Checks the same as `pruneAndCheckConsistency` but neither prunes nor buffers the mesh, i.e.
+  // indices of recorded deltas stay valid and the check runs in any thread.
+  bool checkConsistency () const
+  {
+    if (this->numVertices () == 0)
+    {
+      DILAY_WARN ("empty mesh");
+      return false;
+    }
+
+    const auto contains = [this](unsigned int f, unsigned int v) {
+      unsigned int i1, i2, i3;
+      this->vertexIndices (f, i1, i2, i3);
+      return v == i1 || v == i2 || v == i3;
+    };
+
+    const auto numEdgeAdjacentFaces = [this, &contains](unsigned int v1, unsigned int v2) {
+      unsigned int n = 0;
+      for (unsigned int f : this->vertexData[v1].adjacentFaces)
+      {
+        n += contains (f, v2) ? 1 : 0;
+      }
+      return n;
+    };
+
+    for (unsigned int v = 0; v < this->vertexData.size (); v++)
+    {
+      if (this->isFreeVertex (v) == false)
+      {
+        if (this->valence (v) < 3)
+        {
+          DILAY_WARN ("inconsistent vertex %u with %u adjacent faces", v, this->valence (v));
+          return false;
+        }
+        for (unsigned int f : this->vertexData[v].adjacentFaces)
+        {
+          if (f >= this->faceData.size () || this->isFreeFace (f) || contains (f, v) == false)
+          {
+            DILAY_WARN ("vertex %u has an inconsistent adjacent face %u", v, f);
+            return false;
+          }
+        }
+      }
+    }
+
+    for (unsigned int f = 0; f < this->faceData.size (); f++)
+    {
+      if (this->isFreeFace (f) == false)
+      {
+        unsigned int i[3];
+        this->vertexIndices (f, i[0], i[1], i[2]);
+
+        for (unsigned int j = 0; j < 3; j++)
+        {
+          const unsigned int v1 = i[j];
+          const unsigned int v2 = i[(j + 1) % 3];
+
+          if (v1 >= this->vertexData.size () || this->isFreeVertex (v1))
+          {
+            DILAY_WARN ("face %u has an inconsistent vertex %u", f, v1);
+            return false;
+          }
+          else if (numEdgeAdjacentFaces (v1, v2) != 2)
+          {
+            DILAY_WARN ("inconsistent edge (%u,%u) with %u adjacent faces", v1, v2,
+                        numEdgeAdjacentFaces (v1, v2));
+            return false;
+          }
+        }
+      }
+    }
+    return true;
+  }
+
   bool mirror (const PrimPlane& plane)
   {
     assert (this->pruneAndCheckConsistency (nullptr, nullptr));
@@ -833,6 +1538,26 @@ struct DynamicMesh::Impl
   }
 
   void bufferData ()
+  {
+    if (this->renderChunks.hasLayout () == false && this->numFaces () >= minNumChunkedFaces)
+    {
+      this->renderChunks.setupLayout (this->mesh.bounds ());
+      this->forEachFace (
+        [this](unsigned int i) { this->renderChunks.addFace (i, this->face (i).center ()); });
+    }
+
+    if (this->renderChunks.hasLayout ())
+    {
+      this->mesh.bufferData (false);
+      this->renderChunks.bufferData (this->mesh);
+    }
+    else
+    {
+      this->bufferDataWithoutChunks ();
+    }
+  }
+
+  void bufferDataWithoutChunks ()
   {
     const auto findNonFreeFaceIndex = [this]() -> unsigned int {
       assert (this->numFaces () > 0);
@@ -861,9 +1586,27 @@ struct DynamicMesh::Impl
     this->mesh.bufferData ();
   }
 
+  void releaseBuffers ()
+  {
+    this->mesh.releaseBuffers ();
+    this->renderChunks.releaseBuffers ();
+  }
+
+  unsigned int bufferSize () const
+  {
+    return this->mesh.bufferSize () + this->renderChunks.bufferSize ();
+  }
+
   void render (Camera& camera) const
   {
-    this->mesh.render (camera);
+    if (this->renderChunks.hasLayout ())
+    {
+      this->renderChunks.render (camera, this->mesh);
+    }
+    else
+    {
+      this->mesh.render (camera);
+    }
 #ifdef DILAY_RENDER_OCTREE
     this->octree.render (camera);
 #endif
@@ -907,6 +1650,92 @@ struct DynamicMesh::Impl
     return intersection.isIntersection ();
   }
 
+  // Faces that are unchanged since recording started are found by the octree. Changed faces and
+  // faces of changed vertices are tested in their recorded state, i.e. the cost depends on the
+  // number of changes but not on the size of the mesh.
+  bool intersectsOriginal (const PrimRay& ray, Intersection& intersection) const
+  {
+    const DynamicMeshDelta::Impl* delta = this->recording.delta;
+
+    if (delta == nullptr)
+    {
+      return this->intersects (ray, intersection, false);
+    }
+
+    const auto isUnchanged = [this, delta](unsigned int i) -> bool {
+      if (i >= delta->numFaces || delta->recordedFaces[i])
+      {
+        return false;
+      }
+      unsigned int i1, i2, i3;
+      this->vertexIndices (i, i1, i2, i3);
+
+      return delta->recordedVertices[i1] == false && delta->recordedVertices[i2] == false &&
+             delta->recordedVertices[i3] == false;
+    };
+
+    this->octree.intersects (
+      ray, [this, &ray, &intersection, &isUnchanged](unsigned int i) -> float {
+        const PrimTriangle tri = this->face (i);
+        float              t;
+
+        if (isUnchanged (i) && IntersectionUtil::intersects (ray, tri, false, &t))
+        {
+          intersection.update (t, ray.pointAt (t), tri.normal ());
+          return t;
+        }
+        else
+        {
+          return Util::maxFloat ();
+        }
+      });
+
+    std::unordered_map<unsigned int, const glm::vec3*> originalPositions;
+    for (const VertexState& s : delta->vertices)
+    {
+      originalPositions.emplace (s.index, &s.position);
+    }
+
+    const auto originalPosition = [this, &originalPositions](unsigned int i) -> const glm::vec3& {
+      const auto it = originalPositions.find (i);
+      return it == originalPositions.end () ? this->mesh.vertex (i) : *it->second;
+    };
+
+    const auto intersectsOriginalFace = [&ray, &intersection, &originalPosition](
+                                          unsigned int i1, unsigned int i2, unsigned int i3) {
+      const PrimTriangle tri (originalPosition (i1), originalPosition (i2), originalPosition (i3));
+      float              t;
+
+      if (IntersectionUtil::intersects (ray, tri, false, &t))
+      {
+        intersection.update (t, ray.pointAt (t), tri.normal ());
+      }
+    };
+
+    for (const FaceState& s : delta->faces)
+    {
+      if (s.data.isFree == false)
+      {
+        intersectsOriginalFace (s.i1, s.i2, s.i3);
+      }
+    }
+
+    // unchanged faces of changed vertices keep their vertex indices
+    std::unordered_set<unsigned int> testedFaces;
+    for (const VertexState& s : delta->vertices)
+    {
+      for (unsigned int f : s.data.adjacentFaces)
+      {
+        if (delta->recordedFaces[f] == false && testedFaces.insert (f).second)
+        {
+          intersectsOriginalFace (this->mesh.index ((3 * f) + 0), this->mesh.index ((3 * f) + 1),
+                                  this->mesh.index ((3 * f) + 2));
+        }
+      }
+    }
+    return intersection.isIntersection ();
+  }
+
   template <typename T, typename... Ts>
   bool intersectsT (const T& t, DynamicFaces& faces, const Ts&... args) const
   {
@@ -954,10 +1783,34 @@ struct DynamicMesh::Impl
       pos, [this, &pos](unsigned int i) { return Distance::distance (this->face (i), pos); });
   }
 
+  // Successive positions are usually close to each other, i.e. the distance of the previous
+  // position plus the distance between both positions is a tight bound for the search.
+  void unsignedDistances (const std::vector<glm::vec3>& positions,
+                          std::vector<float>&           distances) const
+  {
+    assert (positions.size () == distances.size ());
+
+    for (unsigned int i = 0; i < positions.size (); i++)
+    {
+      const glm::vec3& pos = positions[i];
+      const float      maxDistance =
+        i == 0 ? Util::maxFloat ()
+               : distances[i - 1] + glm::distance (positions[i - 1], pos) + Util::epsilon ();
+
+      distances[i] = this->octree.distance (pos, maxDistance, [this, &pos](unsigned int f) {
+        return Distance::distance (this->face (f), pos);
+      });
+    }
+  }
+
   void normalize ()
   {
+    assert (this->recording.delta == nullptr);
+
+    this->currentRevision = 0;
     this->mesh.normalize ();
     this->octree.reset ();
+    this->renderChunks.reset ();
 
     this->forEachFace ([this](unsigned int i) { this->addFaceToOctree (i); });
   }
@@ -976,6 +1829,7 @@ DELEGATE1_CONSTRUCTOR_SELF (DynamicMesh, const Mesh&)
 DELEGATE_CONST (unsigned int, DynamicMesh, numVertices)
 DELEGATE_CONST (unsigned int, DynamicMesh, numFaces)
 DELEGATE_CONST (bool, DynamicMesh, isEmpty)
+DELEGATE_CONST (unsigned int, DynamicMesh, revision)
 DELEGATE1_CONST (bool, DynamicMesh, isFreeVertex, unsigned int)
 DELEGATE1_CONST (bool, DynamicMesh, isFreeFace, unsigned int)
 DELEGATE1_MEMBER_CONST (const glm::vec3&, DynamicMesh, vertex, mesh, unsigned int)
@@ -987,6 +1841,8 @@ DELEGATE1_CONST (const glm::vec3&, DynamicMesh, vertexNormal, unsigned int)
 DELEGATE1_CONST (glm::vec3, DynamicMesh, faceNormal, unsigned int)
 DELEGATE1_CONST (const std::vector<unsigned int>&, DynamicMesh, adjacentFaces, unsigned int)
 GETTER_CONST (const Mesh&, DynamicMesh, mesh)
+GETTER_CONST (const std::vector<unsigned int>&, DynamicMesh, freeVertexIndices)
+GETTER_CONST (const std::vector<unsigned int>&, DynamicMesh, freeFaceIndices)
 DELEGATE1 (void, DynamicMesh, forEachVertex, const std::function<void(unsigned int)>&)
 DELEGATE2 (void, DynamicMesh, forEachVertex, const DynamicFaces&,
            const std::function<void(unsigned int)>&)
@@ -1010,7 +1866,7 @@ DELEGATE2 (unsigned int, DynamicMesh, addVertex, const glm::vec3&, const glm::ve
 DELEGATE3 (unsigned int, DynamicMesh, addFace, unsigned int, unsigned int, unsigned int)
 DELEGATE1 (void, DynamicMesh, deleteVertex, unsigned int)
 DELEGATE1 (void, DynamicMesh, deleteFace, unsigned int)
-DELEGATE2_MEMBER (void, DynamicMesh, vertex, mesh, unsigned int, const glm::vec3&)
+DELEGATE2 (void, DynamicMesh, vertex, unsigned int, const glm::vec3&)
 DELEGATE2 (void, DynamicMesh, vertexNormal, unsigned int, const glm::vec3&)
 DELEGATE1 (void, DynamicMesh, setVertexNormal, unsigned int)
 DELEGATE (void, DynamicMesh, setAllNormals)
@@ -1020,21 +1876,30 @@ DELEGATE1 (void, DynamicMesh, realignFace, unsigned int)
 DELEGATE1 (void, DynamicMesh, realignFaces, const DynamicFaces&)
 DELEGATE (void, DynamicMesh, realignAllFaces)
 DELEGATE (void, DynamicMesh, sanitize)
+DELEGATE (void, DynamicMesh, stopRecording)
+DELEGATE1_CONST (void, DynamicMesh, toBytes, std::vector<unsigned char>&)
+DELEGATE1 (bool, DynamicMesh, fromBytes, const std::vector<unsigned char>&)
 DELEGATE2 (void, DynamicMesh, prune, std::vector<unsigned int>*, std::vector<unsigned int>*)
 DELEGATE2 (bool, DynamicMesh, pruneAndCheckConsistency, std::vector<unsigned int>*,
            std::vector<unsigned int>*)
+DELEGATE_CONST (bool, DynamicMesh, checkConsistency)
 DELEGATE1 (bool, DynamicMesh, mirror, const PrimPlane&)
 DELEGATE (void, DynamicMesh, bufferData)
+DELEGATE (void, DynamicMesh, releaseBuffers)
+DELEGATE_CONST (unsigned int, DynamicMesh, bufferSize)
 DELEGATE1_CONST (void, DynamicMesh, render, Camera&)
 DELEGATE_MEMBER_CONST (const RenderMode&, DynamicMesh, renderMode, mesh)
 DELEGATE_MEMBER (RenderMode&, DynamicMesh, renderMode, mesh)
 
 DELEGATE3_CONST (bool, DynamicMesh, intersects, const PrimRay&, Intersection&, bool)
 DELEGATE2 (bool, DynamicMesh, intersects, const PrimRay&, DynamicMeshIntersection&)
+DELEGATE2_CONST (bool, DynamicMesh, intersectsOriginal, const PrimRay&, Intersection&)
 DELEGATE2_CONST (bool, DynamicMesh, intersects, const PrimPlane&, DynamicFaces&)
 DELEGATE2_CONST (bool, DynamicMesh, intersects, const PrimSphere&, DynamicFaces&)
 DELEGATE2_CONST (bool, DynamicMesh, intersects, const PrimAABox&, DynamicFaces&)
 DELEGATE1_CONST (float, DynamicMesh, unsignedDistance, const glm::vec3&)
+DELEGATE2_CONST (void, DynamicMesh, unsignedDistances, const std::vector<glm::vec3>&,
+                 std::vector<float>&)
 
 DELEGATE (void, DynamicMesh, normalize)
 DELEGATE1_MEMBER (void, DynamicMesh, scale, mesh, const glm::vec3&)
@@ -1059,6 +1924,7 @@ DELEGATE1_MEMBER (void, DynamicMesh, color, mesh, const Color&)
 DELEGATE_MEMBER_CONST (const Color&, DynamicMesh, wireframeColor, mesh)
 DELEGATE1_MEMBER (void, DynamicMesh, wireframeColor, mesh, const Color&)
 
+DELEGATE_CONST (std::size_t, DynamicMesh, memorySize)
 DELEGATE_CONST (void, DynamicMesh, printStatistics)
 DELEGATE1 (void, DynamicMesh, runFromConfig, const Config&)
 
@@ -1068,3 +1934,7 @@ void DynamicMesh::findAdjacent (unsigned int e1, unsigned int e2, unsigned int&
 {
   return this->impl->findAdjacent (e1, e2, leftFace, leftVertex, rightFace, rightVertex);
 }
+
+void DynamicMesh::record (DynamicMeshDelta& delta) { this->impl->record (*delta.impl); }
+
+void DynamicMesh::applyDelta (DynamicMeshDelta& delta) { this->impl->applyDelta (*delta.impl); }
@@ -5,6 +5,7 @@
 #ifndef DILAY_DYNAMIC_MESH
 #define DILAY_DYNAMIC_MESH
 
+#include <cstddef>
 #include <functional>
 #include <glm/fwd.hpp>
 #include <vector>
@@ -24,6 +25,22 @@ class PrimSphere;
 class PrimTriangle;
 class RenderMode;
 
+// `DynamicMeshDelta` stores the original state of all elements of a `DynamicMesh` that were
+// changed while it was recording. Applying a delta restores this state and turns the delta into
+// its inverse, i.e. applying a delta twice leaves the mesh unchanged.
+class DynamicMeshDelta
+{
+public:
+  DECLARE_BIG3 (DynamicMeshDelta)
+
+  bool        isEmpty () const;
+  std::size_t memorySize () const;
+
+private:
+  friend class DynamicMesh;
+  IMPLEMENTATION
+};
+
 class DynamicMesh : public Configurable
 {
 public:
@@ -33,6 +50,7 @@ public:
   unsigned int     numVertices () const;
   unsigned int     numFaces () const;
   bool             isEmpty () const;
+  unsigned int     revision () const;
   bool             isFreeVertex (unsigned int) const;
   bool             isFreeFace (unsigned int) const;
   const glm::vec3& vertex (unsigned int) const;
@@ -63,6 +81,11 @@ public:
   float     averageEdgeLengthSqr (unsigned int) const;
 
   const Mesh&  mesh () const;
+
+  // indices of free elements of `mesh`, i.e. elements that are not part of the dynamic mesh
+  const std::vector<unsigned int>& freeVertexIndices () const;
+  const std::vector<unsigned int>& freeFaceIndices () const;
+
   unsigned int addVertex (const glm::vec3&, const glm::vec3&);
   unsigned int addFace (unsigned int, unsigned int, unsigned int);
   void         deleteVertex (unsigned int);
@@ -79,11 +102,19 @@ public:
   void realignFaces (const DynamicFaces&);
   void realignAllFaces ();
   void sanitize ();
+  void record (DynamicMeshDelta&);
+  void stopRecording ();
+  void applyDelta (DynamicMeshDelta&);
+  void toBytes (std::vector<unsigned char>&) const;
+  bool fromBytes (const std::vector<unsigned char>&);
   void prune (std::vector<unsigned int>* = nullptr, std::vector<unsigned int>* = nullptr);
   bool pruneAndCheckConsistency (std::vector<unsigned int>* = nullptr,
                                  std::vector<unsigned int>* = nullptr);
+  bool checkConsistency () const;
   bool mirror (const PrimPlane&);
-  void bufferData ();
+  void         bufferData ();
+  void         releaseBuffers ();
+  unsigned int bufferSize () const;
 
   void render (Camera&) const;
 
@@ -92,10 +123,12 @@ public:
 
   bool  intersects (const PrimRay&, Intersection&, bool = false) const;
   bool  intersects (const PrimRay&, DynamicMeshIntersection&);
+  bool  intersectsOriginal (const PrimRay&, Intersection&) const;
   bool  intersects (const PrimPlane&, DynamicFaces&) const;
   bool  intersects (const PrimSphere&, DynamicFaces&) const;
   bool  intersects (const PrimAABox&, DynamicFaces&) const;
   float unsignedDistance (const glm::vec3&) const;
+  void  unsignedDistances (const std::vector<glm::vec3>&, std::vector<float>&) const;
 
   void               normalize ();
   void               scale (const glm::vec3&);
@@ -120,7 +153,8 @@ public:
   const Color&       wireframeColor () const;
   void               wireframeColor (const Color&);
 
-  void printStatistics () const;
+  std::size_t memorySize () const;
+  void        printStatistics () const;
 
 private:
   IMPLEMENTATION
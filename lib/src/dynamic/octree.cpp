@@ -385,6 +385,9 @@ struct DynamicOctree::Impl
     this->makeElementNodeMap ();
   }
 
+  // Nodes are not moved, i.e. the element node map stays valid
+  Impl (Impl&&) = default;
+
   bool hasRoot () const { return bool(this->root); }
 
   void setupRoot (const glm::vec3& position, float width)
@@ -681,9 +684,14 @@ struct DynamicOctree::Impl
   }
 
   float distance (const glm::vec3& p, const DistanceCallback& getDistance) const
+  {
+    return this->distance (p, Util::maxFloat (), getDistance);
+  }
+
+  float distance (const glm::vec3& p, float maxDistance, const DistanceCallback& getDistance) const
   {
     assert (this->hasRoot ());
-    PrimSphere sphere (p, Util::maxFloat ());
+    PrimSphere sphere (p, maxDistance);
     this->root->distance (sphere, getDistance);
     return sphere.radius ();
   }
@@ -732,4 +740,6 @@ DELEGATE2_CONST (void, DynamicOctree, intersects, const PrimAABox&,
                  const DynamicOctree::ContainsIntersectionCallback&)
 DELEGATE2_CONST (float, DynamicOctree, distance, const glm::vec3&,
                  const DynamicOctree::DistanceCallback&)
+DELEGATE3_CONST (float, DynamicOctree, distance, const glm::vec3&, float,
+                 const DynamicOctree::DistanceCallback&)
 DELEGATE_CONST (void, DynamicOctree, printStatistics)
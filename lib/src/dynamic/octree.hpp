@@ -41,6 +41,9 @@ public:
   void  intersects (const PrimSphere&, const ContainsIntersectionCallback&) const;
   void  intersects (const PrimAABox&, const ContainsIntersectionCallback&) const;
   float distance (const glm::vec3&, const DistanceCallback&) const;
+
+  // the search is bounded by the given distance, which is returned if no element is closer
+  float distance (const glm::vec3&, float, const DistanceCallback&) const;
   void  printStatistics () const;
 
 private:
@@ -0,0 +1,354 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <array>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_access.hpp>
+#include <unordered_map>
+#include <vector>
+#include "../mesh.hpp"
+#include "camera.hpp"
+#include "dynamic/render-chunks.hpp"
+#include "hash.hpp"
+#include "opengl-buffer-id.hpp"
+#include "opengl.hpp"
+#include "primitive/aabox.hpp"
+#include "util.hpp"
+
+namespace
+{
+  constexpr unsigned int numCellsPerDimension = 8;
+
+  struct Chunk
+  {
+    std::vector<unsigned int> faces;
+    OpenGLBufferId            indexBufferId;
+    unsigned int              numIndices;
+    unsigned int              bufferSize;
+    glm::vec3                 minimum;
+    glm::vec3                 maximum;
+    bool                      indicesChanged;
+    bool                      boundsChanged;
+
+    Chunk ()
+      : numIndices (0)
+      , bufferSize (0)
+      , minimum (0.0f)
+      , maximum (0.0f)
+      , indicesChanged (true)
+      , boundsChanged (true)
+    {
+    }
+  };
+
+  struct FaceSlot
+  {
+    unsigned int chunk;
+    unsigned int position;
+
+    FaceSlot ()
+      : chunk (Util::invalidIndex ())
+      , position (Util::invalidIndex ())
+    {
+    }
+
+    FaceSlot (unsigned int c, unsigned int p)
+      : chunk (c)
+      , position (p)
+    {
+    }
+  };
+
+  struct CellHash
+  {
+    std::size_t operator() (const glm::ivec3& cell) const
+    {
+      std::size_t seed = 0;
+      Hash::combine (seed, cell.x);
+      Hash::combine (seed, cell.y);
+      Hash::combine (seed, cell.z);
+      return seed;
+    }
+  };
+
+  typedef std::array<glm::vec4, 6> FrustumPlanes;
+
+  FrustumPlanes frustumPlanes (const glm::mat4x4& mvp)
+  {
+    const glm::vec4 x = glm::row (mvp, 0);
+    const glm::vec4 y = glm::row (mvp, 1);
+    const glm::vec4 z = glm::row (mvp, 2);
+    const glm::vec4 w = glm::row (mvp, 3);
+
+    return FrustumPlanes{{w + x, w - x, w + y, w - y, w + z, w - z}};
+  }
+
+  bool isVisible (const FrustumPlanes& planes, const Chunk& chunk)
+  {
+    for (const glm::vec4& plane : planes)
+    {
+      const glm::vec3 positive (plane.x >= 0.0f ? chunk.maximum.x : chunk.minimum.x,
+                                plane.y >= 0.0f ? chunk.maximum.y : chunk.minimum.y,
+                                plane.z >= 0.0f ? chunk.maximum.z : chunk.minimum.z);
+
+      if (glm::dot (glm::vec3 (plane), positive) + plane.w < 0.0f)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+struct DynamicRenderChunks::Impl
+{
+  glm::vec3                                              origin;
+  float                                                  cellWidth;
+  std::vector<Chunk>                                     chunks;
+  std::unordered_map<glm::ivec3, unsigned int, CellHash> cellMap;
+  std::vector<FaceSlot>                                  faceSlots;
+
+  Impl ()
+    : origin (0.0f)
+    , cellWidth (0.0f)
+  {
+  }
+
+  bool hasLayout () const { return this->cellWidth > 0.0f; }
+
+  void setupLayout (const PrimAABox& bounds)
+  {
+    this->reset ();
+
+    const glm::vec3 extent = bounds.maximum () - bounds.minimum ();
+    const float     maxExtent = glm::max (glm::max (extent.x, extent.y), extent.z);
+
+    this->origin = bounds.minimum ();
+    this->cellWidth = glm::max (maxExtent, Util::epsilon ()) / float(numCellsPerDimension);
+  }
+
+  unsigned int chunkIndex (const glm::vec3& position)
+  {
+    const glm::ivec3 cell (glm::floor ((position - this->origin) / this->cellWidth));
+    const auto       it = this->cellMap.find (cell);
+
+    if (it == this->cellMap.end ())
+    {
+      this->chunks.emplace_back ();
+      this->cellMap.emplace (cell, this->chunks.size () - 1);
+      return this->chunks.size () - 1;
+    }
+    else
+    {
+      return it->second;
+    }
+  }
+
+  bool hasFace (unsigned int face) const
+  {
+    return face < this->faceSlots.size () &&
+           this->faceSlots[face].chunk != Util::invalidIndex ();
+  }
+
+  void addFace (unsigned int face, const glm::vec3& center)
+  {
+    if (this->hasLayout ())
+    {
+      this->deleteFace (face);
+
+      if (face >= this->faceSlots.size ())
+      {
+        this->faceSlots.resize (face + 1);
+      }
+      const unsigned int c = this->chunkIndex (center);
+      Chunk&             chunk = this->chunks[c];
+
+      this->faceSlots[face] = FaceSlot (c, chunk.faces.size ());
+      chunk.faces.push_back (face);
+      chunk.indicesChanged = true;
+      chunk.boundsChanged = true;
+    }
+  }
+
+  void deleteFace (unsigned int face)
+  {
+    if (this->hasFace (face))
+    {
+      const FaceSlot     slot = this->faceSlots[face];
+      Chunk&             chunk = this->chunks[slot.chunk];
+      const unsigned int last = chunk.faces.back ();
+
+      chunk.faces[slot.position] = last;
+      chunk.faces.pop_back ();
+      chunk.indicesChanged = true;
+      chunk.boundsChanged = true;
+
+      this->faceSlots[last].position = slot.position;
+      this->faceSlots[face] = FaceSlot ();
+    }
+  }
+
+  void invalidateBounds (unsigned int face)
+  {
+    if (this->hasFace (face))
+    {
+      this->chunks[this->faceSlots[face].chunk].boundsChanged = true;
+    }
+  }
+
+  void invalidateIndices (unsigned int face)
+  {
+    if (this->hasFace (face))
+    {
+      this->chunks[this->faceSlots[face].chunk].indicesChanged = true;
+    }
+  }
+
+  void updateIndices (const std::vector<unsigned int>& faceIndexMap)
+  {
+    std::vector<FaceSlot> newFaceSlots (faceIndexMap.size ());
+
+    for (unsigned int c = 0; c < this->chunks.size (); c++)
+    {
+      Chunk& chunk = this->chunks[c];
+
+      for (unsigned int p = 0; p < chunk.faces.size (); p++)
+      {
+        const unsigned int newFace = faceIndexMap[chunk.faces[p]];
+        assert (newFace != Util::invalidIndex ());
+
+        chunk.faces[p] = newFace;
+        newFaceSlots[newFace] = FaceSlot (c, p);
+      }
+    }
+    this->faceSlots = std::move (newFaceSlots);
+  }
+
+  void reset ()
+  {
+    this->origin = glm::vec3 (0.0f);
+    this->cellWidth = 0.0f;
+    this->chunks.clear ();
+    this->cellMap.clear ();
+    this->faceSlots.clear ();
+  }
+
+  void updateBounds (Chunk& chunk, const Mesh& mesh)
+  {
+    chunk.minimum = glm::vec3 (Util::maxFloat ());
+    chunk.maximum = glm::vec3 (Util::minFloat ());
+
+    for (unsigned int f : chunk.faces)
+    {
+      for (unsigned int i = 0; i < 3; i++)
+      {
+        const glm::vec3& v = mesh.vertex (mesh.index ((3 * f) + i));
+
+        chunk.minimum = glm::min (chunk.minimum, v);
+        chunk.maximum = glm::max (chunk.maximum, v);
+      }
+    }
+    chunk.boundsChanged = false;
+  }
+
+  void bufferData (Chunk& chunk, const Mesh& mesh, std::vector<unsigned int>& indices)
+  {
+    indices.clear ();
+    indices.reserve (3 * chunk.faces.size ());
+
+    for (unsigned int f : chunk.faces)
+    {
+      indices.push_back (mesh.index ((3 * f) + 0));
+      indices.push_back (mesh.index ((3 * f) + 1));
+      indices.push_back (mesh.index ((3 * f) + 2));
+    }
+
+    if (chunk.indexBufferId.isValid () == false)
+    {
+      chunk.indexBufferId.allocate ();
+    }
+    chunk.numIndices = indices.size ();
+    chunk.bufferSize = indices.size () * sizeof (unsigned int);
+
+    OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), chunk.indexBufferId.id ());
+    OpenGL::glBufferData (OpenGL::ElementArrayBuffer (), chunk.bufferSize, indices.data (),
+                          OpenGL::DynamicDraw ());
+    chunk.indicesChanged = false;
+  }
+
+  void bufferData (const Mesh& mesh)
+  {
+    std::vector<unsigned int> indices;
+
+    for (Chunk& chunk : this->chunks)
+    {
+      if (chunk.boundsChanged)
+      {
+        this->updateBounds (chunk, mesh);
+      }
+      if (chunk.indicesChanged || chunk.indexBufferId.isValid () == false)
+      {
+        this->bufferData (chunk, mesh, indices);
+      }
+    }
+    OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), 0);
+  }
+
+  void releaseBuffers ()
+  {
+    for (Chunk& chunk : this->chunks)
+    {
+      chunk.indexBufferId.reset ();
+      chunk.bufferSize = 0;
+    }
+  }
+
+  void render (Camera& camera, const Mesh& mesh) const
+  {
+    const FrustumPlanes planes =
+      frustumPlanes (camera.projection () * camera.view () * mesh.modelMatrix ());
+
+    std::vector<const Chunk*> visibleChunks;
+    for (const Chunk& chunk : this->chunks)
+    {
+      if (chunk.numIndices > 0 && chunk.indexBufferId.isValid () && isVisible (planes, chunk))
+      {
+        visibleChunks.push_back (&chunk);
+      }
+    }
+
+    mesh.render (camera, [&visibleChunks]() {
+      for (const Chunk* chunk : visibleChunks)
+      {
+        OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), chunk->indexBufferId.id ());
+        OpenGL::glDrawElements (OpenGL::Triangles (), chunk->numIndices, OpenGL::UnsignedInt (),
+                                nullptr);
+      }
+    });
+  }
+
+  unsigned int bufferSize () const
+  {
+    unsigned int size = 0;
+    for (const Chunk& chunk : this->chunks)
+    {
+      size += chunk.bufferSize;
+    }
+    return size;
+  }
+};
+
+DELEGATE_BIG4_COPY (DynamicRenderChunks)
+DELEGATE_CONST (bool, DynamicRenderChunks, hasLayout)
+DELEGATE1 (void, DynamicRenderChunks, setupLayout, const PrimAABox&)
+DELEGATE2 (void, DynamicRenderChunks, addFace, unsigned int, const glm::vec3&)
+DELEGATE1 (void, DynamicRenderChunks, deleteFace, unsigned int)
+DELEGATE1 (void, DynamicRenderChunks, invalidateBounds, unsigned int)
+DELEGATE1 (void, DynamicRenderChunks, invalidateIndices, unsigned int)
+DELEGATE1 (void, DynamicRenderChunks, updateIndices, const std::vector<unsigned int>&)
+DELEGATE (void, DynamicRenderChunks, reset)
+DELEGATE1 (void, DynamicRenderChunks, bufferData, const Mesh&)
+DELEGATE (void, DynamicRenderChunks, releaseBuffers)
+DELEGATE2_CONST (void, DynamicRenderChunks, render, Camera&, const Mesh&)
+DELEGATE_CONST (unsigned int, DynamicRenderChunks, bufferSize)
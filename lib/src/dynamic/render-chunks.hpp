@@ -0,0 +1,40 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_DYNAMIC_RENDER_CHUNKS
+#define DILAY_DYNAMIC_RENDER_CHUNKS
+
+#include <glm/fwd.hpp>
+#include <vector>
+#include "macro.hpp"
+
+class Camera;
+class Mesh;
+class PrimAABox;
+
+// `DynamicRenderChunks` partitions the faces of a dynamic mesh into spatial chunks that are
+// buffered and frustum culled independently
+class DynamicRenderChunks
+{
+public:
+  DECLARE_BIG4_EXPLICIT_COPY (DynamicRenderChunks)
+
+  bool         hasLayout () const;
+  void         setupLayout (const PrimAABox&);
+  void         addFace (unsigned int, const glm::vec3&);
+  void         deleteFace (unsigned int);
+  void         invalidateBounds (unsigned int);
+  void         invalidateIndices (unsigned int);
+  void         updateIndices (const std::vector<unsigned int>&);
+  void         reset ();
+  void         bufferData (const Mesh&);
+  void         releaseBuffers ();
+  void         render (Camera&, const Mesh&) const;
+  unsigned int bufferSize () const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
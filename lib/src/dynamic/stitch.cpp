@@ -0,0 +1,190 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <glm/gtx/norm.hpp>
+#include <map>
+#include <set>
+#include "dynamic/faces.hpp"
+#include "dynamic/mesh.hpp"
+#include "dynamic/stitch.hpp"
+#include "util.hpp"
+
+namespace
+{
+  typedef DynamicStitch::Loop Loop;
+
+  // Twice the vector area of a loop, i.e. its direction is the normal of the loop's orientation
+  glm::vec3 vectorArea (const DynamicMesh& mesh, const Loop& loop)
+  {
+    glm::vec3 area (0.0f);
+    for (unsigned int i = 0; i < loop.size (); i++)
+    {
+      area += glm::cross (mesh.vertex (loop[i]), mesh.vertex (loop[(i + 1) % loop.size ()]));
+    }
+    return area;
+  }
+
+  // Average distance of the vertices of `a` to their nearest vertices of `b`
+  float averageDistance (const DynamicMesh& meshA, const Loop& a, const DynamicMesh& meshB,
+                         const Loop& b)
+  {
+    float sum = 0.0f;
+    for (unsigned int i : a)
+    {
+      float minDistance = Util::maxFloat ();
+      for (unsigned int j : b)
+      {
+        minDistance = glm::min (minDistance, glm::distance2 (meshA.vertex (i), meshB.vertex (j)));
+      }
+      sum += glm::sqrt (minDistance);
+    }
+    return sum / float(a.size ());
+  }
+
+  // Index of the smallest element of `values`, which are read with the given stride
+  unsigned int argMin (const std::vector<float>& values, unsigned int first, unsigned int n,
+                       unsigned int stride)
+  {
+    unsigned int min = 0;
+    for (unsigned int i = 1; i < n; i++)
+    {
+      if (values[first + (i * stride)] < values[first + (min * stride)])
+      {
+        min = i;
+      }
+    }
+    return min;
+  }
+}
+
+bool DynamicStitch::boundaryLoops (const DynamicMesh& mesh, const std::vector<unsigned int>& faces,
+                                   std::vector<Loop>& loops)
+{
+  std::set<ui_pair> edges;
+  for (unsigned int f : faces)
+  {
+    unsigned int i1, i2, i3;
+    mesh.vertexIndices (f, i1, i2, i3);
+
+    edges.emplace (i1, i2);
+    edges.emplace (i2, i3);
+    edges.emplace (i3, i1);
+  }
+
+  std::map<unsigned int, unsigned int> next;
+  for (const ui_pair& edge : edges)
+  {
+    if (edges.count (ui_pair (edge.second, edge.first)) == 0)
+    {
+      if (next.emplace (edge.first, edge.second).second == false)
+      {
+        return false;
+      }
+    }
+  }
+
+  while (next.empty () == false)
+  {
+    Loop         loop;
+    unsigned int vertex = next.begin ()->first;
+    do
+    {
+      const auto it = next.find (vertex);
+      if (it == next.end ())
+      {
+        return false;
+      }
+      loop.push_back (vertex);
+      vertex = it->second;
+      next.erase (it);
+    } while (vertex != loop.front ());
+
+    if (loop.size () < 3)
+    {
+      return false;
+    }
+    loops.push_back (std::move (loop));
+  }
+  return true;
+}
+
+bool DynamicStitch::pairLoops (const DynamicMesh& meshA, const std::vector<Loop>& loopsA,
+                               const DynamicMesh& meshB, const std::vector<Loop>& loopsB,
+                               std::vector<unsigned int>& pairs)
+{
+  const unsigned int n = loopsA.size ();
+
+  if (n == 0 || loopsB.size () != n)
+  {
+    return false;
+  }
+
+  // `distances[(a * n) + b]` is the distance between loops `a` and `b`
+  std::vector<float> distances;
+  distances.reserve (n * n);
+
+  for (const Loop& a : loopsA)
+  {
+    for (const Loop& b : loopsB)
+    {
+      distances.push_back (averageDistance (meshA, a, meshB, b) +
+                           averageDistance (meshB, b, meshA, a));
+    }
+  }
+
+  // Mutually nearest loops are paired one-to-one
+  for (unsigned int a = 0; a < n; a++)
+  {
+    const unsigned int b = argMin (distances, a * n, n, 1);
+
+    if (argMin (distances, b, n, n) != a ||
+        glm::dot (vectorArea (meshA, loopsA[a]), vectorArea (meshB, loopsB[b])) <= 0.0f)
+    {
+      pairs.clear ();
+      return false;
+    }
+    pairs.push_back (b);
+  }
+  return true;
+}
+
+void DynamicStitch::stitch (DynamicMesh& mesh, const Loop& a, const Loop& b, DynamicFaces& faces)
+{
+  const glm::vec3& a0 = mesh.vertex (a[0]);
+  unsigned int     b0 = 0;
+
+  for (unsigned int i = 1; i < b.size (); i++)
+  {
+    if (glm::distance2 (mesh.vertex (b[i]), a0) < glm::distance2 (mesh.vertex (b[b0]), a0))
+    {
+      b0 = i;
+    }
+  }
+
+  unsigned int ai = 0;
+  unsigned int bi = 0;
+
+  while (ai < a.size () || bi < b.size ())
+  {
+    const unsigned int vA = a[ai % a.size ()];
+    const unsigned int vB = b[(b0 + bi) % b.size ()];
+    const unsigned int nextA = a[(ai + 1) % a.size ()];
+    const unsigned int nextB = b[(b0 + bi + 1) % b.size ()];
+
+    const bool advanceA =
+      bi == b.size () ||
+      (ai < a.size () && glm::distance2 (mesh.vertex (nextA), mesh.vertex (vB)) <=
+                           glm::distance2 (mesh.vertex (vA), mesh.vertex (nextB)));
+    if (advanceA)
+    {
+      faces.insert (mesh.addFace (vA, nextA, vB));
+      ai++;
+    }
+    else
+    {
+      faces.insert (mesh.addFace (nextB, vB, vA));
+      bi++;
+    }
+  }
+}
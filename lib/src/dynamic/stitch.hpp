@@ -0,0 +1,34 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_DYNAMIC_STITCH
+#define DILAY_DYNAMIC_STITCH
+
+#include <vector>
+
+class DynamicFaces;
+class DynamicMesh;
+
+namespace DynamicStitch
+{
+  typedef std::vector<unsigned int> Loop;
+
+  // Collects the boundary loops of a set of faces. Loops follow the orientation of the faces.
+  // Fails if the boundary is not a set of disjoint loops.
+  bool boundaryLoops (const DynamicMesh&, const std::vector<unsigned int>&, std::vector<Loop>&);
+
+  // Pairs each loop of the first mesh with the loop of the second mesh whose vertices are
+  // nearest on average. Nested loops may share their centroids, i.e. centroids are not compared.
+  // Fails if paired loops are not mutually nearest or if they are oriented oppositely.
+  bool pairLoops (const DynamicMesh&, const std::vector<Loop>&, const DynamicMesh&,
+                  const std::vector<Loop>&, std::vector<unsigned int>&);
+
+  // Stitches the boundary loop of a hole to the boundary loop of a patch inside the hole. Both
+  // loops follow the orientation of their faces, i.e. the strip of new faces traverses the first
+  // loop forwards and the second loop backwards. The shorter diagonal decides which loop
+  // advances.
+  void stitch (DynamicMesh&, const Loop&, const Loop&, DynamicFaces&);
+};
+
+#endif
@@ -0,0 +1,93 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QObject>
+#include <QTimer>
+#include <atomic>
+#include <thread>
+#include "export-job.hpp"
+#include "import-export.hpp"
+
+namespace
+{
+  // milliseconds between two checks whether the file is written
+  static const int pollInterval = 50;
+}
+
+struct ExportJob::Impl
+{
+  QTimer            timer;
+  std::thread       thread;
+  std::atomic<bool> isFinished;
+  bool              success; // written by `thread`, read after joining it
+  Callback          callback;
+
+  Impl ()
+    : isFinished (false)
+    , success (false)
+  {
+    QObject::connect (&this->timer, &QTimer::timeout, [this]() { this->poll (); });
+  }
+
+  // The callback is not called since its receivers might have been deleted already.
+  ~Impl ()
+  {
+    if (this->isRunning ())
+    {
+      this->thread.join ();
+    }
+  }
+
+  bool isRunning () const { return this->thread.joinable (); }
+
+  void run (const Scene& scene, const std::string& fileName, bool isObjFile, const Callback& c)
+  {
+    this->wait ();
+
+    this->isFinished = false;
+    this->success = false;
+    this->callback = c;
+
+    this->thread = std::thread (
+      [this, fileName, isObjFile, copy = ImportExport::copyScene (scene)]() {
+        this->success = ImportExport::toDlyFile (fileName, copy, isObjFile);
+        this->isFinished = true;
+      });
+    this->timer.start (pollInterval);
+  }
+
+  void wait ()
+  {
+    if (this->isRunning ())
+    {
+      this->finish ();
+    }
+  }
+
+  // The callback might run another job, so the result is taken over before calling it.
+  void finish ()
+  {
+    this->thread.join ();
+    this->timer.stop ();
+
+    const bool     result = this->success;
+    const Callback c = this->callback;
+
+    c (result);
+  }
+
+  void poll ()
+  {
+    if (this->isFinished)
+    {
+      this->finish ();
+    }
+  }
+};
+
+DELEGATE_BIG2 (ExportJob)
+DELEGATE_CONST (bool, ExportJob, isRunning)
+DELEGATE4 (void, ExportJob, run, const Scene&, const std::string&, bool,
+           const ExportJob::Callback&)
+DELEGATE (void, ExportJob, wait)
@@ -0,0 +1,34 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_EXPORT_JOB
+#define DILAY_EXPORT_JOB
+
+#include <functional>
+#include <string>
+#include "macro.hpp"
+
+class Scene;
+
+// `ExportJob` writes a copy of a scene to a file in a background thread, i.e. the scene may be
+// modified while the file is written. Once the file is written, the callback is called with the
+// result in the main thread.
+class ExportJob
+{
+public:
+  typedef std::function<void(bool)> Callback;
+
+  DECLARE_BIG2 (ExportJob)
+
+  bool isRunning () const;
+  void run (const Scene&, const std::string&, bool, const Callback&);
+
+  // blocks until a running job is finished and calls its callback
+  void wait ();
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
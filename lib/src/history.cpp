@@ -2,17 +2,27 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
 #include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
 #include <vector>
 #include "config.hpp"
 #include "dynamic/mesh.hpp"
 #include "history.hpp"
+#include "intersection.hpp"
 #include "maybe.hpp"
 #include "mesh.hpp"
 #include "scene.hpp"
 #include "sketch/mesh.hpp"
 #include "sketch/path.hpp"
-#include "state.hpp"
+#include "util.hpp"
 
 namespace
 {
@@ -20,20 +30,94 @@ namespace
   {
     bool snapshotDynamicMeshes;
     bool snapshotSketchMeshes;
+    bool recordDynamicMeshes;
 
-    SnapshotConfig (bool d, bool s)
+    SnapshotConfig (bool d, bool s, bool r = false)
       : snapshotDynamicMeshes (d)
       , snapshotSketchMeshes (s)
+      , recordDynamicMeshes (r)
     {
-      assert (this->snapshotDynamicMeshes || this->snapshotSketchMeshes);
+      assert (this->snapshotDynamicMeshes || this->snapshotSketchMeshes ||
+              this->recordDynamicMeshes);
+      assert (this->snapshotDynamicMeshes == false || this->recordDynamicMeshes == false);
     }
   };
 
+  struct RecordedMesh
+  {
+    const unsigned int index; // position in the scene
+    DynamicMesh* const mesh;  // only valid while recording
+    DynamicMeshDelta   delta;
+
+    RecordedMesh (unsigned int i, DynamicMesh& m)
+      : index (i)
+      , mesh (&m)
+    {
+    }
+  };
+
+  // Compression of a mesh state on the worker thread of the history
+  struct Compression
+  {
+    const std::shared_ptr<const DynamicMesh> mesh;
+    std::vector<unsigned char>               bytes;
+    std::atomic<bool>                        isFinished;
+
+    Compression (const std::shared_ptr<const DynamicMesh>& m)
+      : mesh (m)
+      , isFinished (false)
+    {
+    }
+  };
+
+  // States of unchanged meshes are shared between snapshots. A state is kept in memory as long
+  // as it belongs to the most recent snapshot of the past or the future. Otherwise it is
+  // compressed in the background and its bytes are moved to the spill file of the history if
+  // the history exceeds its memory budget.
+  struct DynamicMeshState
+  {
+    const unsigned int                 revision;
+    const std::size_t                  meshSize;
+    std::shared_ptr<DynamicMesh>       mesh;        // `nullptr` if compressed
+    std::shared_ptr<Compression>       compression; // pending compression
+    std::vector<unsigned char>         bytes;       // compressed mesh unless spilled
+    long                               fileOffset;  // offset of spilled bytes or -1
+    std::size_t                        fileSize;
+
+    DynamicMeshState (const DynamicMesh& m)
+      : revision (m.revision ())
+      , meshSize (m.memorySize ())
+      , mesh (std::make_shared<DynamicMesh> (m))
+      , fileOffset (-1)
+      , fileSize (0)
+    {
+    }
+
+    DynamicMeshState (DynamicMesh&& m)
+      : revision (m.revision ())
+      , meshSize (m.memorySize ())
+      , mesh (std::make_shared<DynamicMesh> (std::move (m)))
+      , fileOffset (-1)
+      , fileSize (0)
+    {
+    }
+
+    bool isSpilled () const { return this->fileOffset >= 0; }
+
+    std::size_t memorySize () const
+    {
+      return (this->mesh ? this->meshSize : 0) + this->bytes.capacity ();
+    }
+  };
+
+  typedef std::shared_ptr<DynamicMeshState> SharedDynamicMeshState;
+
   struct SceneSnapshot
   {
-    const SnapshotConfig   config;
-    std::list<DynamicMesh> dynamicMeshes;
-    std::list<SketchMesh>  sketchMeshes;
+    const SnapshotConfig                config;
+    std::vector<SharedDynamicMeshState> dynamicMeshes;
+    std::list<SketchMesh>         sketchMeshes;
+    std::list<RecordedMesh>       recordedMeshes;
 
     SceneSnapshot (const SnapshotConfig& c)
       : config (c)
@@ -43,14 +127,206 @@ namespace
 
   typedef std::list<SceneSnapshot> Timeline;
 
-  SceneSnapshot sceneSnapshot (const Scene& scene, const SnapshotConfig& config)
+  // Compressed states are not shared since recent snapshots must not be compressed
+  SharedDynamicMeshState findDynamicMeshState (const Timeline& timeline, unsigned int revision)
+  {
+    for (const SceneSnapshot& snapshot : timeline)
+    {
+      for (const SharedDynamicMeshState& state : snapshot.dynamicMeshes)
+      {
+        if (state->mesh && state->revision == revision)
+        {
+          return state;
+        }
+      }
+    }
+    return nullptr;
+  }
+
+  std::size_t sketchMemorySize (const SketchMesh& mesh)
+  {
+    std::size_t size = 0;
+
+    if (mesh.tree ().hasRoot ())
+    {
+      size += mesh.tree ().root ().numNodes () * sizeof (SketchNode);
+    }
+    for (const SketchPath& path : mesh.paths ())
+    {
+      size += path.spheres ().size () * sizeof (PrimSphere);
+    }
+    return size;
+  }
+
+  // Runs tasks on a background thread, which is started on first use. Pending tasks are
+  // dropped on destruction. Suspended workers keep their tasks until they are resumed.
+  class Worker
+  {
+  public:
+    Worker ()
+      : stop (false)
+      , isSuspended (false)
+    {
+    }
+
+    Worker (const Worker&) = delete;
+    Worker& operator= (const Worker&) = delete;
+
+    ~Worker ()
+    {
+      {
+        std::lock_guard<std::mutex> lock (this->mutex);
+        this->stop = true;
+      }
+      this->taskAvailable.notify_all ();
+
+      if (this->thread.joinable ())
+      {
+        this->thread.join ();
+      }
+    }
+
+    void run (const std::function<void()>& task)
+    {
+      {
+        std::lock_guard<std::mutex> lock (this->mutex);
+        this->tasks.push_back (task);
+      }
+      this->taskAvailable.notify_all ();
+
+      if (this->thread.joinable () == false)
+      {
+        this->thread = std::thread ([this]() { this->work (); });
+      }
+    }
+
+    void suspend (bool s)
+    {
+      {
+        std::lock_guard<std::mutex> lock (this->mutex);
+        this->isSuspended = s;
+      }
+      this->taskAvailable.notify_all ();
+    }
+
+  private:
+    std::mutex                        mutex;
+    std::condition_variable           taskAvailable;
+    std::deque<std::function<void()>> tasks;
+    bool                              stop;
+    bool                              isSuspended;
+    std::thread                       thread;
+
+    void work ()
+    {
+      std::unique_lock<std::mutex> lock (this->mutex);
+
+      while (true)
+      {
+        this->taskAvailable.wait (lock, [this]() {
+          return this->stop || (this->isSuspended == false && this->tasks.empty () == false);
+        });
+        if (this->stop)
+        {
+          return;
+        }
+        const std::function<void()> task = std::move (this->tasks.front ());
+        this->tasks.pop_front ();
+        lock.unlock ();
+
+        task ();
+
+        lock.lock ();
+      }
+    }
+  };
+
+  // Temporary file that is removed when it is closed. Written bytes are appended.
+  class SpillFile
+  {
+  public:
+    SpillFile ()
+      : file (nullptr)
+      , fileSize (0)
+    {
+    }
+
+    SpillFile (const SpillFile&) = delete;
+    SpillFile& operator= (const SpillFile&) = delete;
+
+    ~SpillFile () { this->reset (); }
+
+    std::size_t size () const { return this->fileSize; }
+
+    // Returns the offset of the written bytes or -1 on failure
+    long write (const std::vector<unsigned char>& bytes)
+    {
+      if (this->file == nullptr)
+      {
+        this->file = std::tmpfile ();
+
+        if (this->file == nullptr)
+        {
+          DILAY_WARN ("could not create temporary file for the undo history");
+          return -1;
+        }
+      }
+      const long offset = long(this->fileSize);
+
+      if (std::fseek (this->file, offset, SEEK_SET) != 0 ||
+          std::fwrite (bytes.data (), 1, bytes.size (), this->file) != bytes.size ())
+      {
+        DILAY_WARN ("could not write to temporary file of the undo history");
+        return -1;
+      }
+      this->fileSize += bytes.size ();
+      return offset;
+    }
+
+    bool read (long offset, std::size_t n, std::vector<unsigned char>& bytes)
+    {
+      bytes.resize (n);
+      return this->file && std::fseek (this->file, offset, SEEK_SET) == 0 &&
+             std::fread (bytes.data (), 1, n, this->file) == n;
+    }
+
+    void reset ()
+    {
+      if (this->file)
+      {
+        std::fclose (this->file);
+        this->file = nullptr;
+      }
+      this->fileSize = 0;
+    }
+
+  private:
+    std::FILE*  file;
+    std::size_t fileSize;
+  };
+
+  // Dynamic meshes are only copied if their state is not part of the past or the future yet
+  SceneSnapshot sceneSnapshot (const Scene& scene, const SnapshotConfig& config,
+                               const Timeline& past, const Timeline& future)
   {
     SceneSnapshot snapshot (config);
 
     if (config.snapshotDynamicMeshes)
     {
-      scene.forEachConstMesh (
-        [&snapshot](const DynamicMesh& mesh) { snapshot.dynamicMeshes.emplace_back (mesh); });
+      scene.forEachConstMesh ([&snapshot, &past, &future](const DynamicMesh& mesh) {
+        const unsigned int     revision = mesh.revision ();
+        SharedDynamicMeshState state = findDynamicMeshState (past, revision);
+
+        if (state == nullptr)
+        {
+          state = findDynamicMeshState (future, revision);
+        }
+        if (state == nullptr)
+        {
+          state = std::make_shared<DynamicMeshState> (mesh);
+        }
+        snapshot.dynamicMeshes.push_back (std::move (state));
+      });
     }
     if (config.snapshotSketchMeshes)
     {
@@ -60,27 +336,49 @@ namespace
     return snapshot;
   }
 
-  void resetToSnapshot (const SceneSnapshot& snapshot, State& state)
+  unsigned int dynamicMeshIndex (const Scene& scene, const DynamicMesh& mesh)
   {
-    Scene& scene = state.scene ();
-
-    if (snapshot.config.snapshotDynamicMeshes)
-    {
-      scene.deleteDynamicMeshes ();
+    unsigned int i = 0;
+    unsigned int index = Util::invalidIndex ();
 
-      for (const DynamicMesh& mesh : snapshot.dynamicMeshes)
+    scene.forEachConstMesh ([&mesh, &i, &index](const DynamicMesh& m) {
+      if (&m == &mesh)
       {
-        scene.newDynamicMesh (state.config (), mesh);
+        index = i;
       }
-    }
-    if (snapshot.config.snapshotSketchMeshes)
-    {
-      scene.deleteSketchMeshes ();
+      i++;
+    });
+    assert (index != Util::invalidIndex ());
+    return index;
+  }
 
-      for (const SketchMesh& mesh : snapshot.sketchMeshes)
+  DynamicMesh& dynamicMesh (Scene& scene, unsigned int index)
+  {
+    unsigned int i = 0;
+    DynamicMesh* mesh = nullptr;
+
+    scene.forEachMesh ([index, &i, &mesh](DynamicMesh& m) {
+      if (i == index)
       {
-        scene.newSketchMesh (state.config (), mesh);
+        mesh = &m;
       }
+      i++;
+    });
+    assert (mesh);
+    return *mesh;
+  }
+
+  // Deltas store indices of scene meshes since full snapshots replace meshes
+  void applyDeltas (SceneSnapshot& snapshot, Scene& scene)
+  {
+    assert (snapshot.config.recordDynamicMeshes);
+
+    for (RecordedMesh& r : snapshot.recordedMeshes)
+    {
+      DynamicMesh& mesh = dynamicMesh (scene, r.index);
+
+      mesh.applyDelta (r.delta);
+      mesh.bufferData ();
     }
   }
 }
@@ -88,10 +386,18 @@ namespace
 struct History::Impl
 {
   unsigned int undoDepth;
+  std::size_t  memoryBudget;
   Timeline     past;
   Timeline     future;
+  bool         isRecording;
+  SpillFile    spillFile;
+  Worker       worker;
 
-  Impl (const Config& config) { this->runFromConfig (config); }
+  Impl (const Config& config)
+    : isRecording (false)
+  {
+    this->runFromConfig (config);
+  }
 
   void snapshotAll (const Scene& scene) { this->snapshot (scene, SnapshotConfig (true, true)); }
 
@@ -106,8 +412,16 @@ struct History::Impl
   }
 
   void snapshot (const Scene& scene, const SnapshotConfig& config)
+  {
+    this->prepareSnapshot ();
+    this->past.push_front (sceneSnapshot (scene, config, this->past, this->future));
+    this->updateMemory ();
+  }
+
+  void prepareSnapshot ()
   {
     assert (undoDepth > 0);
+    assert (this->isRecording == false);
 
     this->future.clear ();
 
@@ -115,14 +429,97 @@ struct History::Impl
     {
       this->past.pop_back ();
     }
-    this->past.push_front (sceneSnapshot (scene, config));
+  }
+
+  // Records the changes of meshes that are passed to `recordDynamicMesh` until
+  // `stopRecording` is called
+  void recordDynamicMeshes ()
+  {
+    this->prepareSnapshot ();
+    this->past.emplace_front (SnapshotConfig (false, false, true));
+    this->isRecording = true;
+  }
+
+  void recordDynamicMesh (const Scene& scene, DynamicMesh& mesh)
+  {
+    if (this->isRecording)
+    {
+      std::list<RecordedMesh>& recordedMeshes = this->past.front ().recordedMeshes;
+
+      for (const RecordedMesh& r : recordedMeshes)
+      {
+        if (r.mesh == &mesh)
+        {
+          return;
+        }
+      }
+      recordedMeshes.emplace_back (dynamicMeshIndex (scene, mesh), mesh);
+      mesh.record (recordedMeshes.back ().delta);
+    }
+  }
+
+  void stopRecording ()
+  {
+    if (this->isRecording)
+    {
+      bool isEmpty = true;
+
+      for (RecordedMesh& r : this->past.front ().recordedMeshes)
+      {
+        r.mesh->stopRecording ();
+        isEmpty = isEmpty && r.delta.isEmpty ();
+      }
+      this->isRecording = false;
+
+      if (isEmpty)
+      {
+        this->past.pop_front ();
+      }
+      this->updateMemory ();
+    }
+  }
+
+  // Replaces the recorded deltas by a full snapshot, e.g. if a recorded mesh is about to be
+  // deleted
+  void snapshotRecordedMeshes (const Scene& scene)
+  {
+    if (this->isRecording)
+    {
+      std::list<RecordedMesh>& recordedMeshes = this->past.front ().recordedMeshes;
+
+      for (RecordedMesh& r : recordedMeshes)
+      {
+        r.mesh->stopRecording ();
+        r.mesh->applyDelta (r.delta);
+      }
+      SceneSnapshot snapshot =
+        sceneSnapshot (scene, SnapshotConfig (true, false), this->past, this->future);
+
+      for (RecordedMesh& r : recordedMeshes)
+      {
+        r.mesh->applyDelta (r.delta);
+      }
+      this->isRecording = false;
+      this->past.pop_front ();
+      this->past.push_front (std::move (snapshot));
+      this->updateMemory ();
+    }
   }
 
   void dropPastSnapshot ()
   {
     if (this->past.empty () == false)
     {
+      if (this->isRecording)
+      {
+        for (RecordedMesh& r : this->past.front ().recordedMeshes)
+        {
+          r.mesh->stopRecording ();
+        }
+        this->isRecording = false;
+      }
       this->past.pop_front ();
+      this->updateMemory ();
     }
   }
 
@@ -131,70 +528,353 @@ struct History::Impl
     if (this->future.empty () == false)
     {
       this->future.pop_front ();
+      this->updateMemory ();
     }
   }
 
-  void undo (State& state)
+  void undo (Scene& scene, const Config& config)
   {
-    if (this->past.empty () == false)
+    assert (this->isRecording == false);
+
+    if (this->past.empty () == false && this->past.front ().config.recordDynamicMeshes)
+    {
+      applyDeltas (this->past.front (), scene);
+      this->future.splice (this->future.begin (), this->past, this->past.begin ());
+    }
+    else if (this->past.empty () == false)
     {
-      const SnapshotConfig& config = this->past.front ().config;
+      this->future.push_front (this->restoreSnapshot (this->past, scene, config));
+    }
+    this->updateMemory ();
+  }
 
-      this->future.push_front (sceneSnapshot (state.scene (), config));
-      resetToSnapshot (this->past.front (), state);
-      this->past.pop_front ();
+  void redo (Scene& scene, const Config& config)
+  {
+    assert (this->isRecording == false);
+
+    if (this->future.empty () == false && this->future.front ().config.recordDynamicMeshes)
+    {
+      applyDeltas (this->future.front (), scene);
+      this->past.splice (this->past.begin (), this->future, this->future.begin ());
     }
+    else if (this->future.empty () == false)
+    {
+      this->past.push_front (this->restoreSnapshot (this->future, scene, config));
+    }
+    this->updateMemory ();
   }
 
-  void redo (State& state)
+  // Restores the most recent snapshot of a timeline and returns a snapshot of the replaced
+  // scene. Meshes are moved between the scene and the history unless their states are shared
+  // with other snapshots, i.e. restored meshes keep their buffers and need not be copied.
+  SceneSnapshot restoreSnapshot (Timeline& timeline, Scene& scene, const Config& config)
   {
-    if (this->future.empty () == false)
+    assert (timeline.empty () == false);
+
+    SceneSnapshot& snapshot = timeline.front ();
+    SceneSnapshot  replaced (snapshot.config);
+
+    if (snapshot.config.snapshotDynamicMeshes)
     {
-      const SnapshotConfig& config = this->future.front ().config;
+      std::vector<DynamicMesh*> meshes;
+      scene.forEachMesh ([&meshes](DynamicMesh& mesh) { meshes.push_back (&mesh); });
 
-      this->past.push_front (sceneSnapshot (state.scene (), config));
-      resetToSnapshot (this->future.front (), state);
-      this->future.pop_front ();
+      // Only meshes whose state differs are replaced as long as the snapshot has the same
+      // number of meshes, i.e. meshes at equal positions correspond to each other
+      if (meshes.size () == snapshot.dynamicMeshes.size ())
+      {
+        for (unsigned int i = 0; i < meshes.size (); i++)
+        {
+          SharedDynamicMeshState& meshState = snapshot.dynamicMeshes[i];
+
+          if (meshes[i]->revision () == meshState->revision)
+          {
+            replaced.dynamicMeshes.push_back (meshState);
+          }
+          else
+          {
+            replaced.dynamicMeshes.push_back (this->moveIntoState (
+              scene.replaceMesh (config, *meshes[i], this->takeMesh (meshState))));
+          }
+        }
+      }
+      else
+      {
+        for (DynamicMesh* mesh : meshes)
+        {
+          replaced.dynamicMeshes.push_back (this->moveIntoState (std::move (*mesh)));
+        }
+        scene.deleteDynamicMeshes ();
+
+        for (SharedDynamicMeshState& meshState : snapshot.dynamicMeshes)
+        {
+          scene.newDynamicMesh (config, this->takeMesh (meshState));
+        }
+      }
+    }
+    if (snapshot.config.snapshotSketchMeshes)
+    {
+      scene.forEachConstMesh (
+        [&replaced](const SketchMesh& mesh) { replaced.sketchMeshes.emplace_back (mesh); });
+      scene.deleteSketchMeshes ();
+
+      for (const SketchMesh& mesh : snapshot.sketchMeshes)
+      {
+        scene.newSketchMesh (config, mesh);
+      }
     }
+    timeline.pop_front ();
+    return replaced;
   }
 
+  // Moves a mesh into a new state unless its state is already part of the past or the future
+  SharedDynamicMeshState moveIntoState (DynamicMesh&& mesh)
+  {
+    const unsigned int     revision = mesh.revision ();
+    SharedDynamicMeshState meshState = findDynamicMeshState (this->past, revision);
+
+    if (meshState == nullptr)
+    {
+      meshState = findDynamicMeshState (this->future, revision);
+    }
+    if (meshState == nullptr)
+    {
+      meshState = std::make_shared<DynamicMeshState> (std::move (mesh));
+    }
+    return meshState;
+  }
+
+  // Moves the mesh out of a state that belongs to a single snapshot and copies it otherwise
+  DynamicMesh takeMesh (SharedDynamicMeshState& meshState)
+  {
+    this->load (*meshState);
+
+    if (meshState.use_count () == 1 && meshState->mesh.use_count () == 1)
+    {
+      DynamicMesh mesh (std::move (*meshState->mesh));
+      meshState->mesh.reset ();
+      return mesh;
+    }
+    else
+    {
+      return DynamicMesh (*meshState->mesh);
+    }
+  }
+
+  // Decompresses a state, possibly after reading its bytes from the spill file
+  const DynamicMesh& load (DynamicMeshState& meshState)
+  {
+    if (meshState.mesh == nullptr)
+    {
+      if (meshState.isSpilled ())
+      {
+        if (this->spillFile.read (meshState.fileOffset, meshState.fileSize, meshState.bytes) ==
+            false)
+        {
+          DILAY_PANIC ("could not read from temporary file of the undo history")
+        }
+        meshState.fileOffset = -1;
+        meshState.fileSize = 0;
+      }
+      std::shared_ptr<DynamicMesh> mesh = std::make_shared<DynamicMesh> ();
+
+      if (mesh->fromBytes (meshState.bytes) == false)
+      {
+        DILAY_IMPOSSIBLE
+      }
+      meshState.mesh = std::move (mesh);
+      meshState.bytes = std::vector<unsigned char> ();
+    }
+    return *meshState.mesh;
+  }
+
+  // Compresses states that do not belong to the most recent snapshots and spills compressed
+  // states, starting with the oldest ones, as long as the history exceeds its memory budget
+  void updateMemory ()
+  {
+    std::unordered_set<const DynamicMeshState*> recentStates;
+    bool                                        hasSpilledStates = false;
+
+    for (const Timeline* timeline : {&this->past, &this->future})
+    {
+      if (timeline->empty () == false)
+      {
+        for (const SharedDynamicMeshState& meshState : timeline->front ().dynamicMeshes)
+        {
+          recentStates.insert (meshState.get ());
+        }
+      }
+    }
+
+    for (Timeline* timeline : {&this->past, &this->future})
+    {
+      for (SceneSnapshot& snapshot : *timeline)
+      {
+        for (SharedDynamicMeshState& meshState : snapshot.dynamicMeshes)
+        {
+          const bool isRecent = recentStates.count (meshState.get ()) > 0;
+
+          if (meshState->compression && meshState->compression->isFinished)
+          {
+            if (isRecent == false)
+            {
+              meshState->bytes = std::move (meshState->compression->bytes);
+              meshState->mesh.reset ();
+            }
+            meshState->compression.reset ();
+          }
+          else if (meshState->mesh && meshState->compression == nullptr && isRecent == false)
+          {
+            std::shared_ptr<Compression> compression =
+              std::make_shared<Compression> (meshState->mesh);
+
+            // buffers must be released by this thread
+            meshState->mesh->releaseBuffers ();
+
+            this->worker.run ([compression]() {
+              compression->mesh->toBytes (compression->bytes);
+              compression->isFinished = true;
+            });
+            meshState->compression = std::move (compression);
+          }
+          hasSpilledStates = hasSpilledStates || meshState->isSpilled ();
+        }
+      }
+    }
+
+    if (hasSpilledStates == false)
+    {
+      this->spillFile.reset ();
+    }
+
+    std::size_t size = this->memorySize ();
+
+    for (Timeline* timeline : {&this->past, &this->future})
+    {
+      for (auto it = timeline->rbegin (); it != timeline->rend (); ++it)
+      {
+        for (SharedDynamicMeshState& meshState : it->dynamicMeshes)
+        {
+          if (size <= this->memoryBudget)
+          {
+            return;
+          }
+          else if (meshState->mesh == nullptr && meshState->isSpilled () == false)
+          {
+            const long offset = this->spillFile.write (meshState->bytes);
+
+            if (offset < 0)
+            {
+              return;
+            }
+            size -= meshState->bytes.capacity ();
+
+            meshState->fileOffset = offset;
+            meshState->fileSize = meshState->bytes.size ();
+            meshState->bytes = std::vector<unsigned char> ();
+          }
+        }
+      }
+    }
+  }
+
+  // States that are shared between snapshots are counted once. Pending compressions are not
+  // counted.
+  std::size_t memorySize () const
+  {
+    std::unordered_set<const DynamicMeshState*> states;
+    std::size_t                                 size = 0;
+
+    for (const Timeline* timeline : {&this->past, &this->future})
+    {
+      for (const SceneSnapshot& snapshot : *timeline)
+      {
+        for (const SharedDynamicMeshState& meshState : snapshot.dynamicMeshes)
+        {
+          if (states.insert (meshState.get ()).second)
+          {
+            size += meshState->memorySize ();
+          }
+        }
+        for (const SketchMesh& mesh : snapshot.sketchMeshes)
+        {
+          size += sketchMemorySize (mesh);
+        }
+        for (const RecordedMesh& r : snapshot.recordedMeshes)
+        {
+          size += r.delta.memorySize ();
+        }
+      }
+    }
+    return size;
+  }
+
+  std::size_t diskSize () const { return this->spillFile.size (); }
+
+  void suspendCompression (bool suspend) { this->worker.suspend (suspend); }
+
   bool hasRecentDynamicMesh () const
   {
-    return this->past.empty () == false && this->past.front ().config.snapshotDynamicMeshes;
+    return this->isRecording ||
+           (this->past.empty () == false && this->past.front ().config.snapshotDynamicMeshes);
   }
 
-  void forEachRecentDynamicMesh (const std::function<void(const DynamicMesh&)>& f) const
+  // Recorded meshes are intersected as they were when recording started, i.e. recording is
+  // sufficient to intersect the recent state of a mesh without copying it
+  bool intersectsRecentDynamicMesh (const Scene& scene, const PrimRay& ray,
+                                    Intersection& intersection) const
   {
     assert (this->hasRecentDynamicMesh ());
 
-    for (const DynamicMesh& m : this->past.front ().dynamicMeshes)
+    if (this->isRecording)
     {
-      f (m);
+      scene.forEachConstMesh ([&ray, &intersection](const DynamicMesh& mesh) {
+        mesh.intersectsOriginal (ray, intersection);
+      });
+    }
+    else
+    {
+      for (const SharedDynamicMeshState& m : this->past.front ().dynamicMeshes)
+      {
+        assert (m->mesh);
+        m->mesh->intersects (ray, intersection);
+      }
     }
+    return intersection.isIntersection ();
   }
 
   void reset ()
   {
+    this->stopRecording ();
     this->past.clear ();
     this->future.clear ();
+    this->spillFile.reset ();
   }
 
   void runFromConfig (const Config& config)
   {
     this->undoDepth = config.get<int> ("editor/undo-depth");
+    this->memoryBudget = std::size_t (config.get<int> ("editor/undo-memory")) * 1024 * 1024;
   }
 };
 
-DELEGATE1_BIG3 (History, const Config&)
+DELEGATE1_BIG2 (History, const Config&)
 DELEGATE1 (void, History, snapshotAll, const Scene&)
 DELEGATE1 (void, History, snapshotDynamicMeshes, const Scene&)
 DELEGATE1 (void, History, snapshotSketchMeshes, const Scene&)
+DELEGATE (void, History, recordDynamicMeshes)
+DELEGATE2 (void, History, recordDynamicMesh, const Scene&, DynamicMesh&)
+DELEGATE (void, History, stopRecording)
+DELEGATE1 (void, History, snapshotRecordedMeshes, const Scene&)
 DELEGATE (void, History, dropPastSnapshot)
 DELEGATE (void, History, dropFutureSnapshot)
-DELEGATE1 (void, History, undo, State&)
-DELEGATE1 (void, History, redo, State&)
+DELEGATE2 (void, History, undo, Scene&, const Config&)
+DELEGATE2 (void, History, redo, Scene&, const Config&)
 DELEGATE_CONST (bool, History, hasRecentDynamicMesh)
-DELEGATE1_CONST (void, History, forEachRecentDynamicMesh,
-                 const std::function<void(const DynamicMesh&)>&)
+DELEGATE3_CONST (bool, History, intersectsRecentDynamicMesh, const Scene&, const PrimRay&,
+                 Intersection&)
+DELEGATE_CONST (std::size_t, History, memorySize)
+DELEGATE_CONST (std::size_t, History, diskSize)
+DELEGATE1 (void, History, suspendCompression, bool)
 DELEGATE (void, History, reset)
 DELEGATE1 (void, History, runFromConfig, const Config&)
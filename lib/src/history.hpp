@@ -5,30 +5,42 @@
 #ifndef DILAY_HISTORY
 #define DILAY_HISTORY
 
-#include <functional>
+#include <cstddef>
 #include "configurable.hpp"
 #include "macro.hpp"
 
 class DynamicMesh;
+class Intersection;
+class PrimRay;
 class Scene;
-class State;
 
 class History : public Configurable
 {
 public:
-  DECLARE_BIG3 (History, const Config&)
+  DECLARE_BIG2 (History, const Config&)
 
   void snapshotAll (const Scene&);
   void snapshotDynamicMeshes (const Scene&);
   void snapshotSketchMeshes (const Scene&);
+  void recordDynamicMeshes ();
+  void recordDynamicMesh (const Scene&, DynamicMesh&);
+  void stopRecording ();
+  void snapshotRecordedMeshes (const Scene&);
   void dropPastSnapshot ();
   void dropFutureSnapshot ();
-  void undo (State&);
-  void redo (State&);
+  void undo (Scene&, const Config&);
+  void redo (Scene&, const Config&);
   bool hasRecentDynamicMesh () const;
-  void forEachRecentDynamicMesh (const std::function<void(const DynamicMesh&)>&) const;
+  bool intersectsRecentDynamicMesh (const Scene&, const PrimRay&, Intersection&) const;
   void reset ();
 
+  // memory of all snapshots and size of snapshots that are spilled to disk
+  std::size_t memorySize () const;
+  std::size_t diskSize () const;
+
+  // Suspends or resumes the compression of snapshots in the background. Meant for tests.
+  void suspendCompression (bool);
+
 private:
   IMPLEMENTATION
 
@@ -2,119 +2,866 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <QByteArray>
+#include <QFile>
 #include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
-#include <sstream>
+#include <glm/glm.hpp>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include "dlb.hpp"
 #include "dynamic/mesh.hpp"
 #include "import-export.hpp"
 #include "mesh-util.hpp"
 #include "mesh.hpp"
+#include "ply.hpp"
 #include "scene.hpp"
 #include "sketch/fwd.hpp"
 #include "sketch/mesh.hpp"
 #include "sketch/path.hpp"
+#include "stl.hpp"
+#include "task-pool.hpp"
 #include "util.hpp"
 
 namespace
 {
-  std::ostream& operator<< (std::ostream& os, const glm::vec3& v)
+  // output is buffered in chunks of `bufferSize` bytes
+  const std::size_t bufferSize = 1024 * 1024;
+  const std::size_t maxNumberSize = 32;
+  const int         minPowerOf10 = -64;
+  const int         maxPowerOf10 = 64;
+
+  double powerOf10 (int e)
+  {
+    assert (e >= minPowerOf10 && e <= maxPowerOf10);
+
+    static const struct Powers
+    {
+      double values[maxPowerOf10 - minPowerOf10 + 1];
+
+      Powers ()
+      {
+        for (int i = minPowerOf10; i <= maxPowerOf10; i++)
+        {
+          this->values[i - minPowerOf10] = std::pow (10.0, double(i));
+        }
+      }
+    } powers;
+
+    return powers.values[e - minPowerOf10];
+  }
+
+  char* formatUnsigned (unsigned int value, char* out)
   {
-    os << v.x << " " << v.y << " " << v.z;
-    return os;
+    char  digits[10];
+    char* it = digits;
+
+    do
+    {
+      *it++ = char('0' + (value % 10));
+      value /= 10;
+    } while (value > 0);
+
+    while (it != digits)
+    {
+      *out++ = *--it;
+    }
+    return out;
   }
 
-  std::istream& operator>> (std::istream& is, glm::vec3& v)
+  char* formatString (const char* string, char* out)
   {
-    is >> v.x >> v.y >> v.z;
-    return is;
+    const std::size_t n = std::strlen (string);
+    std::memcpy (out, string, n);
+    return out + n;
   }
 
-  void toDlyFile (std::ostream& stream, const Mesh& mesh)
+  // Writes the shortest decimal representation that reads back as `value`, i.e. at most 9
+  // significant digits. Candidates are checked against the rounding interval of `value` with a
+  // margin for the error of double arithmetic, i.e. ties might cost an additional digit.
+  char* formatFloat (float value, char* out)
   {
-    stream << "o\n";
+    if (std::isfinite (value) == false)
+    {
+      return formatString (std::isnan (value) ? "nan" : (value < 0.0f ? "-inf" : "inf"), out);
+    }
+    if (std::signbit (value))
+    {
+      *out++ = '-';
+      value = -value;
+    }
+    if (value == 0.0f)
+    {
+      *out++ = '0';
+      return out;
+    }
+
+    const double v = value;
+    const double next = std::nextafter (value, std::numeric_limits<float>::infinity ());
+    const double lower = 0.5 * (v + double(std::nextafter (value, 0.0f)));
+    const double upper = std::isinf (next) ? v + (v - lower) : 0.5 * (v + next);
+    const double margin = v * 1.0e-14;
+
+    // exponent of the leading digit
+    int leading = int(std::floor (std::log10 (v)));
+    if (powerOf10 (leading) > v)
+    {
+      leading--;
+    }
+    else if (powerOf10 (leading + 1) <= v)
+    {
+      leading++;
+    }
+
+    unsigned int digits = 0;
+    int          exponent = 0;
+
+    for (int numDigits = 1; numDigits <= 9; numDigits++)
+    {
+      exponent = leading - numDigits + 1;
+
+      const double d = std::round (v * powerOf10 (-exponent));
+      const double candidate = d * powerOf10 (exponent);
+
+      digits = (unsigned int) (d);
+      if ((candidate > lower + margin && candidate < upper - margin) || numDigits == 9)
+      {
+        break;
+      }
+    }
+    while (digits % 10 == 0)
+    {
+      digits /= 10;
+      exponent++;
+    }
+
+    char      buffer[10];
+    const int n = int(formatUnsigned (digits, buffer) - buffer);
+
+    leading = exponent + n - 1;
+
+    if (leading >= -5 && leading < 9 && exponent >= 0)
+    {
+      std::memcpy (out, buffer, n);
+      out += n;
+      for (int i = 0; i < exponent; i++)
+      {
+        *out++ = '0';
+      }
+    }
+    else if (leading >= 0 && leading < 9)
+    {
+      std::memcpy (out, buffer, leading + 1);
+      out += leading + 1;
+      *out++ = '.';
+      std::memcpy (out, buffer + leading + 1, n - leading - 1);
+      out += n - leading - 1;
+    }
+    else if (leading >= -5 && leading < 0)
+    {
+      *out++ = '0';
+      *out++ = '.';
+      for (int i = 0; i < -leading - 1; i++)
+      {
+        *out++ = '0';
+      }
+      std::memcpy (out, buffer, n);
+      out += n;
+    }
+    else
+    {
+      *out++ = buffer[0];
+      if (n > 1)
+      {
+        *out++ = '.';
+        std::memcpy (out, buffer + 1, n - 1);
+        out += n - 1;
+      }
+      *out++ = 'e';
+      if (leading < 0)
+      {
+        *out++ = '-';
+      }
+      out = formatUnsigned ((unsigned int) (std::abs (leading)), out);
+    }
+    return out;
+  }
+
+  // Buffers output and formats numbers without `std::ostream`, i.e. regardless of locales
+  class TextWriter
+  {
+  public:
+    TextWriter (std::ostream& s)
+      : stream (s)
+      , buffer (bufferSize)
+      , it (buffer.data ())
+    {
+    }
+
+    ~TextWriter () { this->flush (); }
+
+    TextWriter& operator<< (char c)
+    {
+      this->reserve (1);
+      *this->it++ = c;
+      return *this;
+    }
+
+    TextWriter& operator<< (const char* string)
+    {
+      for (; *string != '\0'; string++)
+      {
+        *this << *string;
+      }
+      return *this;
+    }
+
+    TextWriter& operator<< (unsigned int value)
+    {
+      this->reserve (maxNumberSize);
+      this->it = formatUnsigned (value, this->it);
+      return *this;
+    }
+
+    TextWriter& operator<< (float value)
+    {
+      this->reserve (maxNumberSize);
+      this->it = formatFloat (value, this->it);
+      return *this;
+    }
+
+    TextWriter& operator<< (const glm::vec3& v)
+    {
+      return *this << v.x << ' ' << v.y << ' ' << v.z;
+    }
+
+    void flush ()
+    {
+      this->stream.write (this->buffer.data (), this->it - this->buffer.data ());
+      this->it = this->buffer.data ();
+    }
+
+  private:
+    std::ostream&     stream;
+    std::vector<char> buffer;
+    char*             it;
+
+    void reserve (std::size_t n)
+    {
+      if (std::size_t ((this->buffer.data () + this->buffer.size ()) - this->it) < n)
+      {
+        this->flush ();
+      }
+    }
+  };
+
+  void toDlyFile (TextWriter& writer, const Mesh& mesh)
+  {
+    writer << "o\n";
     for (unsigned int i = 0; i < mesh.numVertices (); i++)
     {
-      stream << "v " << mesh.vertex (i) << std::endl;
+      writer << "v " << mesh.vertex (i) << '\n';
     }
     for (unsigned int i = 0; i < mesh.numIndices (); i += 3)
     {
-      stream << "f " << mesh.index (i + 0) + 1 << " " << mesh.index (i + 1) + 1 << " "
-             << mesh.index (i + 2) + 1 << std::endl;
+      writer << "f " << mesh.index (i + 0) + 1 << ' ' << mesh.index (i + 1) + 1 << ' '
+             << mesh.index (i + 2) + 1 << '\n';
     }
   }
 
-  unsigned int toDlyFile (std::ostream& stream, const SketchNode& node, unsigned int parentIndex,
+  unsigned int toDlyFile (TextWriter& writer, const SketchNode& node, unsigned int parentIndex,
                           unsigned nodeIndex)
   {
-    stream << "dly_sketch_node " << nodeIndex << " " << parentIndex << " " << node.data ().center ()
-           << " " << node.data ().radius () << std::endl;
+    writer << "dly_sketch_node " << nodeIndex << ' ' << parentIndex << ' ' << node.data ().center ()
+           << ' ' << node.data ().radius () << '\n';
 
     unsigned int childIndex = nodeIndex;
 
-    node.forEachConstChild ([&stream, nodeIndex, &childIndex](const SketchNode& child) {
-      childIndex = toDlyFile (stream, child, nodeIndex, childIndex + 1);
+    node.forEachConstChild ([&writer, nodeIndex, &childIndex](const SketchNode& child) {
+      childIndex = toDlyFile (writer, child, nodeIndex, childIndex + 1);
     });
     return childIndex;
   }
 
-  void toDlyFile (std::ostream& stream, const SketchPath& path)
+  void toDlyFile (TextWriter& writer, const SketchPath& path)
   {
     if (path.isEmpty () == false)
     {
-      stream << "dly_sketch_path"
-             << " " << path.intersectionFirst () << " " << path.intersectionLast () << std::endl;
+      writer << "dly_sketch_path"
+             << ' ' << path.intersectionFirst () << ' ' << path.intersectionLast () << '\n';
 
       for (const PrimSphere& s : path.spheres ())
       {
-        stream << "dly_sketch_sphere"
-               << " " << s.center () << " " << s.radius () << std::endl;
+        writer << "dly_sketch_sphere"
+               << ' ' << s.center () << ' ' << s.radius () << '\n';
       }
     }
   }
 
-  void toDlyFile (std::ostream& stream, const SketchMesh& mesh)
+  void toDlyFile (TextWriter& writer, const SketchTree& tree, const SketchPaths& paths)
   {
-    if (mesh.isEmpty () == false)
+    writer << "dly_sketch_mesh\n";
+
+    if (tree.hasRoot ())
     {
-      stream << "dly_sketch_mesh\n";
+      toDlyFile (writer, tree.root (), Util::invalidIndex (), 0);
+    }
 
-      if (mesh.tree ().hasRoot ())
+    for (const SketchPath& p : paths)
+    {
+      toDlyFile (writer, p);
+    }
+  }
+
+  bool addMeshes (std::vector<Mesh>& meshes, const Config& config, Scene& scene)
+  {
+    meshes.erase (std::remove_if (meshes.begin (), meshes.end (),
+                                  [](Mesh& m) { return m.numVertices () == 0; }),
+                  meshes.end ());
+
+    if (std::all_of (meshes.begin (), meshes.end (),
+                     [](Mesh& m) { return MeshUtil::checkConsistency (m); }))
+    {
+      for (Mesh& m : meshes)
       {
-        toDlyFile (stream, mesh.tree ().root (), Util::invalidIndex (), 0);
+        scene.newDynamicMesh (config, m);
       }
+      return true;
+    }
+    else
+    {
+      return false;
+    }
+  }
+
+  bool hasSuffixIgnoringCase (const std::string& string, const std::string& suffix)
+  {
+    std::string lower (string);
+    std::transform (lower.begin (), lower.end (), lower.begin (),
+                    [](unsigned char c) { return char(std::tolower (c)); });
+    return Util::hasSuffix (lower, suffix);
+  }
+
+  // Text files are split at line boundaries into chunks of at least `minChunkSize` bytes that are
+  // parsed in parallel. Vertices and faces are collected per chunk, whereas all other lines are
+  // recorded as statements, which are replayed in order of appearance, cf. `readDlyText`.
+  const std::size_t minChunkSize = 256 * 1024;
+
+  enum class Keyword
+  {
+    Object,
+    SketchMesh,
+    SketchNode,
+    SketchPath,
+    SketchSphere
+  };
+
+  struct Statement
+  {
+    Keyword      keyword;
+    unsigned int lineNumber;  // within its chunk
+    unsigned int numVertices; // vertices of its chunk that precede it
+    unsigned int numFaces;    // faces of its chunk that precede it
+    unsigned int nodeIndex;
+    unsigned int parentIndex;
+    glm::vec3    vector1;
+    glm::vec3    vector2;
+    float        radius;
+  };
+
+  struct Face
+  {
+    unsigned int numIndices;
+    unsigned int indices[4]; // one-based
+  };
+
+  struct TextChunk
+  {
+    const char*            begin;
+    const char*            end;
+    unsigned int           numLines;
+    std::vector<glm::vec3> vertices;
+    std::vector<Face>      faces;
+    std::vector<Statement> statements;
+    const char*            error; // what could not be parsed in the last line, or `nullptr`
+
+    TextChunk ()
+      : begin (nullptr)
+      , end (nullptr)
+      , numLines (0)
+      , error (nullptr)
+    {
+    }
+  };
+
+  bool isSpace (char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f'; }
+
+  bool isDigit (char c) { return c >= '0' && c <= '9'; }
+
+  // Correctly rounded unless the value is within a few ulps (of double precision) of the
+  // midpoint of two floats
+  float toFloat (std::uint64_t mantissa, int exponent, bool isNegative)
+  {
+    double value = double(mantissa);
+
+    if (mantissa == 0 || exponent < 2 * minPowerOf10)
+    {
+      value = 0.0;
+    }
+    else if (exponent < 0 && exponent >= -22)
+    {
+      value /= powerOf10 (-exponent);
+    }
+    else if (exponent < minPowerOf10)
+    {
+      value *= powerOf10 (minPowerOf10) * powerOf10 (exponent - minPowerOf10);
+    }
+    else if (exponent > maxPowerOf10)
+    {
+      value = std::numeric_limits<double>::infinity ();
+    }
+    else
+    {
+      value *= powerOf10 (exponent);
+    }
+    return float(isNegative ? -value : value);
+  }
+
+  // Scans the tokens of a line without allocations
+  struct LineScanner
+  {
+    const char* it;
+    const char* end;
+
+    LineScanner (const char* i, const char* e)
+      : it (i)
+      , end (e)
+    {
+    }
+
+    void skipSpaces ()
+    {
+      while (this->it != this->end && isSpace (*this->it))
+      {
+        this->it++;
+      }
+    }
+
+    bool isAtEnd ()
+    {
+      this->skipSpaces ();
+      return this->it == this->end;
+    }
+
+    bool keyword (const char* k)
+    {
+      this->skipSpaces ();
 
-      for (const SketchPath& p : mesh.paths ())
+      const char* i = this->it;
+      for (; *k != '\0'; k++, i++)
       {
-        toDlyFile (stream, p);
+        if (i == this->end || *i != *k)
+        {
+          return false;
+        }
+      }
+      if (i == this->end || isSpace (*i))
+      {
+        this->it = i;
+        return true;
+      }
+      return false;
+    }
+
+    bool unsignedInt (unsigned int& value)
+    {
+      this->skipSpaces ();
+
+      if (this->it == this->end || isDigit (*this->it) == false)
+      {
+        return false;
       }
+      std::uint64_t v = 0;
+      for (; this->it != this->end && isDigit (*this->it); this->it++)
+      {
+        v = (10 * v) + std::uint64_t (*this->it - '0');
+        if (v > std::numeric_limits<unsigned int>::max ())
+        {
+          return false;
+        }
+      }
+      value = (unsigned int) (v);
+      return true;
+    }
+
+    // Parses the first index of a token like `1/2/3`
+    bool faceIndex (unsigned int& value)
+    {
+      if (this->unsignedInt (value))
+      {
+        while (this->it != this->end && isSpace (*this->it) == false)
+        {
+          this->it++;
+        }
+        return true;
+      }
+      return false;
+    }
+
+    bool floating (float& value)
+    {
+      this->skipSpaces ();
+
+      const char*   i = this->it;
+      std::uint64_t mantissa = 0;
+      int           exponent = 0;
+      int           numDigits = 0; // significant digits of `mantissa`
+      bool          hasDigits = false;
+      bool          isNegative = false;
+
+      auto addDigit = [&mantissa, &exponent, &numDigits, &hasDigits](char c, bool isFraction) {
+        hasDigits = true;
+        if (numDigits < 19)
+        {
+          mantissa = (10 * mantissa) + std::uint64_t (c - '0');
+          numDigits += mantissa > 0 ? 1 : 0;
+          exponent -= isFraction ? 1 : 0;
+        }
+        else
+        {
+          exponent += isFraction ? 0 : 1;
+        }
+      };
+
+      if (i != this->end && (*i == '-' || *i == '+'))
+      {
+        isNegative = *i == '-';
+        i++;
+      }
+      for (; i != this->end && isDigit (*i); i++)
+      {
+        addDigit (*i, false);
+      }
+      if (i != this->end && *i == '.')
+      {
+        for (i++; i != this->end && isDigit (*i); i++)
+        {
+          addDigit (*i, true);
+        }
+      }
+      if (hasDigits == false)
+      {
+        return false;
+      }
+      if (i != this->end && (*i == 'e' || *i == 'E'))
+      {
+        LineScanner e (i + 1, this->end);
+        bool        isNegativeExponent = false;
+        int         value = 0;
+
+        if (e.it != e.end && (*e.it == '-' || *e.it == '+'))
+        {
+          isNegativeExponent = *e.it == '-';
+          e.it++;
+        }
+        if (e.it == e.end || isDigit (*e.it) == false)
+        {
+          return false;
+        }
+        for (; e.it != e.end && isDigit (*e.it); e.it++)
+        {
+          value = std::min ((10 * value) + (*e.it - '0'), 100000);
+        }
+        exponent += isNegativeExponent ? -value : value;
+        i = e.it;
+      }
+      value = toFloat (mantissa, exponent, isNegative);
+      this->it = i;
+      return true;
+    }
+
+    bool vec3 (glm::vec3& v)
+    {
+      return this->floating (v.x) && this->floating (v.y) && this->floating (v.z);
+    }
+  };
+
+  bool parseLine (TextChunk& chunk, LineScanner& scanner)
+  {
+    Statement s = Statement ();
+    s.lineNumber = chunk.numLines;
+    s.numVertices = chunk.vertices.size ();
+    s.numFaces = chunk.faces.size ();
+
+    if (scanner.keyword ("v"))
+    {
+      glm::vec3 vertex;
+
+      if (scanner.vec3 (vertex) == false)
+      {
+        chunk.error = "vertex";
+        return false;
+      }
+      chunk.vertices.push_back (vertex);
+    }
+    else if (scanner.keyword ("f"))
+    {
+      Face face = Face ();
+
+      if (scanner.faceIndex (face.indices[0]) == false ||
+          scanner.faceIndex (face.indices[1]) == false ||
+          scanner.faceIndex (face.indices[2]) == false)
+      {
+        chunk.error = "face";
+        return false;
+      }
+      else if (scanner.isAtEnd ())
+      {
+        face.numIndices = 3;
+      }
+      else if (scanner.faceIndex (face.indices[3]))
+      {
+        face.numIndices = 4;
+      }
+      else
+      {
+        chunk.error = "face";
+        return false;
+      }
+      chunk.faces.push_back (face);
+    }
+    else if (scanner.keyword ("o"))
+    {
+      s.keyword = Keyword::Object;
+      chunk.statements.push_back (s);
+    }
+    else if (scanner.keyword ("dly_sketch_mesh"))
+    {
+      s.keyword = Keyword::SketchMesh;
+      chunk.statements.push_back (s);
+    }
+    else if (scanner.keyword ("dly_sketch_node"))
+    {
+      s.keyword = Keyword::SketchNode;
+
+      if (scanner.unsignedInt (s.nodeIndex) == false ||
+          scanner.unsignedInt (s.parentIndex) == false || scanner.vec3 (s.vector1) == false ||
+          scanner.floating (s.radius) == false)
+      {
+        chunk.error = "sketch node";
+        return false;
+      }
+      chunk.statements.push_back (s);
+    }
+    else if (scanner.keyword ("dly_sketch_path"))
+    {
+      s.keyword = Keyword::SketchPath;
+
+      if (scanner.vec3 (s.vector1) == false || scanner.vec3 (s.vector2) == false)
+      {
+        chunk.error = "sketch path";
+        return false;
+      }
+      chunk.statements.push_back (s);
+    }
+    else if (scanner.keyword ("dly_sketch_sphere"))
+    {
+      s.keyword = Keyword::SketchSphere;
+
+      if (scanner.vec3 (s.vector1) == false || scanner.floating (s.radius) == false)
+      {
+        chunk.error = "sketch sphere";
+        return false;
+      }
+      chunk.statements.push_back (s);
+    }
+    return true;
+  }
+
+  void parseChunk (TextChunk& chunk)
+  {
+    for (const char* it = chunk.begin; it != chunk.end;)
+    {
+      const char* lineEnd =
+        static_cast<const char*> (std::memchr (it, '\n', std::size_t (chunk.end - it)));
+
+      if (lineEnd == nullptr)
+      {
+        lineEnd = chunk.end;
+      }
+      chunk.numLines++;
+
+      LineScanner scanner (it, lineEnd);
+      if (parseLine (chunk, scanner) == false)
+      {
+        return;
+      }
+      it = lineEnd == chunk.end ? lineEnd : lineEnd + 1;
     }
   }
+
+  std::vector<TextChunk> parseChunks (const char* data, std::size_t size)
+  {
+    const std::size_t  maxNumChunks = 4 * TaskPool::numThreads ();
+    const unsigned int numChunks =
+      (unsigned int) (std::min (maxNumChunks, 1 + (size / minChunkSize)));
+
+    std::vector<TextChunk> chunks (numChunks);
+    const char*            begin = data;
+    const char*            end = data + size;
+
+    for (unsigned int i = 0; i < numChunks; i++)
+    {
+      const char* split = std::max (begin, data + ((i + 1) * (size / numChunks)));
+      const char* newline =
+        i + 1 == numChunks
+          ? nullptr
+          : static_cast<const char*> (std::memchr (split, '\n', std::size_t (end - split)));
+
+      chunks[i].begin = begin;
+      chunks[i].end = newline ? newline + 1 : end;
+      begin = chunks[i].end;
+    }
+    TaskPool::parallelFor (numChunks, [&chunks](unsigned int i) { parseChunk (chunks[i]); });
+    return chunks;
+  }
+
+  bool fromDlyText (const char* data, std::size_t size, const Config& config, Scene& scene)
+  {
+    std::vector<Mesh> meshes;
+
+    const bool success = ImportExport::readDlyText (
+      data, size, [&meshes](Mesh&& mesh) { meshes.push_back (std::move (mesh)); },
+      [&config, &scene](const SketchTree& tree, const SketchPaths& paths) {
+        SketchMesh& sketch = scene.newSketchMesh (config, tree);
+
+        for (const SketchPath& p : paths)
+        {
+          sketch.addPath (p);
+        }
+      });
+
+    return success && addMeshes (meshes, config, scene);
+  }
 };
 
 namespace ImportExport
 {
-  void toDlyFile (std::ostream& stream, Scene& scene, bool isObjFile)
+  // Scene meshes are not pruned since this would invalidate the indices of recorded deltas
+  MeshCopy copyMesh (const DynamicMesh& mesh)
+  {
+    return MeshCopy{mesh.mesh (), mesh.freeVertexIndices (), mesh.freeFaceIndices ()};
+  }
+
+  // Elements are moved like `Util::prune` moves them, i.e. the compact mesh equals a pruned
+  // `DynamicMesh`
+  void withCompactMesh (const MeshCopy& copy, const std::function<void(const Mesh&)>& f)
   {
-    scene.forEachMesh ([&stream](DynamicMesh& mesh) {
-      mesh.prune ();
-      ::toDlyFile (stream, mesh.mesh ());
+    if (copy.freeVertexIndices.empty () && copy.freeFaceIndices.empty ())
+    {
+      f (copy.mesh);
+      return;
+    }
+
+    const Mesh&               mesh = copy.mesh;
+    std::vector<unsigned int> vertices (mesh.numVertices ());
+    std::vector<unsigned int> faces (mesh.numIndices () / 3);
+    std::vector<bool>         isFreeVertex (vertices.size (), false);
+    std::vector<bool>         isFreeFace (faces.size (), false);
+    std::vector<unsigned int> vertexIndexMap;
+    Mesh                      compact;
+
+    for (unsigned int i : copy.freeVertexIndices)
+    {
+      isFreeVertex[i] = true;
+    }
+    for (unsigned int i : copy.freeFaceIndices)
+    {
+      isFreeFace[i] = true;
+    }
+    std::iota (vertices.begin (), vertices.end (), 0);
+    std::iota (faces.begin (), faces.end (), 0);
+
+    Util::prune<unsigned int> (
+      vertices, [&isFreeVertex](unsigned int i) { return isFreeVertex[i]; }, &vertexIndexMap);
+    Util::prune<unsigned int> (faces, [&isFreeFace](unsigned int i) { return isFreeFace[i]; });
+
+    compact.copyNonGeometry (mesh);
+    compact.reserveVertices (vertices.size ());
+    compact.reserveIndices (3 * faces.size ());
+
+    for (unsigned int i : vertices)
+    {
+      compact.addVertex (mesh.vertex (i), mesh.normal (i));
+    }
+    for (unsigned int i : faces)
+    {
+      for (unsigned int j = 0; j < 3; j++)
+      {
+        assert (vertexIndexMap[mesh.index ((3 * i) + j)] != Util::invalidIndex ());
+        compact.addIndex (vertexIndexMap[mesh.index ((3 * i) + j)]);
+      }
+    }
+    f (compact);
+  }
+
+  SceneCopy copyScene (const Scene& scene)
+  {
+    SceneCopy copy;
+
+    scene.forEachConstMesh (
+      [&copy](const DynamicMesh& mesh) { copy.meshes.push_back (ImportExport::copyMesh (mesh)); });
+
+    scene.forEachConstMesh ([&copy](const SketchMesh& mesh) {
+      if (mesh.isEmpty () == false)
+      {
+        copy.sketchTrees.push_back (mesh.tree ());
+        copy.sketchPaths.push_back (mesh.paths ());
+      }
     });
+    return copy;
+  }
+
+  void toDlyFile (std::ostream& stream, const SceneCopy& scene, bool isObjFile)
+  {
+    TextWriter writer (stream);
+
+    for (const MeshCopy& mesh : scene.meshes)
+    {
+      ImportExport::withCompactMesh (mesh, [&writer](const Mesh& m) { ::toDlyFile (writer, m); });
+    }
 
     if (isObjFile == false)
     {
-      scene.forEachConstMesh ([&stream](const SketchMesh& mesh) { ::toDlyFile (stream, mesh); });
+      for (unsigned int i = 0; i < scene.sketchTrees.size (); i++)
+      {
+        ::toDlyFile (writer, scene.sketchTrees[i], scene.sketchPaths[i]);
+      }
     }
   }
 
-  bool toDlyFile (const std::string& fileName, Scene& scene, bool isObjFile)
+  bool toDlyFile (const std::string& fileName, const SceneCopy& scene, bool isObjFile)
   {
-    std::ofstream file (fileName);
+    const bool    isDlbFile = isObjFile == false && Util::hasSuffix (fileName, ".dlb");
+    std::ofstream file (fileName, isDlbFile ? std::ios::binary : std::ios::out);
 
     if (file.is_open ())
     {
-      ImportExport::toDlyFile (file, scene, isObjFile);
+      if (isDlbFile)
+      {
+        ImportExport::toDlbFile (file, scene);
+      }
+      else
+      {
+        ImportExport::toDlyFile (file, scene, isObjFile);
+      }
       file.close ();
-      return true;
+      return file.fail () == false;
     }
     else
     {
@@ -124,242 +871,240 @@ namespace ImportExport
 
   bool fromDlyFile (std::istream& stream, const Config& config, Scene& scene)
   {
-    unsigned int       lineNumber = 0;
-    std::istringstream lineStream;
+    const std::string data ((std::istreambuf_iterator<char> (stream)),
+                            std::istreambuf_iterator<char> ());
+
+    return fromDlyText (data.data (), data.size (), config, scene);
+  }
+
+  bool fromDlyFile (const std::string& fileName, const Config& config, Scene& scene)
+  {
+    QFile file (fileName.c_str ());
+
+    if (file.open (QIODevice::ReadOnly) == false)
+    {
+      return false;
+    }
+
+    // Files are read in place unless they cannot be mapped into memory
+    const unsigned char* data = file.size () > 0 ? file.map (0, file.size ()) : nullptr;
+    std::size_t          size = std::size_t (file.size ());
+    QByteArray           bytes;
+
+    if (data == nullptr)
+    {
+      bytes = file.readAll ();
+      data = reinterpret_cast<const unsigned char*> (bytes.constData ());
+      size = std::size_t (bytes.size ());
+    }
+
+    if (Dlb::isDlb (data, size))
+    {
+      return ImportExport::fromDlbFile (data, size, config, scene);
+    }
+    else if (Ply::isPly (data, size) || hasSuffixIgnoringCase (fileName, ".ply"))
+    {
+      std::vector<Mesh> meshes (1);
+      return Ply::read (data, size, meshes[0]) && addMeshes (meshes, config, scene);
+    }
+    else if (Stl::isStl (data, size) || hasSuffixIgnoringCase (fileName, ".stl"))
+    {
+      std::vector<Mesh> meshes (1);
+      return Stl::read (data, size, meshes[0]) && addMeshes (meshes, config, scene);
+    }
+    else
+    {
+      return fromDlyText (reinterpret_cast<const char*> (data), size, config, scene);
+    }
+  }
+
+  bool readDlyText (const char* data, std::size_t size, const Dlb::MeshCallback& meshCallback,
+                    const Dlb::SketchCallback& sketchCallback, unsigned int* errorLine)
+  {
+    const std::vector<TextChunk> chunks = parseChunks (data, size);
 
-    std::vector<Mesh>        meshes;
+    Mesh                     mesh;
+    SketchTree               tree;
+    SketchPaths              paths;
     std::vector<SketchNode*> nodes;
-    SketchMesh*              sketch = nullptr;
+    bool                     isSketch = false;
     SketchPath*              sketchPath = nullptr;
     glm::vec3                intersectionFirst, intersectionLast;
+    unsigned int             lineOffset = 0;
 
-    auto extractFirst = [](const std::string& string, unsigned int& value) -> bool {
-      auto slashPos = string.find ('/');
-      return Util::fromString (string.substr (0, slashPos), value);
+    const auto fail = [errorLine](unsigned int lineNumber) {
+      if (errorLine)
+      {
+        *errorLine = lineNumber;
+      }
+      return false;
     };
 
-    auto nextLine = [&stream, &lineNumber, &lineStream]() -> bool {
-      std::string line;
-      std::getline (stream, line);
-
-      if (stream)
+    const auto finishMesh = [&mesh, &meshCallback]() {
+      if (mesh.numVertices () > 0)
       {
-        lineNumber++;
-        lineStream.clear ();
-        lineStream.str (line);
-        return true;
+        meshCallback (std::move (mesh));
       }
-      else
+      mesh.reset ();
+    };
+
+    const auto finishSketch = [&tree, &paths, &nodes, &isSketch, &sketchPath, &sketchCallback]() {
+      if (isSketch)
       {
-        return false;
+        sketchCallback (tree, paths);
       }
+      tree.reset ();
+      paths.clear ();
+      nodes.clear ();
+      sketchPath = nullptr;
     };
 
-    while (nextLine ())
-    {
-      std::string keyword;
-      lineStream >> keyword;
-
-      if (lineStream.fail () == false)
+    auto addGeometry = [&mesh](const TextChunk& chunk, unsigned int& vertexIndex,
+                               unsigned int& faceIndex, unsigned int numVertices,
+                               unsigned int numFaces) {
+      for (; vertexIndex < numVertices; vertexIndex++)
+      {
+        mesh.addVertex (chunk.vertices[vertexIndex]);
+      }
+      for (; faceIndex < numFaces; faceIndex++)
       {
-        if (keyword == "o")
+        const Face& f = chunk.faces[faceIndex];
+
+        if (f.numIndices == 3)
         {
-          meshes.push_back (Mesh ());
+          MeshUtil::addFace (mesh, f.indices[0] - 1, f.indices[1] - 1, f.indices[2] - 1);
         }
-        else if (keyword == "v")
+        else
         {
-          glm::vec3 vertex;
-          lineStream >> vertex;
-
-          if (lineStream.fail ())
-          {
-            DILAY_WARN ("could not parse vertex at line %u", lineNumber)
-            return false;
-          }
-          else
-          {
-            if (meshes.empty ())
-            {
-              meshes.push_back (Mesh ());
-            }
-            meshes.back ().addVertex (vertex);
-          }
+          MeshUtil::addFace (mesh, f.indices[0] - 1, f.indices[1] - 1, f.indices[2] - 1,
+                             f.indices[3] - 1);
         }
-        else if (keyword == "f")
+      }
+    };
+
+    for (const TextChunk& chunk : chunks)
+    {
+      unsigned int vertexIndex = 0;
+      unsigned int faceIndex = 0;
+
+      for (const Statement& s : chunk.statements)
+      {
+        const unsigned int lineNumber = lineOffset + s.lineNumber;
+
+        addGeometry (chunk, vertexIndex, faceIndex, s.numVertices, s.numFaces);
+
+        switch (s.keyword)
         {
-          std::string  v1String, v2String, v3String;
-          unsigned int v1, v2, v3;
-
-          lineStream >> v1String >> v2String >> v3String;
-
-          if (lineStream.fail () || extractFirst (v1String, v1) == false ||
-              extractFirst (v2String, v2) == false || extractFirst (v3String, v3) == false)
-          {
-            DILAY_WARN ("could not parse face at line %u", lineNumber)
-            return false;
-          }
-          else
-          {
-            std::string  v4String;
-            unsigned int v4;
-            lineStream >> v4String;
-
-            if (lineStream.fail ())
-            {
-              lineStream.clear ();
+          case Keyword::Object:
+            finishMesh ();
+            break;
 
-              if (meshes.empty ())
-              {
-                meshes.push_back (Mesh ());
-              }
-              MeshUtil::addFace (meshes.back (), v1 - 1, v2 - 1, v3 - 1);
-            }
-            else if (extractFirst (v4String, v4) == false)
+          case Keyword::SketchMesh:
+            finishSketch ();
+            isSketch = true;
+            break;
+
+          case Keyword::SketchNode:
+            if (isSketch == false)
             {
-              DILAY_WARN ("could not parse face at line %u", lineNumber)
-              return false;
+              DILAY_WARN ("could not parse sketch node: no sketch found at line %u", lineNumber)
+              return fail (lineNumber);
             }
-            else
+            else if (s.nodeIndex != nodes.size ())
             {
-              if (meshes.empty ())
-              {
-                meshes.push_back (Mesh ());
-              }
-              MeshUtil::addFace (meshes.back (), v1 - 1, v2 - 1, v3 - 1, v4 - 1);
+              DILAY_WARN ("invalid node index at line %u", lineNumber)
+              return fail (lineNumber);
             }
-          }
-        }
-        else if (keyword == "dly_sketch_mesh")
-        {
-          nodes.clear ();
-          sketch = &scene.newSketchMesh (config, SketchTree ());
-        }
-        else if (keyword == "dly_sketch_node")
-        {
-          if (sketch == nullptr)
-          {
-            DILAY_WARN ("could not parse sketch node: no sketch found at line %u", lineNumber)
-            return false;
-          }
-          unsigned int nodeIndex;
-          unsigned int parentIndex;
-          glm::vec3    center;
-          float        radius;
-
-          lineStream >> nodeIndex >> parentIndex >> center >> radius;
-
-          if (lineStream.fail ())
-          {
-            DILAY_WARN ("could not parse sketch node at line %u", lineNumber)
-            return false;
-          }
-
-          if (nodeIndex == nodes.size ())
-          {
-            if (nodeIndex == 0)
+            else if (s.nodeIndex == 0)
             {
-              nodes.push_back (&sketch->tree ().emplaceRoot (PrimSphere (center, radius)));
+              nodes.push_back (&tree.emplaceRoot (PrimSphere (s.vector1, s.radius)));
             }
-            else if (parentIndex < nodes.size ())
+            else if (s.parentIndex < nodes.size ())
             {
-              nodes.push_back (&nodes.at (parentIndex)->emplaceChild (PrimSphere (center, radius)));
+              nodes.push_back (
+                &nodes.at (s.parentIndex)->emplaceChild (PrimSphere (s.vector1, s.radius)));
             }
             else
             {
               DILAY_WARN ("invalid parent index at line %u", lineNumber)
-              return false;
+              return fail (lineNumber);
             }
-          }
-          else
-          {
-            DILAY_WARN ("invalid node index at line %u", lineNumber)
-            return false;
-          }
-        }
-        else if (keyword == "dly_sketch_path")
-        {
-          lineStream >> intersectionFirst >> intersectionLast;
-
-          if (lineStream.fail ())
-          {
-            DILAY_WARN ("could not parse sketch path at line %u", lineNumber)
-            return false;
-          }
-          if (sketch)
-          {
-            sketchPath = &sketch->addPath (SketchPath ());
-          }
-          else
-          {
-            DILAY_WARN ("could not parse sketch path: no sketch found at line %u", lineNumber)
-            return false;
-          }
-        }
-        else if (keyword == "dly_sketch_sphere")
-        {
-          glm::vec3 center;
-          float     radius;
-
-          lineStream >> center >> radius;
+            break;
 
-          if (lineStream.fail ())
-          {
-            DILAY_WARN ("could not parse sketch sphere at line %u", lineNumber)
-            return false;
-          }
-
-          if (sketchPath)
-          {
-            if (sketchPath->isEmpty ())
+          case Keyword::SketchPath:
+            if (isSketch == false)
             {
-              sketchPath->addSphere (intersectionFirst, center, radius);
+              DILAY_WARN ("could not parse sketch path: no sketch found at line %u", lineNumber)
+              return fail (lineNumber);
             }
-            else
+            intersectionFirst = s.vector1;
+            intersectionLast = s.vector2;
+            paths.push_back (SketchPath ());
+            sketchPath = &paths.back ();
+            break;
+
+          case Keyword::SketchSphere:
+            if (sketchPath == nullptr)
             {
-              sketchPath->addSphere (intersectionLast, center, radius);
+              DILAY_WARN ("could not parse sketch sphere: no sketch path found at line %u",
+                          lineNumber)
+              return fail (lineNumber);
             }
-          }
-          else
-          {
-            DILAY_WARN ("could not parse sketch sphere: no sketch path found at line %u",
-                        lineNumber)
-            return false;
-          }
+            sketchPath->addSphere (sketchPath->isEmpty () ? intersectionFirst : intersectionLast,
+                                   s.vector1, s.radius);
+            break;
         }
       }
-    }
-    meshes.erase (std::remove_if (meshes.begin (), meshes.end (),
-                                  [](Mesh& m) { return m.numVertices () == 0; }),
-                  meshes.end ());
+      addGeometry (chunk, vertexIndex, faceIndex, chunk.vertices.size (), chunk.faces.size ());
 
-    if (std::all_of (meshes.begin (), meshes.end (),
-                     [](Mesh& m) { return MeshUtil::checkConsistency (m); }))
-    {
-      for (Mesh& m : meshes)
+      if (chunk.error)
       {
-        scene.newDynamicMesh (config, m);
+        DILAY_WARN ("could not parse %s at line %u", chunk.error, lineOffset + chunk.numLines)
+        return fail (lineOffset + chunk.numLines);
       }
-      return true;
-    }
-    else
-    {
-      return false;
+      lineOffset += chunk.numLines;
     }
+    finishMesh ();
+    finishSketch ();
+    return true;
   }
 
-  bool fromDlyFile (const std::string& fileName, const Config& config, Scene& scene)
+  bool isMeshFile (const std::string& fileName)
   {
-    std::ifstream file (fileName);
+    return hasSuffixIgnoringCase (fileName, ".stl") || hasSuffixIgnoringCase (fileName, ".ply");
+  }
 
-    if (file.is_open ())
+  void toDlbFile (std::ostream& stream, const SceneCopy& scene)
+  {
+    Dlb::writeHeader (stream);
+
+    for (const MeshCopy& mesh : scene.meshes)
     {
-      const bool success = ImportExport::fromDlyFile (file, config, scene);
-      file.close ();
-      return success;
+      ImportExport::withCompactMesh (mesh,
+                                     [&stream](const Mesh& m) { Dlb::writeMesh (stream, m); });
     }
-    else
+    for (unsigned int i = 0; i < scene.sketchTrees.size (); i++)
     {
-      return false;
+      Dlb::writeSketch (stream, scene.sketchTrees[i], scene.sketchPaths[i]);
     }
   }
+
+  bool fromDlbFile (const unsigned char* data, std::size_t size, const Config& config,
+                    Scene& scene)
+  {
+    std::vector<Mesh> meshes;
+
+    const bool success = Dlb::read (
+      data, size, [&meshes](Mesh&& mesh) { meshes.push_back (std::move (mesh)); },
+      [&config, &scene](const SketchTree& tree, const SketchPaths& paths) {
+        SketchMesh& sketch = scene.newSketchMesh (config, tree);
+
+        for (const SketchPath& p : paths)
+        {
+          sketch.addPath (p);
+        }
+      });
+
+    return success && addMeshes (meshes, config, scene);
+  }
 };
@@ -5,18 +5,62 @@
 #ifndef DILAY_IMPORT_EXPORT
 #define DILAY_IMPORT_EXPORT
 
+#include <cstddef>
+#include <functional>
 #include <iosfwd>
 #include <string>
+#include <vector>
+#include "dlb.hpp"
+#include "mesh.hpp"
+#include "sketch/fwd.hpp"
+#include "sketch/path.hpp"
 
 class Config;
+class DynamicMesh;
 class Scene;
 
 namespace ImportExport
 {
-  void toDlyFile (std::ostream&, Scene&, bool);
-  bool toDlyFile (const std::string&, Scene&, bool);
-  bool fromDlyFile (std::istream&, const Config&, Scene&);
-  bool fromDlyFile (const std::string&, const Config&, Scene&);
+  // Copy of the geometry of a dynamic mesh including its free elements, i.e. the copy is cheap to
+  // take and is compacted by `withCompactMesh`, e.g. by another thread.
+  struct MeshCopy
+  {
+    Mesh                      mesh;
+    std::vector<unsigned int> freeVertexIndices;
+    std::vector<unsigned int> freeFaceIndices;
+  };
+
+  // Copies of the meshes and the non-empty sketches of a scene, i.e. a consistent state of the
+  // scene that can be written by another thread while the scene is modified
+  struct SceneCopy
+  {
+    std::vector<MeshCopy>    meshes;
+    std::vector<SketchTree>  sketchTrees;
+    std::vector<SketchPaths> sketchPaths;
+  };
+
+  MeshCopy  copyMesh (const DynamicMesh&);
+  void      withCompactMesh (const MeshCopy&, const std::function<void(const Mesh&)>&);
+  SceneCopy copyScene (const Scene&);
+  void      toDlyFile (std::ostream&, const SceneCopy&, bool);
+  bool      toDlyFile (const std::string&, const SceneCopy&, bool);
+  bool      fromDlyFile (std::istream&, const Config&, Scene&);
+  bool      fromDlyFile (const std::string&, const Config&, Scene&);
+
+  // Reads a text file, i.e. calls the callbacks for all meshes and sketches in order of
+  // appearance, cf. `Dlb::read`. The number of the line that could not be read is stored in the
+  // last argument if reading fails.
+  bool readDlyText (const char*, std::size_t, const Dlb::MeshCallback&,
+                    const Dlb::SketchCallback&, unsigned int* = nullptr);
+
+  // Binary Dilay files, cf. `Dlb`. Files ending with `.dlb` are written in binary format, and
+  // `fromDlyFile` reads binary files regardless of their name.
+  void toDlbFile (std::ostream&, const SceneCopy&);
+  bool fromDlbFile (const unsigned char*, std::size_t, const Config&, Scene&);
+
+  // Binary STL and PLY files, cf. `Stl` and `Ply`, are recognized by `fromDlyFile` by their
+  // content or their name. Their meshes are imported, i.e. scenes are never written to them.
+  bool isMeshFile (const std::string&);
 };
 
 #endif
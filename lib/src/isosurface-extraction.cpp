@@ -2,182 +2,375 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <atomic>
+#include <functional>
 #include <glm/glm.hpp>
 #include <glm/gtx/norm.hpp>
-#include <thread>
 #include <vector>
 #include "distance.hpp"
 #include "dynamic/mesh.hpp"
 #include "intersection.hpp"
 #include "isosurface-extraction.hpp"
 #include "isosurface-extraction/grid.hpp"
+#include "maybe.hpp"
 #include "mesh.hpp"
 #include "primitive/ray.hpp"
+#include "task-pool.hpp"
 #include "util.hpp"
 
 namespace
 {
-  typedef IsosurfaceExtraction::DistanceCallback     DistanceCallback;
-  typedef IsosurfaceExtraction::IntersectionCallback IntersectionCallback;
+  typedef IsosurfaceExtraction::DistanceCallback      DistanceCallback;
+  typedef IsosurfaceExtraction::BatchDistanceCallback BatchDistanceCallback;
+  typedef IsosurfaceExtraction::IntersectionCallback  IntersectionCallback;
+  typedef IsosurfaceExtraction::Phase                 Phase;
+  typedef IsosurfaceExtraction::ProgressCallback      ProgressCallback;
 
   static const float markInside = -0.5f;
   static const float markOutside = 0.5f;
   static const float markInsideToSample = -0.6f;
   static const float markOutsideToSample = 0.6f;
 
-  struct Parameters
+  // Grids with more samples are extracted in slices, cf. `setMaxNumDenseSamples`
+  static const unsigned int defaultMaxNumDenseSamples = 1 << 24;
+  std::atomic<unsigned int> maxNumDenseSamples (defaultMaxNumDenseSamples);
+
+  // cf. `setSparseSampling`
+  std::atomic<bool> isSparseSampling (true);
+
+  // Intersections of a ray along z with the surface. Samples of a column are marked as inside
+  // if they are in front of `end` and if an odd number of `toggles` is not greater than their
+  // z index.
+  struct Column
   {
-    const DistanceCallback&     getDistance;
-    const IntersectionCallback* getIntersection;
-    IsosurfaceExtractionGrid    grid;
+    std::vector<unsigned int> toggles;
+    unsigned int              end;
 
-    Parameters (const DistanceCallback& d, const IntersectionCallback* i, const PrimAABox& b,
-                float r)
-      : getDistance (d)
-      , getIntersection (i)
-      , grid (b, r)
+    Column ()
+      : end (0)
+    {
+    }
+
+    bool isInside (unsigned int z) const
     {
+      bool inside = false;
+      for (unsigned int i = 0; i < this->toggles.size () && this->toggles[i] <= z; i++)
+      {
+        inside = not inside;
+      }
+      return inside && z < this->end;
     }
   };
 
-  void sampleDistancesThread (Parameters& params, unsigned int numThreads, unsigned int threadId)
+  struct Parameters
   {
-    std::vector<float>& samples = params.grid.samples ();
+    const BatchDistanceCallback& getDistances;
+    const IntersectionCallback*  getIntersection;
+    IsosurfaceExtractionGrid     grid;
+    const float                  tolerance;
+    const ProgressCallback&      progress;
+    std::atomic<bool>            isCanceled;
+    std::vector<Column>          columns;
+
+    Parameters (const BatchDistanceCallback& d, const IntersectionCallback* i, const PrimAABox& b,
+                float r, float t, const ProgressCallback& p)
+      : getDistances (d)
+      , getIntersection (i)
+      , grid (b, r, maxNumDenseSamples)
+      , tolerance (t)
+      , progress (p)
+      , isCanceled (false)
+    {
+    }
 
-    for (unsigned int z = 0; z < params.grid.numSamples ().z; z++)
+    // returns false if the extraction has been canceled
+    bool report (Phase phase, float p)
     {
-      for (unsigned int y = 0; y < params.grid.numSamples ().y; y++)
+      if (this->isCanceled == false && this->progress && this->progress (phase, p) == false)
       {
-        for (unsigned int x = 0; x < params.grid.numSamples ().x; x++)
-        {
-          const unsigned int index = params.grid.sampleIndex (x, y, z);
+        this->isCanceled = true;
+      }
+      return this->isCanceled == false;
+    }
+  };
 
-          if (index % numThreads == threadId)
-          {
-            const glm::vec3 pos = params.grid.samplePos (x, y, z);
+  // Samples are processed in bricks of `brickSize`^3 samples that are handed out dynamically to
+  // the threads of `TaskPool`. A brick is small enough to stay in cache and large enough to
+  // amortize its hand-out. Bricks are skipped once the extraction has been canceled.
+  static const unsigned int brickSize = 16;
 
-            if (params.getIntersection)
-            {
-              if (samples[index] == markInsideToSample)
-              {
-                samples[index] = -params.getDistance (pos);
-              }
-              else if (samples[index] == markOutsideToSample)
-              {
-                samples[index] = params.getDistance (pos);
-              }
-              else
-              {
-                continue;
-              }
-            }
-            else
-            {
-              assert (samples[index] == Util::maxFloat ());
-              samples[index] = params.getDistance (pos);
-            }
-            assert (Util::isNaN (samples[index]) == false);
-            assert (samples[index] != Util::maxFloat ());
-            assert ((x > 0 && x < params.grid.numSamples ().x - 1) || samples[index] > 0.0f);
-            assert ((y > 0 && y < params.grid.numSamples ().y - 1) || samples[index] > 0.0f);
-            assert ((z > 0 && z < params.grid.numSamples ().z - 1) || samples[index] > 0.0f);
-          }
-        }
+  typedef std::function<void(const glm::uvec3&, const glm::uvec3&)> BrickCallback;
+
+  // The progress of the given phase is the fraction of finished bricks.
+  void forEachBrick (Parameters& params, const Maybe<Phase>& phase, const glm::uvec3& begin,
+                     const glm::uvec3& end, const BrickCallback& f)
+  {
+    const glm::uvec3          numBricks = (end - begin + glm::uvec3 (brickSize - 1)) / brickSize;
+    const unsigned int        totalNumBricks = numBricks.x * numBricks.y * numBricks.z;
+    std::atomic<unsigned int> numFinished (0);
+
+    TaskPool::parallelFor (totalNumBricks, [&params, &phase, &begin, &end, &numBricks,
+                                            totalNumBricks, &numFinished, &f](unsigned int i) {
+      if (params.isCanceled)
+      {
+        return;
       }
-    }
+      const glm::uvec3 brick (i % numBricks.x, (i / numBricks.x) % numBricks.y,
+                              i / (numBricks.x * numBricks.y));
+      const glm::uvec3 min = begin + (brick * brickSize);
+      const glm::uvec3 max = glm::min (min + brickSize, end);
+
+      f (min, max);
+
+      const unsigned int n = ++numFinished;
+      if (phase)
+      {
+        params.report (*phase, float(n) / float(totalNumBricks));
+      }
+    });
   }
 
-  void sampleDistances (Parameters& params)
+  // Positions of samples that are evaluated together. A batch is reused for all samples of a
+  // brick.
+  struct DistanceBatch
   {
-    const unsigned int       numThreads = std::thread::hardware_concurrency ();
-    std::vector<std::thread> threads;
+    std::vector<glm::uvec3> samples;
+    std::vector<glm::vec3>  positions;
+    std::vector<float>      distances;
 
-    for (unsigned int i = 0; i < numThreads; i++)
+    void reset ()
     {
-      threads.emplace_back (sampleDistancesThread, std::ref (params), numThreads, i);
+      this->samples.clear ();
+      this->positions.clear ();
     }
-    for (unsigned int i = 0; i < numThreads; i++)
+
+    void add (const Parameters& params, unsigned int x, unsigned int y, unsigned int z)
     {
-      threads.at (i).join ();
+      this->samples.emplace_back (x, y, z);
+      this->positions.push_back (params.grid.samplePos (x, y, z));
     }
+
+    void evaluate (Parameters& params)
+    {
+      this->distances.resize (this->positions.size ());
+
+      if (this->positions.empty () == false)
+      {
+        params.getDistances (this->positions, this->distances);
+      }
+    }
+  };
+
+  float evaluateDistance (Parameters& params, const glm::vec3& position)
+  {
+    const std::vector<glm::vec3> positions (1, position);
+    std::vector<float>           distances (1);
+
+    params.getDistances (positions, distances);
+    return distances[0];
   }
 
-  void sampleIntersectionsThread (Parameters& params, unsigned int numThreads,
-                                  unsigned int threadId)
+  bool needsSample (const Parameters& params, float sample)
   {
-    assert (params.getIntersection);
+    if (params.getIntersection)
+    {
+      return sample == markInsideToSample || sample == markOutsideToSample;
+    }
+    else
+    {
+      assert (sample == Util::maxFloat ());
+      return true;
+    }
+  }
 
+  void setSample (Parameters& params, const glm::uvec3& sample, float distance)
+  {
     std::vector<float>& samples = params.grid.samples ();
+    const unsigned int  index = params.grid.sampleIndex (sample.x, sample.y, sample.z);
+
+    samples[index] = samples[index] == markInsideToSample ? -distance : distance;
+
+    assert (Util::isNaN (samples[index]) == false);
+    assert (samples[index] != Util::maxFloat ());
+    assert ((sample.x > 0 && sample.x < params.grid.numSamples ().x - 1) || samples[index] > 0.0f);
+    assert ((sample.y > 0 && sample.y < params.grid.numSamples ().y - 1) || samples[index] > 0.0f);
+    assert ((sample.z > 0 && sample.z < params.grid.numSamples ().z - 1) || samples[index] > 0.0f);
+  }
 
-    for (unsigned int y = 0; y < params.grid.numSamples ().y; y++)
+  void setSamples (Parameters& params, const DistanceBatch& batch)
+  {
+    for (unsigned int i = 0; i < batch.samples.size (); i++)
     {
-      for (unsigned int x = 0; x < params.grid.numSamples ().x; x++)
+      setSample (params, batch.samples[i], batch.distances[i]);
+    }
+  }
+
+  void addDenseSamples (Parameters& params, DistanceBatch& batch, const glm::uvec3& min,
+                        const glm::uvec3& max)
+  {
+    std::vector<float>& samples = params.grid.samples ();
+
+    for (unsigned int z = min.z; z < max.z; z++)
+    {
+      for (unsigned int y = min.y; y < max.y; y++)
       {
-        if (params.grid.sampleIndex (x, y, 0) % numThreads == threadId)
+        for (unsigned int x = min.x; x < max.x; x++)
         {
-          const glm::vec3 dir (0.0f, 0.0f, 1.0f);
-          bool            inside = false;
-          unsigned int    z = 0;
-          Intersection    intersection;
-          PrimRay         ray (params.grid.samplePos (x, y, 0.0f) - (dir * Util::epsilon ()), dir);
-
-          while (true)
+          if (needsSample (params, samples[params.grid.sampleIndex (x, y, z)]))
           {
-            intersection.reset ();
-            IsosurfaceExtraction::Intersection i = (*params.getIntersection) (ray, intersection);
+            batch.add (params, x, y, z);
+          }
+        }
+      }
+    }
+  }
 
-            if (i == IsosurfaceExtraction::Intersection::None)
-            {
-              break;
-            }
-            else
-            {
-              const float d2 = intersection.distance () * intersection.distance ();
+  // Boxes of samples are refined until they are at most `minSparseSize` samples wide. A box whose
+  // center is farther from the surface than the box's diagonal lies entirely on one side of the
+  // surface, and so do all cubes that share its samples. Its samples are set to the distance of
+  // its center, which yields the same mesh as sampling them, as long as the distance callback
+  // never overestimates distances.
+  static const unsigned int minSparseSize = 4;
 
-              while (glm::distance2 (params.grid.samplePos (x, y, z), ray.origin ()) < d2)
-              {
-                const unsigned int index = params.grid.sampleIndex (x, y, z);
+  void addSparseSamples (Parameters& params, DistanceBatch& batch, const glm::uvec3& min,
+                         const glm::uvec3& max)
+  {
+    const glm::uvec3 size = max - min;
 
-                assert (samples[index] == Util::maxFloat ());
-                samples[index] = inside ? markInside : markOutside;
+    if (size.x <= minSparseSize && size.y <= minSparseSize && size.z <= minSparseSize)
+    {
+      addDenseSamples (params, batch, min, max);
+      return;
+    }
 
-                z++;
-              }
-              ray.origin (intersection.position () + (dir * Util::epsilon ()));
+    const glm::vec3 minPos = params.grid.samplePos (min.x, min.y, min.z);
+    const glm::vec3 maxPos = params.grid.samplePos (max.x - 1, max.y - 1, max.z - 1);
+    const float     distance = evaluateDistance (params, (minPos + maxPos) * 0.5f);
 
-              if (i == IsosurfaceExtraction::Intersection::Sample)
-              {
-                inside = not inside;
-              }
-            }
-          }
+    if (glm::abs (distance) > glm::distance (minPos, maxPos))
+    {
+      std::vector<float>& samples = params.grid.samples ();
 
-          assert (z < params.grid.numSamples ().z - 1);
-          for (; z < params.grid.numSamples ().z; z++)
+      for (unsigned int z = min.z; z < max.z; z++)
+      {
+        for (unsigned int y = min.y; y < max.y; y++)
+        {
+          for (unsigned int x = min.x; x < max.x; x++)
           {
             const unsigned int index = params.grid.sampleIndex (x, y, z);
 
             assert (samples[index] == Util::maxFloat ());
-            samples[index] = markOutside;
+            samples[index] = distance;
           }
         }
       }
     }
+    else
+    {
+      const glm::uvec3 mid = min + glm::max (size / 2u, glm::uvec3 (1));
+
+      for (unsigned int i = 0; i < 8; i++)
+      {
+        const glm::uvec3 childMin ((i & 1) ? mid.x : min.x, (i & 2) ? mid.y : min.y,
+                                   (i & 4) ? mid.z : min.z);
+        const glm::uvec3 childMax ((i & 1) ? max.x : mid.x, (i & 2) ? max.y : mid.y,
+                                   (i & 4) ? max.z : mid.z);
+
+        if (childMin.x < childMax.x && childMin.y < childMax.y && childMin.z < childMax.z)
+        {
+          addSparseSamples (params, batch, childMin, childMax);
+        }
+      }
+    }
   }
 
-  void sampleIntersections (Parameters& params)
+  // Samples distances of slices `[zBegin, zEnd)`. Without an intersection callback, distances
+  // are sampled sparsely. Otherwise, only marked samples near the surface are sampled anyway.
+  // Streaming extractions report the progress of slices instead of bricks.
+  void sampleDistances (Parameters& params, unsigned int zBegin, unsigned int zEnd)
   {
-    const unsigned int       numThreads = std::thread::hardware_concurrency ();
-    std::vector<std::thread> threads;
+    const glm::uvec3   begin (0, 0, zBegin);
+    const glm::uvec3   end (params.grid.numSamples ().x, params.grid.numSamples ().y, zEnd);
+    const Maybe<Phase> phase =
+      params.grid.isStreaming () ? Maybe<Phase> () : Maybe<Phase> (Phase::Distances);
 
-    for (unsigned int i = 0; i < numThreads; i++)
-    {
-      threads.emplace_back (sampleIntersectionsThread, std::ref (params), numThreads, i);
-    }
-    for (unsigned int i = 0; i < numThreads; i++)
+    forEachBrick (params, phase, begin, end, [&params](const glm::uvec3& min,
+                                                       const glm::uvec3& max) {
+      DistanceBatch batch;
+
+      if (params.getIntersection || isSparseSampling == false)
+      {
+        addDenseSamples (params, batch, min, max);
+      }
+      else
+      {
+        addSparseSamples (params, batch, min, max);
+      }
+      batch.evaluate (params);
+      setSamples (params, batch);
+    });
+  }
+
+  void sampleIntersections (Parameters& params, unsigned int x, unsigned int y)
+  {
+    assert (params.getIntersection);
+
+    Column&         column = params.columns[(y * params.grid.numSamples ().x) + x];
+    const glm::vec3 dir (0.0f, 0.0f, 1.0f);
+    unsigned int    z = 0;
+    Intersection    intersection;
+    PrimRay         ray (params.grid.samplePos (x, y, 0.0f) - (dir * Util::epsilon ()), dir);
+
+    while (true)
     {
-      threads.at (i).join ();
+      intersection.reset ();
+      IsosurfaceExtraction::Intersection i = (*params.getIntersection) (ray, intersection);
+
+      if (i == IsosurfaceExtraction::Intersection::None)
+      {
+        break;
+      }
+      else
+      {
+        const float d2 = intersection.distance () * intersection.distance ();
+
+        while (glm::distance2 (params.grid.samplePos (x, y, z), ray.origin ()) < d2)
+        {
+          z++;
+        }
+        ray.origin (intersection.position () + (dir * Util::epsilon ()));
+
+        if (i == IsosurfaceExtraction::Intersection::Sample)
+        {
+          column.toggles.push_back (z);
+        }
+      }
     }
+
+    assert (z < params.grid.numSamples ().z - 1);
+    column.end = z;
+  }
+
+  // Casts a ray along each column of samples. Samples are marked per slice afterwards, i.e.
+  // intersections are stored per column and never for the whole grid.
+  void sampleIntersections (Parameters& params)
+  {
+    const glm::uvec3 numColumns (params.grid.numSamples ().x, params.grid.numSamples ().y, 1);
+
+    params.columns.clear ();
+    params.columns.resize (numColumns.x * numColumns.y);
+
+    // rays run along z, i.e. bricks are tiles of columns
+    forEachBrick (params, Phase::Intersections, glm::uvec3 (0), numColumns,
+                  [&params](const glm::uvec3& min, const glm::uvec3& max) {
+                    for (unsigned int y = min.y; y < max.y; y++)
+                    {
+                      for (unsigned int x = min.x; x < max.x; x++)
+                      {
+                        sampleIntersections (params, x, y);
+                      }
+                    }
+                  });
   }
 
   bool isIntersecting (float s1, float s2)
@@ -185,82 +378,230 @@ namespace
     return (s1 < 0.0f && s2 >= 0.0f) || (s1 >= 0.0f && s2 < 0.0f);
   }
 
-  void markSamplePositions (Parameters& params)
+  // Samples at the border of the grid are always outside, i.e. the surface is clipped by the
+  // bounds if the bounds do not enclose it.
+  void markSamples (Parameters& params, unsigned int z)
   {
     std::vector<float>& samples = params.grid.samples ();
+    const glm::uvec3&   numSamples = params.grid.numSamples ();
+    const bool          isBorderSlice = z == 0 || z == numSamples.z - 1;
 
-    for (unsigned int z = 0; z < params.grid.numCubes ().z; z++)
+    for (unsigned int y = 0; y < numSamples.y; y++)
     {
-      for (unsigned int y = 0; y < params.grid.numCubes ().y; y++)
+      for (unsigned int x = 0; x < numSamples.x; x++)
       {
-        for (unsigned int x = 0; x < params.grid.numCubes ().x; x++)
-        {
-          const unsigned int cubeIndex = params.grid.cubeIndex (x, y, z);
+        const Column&      column = params.columns[(y * numSamples.x) + x];
+        const unsigned int index = params.grid.sampleIndex (x, y, z);
+        const bool         isBorder =
+          isBorderSlice || x == 0 || x == numSamples.x - 1 || y == 0 || y == numSamples.y - 1;
 
-          const unsigned int cubeSampleIndices[] = {
-            params.grid.sampleIndex (cubeIndex, 0), params.grid.sampleIndex (cubeIndex, 1),
-            params.grid.sampleIndex (cubeIndex, 2), params.grid.sampleIndex (cubeIndex, 3),
-            params.grid.sampleIndex (cubeIndex, 4), params.grid.sampleIndex (cubeIndex, 5),
-            params.grid.sampleIndex (cubeIndex, 6), params.grid.sampleIndex (cubeIndex, 7)};
+        assert (samples[index] == Util::maxFloat ());
+        samples[index] = column.isInside (z) && isBorder == false ? markInside : markOutside;
+      }
+    }
+  }
 
-          const float cubeSamples[] = {
-            samples[cubeSampleIndices[0]], samples[cubeSampleIndices[1]],
-            samples[cubeSampleIndices[2]], samples[cubeSampleIndices[3]],
-            samples[cubeSampleIndices[4]], samples[cubeSampleIndices[5]],
-            samples[cubeSampleIndices[6]], samples[cubeSampleIndices[7]]};
+  // marks the samples of crossed cubes in slice `z` for sampling
+  void markSamplePositions (Parameters& params, unsigned int z)
+  {
+    std::vector<float>& samples = params.grid.samples ();
 
-          for (unsigned int edge = 0; edge < 12; edge++)
-          {
-            const unsigned char vertex1 = IsosurfaceExtractionGrid::vertexIndicesByEdge[edge][0];
-            const unsigned char vertex2 = IsosurfaceExtractionGrid::vertexIndicesByEdge[edge][1];
+    for (unsigned int y = 0; y < params.grid.numCubes ().y; y++)
+    {
+      for (unsigned int x = 0; x < params.grid.numCubes ().x; x++)
+      {
+        const unsigned int cubeIndex = params.grid.cubeIndex (x, y, z);
+
+        const unsigned int cubeSampleIndices[] = {
+          params.grid.sampleIndex (cubeIndex, 0), params.grid.sampleIndex (cubeIndex, 1),
+          params.grid.sampleIndex (cubeIndex, 2), params.grid.sampleIndex (cubeIndex, 3),
+          params.grid.sampleIndex (cubeIndex, 4), params.grid.sampleIndex (cubeIndex, 5),
+          params.grid.sampleIndex (cubeIndex, 6), params.grid.sampleIndex (cubeIndex, 7)};
+
+        const float cubeSamples[] = {
+          samples[cubeSampleIndices[0]], samples[cubeSampleIndices[1]],
+          samples[cubeSampleIndices[2]], samples[cubeSampleIndices[3]],
+          samples[cubeSampleIndices[4]], samples[cubeSampleIndices[5]],
+          samples[cubeSampleIndices[6]], samples[cubeSampleIndices[7]]};
+
+        for (unsigned int edge = 0; edge < 12; edge++)
+        {
+          const unsigned char vertex1 = IsosurfaceExtractionGrid::vertexIndicesByEdge[edge][0];
+          const unsigned char vertex2 = IsosurfaceExtractionGrid::vertexIndicesByEdge[edge][1];
 
-            if (isIntersecting (cubeSamples[vertex1], cubeSamples[vertex2]))
+          if (isIntersecting (cubeSamples[vertex1], cubeSamples[vertex2]))
+          {
+            for (unsigned int i = 0; i < 8; i++)
             {
-              for (unsigned int i = 0; i < 8; i++)
+              if (cubeSamples[i] == markInside)
+              {
+                samples[cubeSampleIndices[i]] = markInsideToSample;
+              }
+              else if (cubeSamples[i] == markOutside)
               {
-                if (cubeSamples[i] == markInside)
-                {
-                  samples[cubeSampleIndices[i]] = markInsideToSample;
-                }
-                else if (cubeSamples[i] == markOutside)
-                {
-                  samples[cubeSampleIndices[i]] = markOutsideToSample;
-                }
+                samples[cubeSampleIndices[i]] = markOutsideToSample;
               }
-              break;
             }
+            break;
           }
         }
       }
     }
   }
-}
-
-void IsosurfaceExtraction::extract (const DistanceCallback& getDistance, const PrimAABox& bounds,
-                                    float resolution, DynamicMesh& mesh)
-{
-  Parameters                params (getDistance, nullptr, bounds, resolution);
-  IsosurfaceExtractionGrid& grid = params.grid;
 
-  if (grid.numSamples ().x > 0 && grid.numSamples ().y > 0 && grid.numSamples ().z > 0)
+  // Checkpoints between phases return false if the extraction has been canceled.
+  bool extractDense (Parameters& params, DynamicMesh& mesh)
   {
-    sampleDistances (params);
+    IsosurfaceExtractionGrid& grid = params.grid;
+
+    if (params.getIntersection)
+    {
+      sampleIntersections (params);
+
+      if (params.report (Phase::Marking, 0.0f) == false)
+      {
+        return false;
+      }
+      TaskPool::parallelFor (grid.numSamples ().z,
+                             [&params](unsigned int z) { markSamples (params, z); });
+
+      for (unsigned int z = 0; z < grid.numCubes ().z; z++)
+      {
+        markSamplePositions (params, z);
+
+        if (params.report (Phase::Marking, float(z + 1) / float(grid.numCubes ().z)) == false)
+        {
+          return false;
+        }
+      }
+    }
+    sampleDistances (params, 0, grid.numSamples ().z);
+
+    if (params.report (Phase::CubeVertices, 0.0f) == false)
+    {
+      return false;
+    }
+    grid.setCubes (params.tolerance);
+
+    if (params.report (Phase::Faces, 0.0f) == false)
+    {
+      return false;
+    }
     grid.makeMesh (mesh);
+    return params.report (Phase::Faces, 1.0f);
   }
+
+  // Slices of samples are processed in increasing order. Marks of slice `z + 1` are needed before
+  // the samples of slice `z` are final, which in turn are needed to add cubes to the mesh. All
+  // phases but the intersections are reported as the progress of slices of distances.
+  bool extractStreaming (Parameters& params, DynamicMesh& mesh)
+  {
+    IsosurfaceExtractionGrid& grid = params.grid;
+    const unsigned int        numSlices = grid.numSamples ().z;
+
+    if (params.getIntersection)
+    {
+      sampleIntersections (params);
+
+      if (params.isCanceled)
+      {
+        return false;
+      }
+      grid.resetSamples (0);
+      markSamples (params, 0);
+    }
+    grid.makeMeshBegin (mesh);
+
+    for (unsigned int z = 0; z < numSlices; z++)
+    {
+      if (params.getIntersection == nullptr)
+      {
+        grid.resetSamples (z);
+      }
+      else if (z + 1 < numSlices)
+      {
+        grid.resetSamples (z + 1);
+        markSamples (params, z + 1);
+        markSamplePositions (params, z);
+      }
+      sampleDistances (params, z, z + 1);
+
+      if (params.report (Phase::Distances, float(z + 1) / float(numSlices)) == false)
+      {
+        return false;
+      }
+      grid.makeMeshSlice (mesh, z);
+    }
+    grid.makeMeshEnd (mesh);
+    return params.report (Phase::Faces, 1.0f);
+  }
+
+  BatchDistanceCallback batch (const DistanceCallback& getDistance)
+  {
+    return [&getDistance](const std::vector<glm::vec3>& positions, std::vector<float>& distances) {
+      for (unsigned int i = 0; i < positions.size (); i++)
+      {
+        distances[i] = getDistance (positions[i]);
+      }
+    };
+  }
+
+  bool extractMesh (Parameters& params, DynamicMesh& mesh)
+  {
+    const IsosurfaceExtractionGrid& grid = params.grid;
+
+    if (grid.numSamples ().x > 0 && grid.numSamples ().y > 0 && grid.numSamples ().z > 0)
+    {
+      const bool isComplete =
+        grid.isStreaming () ? extractStreaming (params, mesh) : extractDense (params, mesh);
+
+      if (isComplete == false)
+      {
+        mesh.reset ();
+      }
+      return isComplete;
+    }
+    return true;
+  }
+}
+
+bool IsosurfaceExtraction::extract (const BatchDistanceCallback& getDistances,
+                                    const PrimAABox& bounds, float resolution, float tolerance,
+                                    DynamicMesh& mesh, const ProgressCallback& progress)
+{
+  Parameters params (getDistances, nullptr, bounds, resolution, tolerance, progress);
+  return extractMesh (params, mesh);
+}
+
+bool IsosurfaceExtraction::extract (const BatchDistanceCallback& getDistances,
+                                    const IntersectionCallback&  getIntersection,
+                                    const PrimAABox& bounds, float resolution, float tolerance,
+                                    DynamicMesh& mesh, const ProgressCallback& progress)
+{
+  Parameters params (getDistances, &getIntersection, bounds, resolution, tolerance, progress);
+  return extractMesh (params, mesh);
+}
+
+bool IsosurfaceExtraction::extract (const DistanceCallback& getDistance, const PrimAABox& bounds,
+                                    float resolution, float tolerance, DynamicMesh& mesh,
+                                    const ProgressCallback& progress)
+{
+  return IsosurfaceExtraction::extract (batch (getDistance), bounds, resolution, tolerance, mesh,
+                                        progress);
 }
 
-void IsosurfaceExtraction::extract (const DistanceCallback&     getDistance,
+bool IsosurfaceExtraction::extract (const DistanceCallback&     getDistance,
                                     const IntersectionCallback& getIntersection,
-                                    const PrimAABox& bounds, float resolution, DynamicMesh& mesh)
+                                    const PrimAABox& bounds, float resolution, float tolerance,
+                                    DynamicMesh& mesh, const ProgressCallback& progress)
 {
-  Parameters                params (getDistance, &getIntersection, bounds, resolution);
-  IsosurfaceExtractionGrid& grid = params.grid;
+  return IsosurfaceExtraction::extract (batch (getDistance), getIntersection, bounds, resolution,
+                                        tolerance, mesh, progress);
+}
 
-  if (grid.numSamples ().x > 0 && grid.numSamples ().y > 0 && grid.numSamples ().z > 0)
-  {
-    sampleIntersections (params);
-    markSamplePositions (params);
-    sampleDistances (params);
-    grid.makeMesh (mesh);
-  }
+void IsosurfaceExtraction::setMaxNumDenseSamples (unsigned int n)
+{
+  maxNumDenseSamples = n == 0 ? defaultMaxNumDenseSamples : n;
 }
+
+void IsosurfaceExtraction::setSparseSampling (bool sparse) { isSparseSampling = sparse; }
@@ -7,6 +7,7 @@
 
 #include <functional>
 #include <glm/fwd.hpp>
+#include <vector>
 
 class DynamicMesh;
 class Intersection;
@@ -25,9 +26,47 @@ namespace IsosurfaceExtraction
   typedef std::function<float(const glm::vec3&)>                        DistanceCallback;
   typedef std::function<Intersection (const PrimRay&, ::Intersection&)> IntersectionCallback;
 
-  void extract (const DistanceCallback&, const IntersectionCallback&, const PrimAABox&, float,
-                DynamicMesh&);
-  void extract (const DistanceCallback&, const PrimAABox&, float, DynamicMesh&);
+  // Computes the distances of a batch of positions, i.e. a brick of samples in z-y-x order.
+  // The vector of distances has the same size as the vector of positions.
+  typedef std::function<void(const std::vector<glm::vec3>&, std::vector<float>&)>
+    BatchDistanceCallback;
+
+  enum class Phase
+  {
+    Intersections,
+    Marking,
+    Distances,
+    CubeVertices,
+    Faces
+  };
+
+  // Reports the progress of a phase within [0, 1]. Might be called concurrently by several
+  // threads. Returning false cancels the extraction at its next checkpoint.
+  typedef std::function<bool(Phase, float)> ProgressCallback;
+
+  // Extracts the surface at the given resolution. Cubes where the surface is planar within the
+  // given tolerance, relative to the resolution, are merged. Very large grids are extracted in
+  // slices and are never merged. Rays of the intersection callback start outside of the bounds
+  // but the surface is clipped by the bounds, i.e. the extracted mesh is always closed. Returns
+  // false if the extraction has been canceled. The mesh is not buffered, so extractions may run
+  // in any thread.
+  bool extract (const BatchDistanceCallback&, const IntersectionCallback&, const PrimAABox&, float,
+                float, DynamicMesh&, const ProgressCallback& = nullptr);
+  bool extract (const DistanceCallback&, const IntersectionCallback&, const PrimAABox&, float,
+                float, DynamicMesh&, const ProgressCallback& = nullptr);
+
+  // Distances are sampled sparsely, i.e. the callback must never overestimate distances.
+  bool extract (const BatchDistanceCallback&, const PrimAABox&, float, float, DynamicMesh&,
+                const ProgressCallback& = nullptr);
+  bool extract (const DistanceCallback&, const PrimAABox&, float, float, DynamicMesh&,
+                const ProgressCallback& = nullptr);
+
+  // Grids with more than the given number of samples are extracted in slices. Meant for tests,
+  // zero restores the default.
+  void setMaxNumDenseSamples (unsigned int);
+
+  // Disables or enables the sparse sampling of distances. Meant for tests.
+  void setSparseSampling (bool);
 };
 
 #endif
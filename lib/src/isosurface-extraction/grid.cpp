@@ -2,11 +2,14 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <algorithm>
+#include <glm/gtc/constants.hpp>
 #include <glm/gtx/norm.hpp>
 #include "dynamic/mesh.hpp"
 #include "isosurface-extraction/grid.hpp"
 #include "mesh.hpp"
 #include "primitive/aabox.hpp"
+#include "task-pool.hpp"
 #include "util.hpp"
 
 /* vertex layout:          edge layout:          face layout:
@@ -27,6 +30,12 @@ namespace
 {
   static const glm::vec3 invalidVec3 = glm::vec3 (Util::minFloat ());
 
+  // Streaming grids keep only `numStreamingSlices` slices of samples and cubes in memory
+  static const unsigned int numStreamingSlices = 4;
+
+  // Adaptive meshes merge aligned blocks of up to `maxMergeSize`^3 cubes
+  static const unsigned int maxMergeSize = 8;
+
   static bool nonManifoldConfig[256] = {
     false, false, false, false, false, false, false, false, false, false, false, false, false,
     false, false, false, false, false, false, false, false, false, false, false, false, false,
@@ -325,6 +334,68 @@ namespace
     return (s1 < 0.0f && s2 >= 0.0f) || (s1 >= 0.0f && s2 < 0.0f);
   }
 
+  // smallest eigenvalue of a symmetric matrix
+  float smallestEigenvalue (const glm::mat3x3& m)
+  {
+    const float p1 = (m[0][1] * m[0][1]) + (m[0][2] * m[0][2]) + (m[1][2] * m[1][2]);
+
+    if (p1 == 0.0f)
+    {
+      return glm::min (m[0][0], glm::min (m[1][1], m[2][2]));
+    }
+    else
+    {
+      const float q = (m[0][0] + m[1][1] + m[2][2]) / 3.0f;
+      const float p2 = ((m[0][0] - q) * (m[0][0] - q)) + ((m[1][1] - q) * (m[1][1] - q)) +
+                       ((m[2][2] - q) * (m[2][2] - q)) + (2.0f * p1);
+      const float p = glm::sqrt (p2 / 6.0f);
+
+      if (p == 0.0f)
+      {
+        return q;
+      }
+      const float r = glm::clamp (glm::determinant ((m - glm::mat3x3 (q)) / p) * 0.5f, -1.0f, 1.0f);
+      const float phi = glm::acos (r) / 3.0f;
+
+      return q + (2.0f * p * glm::cos (phi + (2.0f * glm::pi<float> () / 3.0f)));
+    }
+  }
+
+  // Normal of the plane that fits points with the given covariance best, i.e. an eigenvector of
+  // its smallest eigenvalue. Any normal perpendicular to the other eigenvectors is returned if
+  // the smallest eigenvalue is not unique.
+  glm::vec3 planeNormal (const glm::mat3x3& covariance)
+  {
+    const glm::mat3x3 m = covariance - glm::mat3x3 (smallestEigenvalue (covariance));
+    const float       scale = glm::length2 (m[0]) + glm::length2 (m[1]) + glm::length2 (m[2]);
+
+    if (scale == 0.0f)
+    {
+      return glm::vec3 (0.0f, 0.0f, 1.0f);
+    }
+
+    // `m` is symmetric, i.e. its columns span its row space
+    glm::vec3 normal = glm::cross (m[0], m[1]);
+    for (const glm::vec3& n : {glm::cross (m[0], m[2]), glm::cross (m[1], m[2])})
+    {
+      normal = glm::length2 (n) > glm::length2 (normal) ? n : normal;
+    }
+    if (glm::length2 (normal) > Util::epsilon () * scale * scale)
+    {
+      return glm::normalize (normal);
+    }
+
+    glm::vec3 column = m[0];
+    for (const glm::vec3& c : {m[1], m[2]})
+    {
+      column = glm::length2 (c) > glm::length2 (column) ? c : column;
+    }
+    const glm::vec3 axis = glm::abs (column.x) < glm::abs (column.y)
+                             ? glm::vec3 (1.0f, 0.0f, 0.0f)
+                             : glm::vec3 (0.0f, 1.0f, 0.0f);
+    return glm::normalize (glm::cross (column, axis));
+  }
+
   struct Cube
   {
     unsigned char               configuration;
@@ -332,15 +403,21 @@ namespace
     unsigned char               numVertexIndicesInMesh;
     std::array<unsigned int, 3> vertexIndicesInMesh;
     bool                        nonManifold;
+    unsigned char               mergeSize;
+    unsigned int                representative;
 
     Cube ()
       : configuration (0)
       , vertex (invalidVec3)
       , numVertexIndicesInMesh (0)
       , nonManifold (false)
+      , mergeSize (0)
+      , representative (Util::invalidIndex ())
     {
     }
 
+    bool isRepresented () const { return this->representative != Util::invalidIndex (); }
+
     bool nonManifoldConfig () const { return ::nonManifoldConfig[this->configuration]; }
 
     bool collapseNonManifoldConfig () const
@@ -401,8 +478,9 @@ struct IsosurfaceExtractionGrid::Impl
   std::vector<float> samples;
   glm::uvec3         numCubes;
   std::vector<Cube>  cubes;
+  unsigned int       numSlices;
 
-  Impl (const PrimAABox& bounds, float r)
+  Impl (const PrimAABox& bounds, float r, unsigned int maxNumDenseSamples)
     : resolution (r)
   {
     const glm::vec3 min = bounds.minimum () - glm::vec3 (Util::epsilon () + r);
@@ -414,10 +492,34 @@ struct IsosurfaceExtractionGrid::Impl
 
     const unsigned int totalNumSamples =
       this->numSamples.x * this->numSamples.y * this->numSamples.z;
-    const unsigned int totalNumCubes = this->numCubes.x * this->numCubes.y * this->numCubes.z;
 
-    this->samples.resize (totalNumSamples, Util::maxFloat ());
-    this->cubes.resize (totalNumCubes);
+    this->numSlices =
+      (totalNumSamples > maxNumDenseSamples && this->numSamples.z > numStreamingSlices)
+        ? numStreamingSlices
+        : this->numSamples.z;
+
+    this->samples.resize (this->numSamples.x * this->numSamples.y *
+                            std::min (this->numSlices, this->numSamples.z),
+                          Util::maxFloat ());
+    this->cubes.resize (this->numCubes.x * this->numCubes.y *
+                        std::min (this->numSlices, this->numCubes.z));
+  }
+
+  bool isStreaming () const { return this->numSlices < this->numSamples.z; }
+
+  // Slices are stored in a ring buffer of `numSlices` slices. A dense grid stores all slices.
+  unsigned int slice (unsigned int z) const
+  {
+    return z < this->numSlices ? z : z % this->numSlices;
+  }
+
+  void resetSamples (unsigned int z)
+  {
+    const unsigned int sliceSize = this->numSamples.x * this->numSamples.y;
+    const unsigned int begin = this->slice (z) * sliceSize;
+
+    std::fill (this->samples.begin () + begin, this->samples.begin () + begin + sliceSize,
+               Util::maxFloat ());
   }
 
   glm::vec3 samplePos (unsigned int x, unsigned int y, unsigned int z) const
@@ -430,23 +532,10 @@ struct IsosurfaceExtractionGrid::Impl
            (glm::vec3 (this->resolution) * glm::vec3 (float(x), float(y), float(z)));
   }
 
-  glm::vec3 samplePos (unsigned int i) const
-  {
-    const std::div_t divZ = std::div (int(i), int(this->numSamples.x * this->numSamples.y));
-    const std::div_t divY = std::div (divZ.rem, int(this->numSamples.x));
-
-    const unsigned int x = (unsigned int) (divY.rem);
-    const unsigned int y = (unsigned int) (divY.quot);
-    const unsigned int z = (unsigned int) (divZ.quot);
-
-    assert (this->sampleIndex (x, y, z) == i);
-
-    return this->samplePos (x, y, z);
-  }
-
   unsigned int sampleIndex (unsigned int x, unsigned int y, unsigned int z) const
   {
-    return (z * this->numSamples.x * this->numSamples.y) + (y * this->numSamples.x) + x;
+    return (this->slice (z) * this->numSamples.x * this->numSamples.y) +
+           (y * this->numSamples.x) + x;
   }
 
   unsigned int sampleIndex (unsigned int cubeIndex, unsigned char vertex) const
@@ -486,37 +575,50 @@ struct IsosurfaceExtractionGrid::Impl
 
   unsigned int cubeIndex (unsigned int x, unsigned int y, unsigned int z) const
   {
-    return (z * this->numCubes.x * this->numCubes.y) + (y * this->numCubes.x) + x;
+    return (this->slice (z) * this->numCubes.x * this->numCubes.y) + (y * this->numCubes.x) + x;
   }
 
   unsigned int cubeVertexIndex (unsigned int cubeIndex, unsigned char edge) const
   {
-    return this->cubes[cubeIndex].vertexIndex (edge);
+    const Cube& cube = this->cubes[cubeIndex];
+
+    if (cube.isRepresented ())
+    {
+      const Cube& representative = this->cubes[cube.representative];
+
+      assert (representative.numVertexIndicesInMesh == 1);
+      return representative.vertexIndicesInMesh[0];
+    }
+    else
+    {
+      return cube.vertexIndex (edge);
+    }
   }
 
-  void setCubeVertex (unsigned int cubeIndex)
+  void setCubeVertex (unsigned int x, unsigned int y, unsigned int z)
   {
     glm::vec3    vertex = glm::vec3 (0.0f);
     unsigned int numCrossedEdges = 0;
-    Cube&        cube = this->cubes[cubeIndex];
+    Cube&        cube = this->cubes[this->cubeIndex (x, y, z)];
 
     const unsigned int indices[] = {
-      this->sampleIndex (cubeIndex, 0), this->sampleIndex (cubeIndex, 1),
-      this->sampleIndex (cubeIndex, 2), this->sampleIndex (cubeIndex, 3),
-      this->sampleIndex (cubeIndex, 4), this->sampleIndex (cubeIndex, 5),
-      this->sampleIndex (cubeIndex, 6), this->sampleIndex (cubeIndex, 7)};
+      this->sampleIndex (x, y, z),         this->sampleIndex (x + 1, y, z),
+      this->sampleIndex (x, y + 1, z),     this->sampleIndex (x + 1, y + 1, z),
+      this->sampleIndex (x, y, z + 1),     this->sampleIndex (x + 1, y, z + 1),
+      this->sampleIndex (x, y + 1, z + 1), this->sampleIndex (x + 1, y + 1, z + 1)};
 
     const float samples[] = {this->samples[indices[0]], this->samples[indices[1]],
                              this->samples[indices[2]], this->samples[indices[3]],
                              this->samples[indices[4]], this->samples[indices[5]],
                              this->samples[indices[6]], this->samples[indices[7]]};
 
-    const glm::vec3 positions[] = {this->samplePos (indices[0]), this->samplePos (indices[1]),
-                                   this->samplePos (indices[2]), this->samplePos (indices[3]),
-                                   this->samplePos (indices[4]), this->samplePos (indices[5]),
-                                   this->samplePos (indices[6]), this->samplePos (indices[7])};
+    const glm::vec3 positions[] = {
+      this->samplePos (x, y, z),         this->samplePos (x + 1, y, z),
+      this->samplePos (x, y + 1, z),     this->samplePos (x + 1, y + 1, z),
+      this->samplePos (x, y, z + 1),     this->samplePos (x + 1, y, z + 1),
+      this->samplePos (x, y + 1, z + 1), this->samplePos (x + 1, y + 1, z + 1)};
 
-    cube.configuration = 0;
+    cube = Cube ();
     for (unsigned char edge = 0; edge < 12; edge++)
     {
       const unsigned char vertex1 = vertexIndicesByEdge[edge][0];
@@ -576,21 +678,22 @@ struct IsosurfaceExtractionGrid::Impl
     }
   }
 
-  void setCubeVertices ()
+  // The following phases process the cubes of slices `[zBegin, zEnd)` in parallel.
+
+  void setCubeVertices (unsigned int zBegin, unsigned int zEnd)
   {
-    for (unsigned int z = 0; z < this->numCubes.z; z++)
-    {
+    TaskPool::parallelFor (zEnd - zBegin, [this, zBegin](unsigned int i) {
       for (unsigned int y = 0; y < this->numCubes.y; y++)
       {
         for (unsigned int x = 0; x < this->numCubes.x; x++)
         {
-          this->setCubeVertex (this->cubeIndex (x, y, z));
+          this->setCubeVertex (x, y, zBegin + i);
         }
       }
-    }
+    });
 
 #ifndef NDEBUG
-    for (unsigned int z = 0; z < this->numCubes.z; z++)
+    for (unsigned int z = zBegin; z < zEnd; z++)
     {
       for (unsigned int y = 0; y < this->numCubes.y; y++)
       {
@@ -686,55 +789,401 @@ struct IsosurfaceExtractionGrid::Impl
     }
   }
 
-  void resolveNonManifolds ()
+  void resolveNonManifolds (unsigned int zBegin, unsigned int zEnd)
+  {
+    TaskPool::parallelFor (zEnd - zBegin, [this, zBegin](unsigned int i) {
+      for (unsigned int y = 0; y < this->numCubes.y; y++)
+      {
+        for (unsigned int x = 0; x < this->numCubes.x; x++)
+        {
+          this->resolveNonManifold (x, y, zBegin + i);
+        }
+      }
+    });
+  }
+
+  bool isInside (const glm::uvec3& sample) const
+  {
+    return this->samples[this->sampleIndex (sample.x, sample.y, sample.z)] < 0.0f;
+  }
+
+  // Configuration of a block of `size`^3 cubes at `origin`. Following Ju et al., a block is only
+  // merged if the sign at the midpoint of each of its edges and faces and at its center equals
+  // the sign of one of the corners of that edge, face or block.
+  bool blockConfiguration (const glm::uvec3& origin, unsigned int size,
+                           unsigned char& configuration) const
+  {
+    const unsigned int half = size / 2;
+
+    configuration = 0;
+    for (unsigned char v = 0; v < 8; v++)
+    {
+      const glm::uvec3 corner (v & 1 ? size : 0, v & 2 ? size : 0, v & 4 ? size : 0);
+
+      if (this->isInside (origin + corner))
+      {
+        configuration |= 1 << v;
+      }
+    }
+
+    for (unsigned int i = 0; i < 27; i++)
+    {
+      const glm::uvec3 point (i % 3, (i / 3) % 3, i / 9);
+      unsigned int     numCorners = 0;
+      unsigned int     numInsideCorners = 0;
+
+      for (unsigned char v = 0; v < 8; v++)
+      {
+        const glm::uvec3 corner (v & 1 ? 2 : 0, v & 2 ? 2 : 0, v & 4 ? 2 : 0);
+
+        if ((point.x == 1 || point.x == corner.x) && (point.y == 1 || point.y == corner.y) &&
+            (point.z == 1 || point.z == corner.z))
+        {
+          numCorners++;
+          numInsideCorners += (configuration & (1 << v)) ? 1 : 0;
+        }
+      }
+
+      if (numCorners > 1 && (numInsideCorners == 0 || numInsideCorners == numCorners))
+      {
+        if (this->isInside (origin + (point * half)) != (numInsideCorners > 0))
+        {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+
+  template <typename F> void forEachCubeOfBlock (const glm::uvec3& origin, unsigned int size,
+                                                 const F& f)
+  {
+    for (unsigned int z = origin.z; z < origin.z + size; z++)
+    {
+      for (unsigned int y = origin.y; y < origin.y + size; y++)
+      {
+        for (unsigned int x = origin.x; x < origin.x + size; x++)
+        {
+          f (this->cubeIndex (x, y, z));
+        }
+      }
+    }
+  }
+
+  // A block of `size`^3 cubes is merged if its eight sub-blocks are merged, if merging it does
+  // not change the topology of the surface, and if the vertices of its cubes deviate from their
+  // best fitting plane by at most `maxError`.
+  bool isMergeable (const glm::uvec3& origin, unsigned int size, float maxError)
   {
-    for (unsigned int z = 0; z < this->numCubes.z; z++)
+    const unsigned int half = size / 2;
+
+    if (origin.x + size > this->numCubes.x || origin.y + size > this->numCubes.y ||
+        origin.z + size > this->numCubes.z)
+    {
+      return false;
+    }
+
+    for (unsigned char i = 0; i < 8; i++)
+    {
+      const glm::uvec3 child (i & 1 ? half : 0, i & 2 ? half : 0, i & 4 ? half : 0);
+      const unsigned int index =
+        this->cubeIndex (origin.x + child.x, origin.y + child.y, origin.z + child.z);
+
+      if (this->cubes[index].mergeSize < half)
+      {
+        return false;
+      }
+    }
+
+    unsigned char configuration;
+    if (this->blockConfiguration (origin, size, configuration) == false ||
+        ::nonManifoldConfig[configuration] || numVertices (configuration) > 1)
+    {
+      return false;
+    }
+
+    unsigned int n = 0;
+    glm::vec3    sum (0.0f);
+
+    this->forEachCubeOfBlock (origin, size, [this, &n, &sum](unsigned int i) {
+      if (numVertices (this->cubes[i].configuration) > 0)
+      {
+        sum += this->cubes[i].vertex;
+        n++;
+      }
+    });
+
+    if (n == 0)
     {
+      return true;
+    }
+    else if (numVertices (configuration) == 0)
+    {
+      return false;
+    }
+    else
+    {
+      const glm::vec3 mean = sum / float(n);
+      glm::mat3x3     covariance (0.0f);
+
+      this->forEachCubeOfBlock (origin, size, [this, &mean, &covariance](unsigned int i) {
+        if (numVertices (this->cubes[i].configuration) > 0)
+        {
+          const glm::vec3 d = this->cubes[i].vertex - mean;
+          covariance += glm::outerProduct (d, d);
+        }
+      });
+      const glm::vec3 normal = planeNormal (covariance / float(n));
+      bool            isPlanar = true;
+
+      this->forEachCubeOfBlock (origin, size, [this, &mean, &normal, maxError,
+                                               &isPlanar](unsigned int i) {
+        if (numVertices (this->cubes[i].configuration) > 0)
+        {
+          isPlanar = isPlanar &&
+                     glm::abs (glm::dot (this->cubes[i].vertex - mean, normal)) <= maxError;
+        }
+      });
+      return isPlanar;
+    }
+  }
+
+  // The first cube of a merged block that has a vertex represents all other cubes of the block.
+  // It takes the vertex of the block that is closest to the average of their vertices, i.e. merged
+  // meshes keep the vertices of uniform meshes and curved surfaces do not shrink.
+  void representBlock (const glm::uvec3& origin, unsigned int size)
+  {
+    unsigned int representative = Util::invalidIndex ();
+    unsigned int n = 0;
+    glm::vec3    sum (0.0f);
+
+    this->forEachCubeOfBlock (origin, size, [this, &representative, &n, &sum](unsigned int i) {
+      Cube& cube = this->cubes[i];
+
+      if (numVertices (cube.configuration) > 0)
+      {
+        if (representative == Util::invalidIndex ())
+        {
+          representative = i;
+        }
+        else
+        {
+          cube.representative = representative;
+        }
+        sum += cube.vertex;
+        n++;
+      }
+    });
+
+    if (n > 0)
+    {
+      const glm::vec3 mean = sum / float(n);
+      glm::vec3       vertex = this->cubes[representative].vertex;
+
+      this->forEachCubeOfBlock (origin, size, [this, &mean, &vertex](unsigned int i) {
+        const Cube& cube = this->cubes[i];
+
+        if (numVertices (cube.configuration) > 0 &&
+            glm::distance2 (cube.vertex, mean) < glm::distance2 (vertex, mean))
+        {
+          vertex = cube.vertex;
+        }
+      });
+      this->cubes[representative].vertex = vertex;
+    }
+  }
+
+  void mergeCubes (float tolerance)
+  {
+    const float maxError = tolerance * this->resolution;
+
+    TaskPool::parallelFor (this->numCubes.z, [this](unsigned int z) {
       for (unsigned int y = 0; y < this->numCubes.y; y++)
       {
         for (unsigned int x = 0; x < this->numCubes.x; x++)
         {
-          this->resolveNonManifold (x, y, z);
+          Cube& cube = this->cubes[this->cubeIndex (x, y, z)];
+
+          cube.mergeSize =
+            (cube.nonManifoldConfig () || numVertices (cube.configuration) > 1) ? 0 : 1;
         }
       }
+    });
+
+    for (unsigned int size = 2; size <= maxMergeSize; size *= 2)
+    {
+      TaskPool::parallelFor (this->numCubes.z / size, [this, size, maxError](unsigned int bz) {
+        for (unsigned int by = 0; by < this->numCubes.y / size; by++)
+        {
+          for (unsigned int bx = 0; bx < this->numCubes.x / size; bx++)
+          {
+            const glm::uvec3 origin (bx * size, by * size, bz * size);
+
+            if (this->isMergeable (origin, size, maxError))
+            {
+              this->cubes[this->cubeIndex (origin.x, origin.y, origin.z)].mergeSize = size;
+            }
+          }
+        }
+      });
     }
+
+    // Blocks are represented by the task of their origin's slab. Blocks are disjoint.
+    TaskPool::parallelFor (this->numCubes.z, [this](unsigned int z) {
+      for (unsigned int y = 0; y < this->numCubes.y; y++)
+      {
+        for (unsigned int x = 0; x < this->numCubes.x; x++)
+        {
+          for (unsigned int size = maxMergeSize; size >= 2; size /= 2)
+          {
+            const glm::uvec3 origin ((x / size) * size, (y / size) * size, (z / size) * size);
+            const Cube&      cube = this->cubes[this->cubeIndex (origin.x, origin.y, origin.z)];
+
+            if (cube.mergeSize >= size)
+            {
+              if (origin == glm::uvec3 (x, y, z))
+              {
+                this->representBlock (origin, size);
+              }
+              break;
+            }
+          }
+        }
+      }
+    });
   }
 
-  void addCubeVerticesToMesh (Cube& cube, DynamicMesh& mesh)
+  // returns the number of vertices that the cubes of slab `z` add to the mesh
+  unsigned int setNumVertexIndicesInMesh (unsigned int z)
   {
-    cube.numVertexIndicesInMesh =
-      cube.collapseNonManifoldConfig () ? 1 : numVertices (cube.configuration);
+    unsigned int n = 0;
 
-    for (unsigned char i = 0; i < cube.numVertexIndicesInMesh; i++)
+    for (unsigned int y = 0; y < this->numCubes.y; y++)
     {
-      cube.vertexIndicesInMesh[i] = mesh.addVertex (cube.vertex, glm::vec3 (0.0f));
+      for (unsigned int x = 0; x < this->numCubes.x; x++)
+      {
+        Cube& cube = this->cubes[this->cubeIndex (x, y, z)];
+
+        if (cube.isRepresented ())
+        {
+          cube.numVertexIndicesInMesh = 0;
+        }
+        else
+        {
+          cube.numVertexIndicesInMesh =
+            cube.collapseNonManifoldConfig () ? 1 : numVertices (cube.configuration);
+        }
+        n += cube.numVertexIndicesInMesh;
+      }
     }
+    return n;
+  }
+
+  void setVertexIndicesInMesh (unsigned int z, unsigned int firstIndex)
+  {
+    unsigned int index = firstIndex;
+
+    for (unsigned int y = 0; y < this->numCubes.y; y++)
+    {
+      for (unsigned int x = 0; x < this->numCubes.x; x++)
+      {
+        Cube& cube = this->cubes[this->cubeIndex (x, y, z)];
+
+        for (unsigned char i = 0; i < cube.numVertexIndicesInMesh; i++)
+        {
+          cube.vertexIndicesInMesh[i] = index++;
+        }
 #ifndef NDEBUG
-    for (unsigned char i = cube.numVertexIndicesInMesh; i < cube.vertexIndicesInMesh.size (); i++)
+        for (unsigned char i = cube.numVertexIndicesInMesh; i < cube.vertexIndicesInMesh.size ();
+             i++)
+        {
+          cube.vertexIndicesInMesh[i] = Util::invalidIndex ();
+        }
+#endif
+      }
+    }
+  }
+
+  // Vertices are added in the order of their cubes. Each slab counts its vertices, so that the
+  // mesh indices of all slabs can be assigned in parallel before the vertices are added.
+  void addVerticesToMesh (DynamicMesh& mesh, unsigned int zBegin, unsigned int zEnd)
+  {
+    std::vector<unsigned int> firstIndexOfSlab (zEnd - zBegin + 1, 0);
+
+    firstIndexOfSlab[0] = mesh.numVertices ();
+
+    TaskPool::parallelFor (zEnd - zBegin, [this, zBegin, &firstIndexOfSlab](unsigned int i) {
+      firstIndexOfSlab[i + 1] = this->setNumVertexIndicesInMesh (zBegin + i);
+    });
+    for (unsigned int i = 0; i < zEnd - zBegin; i++)
     {
-      cube.vertexIndicesInMesh[i] = Util::invalidIndex ();
+      firstIndexOfSlab[i + 1] += firstIndexOfSlab[i];
+    }
+    TaskPool::parallelFor (zEnd - zBegin, [this, zBegin, &firstIndexOfSlab](unsigned int i) {
+      this->setVertexIndicesInMesh (zBegin + i, firstIndexOfSlab[i]);
+    });
+
+    for (unsigned int z = zBegin; z < zEnd; z++)
+    {
+      for (unsigned int y = 0; y < this->numCubes.y; y++)
+      {
+        for (unsigned int x = 0; x < this->numCubes.x; x++)
+        {
+          const Cube& cube = this->cubes[this->cubeIndex (x, y, z)];
+
+          for (unsigned char i = 0; i < cube.numVertexIndicesInMesh; i++)
+          {
+            const unsigned int index = mesh.addVertex (cube.vertex, glm::vec3 (0.0f));
+
+            assert (index == cube.vertexIndicesInMesh[i]);
+            unused (index);
+          }
+        }
+      }
     }
-#endif
   }
 
-  void addQuadToMesh (DynamicMesh& mesh, unsigned int i, unsigned int iu, unsigned int iv,
-                      unsigned int iuv)
+  void addQuad (const DynamicMesh& mesh, std::vector<unsigned int>& faces, unsigned int i,
+                unsigned int iu, unsigned int iv, unsigned int iuv)
   {
-    if (glm::distance2 (mesh.vertex (i), mesh.vertex (iuv)) <=
-        glm::distance2 (mesh.vertex (iu), mesh.vertex (iv)))
+    if (i == iu || iu == iuv || iuv == iv || iv == i)
+    {
+      // quads of merged cubes degenerate to a single triangle or vanish
+      const unsigned int quad[] = {i, iu, iuv, iv};
+      unsigned int       triangle[3];
+      unsigned int       n = 0;
+
+      for (unsigned int k = 0; k < 4; k++)
+      {
+        if (quad[k] != quad[(k + 1) % 4])
+        {
+          if (n < 3)
+          {
+            triangle[n] = quad[k];
+          }
+          n++;
+        }
+      }
+      if (n == 3)
+      {
+        faces.insert (faces.end (), {triangle[0], triangle[1], triangle[2]});
+      }
+    }
+    else if (glm::distance2 (mesh.vertex (i), mesh.vertex (iuv)) <=
+             glm::distance2 (mesh.vertex (iu), mesh.vertex (iv)))
     {
-      mesh.addFace (i, iu, iuv);
-      mesh.addFace (i, iuv, iv);
+      faces.insert (faces.end (), {i, iu, iuv});
+      faces.insert (faces.end (), {i, iuv, iv});
     }
     else
     {
-      mesh.addFace (iu, iuv, iv);
-      mesh.addFace (iu, iv, i);
+      faces.insert (faces.end (), {iu, iuv, iv});
+      faces.insert (faces.end (), {iu, iv, i});
     }
   }
 
-  void makeFaces (DynamicMesh& mesh, unsigned char edge, unsigned int x, unsigned int y,
-                  unsigned int z)
+  void makeFaces (const DynamicMesh& mesh, std::vector<unsigned int>& faces, unsigned char edge,
+                  unsigned int x, unsigned int y, unsigned int z)
   {
     assert (edge == 0 || edge == 1 || edge == 2);
 
@@ -777,80 +1226,132 @@ struct IsosurfaceExtractionGrid::Impl
         std::swap (iu, iv);
       }
 
-      this->addQuadToMesh (mesh, i, iu, iv, iuv);
+      this->addQuad (mesh, faces, i, iu, iv, iuv);
     }
   }
 
-  void makeFaces (DynamicMesh& mesh, unsigned int x, unsigned int y, unsigned int z)
+  void makeFaces (const DynamicMesh& mesh, std::vector<unsigned int>& faces, unsigned int x,
+                  unsigned int y, unsigned int z)
   {
     if (y > 0 && z > 0)
     {
-      this->makeFaces (mesh, 0, x, y, z);
+      this->makeFaces (mesh, faces, 0, x, y, z);
     }
     if (x > 0 && z > 0)
     {
-      this->makeFaces (mesh, 1, x, y, z);
+      this->makeFaces (mesh, faces, 1, x, y, z);
     }
     if (x > 0 && y > 0)
     {
-      this->makeFaces (mesh, 2, x, y, z);
+      this->makeFaces (mesh, faces, 2, x, y, z);
     }
   }
 
-  void makeMesh (DynamicMesh& mesh)
+  // Each slab collects its faces, which are added in slab order afterwards, i.e. faces are added
+  // in the same order as by a serial traversal of all cubes.
+  void addFacesToMesh (DynamicMesh& mesh, unsigned int zBegin, unsigned int zEnd)
   {
-    this->setCubeVertices ();
-    this->resolveNonManifolds ();
+    std::vector<std::vector<unsigned int>> facesOfSlab (zEnd - zBegin);
 
-    mesh.reset ();
-    for (Cube& cube : this->cubes)
-    {
-      this->addCubeVerticesToMesh (cube, mesh);
-    }
-
-    for (unsigned int z = 0; z < this->numCubes.z; z++)
-    {
+    TaskPool::parallelFor (zEnd - zBegin, [this, zBegin, &mesh, &facesOfSlab](unsigned int i) {
       for (unsigned int y = 0; y < this->numCubes.y; y++)
       {
         for (unsigned int x = 0; x < this->numCubes.x; x++)
         {
-          this->makeFaces (mesh, x, y, z);
+          this->makeFaces (mesh, facesOfSlab[i], x, y, zBegin + i);
         }
       }
-    }
-    mesh.setAllNormals ();
-
-#ifndef NDEBUG
-    std::vector<unsigned int> vertexIndexMap, faceIndexMap;
-    assert (mesh.numFaces () == 0 || mesh.pruneAndCheckConsistency (&vertexIndexMap, nullptr));
+    });
 
-    for (Cube& c : this->cubes)
+    for (const std::vector<unsigned int>& faces : facesOfSlab)
     {
-      if (vertexIndexMap.empty () == false)
+      for (unsigned int i = 0; i < faces.size (); i += 3)
       {
-        for (unsigned char i = 0; i < c.numVertexIndicesInMesh; i++)
-        {
-          c.vertexIndicesInMesh[i] = vertexIndexMap[c.vertexIndicesInMesh[i]];
-          assert (c.vertexIndicesInMesh[i] != Util::invalidIndex ());
-        }
+        mesh.addFace (faces[i + 0], faces[i + 1], faces[i + 2]);
       }
     }
-#endif
-    mesh.bufferData ();
+  }
+
+  void setCubes (float tolerance)
+  {
+    assert (this->isStreaming () == false);
+
+    this->setCubeVertices (0, this->numCubes.z);
+    this->resolveNonManifolds (0, this->numCubes.z);
+
+    if (tolerance > 0.0f)
+    {
+      this->mergeCubes (tolerance);
+    }
+  }
+
+  void makeMesh (DynamicMesh& mesh)
+  {
+    assert (this->isStreaming () == false);
+
+    mesh.reset ();
+    this->addVerticesToMesh (mesh, 0, this->numCubes.z);
+    this->addFacesToMesh (mesh, 0, this->numCubes.z);
+    this->finishMesh (mesh);
+  }
+
+  // A slice of cubes is added to the mesh once the configurations of both adjacent slices of
+  // cubes are known, i.e. the mesh lags two slices behind the samples.
+  void addCubesToMesh (DynamicMesh& mesh, unsigned int z)
+  {
+    this->resolveNonManifolds (z, z + 1);
+    this->addVerticesToMesh (mesh, z, z + 1);
+    this->addFacesToMesh (mesh, z, z + 1);
+  }
+
+  void makeMeshBegin (DynamicMesh& mesh) { mesh.reset (); }
+
+  void makeMeshSlice (DynamicMesh& mesh, unsigned int z)
+  {
+    if (z >= 1)
+    {
+      this->setCubeVertices (z - 1, z);
+    }
+    if (z >= 2)
+    {
+      this->addCubesToMesh (mesh, z - 2);
+    }
+  }
+
+  void makeMeshEnd (DynamicMesh& mesh)
+  {
+    if (this->numCubes.z > 0)
+    {
+      this->addCubesToMesh (mesh, this->numCubes.z - 1);
+    }
+    this->finishMesh (mesh);
+  }
+
+  void finishMesh (DynamicMesh& mesh)
+  {
+    mesh.setAllNormals ();
+
+    // Meshes are extracted in background threads, i.e. they must not be buffered
+    assert (mesh.numFaces () == 0 || mesh.checkConsistency ());
   }
 };
 
-DELEGATE2_BIG4_COPY (IsosurfaceExtractionGrid, const PrimAABox&, float)
+DELEGATE3_BIG4_COPY (IsosurfaceExtractionGrid, const PrimAABox&, float, unsigned int)
 GETTER_CONST (float, IsosurfaceExtractionGrid, resolution)
 GETTER_CONST (const glm::uvec3&, IsosurfaceExtractionGrid, numSamples)
 GETTER_CONST (const glm::uvec3&, IsosurfaceExtractionGrid, numCubes)
 GETTER (std::vector<float>&, IsosurfaceExtractionGrid, samples)
 DELEGATE3_CONST (glm::vec3, IsosurfaceExtractionGrid, samplePos, unsigned int, unsigned int,
                  unsigned int)
-DELEGATE1_CONST (glm::vec3, IsosurfaceExtractionGrid, samplePos, unsigned int)
 DELEGATE3_CONST (unsigned int, IsosurfaceExtractionGrid, sampleIndex, unsigned int, unsigned int,
                  unsigned int)
 DELEGATE2_CONST (unsigned int, IsosurfaceExtractionGrid, sampleIndex, unsigned int, unsigned char)
 DELEGATE3_CONST (unsigned int, IsosurfaceExtractionGrid, cubeIndex, unsigned int, unsigned int,
                  unsigned int)
+DELEGATE_CONST (bool, IsosurfaceExtractionGrid, isStreaming)
+DELEGATE1 (void, IsosurfaceExtractionGrid, resetSamples, unsigned int)
+DELEGATE1 (void, IsosurfaceExtractionGrid, setCubes, float)
 DELEGATE1 (void, IsosurfaceExtractionGrid, makeMesh, DynamicMesh&)
+DELEGATE1 (void, IsosurfaceExtractionGrid, makeMeshBegin, DynamicMesh&)
+DELEGATE2 (void, IsosurfaceExtractionGrid, makeMeshSlice, DynamicMesh&, unsigned int)
+DELEGATE1 (void, IsosurfaceExtractionGrid, makeMeshEnd, DynamicMesh&)
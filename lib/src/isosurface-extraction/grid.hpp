@@ -17,21 +17,34 @@ class IsosurfaceExtractionGrid
 public:
   static const unsigned char vertexIndicesByEdge[12][2];
 
-  DECLARE_BIG4_EXPLICIT_COPY (IsosurfaceExtractionGrid, const PrimAABox&, float)
+  // Grids with more than the given number of samples are streaming grids
+  DECLARE_BIG4_EXPLICIT_COPY (IsosurfaceExtractionGrid, const PrimAABox&, float, unsigned int)
 
   float               resolution () const;
   const glm::uvec3&   numSamples () const;
   const glm::uvec3&   numCubes () const;
   std::vector<float>& samples ();
 
+  // A streaming grid stores a few slices of samples and cubes along z only. Indices of slices
+  // that are not stored refer to the stored slice that they replace.
+  bool isStreaming () const;
+  void resetSamples (unsigned int);
+
   glm::vec3    samplePos (unsigned int, unsigned int, unsigned int) const;
-  glm::vec3    samplePos (unsigned int) const;
   unsigned int sampleIndex (unsigned int, unsigned int, unsigned int) const;
   unsigned int sampleIndex (unsigned int, unsigned char) const;
   unsigned int cubeIndex (unsigned int, unsigned int, unsigned int) const;
 
+  // Dense grids only. `setCubes` merges cubes where the surface is planar within the given
+  // tolerance, relative to the resolution. A tolerance of zero yields a uniform mesh.
+  void setCubes (float);
   void makeMesh (DynamicMesh&);
 
+  // `makeMeshSlice` must be called in increasing order once a slice of samples is final
+  void makeMeshBegin (DynamicMesh&);
+  void makeMeshSlice (DynamicMesh&, unsigned int);
+  void makeMeshEnd (DynamicMesh&);
+
 private:
   IMPLEMENTATION
 };
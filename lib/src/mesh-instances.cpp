@@ -0,0 +1,150 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_inverse.hpp>
+#include <vector>
+#include "camera.hpp"
+#include "color.hpp"
+#include "mesh-instances.hpp"
+#include "mesh.hpp"
+#include "opengl-buffer-id.hpp"
+#include "opengl.hpp"
+#include "render-mode.hpp"
+#include "renderer.hpp"
+
+namespace
+{
+  struct Instance
+  {
+    glm::mat4x4 model;
+    glm::vec3   color;
+
+    Instance (const glm::mat4x4& m, const glm::vec3& c)
+      : model (m)
+      , color (c)
+    {
+    }
+  };
+
+  static_assert (sizeof (Instance) == 19 * sizeof (float), "Unexpected memory layout");
+}
+
+struct MeshInstances::Impl
+{
+  std::vector<Instance> instances;
+  OpenGLBufferId        bufferId;
+  bool                  isBuffered;
+
+  Impl ()
+    : isBuffered (false)
+  {
+  }
+
+  // copies have no buffer, i.e. their instances are buffered anew
+  Impl (const Impl& other)
+    : instances (other.instances)
+    , isBuffered (false)
+  {
+  }
+
+  unsigned int numInstances () const { return this->instances.size (); }
+
+  void reset ()
+  {
+    this->instances.clear ();
+    this->isBuffered = false;
+  }
+
+  void add (const glm::mat4x4& model, const Color& color)
+  {
+    this->instances.emplace_back (model, color.vec3 ());
+    this->isBuffered = false;
+  }
+
+  void bufferData ()
+  {
+    if (this->bufferId.isValid () == false)
+    {
+      this->bufferId.allocate ();
+    }
+    else if (this->isBuffered)
+    {
+      return;
+    }
+    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->bufferId.id ());
+    OpenGL::glBufferData (OpenGL::ArrayBuffer (), this->instances.size () * sizeof (Instance),
+                          this->instances.data (), OpenGL::DynamicDraw ());
+    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
+
+    this->isBuffered = true;
+  }
+
+  // Instance attributes are specified on the vertex array object of the rendered mesh, which
+  // might be shared by several `MeshInstances`.
+  void setupAttributes () const
+  {
+    auto setupAttribute = [](unsigned int index, int size, std::size_t offset) {
+      OpenGL::glEnableVertexAttribArray (index);
+      OpenGL::glVertexAttribPointer (index, size, OpenGL::Float (), false, sizeof (Instance),
+                                     reinterpret_cast<const void*> (offset));
+      OpenGL::glVertexAttribDivisor (index, 1);
+    };
+
+    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->bufferId.id ());
+
+    for (unsigned int i = 0; i < 4; i++)
+    {
+      setupAttribute (OpenGL::InstanceModelIndex + i, 4,
+                      offsetof (Instance, model) + (i * sizeof (glm::vec4)));
+    }
+    setupAttribute (OpenGL::InstanceColorIndex, 3, offsetof (Instance, color));
+
+    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
+  }
+
+  void render (Camera& camera, Mesh& mesh)
+  {
+    if (this->instances.empty ())
+    {
+      return;
+    }
+    else if (OpenGL::isCoreProfile () && mesh.renderMode ().renderWireframe () == false)
+    {
+      this->bufferData ();
+
+      mesh.renderMode ().instanced (true);
+      mesh.render (camera, [this, &mesh]() {
+        this->setupAttributes ();
+        OpenGL::glDrawElementsInstanced (OpenGL::Triangles (), mesh.numIndices (),
+                                         OpenGL::UnsignedInt (), nullptr,
+                                         this->instances.size ());
+      });
+      mesh.renderMode ().instanced (false);
+    }
+    else
+    {
+      const bool rotationOnly = mesh.renderMode ().cameraRotationOnly ();
+
+      mesh.render (camera, [this, &camera, &mesh, rotationOnly]() {
+        for (const Instance& instance : this->instances)
+        {
+          const glm::mat3x3 modelNormal = glm::inverseTranspose (glm::mat3x3 (instance.model));
+
+          camera.setModelViewProjection (instance.model, modelNormal, rotationOnly);
+          camera.renderer ().setColor (Color (instance.color));
+          OpenGL::glDrawElements (OpenGL::Triangles (), mesh.numIndices (),
+                                  OpenGL::UnsignedInt (), nullptr);
+        }
+      });
+    }
+  }
+};
+
+DELEGATE_BIG4_COPY (MeshInstances)
+DELEGATE_CONST (unsigned int, MeshInstances, numInstances)
+DELEGATE (void, MeshInstances, reset)
+DELEGATE2 (void, MeshInstances, add, const glm::mat4x4&, const Color&)
+DELEGATE2 (void, MeshInstances, render, Camera&, Mesh&)
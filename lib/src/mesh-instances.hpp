@@ -0,0 +1,33 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_MESH_INSTANCES
+#define DILAY_MESH_INSTANCES
+
+#include <glm/fwd.hpp>
+#include "macro.hpp"
+
+class Camera;
+class Color;
+class Mesh;
+
+// `MeshInstances` renders a single mesh many times with per-instance model matrices and colors.
+// Instances are only buffered again after they have been changed by `reset` or `add`, i.e. owners
+// should keep their instances as long as they are up to date. Without a core profile context,
+// instances are rendered by successive draw calls.
+class MeshInstances
+{
+public:
+  DECLARE_BIG4_EXPLICIT_COPY (MeshInstances)
+
+  unsigned int numInstances () const;
+  void         reset ();
+  void         add (const glm::mat4x4&, const Color&);
+  void         render (Camera&, Mesh&);
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
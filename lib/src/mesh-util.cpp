@@ -14,6 +14,7 @@
 #include "mesh.hpp"
 #include "primitive/plane.hpp"
 #include "primitive/ray.hpp"
+#include "task-pool.hpp"
 #include "util.hpp"
 
 namespace
@@ -122,6 +123,21 @@ namespace
     }
     return mesh;
   }
+
+  // `-0` and `0` are equal but differ in their bits, i.e. keys are normalized before hashing
+  glm::vec3 positionKey (const glm::vec3& p) { return p + glm::vec3 (0.0f); }
+
+  struct PositionHash
+  {
+    std::size_t operator() (const glm::vec3& p) const
+    {
+      std::size_t seed = 0;
+      Hash::combine (seed, p.x);
+      Hash::combine (seed, p.y);
+      Hash::combine (seed, p.z);
+      return seed;
+    }
+  };
 }
 
 void MeshUtil::addFace (Mesh& mesh, unsigned int i1, unsigned int i2, unsigned int i3)
@@ -747,6 +763,97 @@ Mesh MeshUtil::mirror (const Mesh& mesh, const PrimPlane& plane)
   return m;
 }
 
+Mesh MeshUtil::fromTriangles (const std::vector<glm::vec3>& positions)
+{
+  assert (positions.size () % 3 == 0);
+
+  const unsigned int n = positions.size ();
+  const unsigned int blockSize = 1 << 16;
+  const unsigned int numBlocks = (n + blockSize - 1) / blockSize;
+  const unsigned int numBuckets = 4 * TaskPool::numThreads ();
+
+  // Positions are distributed to buckets by their hash, such that equal positions share a bucket
+  // and buckets are welded independently of each other
+  std::vector<unsigned int> bucketOf (n);
+  TaskPool::parallelFor (numBlocks, [&positions, &bucketOf, n, numBuckets](unsigned int b) {
+    const PositionHash hash;
+
+    for (unsigned int i = b * blockSize; i < std::min (n, (b + 1) * blockSize); i++)
+    {
+      bucketOf[i] = hash (positionKey (positions[i])) % numBuckets;
+    }
+  });
+
+  std::vector<unsigned int> bucketBegin (numBuckets + 1, 0);
+  std::vector<unsigned int> sorted (n);
+
+  for (unsigned int i = 0; i < n; i++)
+  {
+    bucketBegin[bucketOf[i] + 1]++;
+  }
+  for (unsigned int b = 0; b < numBuckets; b++)
+  {
+    bucketBegin[b + 1] += bucketBegin[b];
+  }
+
+  std::vector<unsigned int> bucketNext (bucketBegin.begin (), bucketBegin.end () - 1);
+  for (unsigned int i = 0; i < n; i++)
+  {
+    sorted[bucketNext[bucketOf[i]]++] = i;
+  }
+
+  // Every position is mapped to its first occurrence
+  std::vector<unsigned int> firstOf (n);
+  TaskPool::parallelFor (numBuckets, [&positions, &bucketBegin, &sorted,
+                                      &firstOf](unsigned int b) {
+    std::unordered_map<glm::vec3, unsigned int, PositionHash> firsts;
+    firsts.reserve (bucketBegin[b + 1] - bucketBegin[b]);
+
+    for (unsigned int j = bucketBegin[b]; j < bucketBegin[b + 1]; j++)
+    {
+      const unsigned int i = sorted[j];
+      firstOf[i] = firsts.emplace (positionKey (positions[i]), i).first->second;
+    }
+  });
+
+  unsigned int numVertices = 0;
+  for (unsigned int i = 0; i < n; i++)
+  {
+    if (firstOf[i] == i)
+    {
+      numVertices++;
+    }
+  }
+
+  // Vertices are added in order of their first use, i.e. positions that are only used by
+  // degenerated triangles are dropped
+  Mesh                      mesh;
+  std::vector<unsigned int> newIndex (n, Util::invalidIndex ());
+
+  mesh.reserveVertices (numVertices);
+  mesh.reserveIndices (n);
+
+  for (unsigned int i = 0; i < n; i += 3)
+  {
+    const unsigned int f1 = firstOf[i + 0];
+    const unsigned int f2 = firstOf[i + 1];
+    const unsigned int f3 = firstOf[i + 2];
+
+    if (f1 != f2 && f1 != f3 && f2 != f3)
+    {
+      for (unsigned int f : {f1, f2, f3})
+      {
+        if (newIndex[f] == Util::invalidIndex ())
+        {
+          newIndex[f] = mesh.addVertex (positions[f]);
+        }
+      }
+      MeshUtil::addFace (mesh, newIndex[f1], newIndex[f2], newIndex[f3]);
+    }
+  }
+  return mesh;
+}
+
 bool MeshUtil::checkConsistency (const Mesh& mesh)
 {
   if (mesh.numVertices () == 0)
@@ -5,6 +5,9 @@
 #ifndef DILAY_MESH_UTIL
 #define DILAY_MESH_UTIL
 
+#include <glm/fwd.hpp>
+#include <vector>
+
 class Mesh;
 class PrimPlane;
 
@@ -20,6 +23,11 @@ namespace MeshUtil
   Mesh cylinder (unsigned int);
 
   Mesh mirror (const Mesh&, const PrimPlane&);
+
+  // Builds a mesh of triangles that are given by three consecutive positions each. Equal
+  // positions are welded into a single vertex and degenerated triangles are dropped.
+  Mesh fromTriangles (const std::vector<glm::vec3>&);
+
   bool checkConsistency (const Mesh&);
 };
 
@@ -10,6 +10,7 @@
 #include "color.hpp"
 #include "mesh.hpp"
 #include "opengl-buffer-id.hpp"
+#include "opengl-vertex-array-id.hpp"
 #include "opengl.hpp"
 #include "primitive/aabox.hpp"
 #include "render-mode.hpp"
@@ -20,6 +21,11 @@ namespace
 {
   static_assert (sizeof (glm::vec3) == 3 * sizeof (float), "Unexpected memory layout");
 
+  // Buffers grow geometrically but never reserve more than `maxBufferGrowth` bytes of unused
+  // storage, and are shrunk to fit once the data occupies less than a quarter of them.
+  const unsigned int maxBufferGrowth = 16 * 1024 * 1024;
+  const unsigned int minShrinkSize = 64 * 1024;
+
   template <typename T> struct BufferedData
   {
     OpenGLBufferId id;
@@ -82,6 +88,25 @@ namespace
       return this->data[index];
     }
 
+    unsigned int grownBufferSize (unsigned int dataSize) const
+    {
+      const unsigned int geometric = this->bufferSize + (this->bufferSize / 2);
+      return glm::min (glm::max (dataSize, geometric), dataSize + maxBufferGrowth);
+    }
+
+    void releaseBuffer ()
+    {
+      this->id.reset ();
+      this->bufferSize = 0;
+      this->dataLowerBound = 0;
+      this->dataUpperBound = this->numElements () > 0 ? this->numElements () - 1 : 0;
+    }
+
+    bool isOversized (unsigned int dataSize) const
+    {
+      return this->bufferSize > minShrinkSize && dataSize < this->bufferSize / 4;
+    }
+
     void bufferData (unsigned int target)
     {
       if (this->id.isValid () == false)
@@ -98,11 +123,12 @@ namespace
         OpenGL::glBufferData (target, dataSize, this->data.data (), OpenGL::StaticDraw ());
         this->bufferSize = dataSize;
       }
-      else if (this->bufferSize < dataSize)
+      else if (this->bufferSize < dataSize || this->isOversized (dataSize))
       {
-        const unsigned int newBufferSize = this->bufferSize + (100 * (dataSize - this->bufferSize));
+        const unsigned int newBufferSize =
+          this->bufferSize < dataSize ? this->grownBufferSize (dataSize) : dataSize;
 
-        OpenGL::glBufferData (target, newBufferSize, nullptr, OpenGL::StaticDraw ());
+        OpenGL::glBufferData (target, newBufferSize, nullptr, OpenGL::DynamicDraw ());
         OpenGL::glBufferSubData (target, 0, dataSize, this->data.data ());
         this->bufferSize = newBufferSize;
       }
@@ -110,8 +136,17 @@ namespace
       {
         const unsigned int size = (this->dataUpperBound - this->dataLowerBound + 1) * sizeof (T);
 
-        OpenGL::glBufferSubData (target, this->dataLowerBound * sizeof (T), size,
-                                 &this->get (this->dataLowerBound));
+        if (2 * size > this->bufferSize)
+        {
+          // Orphan the old storage so that the driver need not wait for pending draws
+          OpenGL::glBufferData (target, this->bufferSize, nullptr, OpenGL::DynamicDraw ());
+          OpenGL::glBufferSubData (target, 0, dataSize, this->data.data ());
+        }
+        else
+        {
+          OpenGL::glBufferSubData (target, this->dataLowerBound * sizeof (T), size,
+                                   &this->get (this->dataLowerBound));
+        }
       }
       this->resetBounds ();
     }
@@ -130,6 +165,9 @@ struct Mesh::Impl
   Color                      color;
   Color                      wireframeColor;
 
+  // core profile only: attribute setup of `vertices` and `normals`, cf. `bindVertexArray`
+  mutable OpenGLVertexArrayId vertexArray;
+
   RenderMode renderMode;
 
   Impl ()
@@ -206,16 +244,46 @@ struct Mesh::Impl
     this->normals.set (i, n);
   }
 
-  void bufferData ()
+  unsigned int bufferSize () const
+  {
+    return this->vertices.bufferSize + this->indices.bufferSize + this->normals.bufferSize;
+  }
+
+  void bufferData (bool withIndices)
   {
+    if (OpenGL::isCoreProfile ())
+    {
+      if (this->vertices.id.isValid () == false || this->normals.id.isValid () == false)
+      {
+        this->vertexArray.reset ();
+      }
+      OpenGL::glBindVertexArray (0);
+    }
     this->vertices.bufferData (OpenGL::ArrayBuffer ());
-    this->indices.bufferData (OpenGL::ElementArrayBuffer ());
     this->normals.bufferData (OpenGL::ArrayBuffer ());
 
+    if (withIndices)
+    {
+      this->indices.bufferData (OpenGL::ElementArrayBuffer ());
+    }
+    else
+    {
+      this->indices.releaseBuffer ();
+    }
+
     OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), 0);
     OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
   }
 
+  // The next call of `bufferData` buffers all data
+  void releaseBuffers ()
+  {
+    this->vertices.releaseBuffer ();
+    this->indices.releaseBuffer ();
+    this->normals.releaseBuffer ();
+    this->vertexArray.reset ();
+  }
+
   glm::mat4x4 modelMatrix () const
   {
     return this->translationMatrix * this->rotationMatrix * this->scalingMatrix;
@@ -249,49 +317,99 @@ struct Mesh::Impl
 
     this->setModelMatrix (camera, this->renderMode.cameraRotationOnly ());
 
-    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->vertices.id.id ());
-    OpenGL::glEnableVertexAttribArray (OpenGL::PositionIndex);
-    OpenGL::glVertexAttribPointer (OpenGL::PositionIndex, 3, OpenGL::Float (), false, 0, 0);
+    if (OpenGL::isCoreProfile ())
+    {
+      this->bindVertexArray ();
+    }
+    else
+    {
+      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->vertices.id.id ());
+      OpenGL::glEnableVertexAttribArray (OpenGL::PositionIndex);
+      OpenGL::glVertexAttribPointer (OpenGL::PositionIndex, 3, OpenGL::Float (), false, 0, 0);
 
+      if (this->renderMode.smoothShading ())
+      {
+        OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->normals.id.id ());
+        OpenGL::glEnableVertexAttribArray (OpenGL::NormalIndex);
+        OpenGL::glVertexAttribPointer (OpenGL::NormalIndex, 3, OpenGL::Float (), false, 0, 0);
+      }
+      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
+    }
     OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), this->indices.id.id ());
 
-    if (this->renderMode.smoothShading ())
+    if (this->renderMode.noDepthTest ())
     {
-      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->normals.id.id ());
-      OpenGL::glEnableVertexAttribArray (OpenGL::NormalIndex);
-      OpenGL::glVertexAttribPointer (OpenGL::NormalIndex, 3, OpenGL::Float (), false, 0, 0);
+      OpenGL::glDisable (OpenGL::DepthTest ());
     }
-    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
+  }
 
-    if (this->renderMode.noDepthTest ())
+  // Attribute pointers are specified once per vertex array object. Since buffer objects
+  // are referenced by id, they only need to be re-specified if `bufferData` allocates new
+  // buffers, which resets `vertexArray`. Normals are always enabled if they are buffered:
+  // shaders without a `normal` attribute just ignore them.
+  void bindVertexArray () const
+  {
+    if (this->vertexArray.isValid ())
     {
-      OpenGL::glDisable (OpenGL::DepthTest ());
+      OpenGL::glBindVertexArray (this->vertexArray.id ());
+    }
+    else
+    {
+      this->vertexArray.allocate ();
+      OpenGL::glBindVertexArray (this->vertexArray.id ());
+
+      if (this->vertices.id.isValid ())
+      {
+        OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->vertices.id.id ());
+        OpenGL::glEnableVertexAttribArray (OpenGL::PositionIndex);
+        OpenGL::glVertexAttribPointer (OpenGL::PositionIndex, 3, OpenGL::Float (), false, 0, 0);
+      }
+      if (this->normals.id.isValid ())
+      {
+        OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), this->normals.id.id ());
+        OpenGL::glEnableVertexAttribArray (OpenGL::NormalIndex);
+        OpenGL::glVertexAttribPointer (OpenGL::NormalIndex, 3, OpenGL::Float (), false, 0, 0);
+      }
+      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
     }
   }
 
   void renderEnd () const
   {
-    OpenGL::glDisableVertexAttribArray (OpenGL::PositionIndex);
-    OpenGL::glDisableVertexAttribArray (OpenGL::NormalIndex);
-    OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
-    OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), 0);
+    if (OpenGL::isCoreProfile ())
+    {
+      OpenGL::glBindVertexArray (0);
+    }
+    else
+    {
+      OpenGL::glDisableVertexAttribArray (OpenGL::PositionIndex);
+      OpenGL::glDisableVertexAttribArray (OpenGL::NormalIndex);
+      OpenGL::glBindBuffer (OpenGL::ArrayBuffer (), 0);
+      OpenGL::glBindBuffer (OpenGL::ElementArrayBuffer (), 0);
+    }
     OpenGL::glEnable (OpenGL::DepthTest ());
   }
 
   void render (Camera& camera) const
+  {
+    this->render (camera, [this]() {
+      OpenGL::glDrawElements (OpenGL::Triangles (), this->numIndices (), OpenGL::UnsignedInt (),
+                              nullptr);
+    });
+  }
+
+  void render (Camera& camera, const std::function<void()>& draw) const
   {
     this->renderBegin (camera);
 
-    OpenGL::glDrawElements (OpenGL::Triangles (), this->numIndices (), OpenGL::UnsignedInt (),
-                            nullptr);
+    draw ();
 
     if (this->renderMode.renderWireframe () && OpenGL::hasGeometryShader () == false)
     {
       camera.renderer ().setColor (this->wireframeColor);
       OpenGL::glPolygonMode (OpenGL::FrontAndBack (), OpenGL::Line ());
 
-      OpenGL::glDrawElements (OpenGL::Triangles (), this->numIndices (), OpenGL::UnsignedInt (),
-                              nullptr);
+      draw ();
 
       OpenGL::glPolygonMode (OpenGL::FrontAndBack (), OpenGL::Fill ());
     }
@@ -319,6 +437,7 @@ struct Mesh::Impl
     this->vertices.reset ();
     this->indices.reset ();
     this->normals.reset ();
+    this->vertexArray.reset ();
   }
 
   void scale (const glm::vec3& v) { this->scalingMatrix = glm::scale (this->scalingMatrix, v); }
@@ -422,12 +541,15 @@ DELEGATE2 (void, Mesh, index, unsigned int, unsigned int)
 DELEGATE2 (void, Mesh, vertex, unsigned int, const glm::vec3&)
 DELEGATE2 (void, Mesh, normal, unsigned int, const glm::vec3&)
 
-DELEGATE (void, Mesh, bufferData)
+DELEGATE_CONST (unsigned int, Mesh, bufferSize)
+DELEGATE1 (void, Mesh, bufferData, bool)
+DELEGATE (void, Mesh, releaseBuffers)
 DELEGATE_CONST (glm::mat4x4, Mesh, modelMatrix)
 DELEGATE_CONST (glm::mat3x3, Mesh, modelNormalMatrix)
 DELEGATE1_CONST (void, Mesh, renderBegin, Camera&)
 DELEGATE_CONST (void, Mesh, renderEnd)
 DELEGATE1_CONST (void, Mesh, render, Camera&)
+DELEGATE2_CONST (void, Mesh, render, Camera&, const std::function<void()>&)
 DELEGATE1_CONST (void, Mesh, renderLines, Camera&)
 DELEGATE (void, Mesh, reset)
 DELEGATE (void, Mesh, resetGeometry)
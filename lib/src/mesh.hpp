@@ -5,6 +5,7 @@
 #ifndef DILAY_MESH
 #define DILAY_MESH
 
+#include <functional>
 #include <glm/fwd.hpp>
 #include "macro.hpp"
 
@@ -36,12 +37,15 @@ public:
   void             vertex (unsigned int, const glm::vec3&);
   void             normal (unsigned int, const glm::vec3&);
 
-  void              bufferData ();
+  unsigned int      bufferSize () const;
+  void              bufferData (bool = true);
+  void              releaseBuffers ();
   glm::mat4x4       modelMatrix () const;
   glm::mat3x3       modelNormalMatrix () const;
   void              renderBegin (Camera&) const;
   void              renderEnd () const;
   void              render (Camera&) const;
+  void              render (Camera&, const std::function<void()>&) const;
   void              renderLines (Camera&) const;
   void              reset ();
   void              resetGeometry ();
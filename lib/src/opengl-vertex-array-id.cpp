@@ -0,0 +1,61 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include "opengl-vertex-array-id.hpp"
+#include "opengl.hpp"
+
+OpenGLVertexArrayId::OpenGLVertexArrayId ()
+  : _id (0)
+{
+}
+
+OpenGLVertexArrayId::OpenGLVertexArrayId (const OpenGLVertexArrayId&)
+  : OpenGLVertexArrayId ()
+{
+}
+
+OpenGLVertexArrayId::OpenGLVertexArrayId (OpenGLVertexArrayId&& other)
+  : _id (other._id)
+{
+  other._id = 0;
+}
+
+const OpenGLVertexArrayId& OpenGLVertexArrayId::operator= (const OpenGLVertexArrayId&)
+{
+  return *this;
+}
+
+const OpenGLVertexArrayId& OpenGLVertexArrayId::operator= (OpenGLVertexArrayId&& other)
+{
+  if (this != &other)
+  {
+    this->reset ();
+    this->_id = other._id;
+    other._id = 0;
+  }
+  return *this;
+}
+
+OpenGLVertexArrayId::~OpenGLVertexArrayId () { this->reset (); }
+
+unsigned int OpenGLVertexArrayId::id () const { return this->_id; }
+
+bool OpenGLVertexArrayId::isValid () const { return this->_id > 0; }
+
+void OpenGLVertexArrayId::allocate ()
+{
+  assert (this->isValid () == false);
+
+  OpenGL::glGenVertexArrays (1, &this->_id);
+
+  assert (this->isValid ());
+}
+
+void OpenGLVertexArrayId::reset ()
+{
+  if (this->isValid ())
+  {
+    OpenGL::safeDeleteVertexArray (this->_id);
+  }
+}
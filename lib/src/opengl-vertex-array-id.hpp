@@ -0,0 +1,25 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_OPENGL_VERTEX_ARRAY_ID
+#define DILAY_OPENGL_VERTEX_ARRAY_ID
+
+#include "macro.hpp"
+
+class OpenGLVertexArrayId
+{
+public:
+  DECLARE_BIG6 (OpenGLVertexArrayId)
+
+  unsigned int id () const;
+  bool         isValid () const;
+
+  void allocate ();
+  void reset ();
+
+private:
+  unsigned int _id;
+};
+
+#endif
@@ -5,6 +5,7 @@
 #include <QOpenGLContext>
 #include <QOpenGLExtensions>
 #include <QOpenGLFunctions_2_1>
+#include <QOpenGLFunctions_3_3_Core>
 #include <glm/glm.hpp>
 #include <iostream>
 #include <memory>
@@ -15,22 +16,24 @@
 
 #define DELEGATE_GL_CONSTANT(method, constant) \
   unsigned int method () { return constant; }
+#define CALL_GL(method, ...) \
+  (coreFun ? coreFun->method (__VA_ARGS__) : fun->method (__VA_ARGS__))
 #define DELEGATE_GL(r, method) \
-  r method () { return fun->method (); }
+  r method () { return CALL_GL (method); }
 #define DELEGATE1_GL(r, method, t1) \
-  r method (t1 a1) { return fun->method (a1); }
+  r method (t1 a1) { return CALL_GL (method, a1); }
 #define DELEGATE2_GL(r, method, t1, t2) \
-  r method (t1 a1, t2 a2) { return fun->method (a1, a2); }
+  r method (t1 a1, t2 a2) { return CALL_GL (method, a1, a2); }
 #define DELEGATE3_GL(r, method, t1, t2, t3) \
-  r method (t1 a1, t2 a2, t3 a3) { return fun->method (a1, a2, a3); }
+  r method (t1 a1, t2 a2, t3 a3) { return CALL_GL (method, a1, a2, a3); }
 #define DELEGATE4_GL(r, method, t1, t2, t3, t4) \
-  r method (t1 a1, t2 a2, t3 a3, t4 a4) { return fun->method (a1, a2, a3, a4); }
+  r method (t1 a1, t2 a2, t3 a3, t4 a4) { return CALL_GL (method, a1, a2, a3, a4); }
 #define DELEGATE5_GL(r, method, t1, t2, t3, t4, t5) \
-  r method (t1 a1, t2 a2, t3 a3, t4 a4, t5 a5) { return fun->method (a1, a2, a3, a4, a5); }
+  r method (t1 a1, t2 a2, t3 a3, t4 a4, t5 a5) { return CALL_GL (method, a1, a2, a3, a4, a5); }
 #define DELEGATE6_GL(r, method, t1, t2, t3, t4, t5, t6) \
   r method (t1 a1, t2 a2, t3 a3, t4 a4, t5 a5, t6 a6)   \
   {                                                     \
-    return fun->method (a1, a2, a3, a4, a5, a6);        \
+    return CALL_GL (method, a1, a2, a3, a4, a5, a6);    \
   }
 
 namespace OpenGL
@@ -39,17 +42,31 @@ namespace OpenGL
   static_assert (sizeof (int) >= 4, "type does not meet size required by OpenGL");
   static_assert (sizeof (float) >= 4, "type does not meet size required by OpenGL");
 
+  // `coreFun` is only set if the current context is a 3.3 core profile context, otherwise all
+  // calls are dispatched to the 2.1 functions `fun`
   static QOpenGLFunctions_2_1*                                  fun = nullptr;
+  static QOpenGLFunctions_3_3_Core*                             coreFun = nullptr;
   static std::unique_ptr<QOpenGLExtension_EXT_geometry_shader4> gsFun;
+  static bool                                                   coreGeometryShader = false;
+  static unsigned int                                           defaultVertexArray = 0;
+  static unsigned int                                           drawCalls = 0;
 
-  void setDefaultFormat ()
+  void setDefaultFormat (bool coreProfile)
   {
     QSurfaceFormat format;
 
-    format.setVersion (2, 1);
+    if (coreProfile)
+    {
+      format.setVersion (3, 3);
+      format.setProfile (QSurfaceFormat::CoreProfile);
+    }
+    else
+    {
+      format.setVersion (2, 1);
+      format.setProfile (QSurfaceFormat::NoProfile);
+    }
     format.setDepthBufferSize (24);
     format.setStencilBufferSize (1);
-    format.setProfile (QSurfaceFormat::NoProfile);
     format.setRenderableType (QSurfaceFormat::OpenGL);
 
     QSurfaceFormat::setDefaultFormat (format);
@@ -57,32 +74,57 @@ namespace OpenGL
 
   void initializeFunctions (bool initGeometryShader)
   {
-    fun = QOpenGLContext::currentContext ()->versionFunctions<QOpenGLFunctions_2_1> ();
-    if (fun == nullptr)
+    QOpenGLContext&      context = *QOpenGLContext::currentContext ();
+    const QSurfaceFormat format = context.format ();
+
+    fun = nullptr;
+    coreFun = nullptr;
+    gsFun.reset ();
+    coreGeometryShader = false;
+    defaultVertexArray = 0;
+
+    if (format.profile () == QSurfaceFormat::CoreProfile &&
+        format.version () >= qMakePair (3, 3))
     {
-      DILAY_PANIC ("could not obtain OpenGL 2.1 context")
+      coreFun = context.versionFunctions<QOpenGLFunctions_3_3_Core> ();
     }
-    fun->initializeOpenGLFunctions ();
 
-    if (initGeometryShader)
+    if (coreFun)
     {
-      const bool support =
-        QOpenGLContext::currentContext ()->hasExtension (QByteArray ("GL_EXT_geometry_shader4"));
-      if (support)
+      coreFun->initializeOpenGLFunctions ();
+      coreFun->glGenVertexArrays (1, &defaultVertexArray);
+      coreFun->glBindVertexArray (defaultVertexArray);
+      coreGeometryShader = initGeometryShader;
+    }
+    else
+    {
+      fun = context.versionFunctions<QOpenGLFunctions_2_1> ();
+      if (fun == nullptr)
+      {
+        DILAY_PANIC ("could not obtain OpenGL 2.1 context")
+      }
+      fun->initializeOpenGLFunctions ();
+
+      if (initGeometryShader)
       {
-        gsFun = std::make_unique<QOpenGLExtension_EXT_geometry_shader4> ();
-        if (gsFun == nullptr)
+        const bool support = context.hasExtension (QByteArray ("GL_EXT_geometry_shader4"));
+        if (support)
         {
-          DILAY_PANIC ("could not initialize GL_EXT_geometry_shader4 extension")
+          gsFun = std::make_unique<QOpenGLExtension_EXT_geometry_shader4> ();
+          if (gsFun == nullptr)
+          {
+            DILAY_PANIC ("could not initialize GL_EXT_geometry_shader4 extension")
+          }
+          gsFun->initializeOpenGLFunctions ();
         }
-        gsFun->initializeOpenGLFunctions ();
       }
     }
 
-    DILAY_INFO ("OpenGL version: %s", fun->glGetString (GL_VERSION));
-    DILAY_INFO ("OpenGL vendor: %s", fun->glGetString (GL_VENDOR));
-    DILAY_INFO ("OpenGL renderer: %s", fun->glGetString (GL_RENDERER));
-    DILAY_INFO ("OpenGL GLSL version: %s", fun->glGetString (GL_SHADING_LANGUAGE_VERSION));
+    DILAY_INFO ("OpenGL version: %s", CALL_GL (glGetString, GL_VERSION));
+    DILAY_INFO ("OpenGL vendor: %s", CALL_GL (glGetString, GL_VENDOR));
+    DILAY_INFO ("OpenGL renderer: %s", CALL_GL (glGetString, GL_RENDERER));
+    DILAY_INFO ("OpenGL GLSL version: %s", CALL_GL (glGetString, GL_SHADING_LANGUAGE_VERSION));
+    DILAY_INFO ("OpenGL core profile: %i", coreFun != nullptr);
     DILAY_INFO ("OpenGL supports GL_EXT_geometry_shader4: %i", gsFun != nullptr);
   }
 
@@ -100,6 +142,7 @@ namespace OpenGL
   DELEGATE_GL_CONSTANT (DepthBufferBit, GL_DEPTH_BUFFER_BIT);
   DELEGATE_GL_CONSTANT (DepthTest, GL_DEPTH_TEST);
   DELEGATE_GL_CONSTANT (DstColor, GL_DST_COLOR);
+  DELEGATE_GL_CONSTANT (DynamicDraw, GL_DYNAMIC_DRAW);
   DELEGATE_GL_CONSTANT (ElementArrayBuffer, GL_ELEMENT_ARRAY_BUFFER);
   DELEGATE_GL_CONSTANT (Equal, GL_EQUAL);
   DELEGATE_GL_CONSTANT (Fill, GL_FILL);
@@ -139,7 +182,6 @@ namespace OpenGL
   DELEGATE1_GL (void, glDepthMask, bool)
   DELEGATE1_GL (void, glDisable, unsigned int)
   DELEGATE1_GL (void, glDisableVertexAttribArray, unsigned int)
-  DELEGATE4_GL (void, glDrawElements, unsigned int, unsigned int, unsigned int, const void*)
   DELEGATE1_GL (void, glEnable, unsigned int)
   DELEGATE1_GL (void, glEnableVertexAttribArray, unsigned int)
   DELEGATE1_GL (void, glFrontFace, unsigned int)
@@ -160,71 +202,130 @@ namespace OpenGL
                 const void*)
   DELEGATE4_GL (void, glViewport, unsigned int, unsigned int, unsigned int, unsigned int)
 
-  bool hasGeometryShader () { return bool(gsFun); }
+  // Core profile contexts have no default vertex array object, i.e. buffer bindings outside of
+  // `Mesh::renderBegin`/`Mesh::renderEnd` would fail. Hence, `0` binds a vertex array object
+  // that only serves as target for such bindings.
+  void glBindVertexArray (unsigned int id)
+  {
+    assert (coreFun);
+    coreFun->glBindVertexArray (id > 0 ? id : defaultVertexArray);
+  }
+
+  void glDrawElementsInstanced (unsigned int mode, unsigned int count, unsigned int type,
+                                const void* indices, unsigned int numInstances)
+  {
+    assert (coreFun);
+    coreFun->glDrawElementsInstanced (mode, count, type, indices, numInstances);
+    drawCalls++;
+  }
+
+  void glGenVertexArrays (unsigned int n, unsigned int* ids)
+  {
+    assert (coreFun);
+    coreFun->glGenVertexArrays (n, ids);
+  }
+
+  void glVertexAttribDivisor (unsigned int index, unsigned int divisor)
+  {
+    assert (coreFun);
+    coreFun->glVertexAttribDivisor (index, divisor);
+  }
+
+  void glDrawElements (unsigned int mode, unsigned int count, unsigned int type,
+                       const void* indices)
+  {
+    CALL_GL (glDrawElements, mode, count, type, indices);
+    drawCalls++;
+  }
+
+  unsigned int numDrawCalls () { return drawCalls; }
+
+  void resetNumDrawCalls () { drawCalls = 0; }
+
+  bool isCoreProfile () { return coreFun != nullptr; }
+
+  bool hasGeometryShader () { return coreGeometryShader || bool(gsFun); }
+
+  void glUniformVec3 (unsigned int id, const glm::vec3& v)
+  {
+    CALL_GL (glUniform3f, id, v.x, v.y, v.z);
+  }
 
-  void glUniformVec3 (unsigned int id, const glm::vec3& v) { fun->glUniform3f (id, v.x, v.y, v.z); }
   void glUniformVec4 (unsigned int id, const glm::vec4& v)
   {
-    fun->glUniform4f (id, v.x, v.y, v.z, v.w);
+    CALL_GL (glUniform4f, id, v.x, v.y, v.z, v.w);
   }
 
   void safeDeleteBuffer (unsigned int& id)
   {
     if (id > 0)
     {
-      fun->glDeleteBuffers (1, &id);
+      CALL_GL (glDeleteBuffers, 1, &id);
+    }
+    id = 0;
+  }
+
+  void safeDeleteVertexArray (unsigned int& id)
+  {
+    if (id > 0 && coreFun)
+    {
+      coreFun->glDeleteVertexArrays (1, &id);
     }
     id = 0;
   }
 
   void safeDeleteShader (unsigned int& id)
   {
-    if (id > 0 && fun->glIsShader (id) == GL_TRUE)
+    if (id > 0 && CALL_GL (glIsShader, id) == GL_TRUE)
     {
-      fun->glDeleteShader (id);
+      CALL_GL (glDeleteShader, id);
     }
     id = 0;
   }
 
   void safeDeleteProgram (unsigned int& id)
   {
-    if (id > 0 && fun->glIsProgram (id) == GL_TRUE)
+    if (id > 0 && CALL_GL (glIsProgram, id) == GL_TRUE)
     {
       GLsizei numShaders;
       GLuint  shaderIds[2];
 
-      fun->glGetAttachedShaders (id, 2, &numShaders, shaderIds);
+      CALL_GL (glGetAttachedShaders, id, 2, &numShaders, shaderIds);
 
       for (GLsizei i = 0; i < numShaders; i++)
       {
         OpenGL::safeDeleteShader (shaderIds[i]);
       }
-      fun->glDeleteProgram (id);
+      CALL_GL (glDeleteProgram, id);
     }
     id = 0;
   }
 
   unsigned int loadProgram (const char* vertexShader, const char* fragmentShader,
-                            bool loadGeometryShader)
+                            bool loadGeometryShader, bool instanced)
   {
+    assert (instanced == false || isCoreProfile ());
+
     auto showInfoLog = [](GLuint id) {
       const int maxLogLength = 1000;
       char      logBuffer[maxLogLength];
       GLsizei   logLength;
-      fun->glGetShaderInfoLog (id, maxLogLength, &logLength, logBuffer);
+      CALL_GL (glGetShaderInfoLog, id, maxLogLength, &logLength, logBuffer);
       if (logLength > 0)
       {
         DILAY_WARN ("%s", logBuffer)
       }
     };
 
-    auto compileShader = [&showInfoLog](GLenum shaderType, const char* shaderSource) -> GLuint {
-      GLuint shaderId = fun->glCreateShader (shaderType);
-      fun->glShaderSource (shaderId, 1, &shaderSource, NULL);
-      fun->glCompileShader (shaderId);
+    auto compileShader = [&showInfoLog](GLenum shaderType, const char* shaderPrelude,
+                                        const char* shaderSource) -> GLuint {
+      const char* sources[] = {shaderPrelude, shaderSource};
+      GLuint      shaderId = CALL_GL (glCreateShader, shaderType);
+      CALL_GL (glShaderSource, shaderId, 2, sources, NULL);
+      CALL_GL (glCompileShader, shaderId);
 
       GLint status;
-      fun->glGetShaderiv (shaderId, GL_COMPILE_STATUS, &status);
+      CALL_GL (glGetShaderiv, shaderId, GL_COMPILE_STATUS, &status);
       if (status == GL_FALSE)
       {
         showInfoLog (shaderId);
@@ -233,33 +334,51 @@ namespace OpenGL
       return shaderId;
     };
 
-    GLuint programId = fun->glCreateProgram ();
-    GLuint vsId = compileShader (GL_VERTEX_SHADER, vertexShader);
-    GLuint fsId = compileShader (GL_FRAGMENT_SHADER, fragmentShader);
+    GLuint programId = CALL_GL (glCreateProgram);
+    GLuint vsId = compileShader (
+      GL_VERTEX_SHADER, Shader::vertexShaderPrelude (isCoreProfile (), instanced), vertexShader);
+    GLuint fsId = compileShader (GL_FRAGMENT_SHADER,
+                                 Shader::fragmentShaderPrelude (isCoreProfile (), instanced),
+                                 fragmentShader);
     GLuint gmId = 0;
 
-    fun->glAttachShader (programId, vsId);
-    fun->glAttachShader (programId, fsId);
+    CALL_GL (glAttachShader, programId, vsId);
+    CALL_GL (glAttachShader, programId, fsId);
 
     if (loadGeometryShader)
     {
       assert (OpenGL::hasGeometryShader ());
 
-      gmId = compileShader (GL_GEOMETRY_SHADER_EXT, Shader::geometryShader ());
-      fun->glAttachShader (programId, gmId);
+      if (isCoreProfile ())
+      {
+        gmId = compileShader (GL_GEOMETRY_SHADER, "", Shader::coreGeometryShader ());
+        CALL_GL (glAttachShader, programId, gmId);
+      }
+      else
+      {
+        gmId = compileShader (GL_GEOMETRY_SHADER_EXT, "", Shader::geometryShader ());
+        CALL_GL (glAttachShader, programId, gmId);
 
-      gsFun->glProgramParameteriEXT (programId, GL_GEOMETRY_VERTICES_OUT_EXT, 3);
-      gsFun->glProgramParameteriEXT (programId, GL_GEOMETRY_INPUT_TYPE_EXT, GL_TRIANGLES);
-      gsFun->glProgramParameteriEXT (programId, GL_GEOMETRY_OUTPUT_TYPE_EXT, GL_TRIANGLE_STRIP);
+        gsFun->glProgramParameteriEXT (programId, GL_GEOMETRY_VERTICES_OUT_EXT, 3);
+        gsFun->glProgramParameteriEXT (programId, GL_GEOMETRY_INPUT_TYPE_EXT, GL_TRIANGLES);
+        gsFun->glProgramParameteriEXT (programId, GL_GEOMETRY_OUTPUT_TYPE_EXT,
+                                       GL_TRIANGLE_STRIP);
+      }
     }
 
-    fun->glBindAttribLocation (programId, OpenGL::PositionIndex, "position");
-    fun->glBindAttribLocation (programId, OpenGL::NormalIndex, "normal");
+    CALL_GL (glBindAttribLocation, programId, OpenGL::PositionIndex, "position");
+    CALL_GL (glBindAttribLocation, programId, OpenGL::NormalIndex, "normal");
 
-    fun->glLinkProgram (programId);
+    if (instanced)
+    {
+      CALL_GL (glBindAttribLocation, programId, OpenGL::InstanceModelIndex, "instanceModel");
+      CALL_GL (glBindAttribLocation, programId, OpenGL::InstanceColorIndex, "instanceColor");
+    }
+
+    CALL_GL (glLinkProgram, programId);
 
     GLint status;
-    fun->glGetProgramiv (programId, GL_LINK_STATUS, &status);
+    CALL_GL (glGetProgramiv, programId, GL_LINK_STATUS, &status);
 
     if (status == GL_FALSE)
     {
@@ -273,11 +392,13 @@ namespace OpenGL
     return programId;
   }
 
-  void clearError () { fun->glGetError (); }
+  void clearError () { CALL_GL (glGetError); }
+
+  bool hasError () { return CALL_GL (glGetError) != GL_NO_ERROR; }
 
   void printError ()
   {
-    const unsigned int glError = fun->glGetError ();
+    const unsigned int glError = CALL_GL (glGetError);
 
     switch (glError)
     {
@@ -11,7 +11,7 @@
 namespace OpenGL
 {
   // QT related
-  void setDefaultFormat ();
+  void setDefaultFormat (bool);
   void initializeFunctions (bool);
 
   // wrappers
@@ -29,6 +29,7 @@ namespace OpenGL
   unsigned int DepthBufferBit ();
   unsigned int DepthTest ();
   unsigned int DstColor ();
+  unsigned int DynamicDraw ();
   unsigned int ElementArrayBuffer ();
   unsigned int Equal ();
   unsigned int Fill ();
@@ -88,21 +89,35 @@ namespace OpenGL
   void glVertexAttribPointer (unsigned int, int, unsigned int, bool, unsigned int, const void*);
   void glViewport (unsigned int, unsigned int, unsigned int, unsigned int);
 
+  // core profile only
+  void glBindVertexArray (unsigned int);
+  void glDrawElementsInstanced (unsigned int, unsigned int, unsigned int, const void*,
+                                unsigned int);
+  void glGenVertexArrays (unsigned int, unsigned int*);
+  void glVertexAttribDivisor (unsigned int, unsigned int);
+
   // utilities
   enum VertexAttributIndex
   {
     PositionIndex = 0,
-    NormalIndex = 1
+    NormalIndex = 1,
+    InstanceModelIndex = 2, // occupies four indices, one per column
+    InstanceColorIndex = 6
   };
 
+  unsigned int numDrawCalls ();
+  void         resetNumDrawCalls ();
+  bool         isCoreProfile ();
   bool         hasGeometryShader ();
   void         glUniformVec3 (unsigned int, const glm::vec3&);
   void         glUniformVec4 (unsigned int, const glm::vec4&);
   void         safeDeleteBuffer (unsigned int&);
+  void         safeDeleteVertexArray (unsigned int&);
   void         safeDeleteShader (unsigned int&);
   void         safeDeleteProgram (unsigned int&);
-  unsigned int loadProgram (const char*, const char*, bool);
+  unsigned int loadProgram (const char*, const char*, bool, bool);
   void         clearError ();
+  bool         hasError ();
   void         printError ();
 }
 
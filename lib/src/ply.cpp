@@ -0,0 +1,461 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "ply.hpp"
+#include "util.hpp"
+
+namespace
+{
+  enum class Type
+  {
+    Int8,
+    UInt8,
+    Int16,
+    UInt16,
+    Int32,
+    UInt32,
+    Float32,
+    Float64,
+    Invalid
+  };
+
+  enum class Format
+  {
+    Ascii,
+    LittleEndian,
+    BigEndian,
+    Invalid
+  };
+
+  // Properties of interest are classified while parsing the header
+  enum class Usage
+  {
+    X,
+    Y,
+    Z,
+    VertexIndices,
+    None
+  };
+
+  struct Property
+  {
+    Type  type;
+    Type  countType;
+    bool  isList;
+    Usage usage;
+  };
+
+  struct Element
+  {
+    std::string           name;
+    unsigned int          count;
+    std::vector<Property> properties;
+  };
+
+  struct Header
+  {
+    Format               format;
+    std::vector<Element> elements;
+    std::size_t          size;
+  };
+
+  Type toType (const std::string& name)
+  {
+    if (name == "char" || name == "int8")
+    {
+      return Type::Int8;
+    }
+    else if (name == "uchar" || name == "uint8")
+    {
+      return Type::UInt8;
+    }
+    else if (name == "short" || name == "int16")
+    {
+      return Type::Int16;
+    }
+    else if (name == "ushort" || name == "uint16")
+    {
+      return Type::UInt16;
+    }
+    else if (name == "int" || name == "int32")
+    {
+      return Type::Int32;
+    }
+    else if (name == "uint" || name == "uint32")
+    {
+      return Type::UInt32;
+    }
+    else if (name == "float" || name == "float32")
+    {
+      return Type::Float32;
+    }
+    else if (name == "double" || name == "float64")
+    {
+      return Type::Float64;
+    }
+    else
+    {
+      return Type::Invalid;
+    }
+  }
+
+  std::size_t typeSize (Type type)
+  {
+    switch (type)
+    {
+      case Type::Int8:
+      case Type::UInt8:
+        return 1;
+      case Type::Int16:
+      case Type::UInt16:
+        return 2;
+      case Type::Int32:
+      case Type::UInt32:
+      case Type::Float32:
+        return 4;
+      case Type::Float64:
+        return 8;
+      default:
+        DILAY_IMPOSSIBLE
+    }
+  }
+
+  Usage toUsage (const std::string& element, const std::string& property, bool isList)
+  {
+    if (element == "vertex" && isList == false)
+    {
+      if (property == "x")
+      {
+        return Usage::X;
+      }
+      else if (property == "y")
+      {
+        return Usage::Y;
+      }
+      else if (property == "z")
+      {
+        return Usage::Z;
+      }
+    }
+    else if (element == "face" && isList &&
+             (property == "vertex_indices" || property == "vertex_index"))
+    {
+      return Usage::VertexIndices;
+    }
+    return Usage::None;
+  }
+
+  bool readHeader (const unsigned char* data, std::size_t size, Header& header)
+  {
+    const char* begin = reinterpret_cast<const char*> (data);
+    const char* it = begin;
+    const char* end = begin + size;
+
+    header.format = Format::Invalid;
+
+    while (it != end)
+    {
+      const char* lineEnd = std::find (it, end, '\n');
+      std::string line (it, lineEnd);
+      it = lineEnd == end ? end : lineEnd + 1;
+
+      if (line.empty () == false && line.back () == '\r')
+      {
+        line.pop_back ();
+      }
+
+      std::istringstream stream (line);
+      std::string        keyword;
+      stream >> keyword;
+
+      if (keyword == "format")
+      {
+        std::string format;
+        stream >> format;
+
+        if (format == "ascii")
+        {
+          header.format = Format::Ascii;
+        }
+        else if (format == "binary_little_endian")
+        {
+          header.format = Format::LittleEndian;
+        }
+        else if (format == "binary_big_endian")
+        {
+          header.format = Format::BigEndian;
+        }
+      }
+      else if (keyword == "element")
+      {
+        Element element;
+        stream >> element.name >> element.count;
+
+        if (stream.fail ())
+        {
+          return false;
+        }
+        header.elements.push_back (std::move (element));
+      }
+      else if (keyword == "property")
+      {
+        Property    property;
+        std::string type;
+        std::string name;
+
+        if (header.elements.empty ())
+        {
+          return false;
+        }
+
+        stream >> type;
+        property.isList = type == "list";
+
+        if (property.isList)
+        {
+          std::string countType;
+          stream >> countType >> type;
+          property.countType = toType (countType);
+        }
+        else
+        {
+          property.countType = Type::UInt8;
+        }
+        stream >> name;
+        property.type = toType (type);
+        property.usage = toUsage (header.elements.back ().name, name, property.isList);
+
+        if (stream.fail () || property.type == Type::Invalid || property.countType == Type::Invalid)
+        {
+          return false;
+        }
+        header.elements.back ().properties.push_back (property);
+      }
+      else if (keyword == "end_header")
+      {
+        header.size = std::size_t (it - begin);
+        return header.format != Format::Invalid;
+      }
+    }
+    return false;
+  }
+
+  struct ByteReader
+  {
+    const unsigned char* it;
+    const unsigned char* end;
+    bool                 isBigEndian;
+    bool                 isValid;
+
+    ByteReader (const unsigned char* i, const unsigned char* e, bool b)
+      : it (i)
+      , end (e)
+      , isBigEndian (b)
+      , isValid (true)
+    {
+    }
+
+    std::size_t numBytesLeft () const { return std::size_t (this->end - this->it); }
+
+    uint64_t bits (std::size_t size)
+    {
+      if (this->numBytesLeft () < size)
+      {
+        this->isValid = false;
+        return 0;
+      }
+      uint64_t value = 0;
+      for (std::size_t i = 0; i < size; i++)
+      {
+        const std::size_t shift = this->isBigEndian ? size - i - 1 : i;
+        value |= uint64_t (this->it[i]) << (8 * shift);
+      }
+      this->it += size;
+      return value;
+    }
+
+    double scalar (Type type)
+    {
+      const uint64_t value = this->bits (typeSize (type));
+
+      switch (type)
+      {
+        case Type::Int8:
+          return double(int8_t (value));
+        case Type::UInt8:
+          return double(uint8_t (value));
+        case Type::Int16:
+          return double(int16_t (value));
+        case Type::UInt16:
+          return double(uint16_t (value));
+        case Type::Int32:
+          return double(int32_t (value));
+        case Type::UInt32:
+          return double(uint32_t (value));
+        case Type::Float32:
+        {
+          const uint32_t bits32 = uint32_t (value);
+          float          f;
+          std::memcpy (&f, &bits32, sizeof (float));
+          return double(f);
+        }
+        case Type::Float64:
+        {
+          double d;
+          std::memcpy (&d, &value, sizeof (double));
+          return d;
+        }
+        default:
+          DILAY_IMPOSSIBLE
+      }
+    }
+  };
+
+  bool readElement (ByteReader& reader, const Element& element, std::vector<glm::vec3>& vertices,
+                    std::vector<unsigned int>& indices)
+  {
+    const bool  isVertex = element.name == "vertex";
+    std::size_t minSize = 0;
+
+    for (const Property& p : element.properties)
+    {
+      minSize += typeSize (p.isList ? p.countType : p.type);
+    }
+    if (minSize == 0)
+    {
+      return true;
+    }
+    else if (reader.numBytesLeft () / minSize < element.count)
+    {
+      return false;
+    }
+
+    if (isVertex)
+    {
+      vertices.reserve (element.count);
+    }
+
+    std::vector<unsigned int> polygon;
+    for (unsigned int i = 0; i < element.count && reader.isValid; i++)
+    {
+      glm::vec3 vertex (0.0f);
+
+      for (const Property& p : element.properties)
+      {
+        if (p.isList)
+        {
+          const double count = reader.scalar (p.countType);
+
+          if (count < 0.0 || count > double(reader.numBytesLeft ()))
+          {
+            return false;
+          }
+          polygon.clear ();
+          for (unsigned int j = 0; j < (unsigned int) (count); j++)
+          {
+            const double value = reader.scalar (p.type);
+
+            if (p.usage == Usage::VertexIndices)
+            {
+              if (value < 0.0)
+              {
+                return false;
+              }
+              polygon.push_back ((unsigned int) (value));
+            }
+          }
+          for (unsigned int j = 2; j < polygon.size (); j++)
+          {
+            indices.push_back (polygon[0]);
+            indices.push_back (polygon[j - 1]);
+            indices.push_back (polygon[j]);
+          }
+        }
+        else
+        {
+          const double value = reader.scalar (p.type);
+
+          switch (p.usage)
+          {
+            case Usage::X:
+              vertex.x = float(value);
+              break;
+            case Usage::Y:
+              vertex.y = float(value);
+              break;
+            case Usage::Z:
+              vertex.z = float(value);
+              break;
+            default:
+              break;
+          }
+        }
+      }
+      if (isVertex)
+      {
+        vertices.push_back (vertex);
+      }
+    }
+    return reader.isValid;
+  }
+}
+
+bool Ply::isPly (const unsigned char* data, std::size_t size)
+{
+  return size >= 4 && std::memcmp (data, "ply", 3) == 0 && (data[3] == '\n' || data[3] == '\r');
+}
+
+bool Ply::read (const unsigned char* data, std::size_t size, Mesh& mesh)
+{
+  Header header;
+
+  if (Ply::isPly (data, size) == false || readHeader (data, size, header) == false)
+  {
+    DILAY_WARN ("malformed PLY header")
+    return false;
+  }
+  else if (header.format == Format::Ascii)
+  {
+    DILAY_WARN ("ASCII PLY files are not supported")
+    return false;
+  }
+
+  ByteReader reader (data + header.size, data + size, header.format == Format::BigEndian);
+
+  std::vector<glm::vec3>    vertices;
+  std::vector<unsigned int> indices;
+
+  for (const Element& element : header.elements)
+  {
+    if (readElement (reader, element, vertices, indices) == false)
+    {
+      DILAY_WARN ("truncated PLY element '%s'", element.name.c_str ())
+      return false;
+    }
+  }
+
+  std::vector<glm::vec3> positions;
+  positions.reserve (indices.size ());
+
+  for (unsigned int index : indices)
+  {
+    if (index >= vertices.size ())
+    {
+      DILAY_WARN ("invalid PLY vertex index %u", index)
+      return false;
+    }
+    positions.push_back (vertices[index]);
+  }
+  mesh = MeshUtil::fromTriangles (positions);
+  return true;
+}
@@ -0,0 +1,21 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_PLY
+#define DILAY_PLY
+
+#include <cstddef>
+
+class Mesh;
+
+// `Ply` reads binary PLY files of either byte order. Only the positions of the `vertex` element
+// and the `vertex_indices` of the `face` element are read, all other elements and properties are
+// skipped. Polygons are triangulated and welded into a mesh, cf. `MeshUtil::fromTriangles`.
+namespace Ply
+{
+  bool isPly (const unsigned char*, std::size_t);
+  bool read (const unsigned char*, std::size_t, Mesh&);
+}
+
+#endif
@@ -3,6 +3,7 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include "primitive/aabox.hpp"
+#include "primitive/triangle.hpp"
 
 PrimAABox::PrimAABox (const glm::vec3& min, const glm::vec3& max)
   : _minimum (min)
@@ -24,8 +25,20 @@ PrimAABox::PrimAABox (const glm::vec3& pos, float w)
 
 glm::vec3 PrimAABox::halfWidth () const { return (this->_maximum - this->_minimum) * 0.5f; }
 
+bool PrimAABox::contains (const glm::vec3& p) const
+{
+  return glm::all (glm::lessThanEqual (this->_minimum, p)) &&
+         glm::all (glm::greaterThanEqual (this->_maximum, p));
+}
+
 bool PrimAABox::contains (const PrimAABox& box) const
 {
   return glm::all (glm::lessThanEqual (this->_minimum, box._minimum)) &&
          glm::all (glm::greaterThanEqual (this->_maximum, box._maximum));
 }
+
+bool PrimAABox::contains (const PrimTriangle& tri) const
+{
+  return this->contains (tri.vertex1 ()) && this->contains (tri.vertex2 ()) &&
+         this->contains (tri.vertex3 ());
+}
@@ -7,6 +7,8 @@
 
 #include <glm/glm.hpp>
 
+class PrimTriangle;
+
 class PrimAABox
 {
 public:
@@ -19,7 +21,9 @@ public:
   const glm::vec3& center () const { return this->_center; }
 
   glm::vec3 halfWidth () const;
+  bool      contains (const glm::vec3&) const;
   bool      contains (const PrimAABox&) const;
+  bool      contains (const PrimTriangle&) const;
 
 private:
   const glm::vec3 _minimum;
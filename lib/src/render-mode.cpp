@@ -13,6 +13,7 @@ RenderMode::RenderMode ()
   this->renderWireframe (false);
   this->cameraRotationOnly (false);
   this->noDepthTest (false);
+  this->instanced (false);
 }
 
 RenderMode::RenderMode (const RenderMode& other)
@@ -32,6 +33,8 @@ bool RenderMode::cameraRotationOnly () const { return this->flags.get<4> (); }
 
 bool RenderMode::noDepthTest () const { return this->flags.get<5> (); }
 
+bool RenderMode::instanced () const { return this->flags.get<6> (); }
+
 const char* RenderMode::vertexShader () const
 {
   if (this->smoothShading ())
@@ -110,3 +113,5 @@ void RenderMode::renderWireframe (bool v) { this->flags.set<3> (v); }
 void RenderMode::cameraRotationOnly (bool v) { this->flags.set<4> (v); }
 
 void RenderMode::noDepthTest (bool v) { this->flags.set<5> (v); }
+
+void RenderMode::instanced (bool v) { this->flags.set<6> (v); }
@@ -19,6 +19,7 @@ public:
   bool        renderWireframe () const;
   bool        cameraRotationOnly () const;
   bool        noDepthTest () const;
+  bool        instanced () const;
   const char* vertexShader () const;
   const char* fragmentShader () const;
 
@@ -28,6 +29,7 @@ public:
   void renderWireframe (bool);
   void cameraRotationOnly (bool);
   void noDepthTest (bool);
+  void instanced (bool);
 
 private:
   Bitset<unsigned int> flags;
@@ -3,6 +3,7 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
 #include "color.hpp"
 #include "config.hpp"
 #include "opengl.hpp"
@@ -28,6 +29,42 @@ namespace
     }
   };
 
+  // `UniformCache` stores the value that was last uploaded to a uniform
+  template <typename T> struct UniformCache
+  {
+    T    value;
+    bool isSet;
+
+    UniformCache ()
+      : isSet (false)
+    {
+    }
+
+    bool update (const T& newValue)
+    {
+      if (this->isSet && this->value == newValue)
+      {
+        return false;
+      }
+      else
+      {
+        this->value = newValue;
+        this->isSet = true;
+        return true;
+      }
+    }
+  };
+
+  struct UniformCaches
+  {
+    UniformCache<glm::mat4x4> model;
+    UniformCache<glm::mat3x3> modelNormal;
+    UniformCache<glm::mat4x4> view;
+    UniformCache<glm::mat4x4> projection;
+    UniformCache<glm::vec4>   color;
+    UniformCache<glm::vec4>   wireframeColor;
+  };
+
   struct ShaderIds
   {
     unsigned int programId;
@@ -41,6 +78,10 @@ namespace
     int          barycentricId;
     LightIds     lightIds[numLights];
 
+    // per-program state: uniforms keep their values while other programs are in use
+    unsigned int  globalUniformsVersion;
+    UniformCaches uniformCaches;
+
     ShaderIds ()
       : programId (0)
       , modelId (0)
@@ -51,6 +92,7 @@ namespace
       , wireframeColorId (0)
       , eyePointId (0)
       , barycentricId (0)
+      , globalUniformsVersion (0)
     {
     }
   };
@@ -62,21 +104,46 @@ namespace
     float     irradiance;
   };
 
+  // Global uniforms are uploaded to a program only if they changed since they were last uploaded
+  // to it, i.e. usually once per program and frame.
   struct GlobalUniforms
   {
     GlobalLightUniforms lightUniforms[numLights];
     glm::vec3           eyePoint;
+    unsigned int        version;
+
+    GlobalUniforms ()
+      : eyePoint (0.0f)
+      , version (1)
+    {
+    }
+  };
+
+  struct Statistics
+  {
+    unsigned int numDrawCalls;
+    unsigned int numStateChanges;
+    unsigned int numSkippedStateChanges;
+
+    Statistics ()
+      : numDrawCalls (0)
+      , numStateChanges (0)
+      , numSkippedStateChanges (0)
+    {
+    }
   };
 };
 
 struct Renderer::Impl
 {
-  static const unsigned int numShaders = 6;
+  static const unsigned int numShaders = 12;
 
   ShaderIds      shaderIds[Impl::numShaders];
   ShaderIds*     activeShaderIndex;
   GlobalUniforms globalUniforms;
   Color          clearColor;
+  Statistics     statistics;
+  Statistics     lastFrameStatistics;
 
   Impl (const Config& config)
     : activeShaderIndex (nullptr)
@@ -94,6 +161,11 @@ struct Renderer::Impl
 
   void setupRendering ()
   {
+    // programs might have been changed between frames, e.g. by `QPainter`
+    this->activeShaderIndex = nullptr;
+    this->statistics = Statistics ();
+    OpenGL::resetNumDrawCalls ();
+
     OpenGL::glClearColor (this->clearColor.r (), this->clearColor.g (), this->clearColor.b (),
                           0.0f);
     OpenGL::glClearStencil (0);
@@ -109,9 +181,41 @@ struct Renderer::Impl
   {
     OpenGL::glDisable (OpenGL::DepthTest ());
     OpenGL::glDisable (OpenGL::CullFace ());
+
+    this->statistics.numDrawCalls = OpenGL::numDrawCalls ();
+    this->lastFrameStatistics = this->statistics;
+  }
+
+  bool countStateChange (bool isChange)
+  {
+    if (isChange)
+    {
+      this->statistics.numStateChanges++;
+    }
+    else
+    {
+      this->statistics.numSkippedStateChanges++;
+    }
+    return isChange;
+  }
+
+  unsigned int numDrawCalls () const { return this->lastFrameStatistics.numDrawCalls; }
+
+  unsigned int numStateChanges () const { return this->lastFrameStatistics.numStateChanges; }
+
+  unsigned int numSkippedStateChanges () const
+  {
+    return this->lastFrameStatistics.numSkippedStateChanges;
   }
 
   unsigned int shaderIndex (const RenderMode& renderMode)
+  {
+    const unsigned int offset = renderMode.instanced () ? Impl::numShaders / 2 : 0;
+
+    return offset + this->nonInstancedShaderIndex (renderMode);
+  }
+
+  unsigned int nonInstancedShaderIndex (const RenderMode& renderMode)
   {
     if (renderMode.smoothShading ())
     {
@@ -134,9 +238,11 @@ struct Renderer::Impl
   void initalizeProgram (const RenderMode& renderMode)
   {
     assert (renderMode.renderWireframe () == false || OpenGL::hasGeometryShader ());
+    assert (renderMode.instanced () == false || OpenGL::isCoreProfile ());
 
-    const unsigned int id = OpenGL::loadProgram (
-      renderMode.vertexShader (), renderMode.fragmentShader (), renderMode.renderWireframe ());
+    const unsigned int id =
+      OpenGL::loadProgram (renderMode.vertexShader (), renderMode.fragmentShader (),
+                           renderMode.renderWireframe (), renderMode.instanced ());
 
     unsigned int index = this->shaderIndex (renderMode);
     assert (this->shaderIds[index].programId == 0);
@@ -170,87 +276,129 @@ struct Renderer::Impl
     }
     assert (this->shaderIds[index].programId);
 
-    this->activeShaderIndex = &this->shaderIds[index];
-    OpenGL::glUseProgram (this->activeShaderIndex->programId);
+    if (this->countStateChange (this->activeShaderIndex != &this->shaderIds[index]))
+    {
+      this->activeShaderIndex = &this->shaderIds[index];
+      OpenGL::glUseProgram (this->activeShaderIndex->programId);
+    }
 
-    OpenGL::glUniformVec3 (this->activeShaderIndex->eyePointId, this->globalUniforms.eyePoint);
+    ShaderIds& s = *this->activeShaderIndex;
 
-    for (unsigned int i = 0; i < numLights; i++)
+    if (this->countStateChange (s.globalUniformsVersion != this->globalUniforms.version))
     {
-      OpenGL::glUniformVec3 (this->activeShaderIndex->lightIds[i].directionId,
-                             this->globalUniforms.lightUniforms[i].direction);
-      OpenGL::glUniformVec3 (this->activeShaderIndex->lightIds[i].colorId,
-                             this->globalUniforms.lightUniforms[i].color.vec3 ());
-      OpenGL::glUniform1f (this->activeShaderIndex->lightIds[i].irradianceId,
-                           this->globalUniforms.lightUniforms[i].irradiance);
+      OpenGL::glUniformVec3 (s.eyePointId, this->globalUniforms.eyePoint);
+
+      for (unsigned int i = 0; i < numLights; i++)
+      {
+        OpenGL::glUniformVec3 (s.lightIds[i].directionId,
+                               this->globalUniforms.lightUniforms[i].direction);
+        OpenGL::glUniformVec3 (s.lightIds[i].colorId,
+                               this->globalUniforms.lightUniforms[i].color.vec3 ());
+        OpenGL::glUniform1f (s.lightIds[i].irradianceId,
+                             this->globalUniforms.lightUniforms[i].irradiance);
+      }
+      s.globalUniformsVersion = this->globalUniforms.version;
     }
   }
 
   void setModel (const float* model, const float* modelNormal)
   {
     assert (this->activeShaderIndex);
-    OpenGL::glUniformMatrix4fv (this->activeShaderIndex->modelId, 1, false, model);
-    OpenGL::glUniformMatrix3fv (this->activeShaderIndex->modelNormalId, 1, false, modelNormal);
+    UniformCaches& caches = this->activeShaderIndex->uniformCaches;
+
+    if (this->countStateChange (caches.model.update (glm::make_mat4 (model))))
+    {
+      OpenGL::glUniformMatrix4fv (this->activeShaderIndex->modelId, 1, false, model);
+    }
+    if (this->countStateChange (caches.modelNormal.update (glm::make_mat3 (modelNormal))))
+    {
+      OpenGL::glUniformMatrix3fv (this->activeShaderIndex->modelNormalId, 1, false, modelNormal);
+    }
   }
 
   void setView (const float* view)
   {
     assert (this->activeShaderIndex);
-    OpenGL::glUniformMatrix4fv (this->activeShaderIndex->viewId, 1, false, view);
+    UniformCaches& caches = this->activeShaderIndex->uniformCaches;
+
+    if (this->countStateChange (caches.view.update (glm::make_mat4 (view))))
+    {
+      OpenGL::glUniformMatrix4fv (this->activeShaderIndex->viewId, 1, false, view);
+    }
   }
 
   void setProjection (const float* projection)
   {
     assert (this->activeShaderIndex);
-    OpenGL::glUniformMatrix4fv (this->activeShaderIndex->projectionId, 1, false, projection);
+    UniformCaches& caches = this->activeShaderIndex->uniformCaches;
+
+    if (this->countStateChange (caches.projection.update (glm::make_mat4 (projection))))
+    {
+      OpenGL::glUniformMatrix4fv (this->activeShaderIndex->projectionId, 1, false, projection);
+    }
   }
 
-  void setColor (const Color& c, bool withOpacity)
+  void setColor (int id, UniformCache<glm::vec4>& cache, const Color& c, bool withOpacity)
   {
-    assert (this->activeShaderIndex);
+    const glm::vec4 value = withOpacity ? c.vec4 () : glm::vec4 (c.vec3 (), 1.0f);
 
-    if (withOpacity)
-    {
-      OpenGL::glUniformVec4 (this->activeShaderIndex->colorId, c.vec4 ());
-    }
-    else
+    if (this->countStateChange (cache.update (value)))
     {
-      OpenGL::glUniformVec3 (this->activeShaderIndex->colorId, c.vec3 ());
+      if (withOpacity)
+      {
+        OpenGL::glUniformVec4 (id, value);
+      }
+      else
+      {
+        OpenGL::glUniformVec3 (id, c.vec3 ());
+      }
     }
   }
 
+  void setColor (const Color& c, bool withOpacity)
+  {
+    assert (this->activeShaderIndex);
+
+    this->setColor (this->activeShaderIndex->colorId,
+                    this->activeShaderIndex->uniformCaches.color, c, withOpacity);
+  }
+
   void setWireframeColor (const Color& c, bool withOpacity)
   {
     assert (this->activeShaderIndex);
 
-    if (withOpacity)
-    {
-      OpenGL::glUniformVec4 (this->activeShaderIndex->wireframeColorId, c.vec4 ());
-    }
-    else
+    this->setColor (this->activeShaderIndex->wireframeColorId,
+                    this->activeShaderIndex->uniformCaches.wireframeColor, c, withOpacity);
+  }
+
+  void setEyePoint (const glm::vec3& e)
+  {
+    if (this->globalUniforms.eyePoint != e)
     {
-      OpenGL::glUniformVec3 (this->activeShaderIndex->wireframeColorId, c.vec3 ());
+      this->globalUniforms.eyePoint = e;
+      this->globalUniforms.version++;
     }
   }
 
-  void setEyePoint (const glm::vec3& e) { this->globalUniforms.eyePoint = e; }
-
   void setLightDirection (unsigned int i, const glm::vec3& d)
   {
     assert (i < numLights);
     this->globalUniforms.lightUniforms[i].direction = d;
+    this->globalUniforms.version++;
   }
 
   void setLightColor (unsigned int i, const Color& c)
   {
     assert (i < numLights);
     this->globalUniforms.lightUniforms[i].color = c;
+    this->globalUniforms.version++;
   }
 
   void setLightIrradiance (unsigned int i, float irr)
   {
     assert (i < numLights);
     this->globalUniforms.lightUniforms[i].irradiance = irr;
+    this->globalUniforms.version++;
   }
 
   void runFromConfig (const Config& config)
@@ -283,4 +431,7 @@ DELEGATE1 (void, Renderer, setEyePoint, const glm::vec3&)
 DELEGATE2 (void, Renderer, setLightDirection, unsigned int, const glm::vec3&)
 DELEGATE2 (void, Renderer, setLightColor, unsigned int, const Color&)
 DELEGATE2 (void, Renderer, setLightIrradiance, unsigned int, float)
+DELEGATE_CONST (unsigned int, Renderer, numDrawCalls)
+DELEGATE_CONST (unsigned int, Renderer, numStateChanges)
+DELEGATE_CONST (unsigned int, Renderer, numSkippedStateChanges)
 DELEGATE1 (void, Renderer, runFromConfig, const Config&)
@@ -31,6 +31,11 @@ public:
   void setLightColor (unsigned int, const Color&);
   void setLightIrradiance (unsigned int, float);
 
+  // statistics of the last rendered frame
+  unsigned int numDrawCalls () const;
+  unsigned int numStateChanges () const;
+  unsigned int numSkippedStateChanges () const;
+
 private:
   IMPLEMENTATION
 
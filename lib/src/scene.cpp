@@ -3,9 +3,11 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <list>
+#include <unordered_map>
 #include "config.hpp"
 #include "dynamic/mesh-intersection.hpp"
 #include "dynamic/mesh.hpp"
+#include "export-job.hpp"
 #include "import-export.hpp"
 #include "intersection.hpp"
 #include "render-mode.hpp"
@@ -19,14 +21,18 @@
 
 struct Scene::Impl
 {
-  Scene*                 self;
-  std::list<DynamicMesh> dynamicMeshes;
-  std::list<SketchMesh>  sketchMeshes;
-  RenderMode             commonRenderMode;
-  std::string            fileName;
+  Scene*                                        self;
+  std::list<DynamicMesh>                        dynamicMeshes;
+  std::list<SketchMesh>                         sketchMeshes;
+  unsigned int                                  lastMeshId;
+  std::unordered_map<const void*, unsigned int> meshIds;
+  RenderMode                                    commonRenderMode;
+  std::string                                   fileName;
+  ExportJob                                     exportJob;
 
   Impl (Scene* s, const Config& config)
     : self (s)
+    , lastMeshId (0)
   {
     this->runFromConfig (config);
 
@@ -36,30 +42,62 @@ struct Scene::Impl
   DynamicMesh& newDynamicMesh (const Config& config, const DynamicMesh& other)
   {
     this->dynamicMeshes.emplace_back (other);
-    this->setupMesh (config, this->dynamicMeshes.back ());
-    return this->dynamicMeshes.back ();
+    return this->addMesh (config, this->dynamicMeshes);
+  }
+
+  DynamicMesh& newDynamicMesh (const Config& config, DynamicMesh&& other)
+  {
+    this->dynamicMeshes.emplace_back (std::move (other));
+    return this->addMesh (config, this->dynamicMeshes);
   }
 
   DynamicMesh& newDynamicMesh (const Config& config, const Mesh& mesh)
   {
     this->dynamicMeshes.emplace_back (mesh);
-    this->setupMesh (config, this->dynamicMeshes.back ());
-    return this->dynamicMeshes.back ();
+    return this->addMesh (config, this->dynamicMeshes);
   }
 
   SketchMesh& newSketchMesh (const Config& config, const SketchMesh& other)
   {
     this->sketchMeshes.emplace_back (other);
-    this->setupMesh (config, this->sketchMeshes.back ());
-    return this->sketchMeshes.back ();
+    return this->addMesh (config, this->sketchMeshes);
   }
 
   SketchMesh& newSketchMesh (const Config& config, const SketchTree& tree)
   {
     this->sketchMeshes.emplace_back ();
     this->sketchMeshes.back ().fromTree (tree);
-    this->setupMesh (config, this->sketchMeshes.back ());
-    return this->sketchMeshes.back ();
+    return this->addMesh (config, this->sketchMeshes);
+  }
+
+  // Ids are assigned when meshes are added to the scene and are never reused, i.e. unlike
+  // addresses they identify meshes even after other meshes have been deleted.
+  template <typename T> T& addMesh (const Config& config, std::list<T>& list)
+  {
+    this->meshIds[&list.back ()] = ++this->lastMeshId;
+    this->setupMesh (config, list.back ());
+    return list.back ();
+  }
+
+  // Moves another mesh to the position of a mesh and returns the replaced mesh. Both meshes keep
+  // their buffers, i.e. only changed data must be buffered.
+  DynamicMesh replaceMesh (const Config& config, DynamicMesh& mesh, DynamicMesh&& other)
+  {
+    for (auto it = this->dynamicMeshes.begin (); it != this->dynamicMeshes.end (); ++it)
+    {
+      if (&*it == &mesh)
+      {
+        DynamicMesh replaced (std::move (*it));
+        auto        newIt = this->dynamicMeshes.emplace (it, std::move (other));
+
+        this->meshIds.erase (&*it);
+        this->meshIds[&*newIt] = ++this->lastMeshId;
+        this->dynamicMeshes.erase (it);
+        this->setupMesh (config, *newIt);
+        return replaced;
+      }
+    }
+    DILAY_IMPOSSIBLE
   }
 
   void setupMesh (const Config& config, DynamicMesh& mesh)
@@ -75,12 +113,39 @@ struct Scene::Impl
     mesh.fromConfig (config);
   }
 
+  unsigned int id (const DynamicMesh& mesh) const { return this->meshIds.at (&mesh); }
+
+  unsigned int id (const SketchMesh& mesh) const { return this->meshIds.at (&mesh); }
+
+  template <typename T> T* meshT (std::list<T>& list, unsigned int id)
+  {
+    for (T& m : list)
+    {
+      if (this->meshIds.at (&m) == id)
+      {
+        return &m;
+      }
+    }
+    return nullptr;
+  }
+
+  DynamicMesh* dynamicMesh (unsigned int id)
+  {
+    return this->meshT<DynamicMesh> (this->dynamicMeshes, id);
+  }
+
+  SketchMesh* sketchMesh (unsigned int id)
+  {
+    return this->meshT<SketchMesh> (this->sketchMeshes, id);
+  }
+
   void deleteMesh (DynamicMesh& mesh)
   {
     for (auto it = this->dynamicMeshes.begin (); it != this->dynamicMeshes.end (); ++it)
     {
       if (&*it == &mesh)
       {
+        this->meshIds.erase (&mesh);
         this->dynamicMeshes.erase (it);
         this->resetIfEmpty ();
         return;
@@ -95,6 +160,7 @@ struct Scene::Impl
     {
       if (&*it == &mesh)
       {
+        this->meshIds.erase (&mesh);
         this->sketchMeshes.erase (it);
         this->resetIfEmpty ();
         return;
@@ -103,14 +169,31 @@ struct Scene::Impl
     DILAY_IMPOSSIBLE
   }
 
-  void deleteDynamicMeshes () { this->dynamicMeshes.clear (); }
+  template <typename T> void deleteMeshesT (std::list<T>& list)
+  {
+    for (const T& m : list)
+    {
+      this->meshIds.erase (&m);
+    }
+    list.clear ();
+  }
 
-  void deleteSketchMeshes () { this->sketchMeshes.clear (); }
+  void deleteDynamicMeshes () { this->deleteMeshesT<DynamicMesh> (this->dynamicMeshes); }
+
+  void deleteSketchMeshes () { this->deleteMeshesT<SketchMesh> (this->sketchMeshes); }
 
   void deleteEmptyMeshes ()
   {
-    this->dynamicMeshes.remove_if ([](const auto& mesh) { return mesh.isEmpty (); });
-    this->sketchMeshes.remove_if ([](const auto& mesh) { return mesh.isEmpty (); });
+    const auto deleteIfEmpty = [this](const auto& mesh) {
+      if (mesh.isEmpty ())
+      {
+        this->meshIds.erase (&mesh);
+        return true;
+      }
+      return false;
+    };
+    this->dynamicMeshes.remove_if (deleteIfEmpty);
+    this->sketchMeshes.remove_if (deleteIfEmpty);
     this->resetIfEmpty ();
   }
 
@@ -309,35 +392,38 @@ struct Scene::Impl
 
   bool hasFileName () const { return !this->fileName.empty (); }
 
-  bool toDlyFile (bool isObjFile)
+  void toDlyFile (bool isObjFile, const std::function<void(bool)>& callback)
   {
     assert (this->hasFileName ());
 
-    return Util::withCLocale<bool> ([this, isObjFile]() {
-      if (ImportExport::toDlyFile (this->fileName, *this->self, isObjFile))
-      {
-        return true;
-      }
-      else
-      {
-        this->fileName.clear ();
-        return false;
-      }
-    });
+    this->exportJob.run (*this->self, this->fileName, isObjFile,
+                         [this, savedFileName = this->fileName, callback](bool success) {
+                           if (success == false && this->fileName == savedFileName)
+                           {
+                             this->fileName.clear ();
+                           }
+                           callback (success);
+                         });
   }
 
-  bool toDlyFile (const std::string& newFileName, bool isObjFile)
+  void toDlyFile (const std::string& newFileName, bool isObjFile,
+                  const std::function<void(bool)>& callback)
   {
     this->fileName = newFileName;
-    return this->toDlyFile (isObjFile);
+    this->toDlyFile (isObjFile, callback);
   }
 
   bool fromDlyFile (const Config& config, const std::string& newFileName)
   {
+    this->exportJob.wait ();
     this->fileName = newFileName;
 
     if (ImportExport::fromDlyFile (this->fileName, config, *this->self))
     {
+      if (ImportExport::isMeshFile (this->fileName))
+      {
+        this->fileName.clear ();
+      }
       return true;
     }
     else
@@ -354,14 +440,20 @@ struct Scene::Impl
   }
 };
 
-DELEGATE1_BIG3_SELF (Scene, const Config&)
+DELEGATE1_BIG2_SELF (Scene, const Config&)
 
 DELEGATE2 (DynamicMesh&, Scene, newDynamicMesh, const Config&, const DynamicMesh&)
+DELEGATE2 (DynamicMesh&, Scene, newDynamicMesh, const Config&, DynamicMesh&&)
 DELEGATE2 (DynamicMesh&, Scene, newDynamicMesh, const Config&, const Mesh&)
 DELEGATE2 (SketchMesh&, Scene, newSketchMesh, const Config&, const SketchMesh&)
 DELEGATE2 (SketchMesh&, Scene, newSketchMesh, const Config&, const SketchTree&)
+DELEGATE3 (DynamicMesh, Scene, replaceMesh, const Config&, DynamicMesh&, DynamicMesh&&)
 DELEGATE2 (void, Scene, setupMesh, const Config&, DynamicMesh&)
 DELEGATE2 (void, Scene, setupMesh, const Config&, SketchMesh&)
+DELEGATE1_CONST (unsigned int, Scene, id, const DynamicMesh&)
+DELEGATE1_CONST (unsigned int, Scene, id, const SketchMesh&)
+DELEGATE1 (DynamicMesh*, Scene, dynamicMesh, unsigned int)
+DELEGATE1 (SketchMesh*, Scene, sketchMesh, unsigned int)
 DELEGATE1 (void, Scene, deleteMesh, DynamicMesh&)
 DELEGATE1 (void, Scene, deleteMesh, SketchMesh&)
 DELEGATE (void, Scene, deleteDynamicMeshes)
@@ -393,7 +485,7 @@ DELEGATE_CONST (unsigned int, Scene, numSketchMeshes)
 DELEGATE_CONST (unsigned int, Scene, numFaces)
 DELEGATE_CONST (bool, Scene, hasFileName)
 GETTER_CONST (const std::string&, Scene, fileName)
-DELEGATE1 (bool, Scene, toDlyFile, bool)
-DELEGATE2 (bool, Scene, toDlyFile, const std::string&, bool)
+DELEGATE2 (void, Scene, toDlyFile, bool, const std::function<void(bool)>&)
+DELEGATE3 (void, Scene, toDlyFile, const std::string&, bool, const std::function<void(bool)>&)
 DELEGATE2 (bool, Scene, fromDlyFile, const Config&, const std::string&)
 DELEGATE1 (void, Scene, runFromConfig, const Config&)
@@ -21,14 +21,20 @@ class RenderMode;
 class Scene : public Configurable
 {
 public:
-  DECLARE_BIG3 (Scene, const Config&)
+  DECLARE_BIG2 (Scene, const Config&)
 
   DynamicMesh& newDynamicMesh (const Config&, const DynamicMesh&);
+  DynamicMesh& newDynamicMesh (const Config&, DynamicMesh&&);
   DynamicMesh& newDynamicMesh (const Config&, const Mesh&);
   SketchMesh&  newSketchMesh (const Config&, const SketchMesh&);
   SketchMesh&  newSketchMesh (const Config&, const SketchTree&);
+  DynamicMesh  replaceMesh (const Config&, DynamicMesh&, DynamicMesh&&);
   void         setupMesh (const Config&, DynamicMesh&);
   void         setupMesh (const Config&, SketchMesh&);
+  unsigned int id (const DynamicMesh&) const;
+  unsigned int id (const SketchMesh&) const;
+  DynamicMesh* dynamicMesh (unsigned int);
+  SketchMesh*  sketchMesh (unsigned int);
   void         deleteMesh (DynamicMesh&);
   void         deleteMesh (SketchMesh&);
   void         deleteDynamicMeshes ();
@@ -60,9 +66,12 @@ public:
   unsigned int       numFaces () const;
   bool               hasFileName () const;
   const std::string& fileName () const;
-  bool               toDlyFile (bool);
-  bool               toDlyFile (const std::string&, bool);
-  bool               fromDlyFile (const Config&, const std::string&);
+
+  // Files are written in a background thread, cf. `ExportJob`, i.e. the callback is called with
+  // the result later. The file name is cleared if the file could not be written.
+  void toDlyFile (bool, const std::function<void(bool)>&);
+  void toDlyFile (const std::string&, bool, const std::function<void(bool)>&);
+  bool fromDlyFile (const Config&, const std::string&);
 
 private:
   IMPLEMENTATION
@@ -2,18 +2,50 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <cassert>
 #include "shader.hpp"
 
-#define SMOOTH_VERTEX_SHADER                                                                   \
+#define VERTEX_SHADER_PRELUDE_120                                                              \
+  "#version 120                                                                            \n" \
+  "#define IN  attribute                                                                   \n" \
+  "#define OUT varying                                                                     \n"
+
+#define VERTEX_SHADER_PRELUDE_330                                                              \
+  "#version 330 core                                                                       \n" \
+  "#define IN  in                                                                          \n" \
+  "#define OUT out                                                                         \n"
+
+#define FRAGMENT_SHADER_PRELUDE_120                                                            \
   "#version 120                                                                            \n" \
+  "#define IN         varying                                                              \n" \
+  "#define FRAG_COLOR gl_FragColor                                                         \n"
+
+#define FRAGMENT_SHADER_PRELUDE_330                                                            \
+  "#version 330 core                                                                       \n" \
+  "#define IN         in                                                                   \n" \
+  "#define FRAG_COLOR fragColor                                                            \n" \
   "                                                                                        \n" \
+  "out vec4 fragColor;                                                                     \n"
+
+#define INSTANCED_PRELUDE                                                                      \
+  "#define INSTANCED                                                                       \n"
+
+#define SMOOTH_VERTEX_SHADER                                                                   \
+  "#ifdef INSTANCED                                                                        \n" \
+  "IN        mat4  instanceModel;                                                          \n" \
+  "IN        vec3  instanceColor;                                                          \n" \
+  "#define model       instanceModel                                                       \n" \
+  "#define modelNormal transpose (inverse (mat3 (instanceModel)))                          \n" \
+  "#define color       instanceColor                                                       \n" \
+  "#else                                                                                   \n" \
   "uniform   mat4  model;                                                                  \n" \
   "uniform   mat3  modelNormal;                                                            \n" \
+  "uniform   vec3  color;                                                                  \n" \
+  "#endif                                                                                  \n" \
   "uniform   mat4  view;                                                                   \n" \
   "uniform   mat4  projection;                                                             \n" \
-  "attribute vec3  position;                                                               \n" \
-  "attribute vec3  normal;                                                                 \n" \
-  "uniform   vec3  color;                                                                  \n" \
+  "IN        vec3  position;                                                               \n" \
+  "IN        vec3  normal;                                                                 \n" \
   "uniform   vec3  light1Direction;                                                        \n" \
   "uniform   vec3  light1Color;                                                            \n" \
   "uniform   float light1Irradiance;                                                       \n" \
@@ -21,7 +53,7 @@
   "uniform   vec3  light2Color;                                                            \n" \
   "uniform   float light2Irradiance;                                                       \n" \
   "                                                                                        \n" \
-  "varying vec3 vsColor;                                                                   \n" \
+  "OUT     vec3 vsColor;                                                                   \n" \
   "                                                                                        \n" \
   "void main () {                                                                          \n" \
   "  gl_Position      = (projection * view * model) * vec4 (position, 1.0);                \n" \
@@ -34,38 +66,47 @@
   "}                                                                                       \n"
 
 #define SMOOTH_FRAGMENT_SHADER(COLOR, FINAL)                                                   \
-  "#version 120                                                                            \n" \
-  "                                                                                        \n" \
   "uniform vec3 wireframeColor;                                                            \n" \
   "                                                                                        \n" \
-  "varying vec3 " COLOR ";                                                                 \n" \
-  "varying vec3 barycentric;                                                               \n" \
+  "IN      vec3 " COLOR ";                                                                 \n" \
+  "IN      vec3 barycentric;                                                               \n" \
   "                                                                                        \n" \
   "void main () {                                                                          \n" \
-  "  gl_FragColor = vec4 (" COLOR                                                              \
+  "  FRAG_COLOR = vec4 (" COLOR                                                                \
   ", 1.0);                                                 \n" FINAL                           \
   "}                                                                                       \n"
 
 #define FLAT_VERTEX_SHADER                                                                     \
-  "#version 120                                                                            \n" \
-  "                                                                                        \n" \
+  "#ifdef INSTANCED                                                                        \n" \
+  "IN        mat4 instanceModel;                                                           \n" \
+  "IN        vec3 instanceColor;                                                           \n" \
+  "OUT       vec3 vsInstanceColor;                                                         \n" \
+  "#define model instanceModel                                                             \n" \
+  "#else                                                                                   \n" \
   "uniform   mat4 model;                                                                   \n" \
+  "#endif                                                                                  \n" \
   "uniform   mat4 view;                                                                    \n" \
   "uniform   mat4 projection;                                                              \n" \
-  "attribute vec3 position;                                                                \n" \
+  "IN        vec3 position;                                                                \n" \
   "                                                                                        \n" \
-  "varying vec3 vsColor;                                                                   \n" \
+  "OUT     vec3 vsColor;                                                                   \n" \
   "                                                                                        \n" \
   "void main () {                                                                          \n" \
   "  gl_Position = (projection * view * model) * vec4 (position,1.0);                      \n" \
   "  vsColor     = vec3 (model * vec4 (position, 1.0));                                    \n" \
+  "#ifdef INSTANCED                                                                        \n" \
+  "  vsInstanceColor = instanceColor;                                                      \n" \
+  "#endif                                                                                  \n" \
   "}                                                                                       \n"
 
 #define FLAT_FRAGMENT_SHADER(COLOR, FINAL)                                                     \
-  "#version 120                                                                            \n" \
-  "                                                                                        \n" \
   "uniform mat4  view;                                                                     \n" \
+  "#ifdef INSTANCED                                                                        \n" \
+  "IN      vec3  vsInstanceColor;                                                          \n" \
+  "#define color vsInstanceColor                                                           \n" \
+  "#else                                                                                   \n" \
   "uniform vec3  color;                                                                    \n" \
+  "#endif                                                                                  \n" \
   "uniform vec3  wireframeColor;                                                           \n" \
   "uniform vec3  light1Direction;                                                          \n" \
   "uniform vec3  light1Color;                                                              \n" \
@@ -74,8 +115,8 @@
   "uniform vec3  light2Color;                                                              \n" \
   "uniform float light2Irradiance;                                                         \n" \
   "                                                                                        \n" \
-  "varying vec3 " COLOR ";                                                                 \n" \
-  "varying vec3 barycentric;                                                               \n" \
+  "IN      vec3 " COLOR ";                                                                 \n" \
+  "IN      vec3 barycentric;                                                               \n" \
   "                                                                                        \n" \
   "void main () {                                                                          \n" \
   "  vec3  normal     = normalize(cross(dFdx(" COLOR "),dFdy(" COLOR ")));                 \n" \
@@ -86,32 +127,46 @@
   "  vec3  light1     = light1Irradiance * light1Color * vec3 (light1Diff);                \n" \
   "  vec3  light2     = light2Irradiance * light2Color * vec3 (light2Diff);                \n" \
   "                                                                                        \n" \
-  "  gl_FragColor     = vec4 (color * (light1 + light2), 1.0);                             "   \
+  "  FRAG_COLOR       = vec4 (color * (light1 + light2), 1.0);                             "   \
   "\n" FINAL                                                                                   \
   "}                                                                                       \n"
 
 #define CONSTANT_VERTEX_SHADER                                                                 \
-  "#version 120                                                                            \n" \
-  "                                                                                        \n" \
+  "#ifdef INSTANCED                                                                        \n" \
+  "IN        mat4 instanceModel;                                                           \n" \
+  "IN        vec3 instanceColor;                                                           \n" \
+  "OUT       vec3 vsInstanceColor;                                                         \n" \
+  "#define model instanceModel                                                             \n" \
+  "#else                                                                                   \n" \
   "uniform   mat4 model;                                                                   \n" \
+  "#endif                                                                                  \n" \
   "uniform   mat4 view;                                                                    \n" \
   "uniform   mat4 projection;                                                              \n" \
-  "attribute vec3 position;                                                                \n" \
+  "IN        vec3 position;                                                                \n" \
+  "                                                                                        \n" \
+  "OUT     vec3 vsColor;                                                                   \n" \
   "                                                                                        \n" \
   "void main(){                                                                            \n" \
   "  gl_Position = (projection * view * model) * vec4 (position,1.0);                      \n" \
+  "  vsColor     = vec3 (0.0);                                                             \n" \
+  "#ifdef INSTANCED                                                                        \n" \
+  "  vsInstanceColor = instanceColor;                                                      \n" \
+  "#endif                                                                                  \n" \
   "}                                                                                       \n"
 
 #define CONSTANT_FRAGMENT_SHADER(FINAL)                                                        \
-  "#version 120                                                                            \n" \
-  "                                                                                        \n" \
+  "#ifdef INSTANCED                                                                        \n" \
+  "IN      vec3 vsInstanceColor;                                                           \n" \
+  "#define color vsInstanceColor                                                           \n" \
+  "#else                                                                                   \n" \
   "uniform vec3 color;                                                                     \n" \
+  "#endif                                                                                  \n" \
   "uniform vec3 wireframeColor;                                                            \n" \
   "                                                                                        \n" \
-  "varying vec3 barycentric;                                                               \n" \
+  "IN      vec3 barycentric;                                                               \n" \
   "                                                                                        \n" \
   "void main(){                                                                            \n" \
-  "  gl_FragColor = vec4 (color, 1.0);                                                     "   \
+  "  FRAG_COLOR = vec4 (color, 1.0);                                                       "   \
   "\n" FINAL                                                                                   \
   "}                                                                                       \n"
 
@@ -121,7 +176,7 @@
   "vec3 edgeFactor = smoothstep (vec3 (0.0), barycDelta * 1.0, barycentric);               \n" \
   "float minEdgeFactor = min (min (edgeFactor.x, edgeFactor.y), edgeFactor.z);             \n" \
   "                                                                                        \n" \
-  "gl_FragColor.rgb = mix (wireframeColor, gl_FragColor.rgb, minEdgeFactor);               \n"
+  "FRAG_COLOR.rgb = mix (wireframeColor, FRAG_COLOR.rgb, minEdgeFactor);                   \n"
 
 #define GEOMETRY_SHADER                                                                        \
   "#extension GL_EXT_geometry_shader4: require                                             \n" \
@@ -149,6 +204,35 @@
   "    EndPrimitive();                                                                     \n" \
   "}                                                                                       \n"
 
+#define CORE_GEOMETRY_SHADER                                                                   \
+  "#version 330 core                                                                       \n" \
+  "                                                                                        \n" \
+  "layout (triangles) in;                                                                  \n" \
+  "layout (triangle_strip, max_vertices = 3) out;                                          \n" \
+  "                                                                                        \n" \
+  "in  vec3 vsColor[];                                                                     \n" \
+  "out vec3 gsColor;                                                                       \n" \
+  "out vec3 barycentric;                                                                   \n" \
+  "                                                                                        \n" \
+  "void main() {                                                                           \n" \
+  "    gl_Position = gl_in[0].gl_Position;                                                 \n" \
+  "    gsColor     = vsColor[0];                                                           \n" \
+  "    barycentric = vec3 (1.0,0.0,0.0);                                                   \n" \
+  "    EmitVertex();                                                                       \n" \
+  "                                                                                        \n" \
+  "    gl_Position = gl_in[1].gl_Position;                                                 \n" \
+  "    gsColor     = vsColor[1];                                                           \n" \
+  "    barycentric = vec3 (0.0,1.0,0.0);                                                   \n" \
+  "    EmitVertex();                                                                       \n" \
+  "                                                                                        \n" \
+  "    gl_Position = gl_in[2].gl_Position;                                                 \n" \
+  "    gsColor     = vsColor[2];                                                           \n" \
+  "    barycentric = vec3 (0.0,0.0,1.0);                                                   \n" \
+  "    EmitVertex();                                                                       \n" \
+  "                                                                                        \n" \
+  "    EndPrimitive();                                                                     \n" \
+  "}                                                                                       \n"
+
 const char* Shader::smoothVertexShader () { return SMOOTH_VERTEX_SHADER; }
 
 const char* Shader::smoothFragmentShader () { return SMOOTH_FRAGMENT_SHADER ("vsColor", ""); }
@@ -177,3 +261,33 @@ const char* Shader::constantWireframeFragmentShader ()
 }
 
 const char* Shader::geometryShader () { return GEOMETRY_SHADER; }
+
+const char* Shader::coreGeometryShader () { return CORE_GEOMETRY_SHADER; }
+
+const char* Shader::vertexShaderPrelude (bool coreProfile, bool instanced)
+{
+  assert (instanced == false || coreProfile);
+
+  if (instanced)
+  {
+    return VERTEX_SHADER_PRELUDE_330 INSTANCED_PRELUDE;
+  }
+  else
+  {
+    return coreProfile ? VERTEX_SHADER_PRELUDE_330 : VERTEX_SHADER_PRELUDE_120;
+  }
+}
+
+const char* Shader::fragmentShaderPrelude (bool coreProfile, bool instanced)
+{
+  assert (instanced == false || coreProfile);
+
+  if (instanced)
+  {
+    return FRAGMENT_SHADER_PRELUDE_330 INSTANCED_PRELUDE;
+  }
+  else
+  {
+    return coreProfile ? FRAGMENT_SHADER_PRELUDE_330 : FRAGMENT_SHADER_PRELUDE_120;
+  }
+}
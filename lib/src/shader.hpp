@@ -19,6 +19,14 @@ namespace Shader
   const char* constantFragmentShader ();
   const char* constantWireframeFragmentShader ();
   const char* geometryShader ();
+  const char* coreGeometryShader ();
+
+  // shader sources above are version agnostic: `IN`, `OUT` and `FRAG_COLOR` are defined by the
+  // prelude that is prepended when compiling for a 2.1 context or a 3.3 core profile context.
+  // Instanced shaders (3.3 core profile only) read their model matrix and color from
+  // per-instance attributes instead of uniforms.
+  const char* vertexShaderPrelude (bool, bool);
+  const char* fragmentShaderPrelude (bool, bool);
 };
 
 #endif
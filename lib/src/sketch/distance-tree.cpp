@@ -0,0 +1,257 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <glm/glm.hpp>
+#include "distance.hpp"
+#include "primitive/cone-sphere.hpp"
+#include "sketch/distance-tree.hpp"
+#include "sketch/path.hpp"
+#include "util.hpp"
+
+namespace
+{
+  // maximal number of primitives of a leaf
+  static const unsigned int leafSize = 4;
+
+  // Nodes are stored in depth-first order, i.e. the first child of an inner node directly follows
+  // its parent. Leaves refer to the range `[begin, end)` of the ordered primitives.
+  struct Node
+  {
+    glm::vec3    minimum;
+    glm::vec3    maximum;
+    unsigned int begin;
+    unsigned int end;
+    unsigned int secondChild; // 0 for leaves
+
+    bool isLeaf () const { return this->secondChild == 0; }
+
+    // Lower bound of the signed distances of all primitives of the node. Positions inside of
+    // the node's bounds might be inside of a primitive, i.e. there is no positive bound.
+    float distance (const glm::vec3& p) const
+    {
+      return glm::length (glm::max (glm::max (this->minimum - p, p - this->maximum), 0.0f));
+    }
+  };
+
+  struct Bounds
+  {
+    glm::vec3 minimum;
+    glm::vec3 maximum;
+
+    Bounds ()
+      : minimum (Util::maxFloat ())
+      , maximum (Util::minFloat ())
+    {
+    }
+
+    Bounds (const PrimSphere& s)
+      : minimum (s.center () - glm::vec3 (s.radius ()))
+      , maximum (s.center () + glm::vec3 (s.radius ()))
+    {
+    }
+
+    void extend (const glm::vec3& min, const glm::vec3& max)
+    {
+      this->minimum = glm::min (this->minimum, min);
+      this->maximum = glm::max (this->maximum, max);
+    }
+
+    void extend (const Bounds& b) { this->extend (b.minimum, b.maximum); }
+
+    glm::vec3 center () const { return (this->minimum + this->maximum) * 0.5f; }
+  };
+}
+
+struct SketchDistanceTree::Impl
+{
+  // Primitives `[0, coneSpheres.size ())` are cone spheres, the remaining ones are spheres.
+  std::vector<PrimConeSphere> coneSpheres;
+  std::vector<PrimSphere>     spheres;
+  std::vector<unsigned int>   order;
+  std::vector<Node>           nodes;
+
+  Impl (const SketchTree& tree, const SketchPaths& paths)
+  {
+    if (tree.hasRoot ())
+    {
+      tree.root ().forEachConstNode ([this](const SketchNode& node) {
+        if (node.parent ())
+        {
+          this->coneSpheres.emplace_back (node.data (), node.parent ()->data ());
+        }
+        else
+        {
+          this->spheres.push_back (node.data ());
+        }
+      });
+    }
+    for (const SketchPath& p : paths)
+    {
+      this->spheres.insert (this->spheres.end (), p.spheres ().begin (), p.spheres ().end ());
+    }
+
+    const unsigned int  numPrimitives = this->coneSpheres.size () + this->spheres.size ();
+    std::vector<Bounds> bounds;
+
+    bounds.reserve (numPrimitives);
+    for (const PrimConeSphere& c : this->coneSpheres)
+    {
+      bounds.emplace_back (c.sphere1 ());
+      bounds.back ().extend (Bounds (c.sphere2 ()));
+    }
+    for (const PrimSphere& s : this->spheres)
+    {
+      bounds.emplace_back (s);
+    }
+
+    this->order.resize (numPrimitives);
+    for (unsigned int i = 0; i < numPrimitives; i++)
+    {
+      this->order[i] = i;
+    }
+    if (numPrimitives > 0)
+    {
+      this->nodes.reserve (2 * ((numPrimitives / leafSize) + 1));
+      this->build (bounds, 0, numPrimitives);
+    }
+  }
+
+  // Splits primitives at the median of their centers along the longest axis of the centers'
+  // bounds. Returns the index of the new node.
+  unsigned int build (const std::vector<Bounds>& bounds, unsigned int begin, unsigned int end)
+  {
+    const unsigned int index = this->nodes.size ();
+    Bounds             nodeBounds;
+    Bounds             centerBounds;
+
+    for (unsigned int i = begin; i < end; i++)
+    {
+      const Bounds& b = bounds[this->order[i]];
+      nodeBounds.extend (b);
+      centerBounds.extend (b.center (), b.center ());
+    }
+    this->nodes.push_back (Node{nodeBounds.minimum, nodeBounds.maximum, begin, end, 0});
+
+    if (end - begin > leafSize)
+    {
+      const glm::vec3    extent = centerBounds.maximum - centerBounds.minimum;
+      const unsigned int axis = extent.x >= extent.y && extent.x >= extent.z
+                                  ? 0
+                                  : (extent.y >= extent.z ? 1 : 2);
+      const unsigned int middle = (begin + end) / 2;
+
+      std::nth_element (this->order.begin () + begin, this->order.begin () + middle,
+                        this->order.begin () + end,
+                        [&bounds, axis](unsigned int a, unsigned int b) {
+                          return bounds[a].center ()[axis] < bounds[b].center ()[axis];
+                        });
+
+      this->build (bounds, begin, middle);
+      const unsigned int secondChild = this->build (bounds, middle, end);
+      this->nodes[index].secondChild = secondChild;
+    }
+    return index;
+  }
+
+  bool isEmpty () const { return this->nodes.empty (); }
+
+  float primitiveDistance (unsigned int i, const glm::vec3& p) const
+  {
+    if (i < this->coneSpheres.size ())
+    {
+      return Distance::distance (this->coneSpheres[i], p);
+    }
+    else
+    {
+      return Distance::distance (this->spheres[i - this->coneSpheres.size ()], p);
+    }
+  }
+
+  // Nodes whose lower bound is positive and not less than the best distance found so far are
+  // skipped. The nearer child of a node is visited first.
+  float distance (const glm::vec3& p, unsigned int& nearest) const
+  {
+    float best = Util::maxFloat ();
+
+    if (this->isEmpty ())
+    {
+      return best;
+    }
+    else if (nearest < this->order.size ())
+    {
+      best = this->primitiveDistance (nearest, p);
+    }
+
+    unsigned int stack[64];
+    unsigned int stackSize = 0;
+
+    stack[stackSize++] = 0;
+    while (stackSize > 0)
+    {
+      const Node& node = this->nodes[stack[--stackSize]];
+      const float d = node.distance (p);
+
+      if (d > 0.0f && d >= best)
+      {
+        continue;
+      }
+      else if (node.isLeaf ())
+      {
+        for (unsigned int i = node.begin; i < node.end; i++)
+        {
+          const unsigned int primitive = this->order[i];
+          const float        pd = this->primitiveDistance (primitive, p);
+
+          if (pd < best)
+          {
+            best = pd;
+            nearest = primitive;
+          }
+        }
+      }
+      else
+      {
+        const unsigned int first = &node - this->nodes.data () + 1;
+        const unsigned int second = node.secondChild;
+
+        assert (stackSize + 2 <= 64);
+        if (this->nodes[first].distance (p) <= this->nodes[second].distance (p))
+        {
+          stack[stackSize++] = second;
+          stack[stackSize++] = first;
+        }
+        else
+        {
+          stack[stackSize++] = first;
+          stack[stackSize++] = second;
+        }
+      }
+    }
+    return best;
+  }
+
+  float distance (const glm::vec3& p) const
+  {
+    unsigned int nearest = this->order.size ();
+    return this->distance (p, nearest);
+  }
+
+  void distances (const std::vector<glm::vec3>& positions, std::vector<float>& distances) const
+  {
+    unsigned int nearest = this->order.size ();
+
+    distances.resize (positions.size ());
+    for (unsigned int i = 0; i < positions.size (); i++)
+    {
+      distances[i] = this->distance (positions[i], nearest);
+    }
+  }
+};
+
+DELEGATE2_BIG2 (SketchDistanceTree, const SketchTree&, const SketchPaths&)
+DELEGATE_CONST (bool, SketchDistanceTree, isEmpty)
+DELEGATE1_CONST (float, SketchDistanceTree, distance, const glm::vec3&)
+DELEGATE2_CONST (void, SketchDistanceTree, distances, const std::vector<glm::vec3>&,
+                 std::vector<float>&)
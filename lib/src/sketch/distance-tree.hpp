@@ -0,0 +1,33 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_SKETCH_DISTANCE_TREE
+#define DILAY_SKETCH_DISTANCE_TREE
+
+#include <glm/fwd.hpp>
+#include <vector>
+#include "macro.hpp"
+#include "sketch/fwd.hpp"
+
+// `SketchDistanceTree` is a bounding volume hierarchy over the cone spheres of a sketch's bones
+// and the spheres of its paths. The distance to a sketch is the minimal signed distance to any
+// of these primitives. The tree is a snapshot, i.e. it does not follow later changes of the
+// sketch, and may be queried by several threads concurrently.
+class SketchDistanceTree
+{
+public:
+  DECLARE_BIG2 (SketchDistanceTree, const SketchTree&, const SketchPaths&)
+
+  bool  isEmpty () const;
+  float distance (const glm::vec3&) const;
+
+  // Positions are expected to be spatially coherent, e.g. samples of a brick of a grid: the
+  // nearest primitive of a position bounds the search of the next position.
+  void distances (const std::vector<glm::vec3>&, std::vector<float>&) const;
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
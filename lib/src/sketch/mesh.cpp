@@ -9,6 +9,7 @@
 #include "config.hpp"
 #include "dimension.hpp"
 #include "distance.hpp"
+#include "mesh-instances.hpp"
 #include "mesh-util.hpp"
 #include "primitive/aabox.hpp"
 #include "primitive/cone-sphere.hpp"
@@ -78,15 +79,19 @@ namespace
 
 struct SketchMesh::Impl
 {
-  SketchMesh*  self;
-  SketchTree   tree;
-  SketchPaths  paths;
-  Mesh         sphereMesh;
-  Mesh         boneMesh;
-  RenderConfig renderConfig;
+  SketchMesh*   self;
+  SketchTree    tree;
+  SketchPaths   paths;
+  Mesh          sphereMesh;
+  Mesh          boneMesh;
+  MeshInstances sphereInstances;
+  MeshInstances boneInstances;
+  RenderConfig  renderConfig;
+  bool          instancesChanged;
 
   Impl (SketchMesh* s)
     : self (s)
+    , instancesChanged (true)
   {
     this->sphereMesh = MeshUtil::icosphere (3);
     this->sphereMesh.bufferData ();
@@ -104,7 +109,10 @@ struct SketchMesh::Impl
     , paths (other.paths)
     , sphereMesh (other.sphereMesh)
     , boneMesh (other.boneMesh)
+    , sphereInstances (other.sphereInstances)
+    , boneInstances (other.boneInstances)
     , renderConfig (other.renderConfig)
+    , instancesChanged (true)
   {
     this->sphereMesh.bufferData ();
     this->boneMesh.bufferData ();
@@ -112,9 +120,27 @@ struct SketchMesh::Impl
 
   bool isEmpty () const { return this->tree.hasRoot () == false && this->paths.empty (); }
 
-  void fromTree (const SketchTree& newTree) { this->tree = newTree; }
+  // Instances of nodes, bones and path spheres are only collected anew after the sketch or its
+  // render configuration has been changed
+  void changed () { this->instancesChanged = true; }
 
-  void reset () { this->tree.reset (); }
+  SketchTree& mutableTree ()
+  {
+    this->changed ();
+    return this->tree;
+  }
+
+  void fromTree (const SketchTree& newTree)
+  {
+    this->changed ();
+    this->tree = newTree;
+  }
+
+  void reset ()
+  {
+    this->changed ();
+    this->tree.reset ();
+  }
 
   bool intersects (const PrimRay& ray, SketchNodeIntersection& intersection,
                    const SketchNode* exclude = nullptr)
@@ -289,18 +315,17 @@ struct SketchMesh::Impl
     return intersection.isIntersection ();
   }
 
-  void renderTree (Camera& camera)
+  void addTreeInstances ()
   {
     if (this->tree.hasRoot ())
     {
-      this->tree.root ().forEachConstNode ([this, &camera](const SketchNode& node) {
+      this->tree.root ().forEachConstNode ([this](const SketchNode& node) {
         const glm::vec3& pos = node.data ().center ();
         const float      radius = node.data ().radius ();
 
         this->sphereMesh.position (pos);
         this->sphereMesh.scaling (glm::vec3 (radius));
-        this->sphereMesh.color (this->renderConfig.nodeColor);
-        this->sphereMesh.render (camera);
+        this->sphereInstances.add (this->sphereMesh.modelMatrix (), this->renderConfig.nodeColor);
 
         if (node.parent ())
         {
@@ -327,15 +352,12 @@ struct SketchMesh::Impl
               this->boneMesh.rotationMatrix (glm::orientation (direction, down));
             }
 
-            this->boneMesh.color (this->renderConfig.nodeColor);
             this->boneMesh.position (parPos);
             this->boneMesh.scaling (glm::vec3 (parRadius, distance, parRadius));
-            this->boneMesh.render (camera);
+            this->boneInstances.add (this->boneMesh.modelMatrix (), this->renderConfig.nodeColor);
           }
           else
           {
-            this->sphereMesh.color (this->renderConfig.bubbleColor);
-
             for (float d = radius * 0.5f; d < distance;)
             {
               const glm::vec3 bubblePos = pos + (d * direction);
@@ -343,7 +365,8 @@ struct SketchMesh::Impl
 
               this->sphereMesh.position (bubblePos);
               this->sphereMesh.scaling (glm::vec3 (bubbleRadius));
-              this->sphereMesh.render (camera);
+              this->sphereInstances.add (this->sphereMesh.modelMatrix (),
+                                         this->renderConfig.bubbleColor);
 
               d += bubbleRadius * 0.5f;
             }
@@ -353,27 +376,38 @@ struct SketchMesh::Impl
     }
   }
 
-  void renderPaths (Camera& camera)
+  void addPathInstances ()
   {
-    this->sphereMesh.color (this->renderConfig.sphereColor);
-
     for (const SketchPath& p : this->paths)
     {
-      p.render (camera, this->sphereMesh);
+      p.addInstances (this->sphereMesh, this->sphereInstances, this->renderConfig.sphereColor);
     }
   }
 
   void render (Camera& camera)
   {
-    this->renderTree (camera);
-
-    if (this->renderConfig.renderWireframe == false)
+    if (this->instancesChanged)
     {
-      this->renderPaths (camera);
+      this->sphereInstances.reset ();
+      this->boneInstances.reset ();
+
+      this->addTreeInstances ();
+
+      if (this->renderConfig.renderWireframe == false)
+      {
+        this->addPathInstances ();
+      }
+      this->instancesChanged = false;
     }
+    this->sphereInstances.render (camera, this->sphereMesh);
+    this->boneInstances.render (camera, this->boneMesh);
   }
 
-  void renderWireframe (bool v) { this->renderConfig.renderWireframe = v; }
+  void renderWireframe (bool v)
+  {
+    this->changed ();
+    this->renderConfig.renderWireframe = v;
+  }
 
   PrimPlane mirrorPlane (Dimension dim) const
   {
@@ -451,6 +485,7 @@ struct SketchMesh::Impl
   SketchNode& addChild (SketchNode& parent, const glm::vec3& pos, float radius,
                         const Dimension* dim)
   {
+    this->changed ();
     SketchNode& newNode = parent.emplaceChild (pos, radius);
 
     if (dim)
@@ -463,6 +498,7 @@ struct SketchMesh::Impl
   SketchNode& addParent (SketchNode& child, const glm::vec3& pos, float radius,
                          const Dimension* dim)
   {
+    this->changed ();
     assert (child.parent ());
 
     SketchNode& newNode = child.parent ()->emplaceChild (pos, radius);
@@ -489,6 +525,7 @@ struct SketchMesh::Impl
 
   SketchPath& addPath (const SketchPath& path)
   {
+    this->changed ();
     this->paths.push_back (path);
     return this->paths.back ();
   }
@@ -496,6 +533,7 @@ struct SketchMesh::Impl
   void addSphere (bool newPath, const glm::vec3& intersection, const glm::vec3& position,
                   float radius, const Dimension* dim)
   {
+    this->changed ();
     if (newPath)
     {
       this->paths.emplace_back ();
@@ -517,6 +555,7 @@ struct SketchMesh::Impl
 
   void move (SketchNode& node, const glm::vec3& delta, bool all, const Dimension* dim)
   {
+    this->changed ();
     const auto moveNodes = [all](SketchNode& node, const glm::vec3& delta) {
       if (all)
       {
@@ -549,6 +588,7 @@ struct SketchMesh::Impl
 
   void scale (SketchNode& node, float factor, bool all, const Dimension* dim)
   {
+    this->changed ();
     const auto scaleNodes = [factor, all](SketchNode& node) {
       if (all)
       {
@@ -580,6 +620,7 @@ struct SketchMesh::Impl
 
   void rotate (SketchNode& node, const glm::vec3& axis, float angle, const Dimension* dim)
   {
+    this->changed ();
     const auto rotateNodes = [](SketchNode& node, const glm::vec3& axis, float angle) {
       const glm::mat4x4 matrix = Util::rotation (node.data ().center (), axis, angle);
 
@@ -608,6 +649,7 @@ struct SketchMesh::Impl
 
   void deleteNode (SketchNode& node, bool deleteChildren, const Dimension* dim)
   {
+    this->changed ();
     assert (this->tree.hasRoot ());
 
     if (node.parent () == nullptr)
@@ -647,6 +689,7 @@ struct SketchMesh::Impl
 
   void deletePath (SketchPath& path, const Dimension* dim)
   {
+    this->changed ();
     assert (this->paths.empty () == false);
 
     if (dim && this->paths.size () >= 2)
@@ -744,18 +787,21 @@ struct SketchMesh::Impl
 
   void mirror (Dimension dim)
   {
+    this->changed ();
     this->mirrorTree (dim);
     this->mirrorPaths (dim);
   }
 
   void rebalance (SketchNode& newRoot)
   {
+    this->changed ();
     assert (this->tree.hasRoot ());
     this->tree.rebalance (newRoot);
   }
 
   SketchNode& snap (SketchNode& node, Dimension dim)
   {
+    this->changed ();
     assert (this->tree.hasRoot ());
     const PrimPlane mPlane = this->mirrorPlane (dim);
 
@@ -809,6 +855,7 @@ struct SketchMesh::Impl
   void smoothPath (SketchPath& path, const PrimSphere& range, unsigned int halfWidth,
                    SketchPathSmoothEffect effect, const Dimension* dim)
   {
+    this->changed ();
     if (IntersectionUtil::intersects (range, path.aabox ()))
     {
       PrimSphereIntersection intersection1, intersection2;
@@ -841,6 +888,7 @@ struct SketchMesh::Impl
 
   void optimizePaths ()
   {
+    this->changed ();
     for (SketchPath& p1 : this->paths)
     {
       for (SketchPath& p2 : this->paths)
@@ -908,6 +956,7 @@ struct SketchMesh::Impl
 
   void runFromConfig (const Config& config)
   {
+    this->changed ();
     this->renderConfig.nodeColor = config.get<Color> ("editor/sketch/node/color");
     this->renderConfig.bubbleColor = config.get<Color> ("editor/sketch/bubble/color");
     this->renderConfig.sphereColor = config.get<Color> ("editor/sketch/sphere/color");
@@ -916,7 +965,7 @@ struct SketchMesh::Impl
 
 DELEGATE_BIG4_COPY_SELF (SketchMesh);
 GETTER_CONST (const SketchTree&, SketchMesh, tree)
-GETTER (SketchTree&, SketchMesh, tree)
+SketchTree& SketchMesh::tree () { return this->impl->mutableTree (); }
 GETTER_CONST (const SketchPaths&, SketchMesh, paths)
 DELEGATE_CONST (bool, SketchMesh, isEmpty)
 DELEGATE1 (void, SketchMesh, fromTree, const SketchTree&)
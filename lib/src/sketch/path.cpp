@@ -1,5 +1,6 @@
 #include "../mesh.hpp"
 #include "intersection.hpp"
+#include "mesh-instances.hpp"
 #include "primitive/aabox.hpp"
 #include "primitive/plane.hpp"
 #include "primitive/ray.hpp"
@@ -75,13 +76,13 @@ struct SketchPath::Impl
     return this->spheres.erase (it);
   }
 
-  void render (Camera& camera, Mesh& mesh) const
+  void addInstances (Mesh& mesh, MeshInstances& instances, const Color& color) const
   {
     for (const PrimSphere& s : this->spheres)
     {
       mesh.position (s.center ());
       mesh.scaling (glm::vec3 (s.radius ()));
-      mesh.render (camera);
+      instances.add (mesh.modelMatrix (), color);
     }
   }
 
@@ -232,7 +233,7 @@ DELEGATE_CONST (PrimAABox, SketchPath, aabox)
 DELEGATE3 (void, SketchPath, addSphere, const glm::vec3&, const glm::vec3&, float)
 DELEGATE1 (SketchPath::Spheres::iterator, SketchPath, deleteSphere,
            SketchPath::Spheres::const_iterator)
-DELEGATE2_CONST (void, SketchPath, render, Camera&, Mesh&)
+DELEGATE3_CONST (void, SketchPath, addInstances, Mesh&, MeshInstances&, const Color&)
 DELEGATE3 (bool, SketchPath, intersects, const PrimRay&, SketchMesh&, SketchPathIntersection&)
 DELEGATE1 (SketchPath, SketchPath, mirror, const PrimPlane&)
 DELEGATE5 (void, SketchPath, smooth, const PrimSphere&, unsigned int, SketchPathSmoothEffect,
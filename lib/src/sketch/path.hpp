@@ -9,9 +9,10 @@
 #include "macro.hpp"
 #include "sketch/fwd.hpp"
 
-class Camera;
+class Color;
 class Intersection;
 class Mesh;
+class MeshInstances;
 class PrimAABox;
 class PrimPlane;
 class PrimRay;
@@ -43,7 +44,7 @@ public:
   PrimAABox         aabox () const;
   void              addSphere (const glm::vec3&, const glm::vec3&, float);
   Spheres::iterator deleteSphere (Spheres::const_iterator);
-  void              render (Camera&, Mesh&) const;
+  void              addInstances (Mesh&, MeshInstances&, const Color&) const;
   bool              intersects (const PrimRay&, SketchMesh&, SketchPathIntersection&);
   SketchPath        mirror (const PrimPlane&);
   void smooth (const PrimSphere&, unsigned int, SketchPathSmoothEffect, const PrimSphere*,
@@ -4,6 +4,7 @@
  */
 #include <QShortcut>
 #include <memory>
+#include "autosave.hpp"
 #include "cache.hpp"
 #include "camera.hpp"
 #include "config.hpp"
@@ -36,6 +37,7 @@ struct State::Impl
   Camera                  camera;
   History                 history;
   Scene                   scene;
+  Autosave                autosave;
   std::unique_ptr<Tool>   toolPtr;
   Maybe<ToolKey>          previousToolKey;
   std::vector<QShortcut*> shortcuts;
@@ -48,6 +50,7 @@ struct State::Impl
     , camera (this->config)
     , history (this->config)
     , scene (this->config)
+    , autosave (this->scene, this->config)
   {
     this->resetTool ();
   }
@@ -302,6 +305,7 @@ struct State::Impl
     this->camera.fromConfig (this->config);
     this->history.fromConfig (this->config);
     this->scene.fromConfig (this->config);
+    this->autosave.fromConfig (this->config);
 
     if (this->hasTool ())
     {
@@ -315,7 +319,7 @@ struct State::Impl
     {
       this->handleToolResponse (this->toolPtr->commit ());
     }
-    this->history.undo (*this->self);
+    this->history.undo (this->scene, this->config);
     this->mainWindow.infoPane ().scene ().updateInfo ();
     this->mainWindow.update ();
   }
@@ -326,7 +330,7 @@ struct State::Impl
     {
       this->handleToolResponse (this->toolPtr->commit ());
     }
-    this->history.redo (*this->self);
+    this->history.redo (this->scene, this->config);
     this->mainWindow.infoPane ().scene ().updateInfo ();
     this->mainWindow.update ();
   }
@@ -356,6 +360,7 @@ GETTER (Config&, State, config)
 GETTER (Cache&, State, cache)
 GETTER (Camera&, State, camera)
 GETTER (History&, State, history)
+GETTER (Autosave&, State, autosave)
 GETTER (Scene&, State, scene)
 DELEGATE (bool, State, hasTool)
 DELEGATE (Tool&, State, tool)
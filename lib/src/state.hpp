@@ -8,6 +8,7 @@
 #include <initializer_list>
 #include "macro.hpp"
 
+class Autosave;
 class Cache;
 class Camera;
 class Config;
@@ -34,6 +35,7 @@ public:
   Cache&          cache ();
   Camera&         camera ();
   History&        history ();
+  Autosave&       autosave ();
   Scene&          scene ();
   bool            hasTool ();
   Tool&           tool ();
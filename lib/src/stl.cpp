@@ -0,0 +1,82 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cstring>
+#include <glm/glm.hpp>
+#include <vector>
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "stl.hpp"
+#include "util.hpp"
+
+namespace
+{
+  const std::size_t headerSize = 84;
+  const std::size_t triangleSize = 50;
+  const std::size_t normalSize = 12;
+
+  unsigned int readUnsignedInt (const unsigned char* data)
+  {
+    unsigned int value = 0;
+    for (unsigned int i = 0; i < 4; i++)
+    {
+      value |= static_cast<unsigned int> (data[i]) << (8 * i);
+    }
+    return value;
+  }
+
+  float readFloat (const unsigned char* data)
+  {
+    const unsigned int bits = readUnsignedInt (data);
+    float              value;
+    std::memcpy (&value, &bits, sizeof (float));
+    return value;
+  }
+
+  unsigned int numTriangles (const unsigned char* data, std::size_t size)
+  {
+    return size >= headerSize ? readUnsignedInt (data + 80) : 0;
+  }
+}
+
+bool Stl::isStl (const unsigned char* data, std::size_t size)
+{
+  return size >= headerSize &&
+         size == headerSize + (triangleSize * std::size_t (numTriangles (data, size)));
+}
+
+bool Stl::read (const unsigned char* data, std::size_t size, Mesh& mesh)
+{
+  if (Stl::isStl (data, size) == false)
+  {
+    if (size >= 5 && std::memcmp (data, "solid", 5) == 0)
+    {
+      DILAY_WARN ("ASCII STL files are not supported")
+    }
+    else
+    {
+      DILAY_WARN ("not a binary STL file")
+    }
+    return false;
+  }
+
+  const unsigned int     n = numTriangles (data, size);
+  std::vector<glm::vec3> positions;
+  positions.reserve (3 * std::size_t (n));
+
+  for (unsigned int i = 0; i < n; i++)
+  {
+    const unsigned char* triangle = data + headerSize + (triangleSize * std::size_t (i));
+
+    for (unsigned int j = 0; j < 3; j++)
+    {
+      const unsigned char* position = triangle + normalSize + (12 * j);
+
+      positions.emplace_back (readFloat (position), readFloat (position + 4),
+                              readFloat (position + 8));
+    }
+  }
+  mesh = MeshUtil::fromTriangles (positions);
+  return true;
+}
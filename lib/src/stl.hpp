@@ -0,0 +1,22 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_STL
+#define DILAY_STL
+
+#include <cstddef>
+
+class Mesh;
+
+// `Stl` reads binary STL files, i.e. an 80 byte header, the number of triangles and 50 bytes per
+// triangle: a normal, three positions and an attribute, all of them little-endian. The triangles
+// are welded into a mesh, cf. `MeshUtil::fromTriangles`.
+namespace Stl
+{
+  // Binary files are recognized by their size, since their header is arbitrary
+  bool isStl (const unsigned char*, std::size_t);
+  bool read (const unsigned char*, std::size_t, Mesh&);
+}
+
+#endif
@@ -0,0 +1,211 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "task-pool.hpp"
+
+namespace
+{
+  struct Job
+  {
+    const TaskPool::IndexTask& task;
+    const unsigned int         numIndices;
+    const unsigned int         maxNumWorkers;
+    std::atomic<unsigned int>  nextIndex;
+    unsigned int               numWorkers; // guarded by `Pool::mutex`
+    std::exception_ptr         exception;  // guarded by `Pool::mutex`
+
+    Job (const TaskPool::IndexTask& t, unsigned int n, unsigned int w)
+      : task (t)
+      , numIndices (n)
+      , maxNumWorkers (w)
+      , nextIndex (0)
+      , numWorkers (0)
+    {
+    }
+
+    // Returns the exception of a failing task. No further indices are handed out after a task
+    // failed.
+    std::exception_ptr run ()
+    {
+      try
+      {
+        for (unsigned int i = this->nextIndex++; i < this->numIndices; i = this->nextIndex++)
+        {
+          this->task (i);
+        }
+        return nullptr;
+      }
+      catch (...)
+      {
+        this->nextIndex = this->numIndices;
+        return std::current_exception ();
+      }
+    }
+
+    // keeps the first exception, requires a lock of `Pool::mutex`
+    void fail (const std::exception_ptr& e)
+    {
+      if (e && this->exception == nullptr)
+      {
+        this->exception = e;
+      }
+    }
+
+    // requires a lock of `Pool::mutex`
+    bool acceptsWorker () const
+    {
+      return this->nextIndex < this->numIndices && this->numWorkers < this->maxNumWorkers;
+    }
+  };
+
+  class Pool
+  {
+  public:
+    Pool ()
+      : stop (false)
+    {
+      const unsigned int numWorkers = std::max (1u, std::thread::hardware_concurrency ()) - 1;
+
+      for (unsigned int i = 0; i < numWorkers; i++)
+      {
+        this->threads.emplace_back ([this]() { this->work (); });
+      }
+      this->maxNumThreads = this->threads.size () + 1;
+    }
+
+    ~Pool ()
+    {
+      {
+        std::lock_guard<std::mutex> lock (this->mutex);
+        this->stop = true;
+      }
+      this->jobAvailable.notify_all ();
+
+      for (std::thread& t : this->threads)
+      {
+        t.join ();
+      }
+    }
+
+    unsigned int numThreads () const { return this->maxNumThreads; }
+
+    void setMaxNumThreads (unsigned int n)
+    {
+      const unsigned int allThreads = this->threads.size () + 1;
+      this->maxNumThreads = n == 0 ? allThreads : std::min (n, allThreads);
+    }
+
+    void parallelFor (unsigned int n, const TaskPool::IndexTask& task)
+    {
+      if (n == 0)
+      {
+        return;
+      }
+
+      const unsigned int maxNumWorkers = this->maxNumThreads - 1;
+
+      if (n == 1 || maxNumWorkers == 0)
+      {
+        for (unsigned int i = 0; i < n; i++)
+        {
+          task (i);
+        }
+        return;
+      }
+
+      Job job (task, n, maxNumWorkers);
+      {
+        std::lock_guard<std::mutex> lock (this->mutex);
+        this->jobs.push_back (&job);
+      }
+      this->jobAvailable.notify_all ();
+
+      const std::exception_ptr exception = job.run ();
+
+      // all indices are handed out at this point, i.e. the job is done once no worker runs it
+      std::unique_lock<std::mutex> lock (this->mutex);
+      this->removeJob (job);
+      this->jobFinished.wait (lock, [&job]() { return job.numWorkers == 0; });
+
+      job.fail (exception);
+      if (job.exception)
+      {
+        std::rethrow_exception (job.exception);
+      }
+    }
+
+  private:
+    std::mutex                mutex;
+    std::condition_variable   jobAvailable;
+    std::condition_variable   jobFinished;
+    std::deque<Job*>          jobs;
+    std::vector<std::thread>  threads;
+    std::atomic<unsigned int> maxNumThreads;
+    bool                      stop;
+
+    void removeJob (Job& job)
+    {
+      auto it = std::find (this->jobs.begin (), this->jobs.end (), &job);
+      if (it != this->jobs.end ())
+      {
+        this->jobs.erase (it);
+      }
+    }
+
+    void work ()
+    {
+      std::unique_lock<std::mutex> lock (this->mutex);
+
+      while (true)
+      {
+        this->jobAvailable.wait (lock,
+                                 [this]() { return this->stop || this->jobs.empty () == false; });
+        if (this->stop)
+        {
+          return;
+        }
+        Job& job = *this->jobs.front ();
+
+        if (job.acceptsWorker () == false)
+        {
+          this->removeJob (job);
+          continue;
+        }
+        job.numWorkers++;
+        lock.unlock ();
+
+        const std::exception_ptr exception = job.run ();
+
+        lock.lock ();
+        job.fail (exception);
+        this->removeJob (job);
+        job.numWorkers--;
+        this->jobFinished.notify_all ();
+      }
+    }
+  };
+
+  Pool& pool ()
+  {
+    static Pool p;
+    return p;
+  }
+}
+
+unsigned int TaskPool::numThreads () { return pool ().numThreads (); }
+
+void TaskPool::setMaxNumThreads (unsigned int n) { pool ().setMaxNumThreads (n); }
+
+void TaskPool::parallelFor (unsigned int n, const IndexTask& task)
+{
+  pool ().parallelFor (n, task);
+}
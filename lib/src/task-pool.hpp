@@ -0,0 +1,31 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TASK_POOL
+#define DILAY_TASK_POOL
+
+#include <functional>
+
+// `TaskPool` is a process-wide pool of worker threads that are started on first use and live
+// until the program exits.
+namespace TaskPool
+{
+  typedef std::function<void(unsigned int)> IndexTask;
+
+  // number of threads that execute tasks, including the calling thread
+  unsigned int numThreads ();
+
+  // Limits the number of threads that execute tasks, e.g. to compare parallel with serial results
+  // in tests. Zero lifts the limit.
+  void setMaxNumThreads (unsigned int);
+
+  // Calls the task for every index in `[0, n)` and blocks until all calls returned. Indices are
+  // handed out dynamically, i.e. tasks should be coarse enough to amortize the hand-out but fine
+  // enough to balance the load. The calling thread takes part in the execution, so nested or
+  // concurrent calls from several threads always make progress. If a task throws, no further
+  // indices are handed out and the first exception is rethrown once all running tasks returned.
+  void parallelFor (unsigned int, const IndexTask&);
+}
+
+#endif
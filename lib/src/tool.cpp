@@ -145,11 +145,8 @@ struct Tool::Impl
 
   bool intersectsRecentDynamicMesh (const PrimRay& ray, Intersection& intersection) const
   {
-    assert (this->state.history ().hasRecentDynamicMesh ());
-
-    this->state.history ().forEachRecentDynamicMesh (
-      [&ray, &intersection](const DynamicMesh& mesh) { mesh.intersects (ray, intersection); });
-    return intersection.isIntersection ();
+    return this->state.history ().intersectsRecentDynamicMesh (this->state.scene (), ray,
+                                                               intersection);
   }
 
   bool intersectsRecentDynamicMesh (const glm::ivec2& pos, Intersection& intersection) const
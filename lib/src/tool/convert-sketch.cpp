@@ -3,20 +3,24 @@
  * Use and redistribute under the terms of the GNU General Public License
  */
 #include <QCheckBox>
+#include <memory>
+#include <sstream>
+#include <string>
 #include "cache.hpp"
-#include "distance.hpp"
+#include "dlb.hpp"
 #include "dynamic/mesh.hpp"
 #include "isosurface-extraction.hpp"
 #include "mesh.hpp"
 #include "primitive/aabox.hpp"
-#include "primitive/cone-sphere.hpp"
 #include "scene.hpp"
+#include "sketch/distance-tree.hpp"
 #include "sketch/mesh-intersection.hpp"
 #include "sketch/mesh.hpp"
-#include "sketch/path.hpp"
 #include "state.hpp"
 #include "tool/sculpt/util/action.hpp"
+#include "tool/util/extraction.hpp"
 #include "tools.hpp"
+#include "view/double-slider.hpp"
 #include "view/pointing-event.hpp"
 #include "view/resolution-slider.hpp"
 #include "view/tool-tip.hpp"
@@ -25,6 +29,14 @@
 
 namespace
 {
+  // Sketches have no revisions, i.e. their changes are detected by comparing their encodings
+  std::string encodeSketch (const SketchMesh& mesh)
+  {
+    std::ostringstream stream;
+    Dlb::writeSketch (stream, mesh.tree (), mesh.paths ());
+    return stream.str ();
+  }
+
   glm::vec3 computeCenter (const SketchMesh& mesh)
   {
     if (mesh.tree ().hasRoot ())
@@ -38,17 +50,38 @@ namespace
       return ((min + max) * 0.5f);
     }
   }
+
+  bool extract (SketchMesh& sketch, float resolution, float tolerance, DynamicMesh& mesh,
+                const IsosurfaceExtraction::ProgressCallback& progress)
+  {
+    glm::vec3 min, max;
+    sketch.minMax (min, max);
+
+    sketch.optimizePaths ();
+
+    const SketchDistanceTree                         tree (sketch.tree (), sketch.paths ());
+    const IsosurfaceExtraction::BatchDistanceCallback getDistances =
+      [&tree](const std::vector<glm::vec3>& positions, std::vector<float>& distances) {
+        tree.distances (positions, distances);
+      };
+
+    return IsosurfaceExtraction::extract (getDistances, PrimAABox (min, max), resolution,
+                                          tolerance, mesh, progress);
+  }
 }
 
 struct ToolConvertSketch::Impl
 {
   ToolConvertSketch* self;
   float              resolution;
+  float              tolerance;
   bool               moveToCenter;
+  ToolUtilExtraction extraction;
 
   Impl (ToolConvertSketch* s)
     : self (s)
     , resolution (s->cache ().get<float> ("resolution", 0.06))
+    , tolerance (s->cache ().get<float> ("tolerance", 0.0f))
     , moveToCenter (s->cache ().get<bool> ("move-to-center", true))
   {
   }
@@ -73,6 +106,16 @@ struct ToolConvertSketch::Impl
     });
     properties.addStacked (QObject::tr ("Resolution"), resolutionEdit);
 
+    ViewDoubleSlider& toleranceEdit = ViewUtil::slider (2, 0.0f, this->tolerance, 1.0f);
+    ViewUtil::connect (toleranceEdit, [this](float t) {
+      this->tolerance = t;
+      this->self->cache ().set ("tolerance", t);
+    });
+    toleranceEdit.setToolTip (
+      QObject::tr ("Merges planar regions. Meshes that are very large relative to the resolution "
+                   "are extracted in slices and are never merged."));
+    properties.addStacked (QObject::tr ("Tolerance"), toleranceEdit);
+
     QCheckBox& moveToCenterEdit =
       ViewUtil::checkBox (QObject::tr ("Move to center"), this->moveToCenter);
     ViewUtil::connect (moveToCenterEdit, [this](bool m) {
@@ -80,6 +123,8 @@ struct ToolConvertSketch::Impl
       this->self->cache ().set ("move-to-center", m);
     });
     properties.add (moveToCenterEdit);
+
+    this->extraction.addProperties (properties);
   }
 
   void setupToolTip ()
@@ -89,71 +134,66 @@ struct ToolConvertSketch::Impl
     this->self->state ().setToolTip (&toolTip);
   }
 
-  DynamicMesh& convert (SketchMesh& sketch)
+  // The sketch is converted in the background. The scene is only modified once the conversion is
+  // complete and if the sketch still exists unchanged.
+  void convert (SketchMesh& sketch)
   {
-    glm::vec3 min, max;
-    sketch.minMax (min, max);
-
-    const IsosurfaceExtraction::DistanceCallback getDistance = [&sketch](const glm::vec3& pos) {
-      float distance = Util::maxFloat ();
-
-      if (sketch.tree ().hasRoot ())
-      {
-        sketch.tree ().root ().forEachConstNode ([&pos, &distance](const SketchNode& node) {
-          const float d =
-            node.parent ()
-              ? Distance::distance (PrimConeSphere (node.data (), node.parent ()->data ()), pos)
-              : Distance::distance (node.data (), pos);
-
-          distance = glm::min (distance, d);
-        });
-      }
-      for (const SketchPath& p : sketch.paths ())
-      {
-        for (const PrimSphere& s : p.spheres ())
+    const std::shared_ptr<SketchMesh> copy = std::make_shared<SketchMesh> (sketch);
+    const glm::vec3                   center = computeCenter (sketch);
+    const float                       resolution = this->resolution;
+    const float                       tolerance = this->tolerance;
+    const bool                        moveToCenter = this->moveToCenter;
+    const unsigned int                id = this->self->state ().scene ().id (sketch);
+    const std::string                 encoding = encodeSketch (sketch);
+
+    this->extraction.run (
+      [copy, resolution, tolerance](DynamicMesh& mesh,
+                                    const IsosurfaceExtraction::ProgressCallback& progress) {
+        return extract (*copy, resolution, tolerance, mesh, progress);
+      },
+      [this, id, encoding, center, moveToCenter](DynamicMesh& mesh) {
+        State&      state = this->self->state ();
+        SketchMesh* sketch = state.scene ().sketchMesh (id);
+
+        if (sketch && encodeSketch (*sketch) == encoding)
         {
-          distance = glm::min (distance, Distance::distance (s, pos));
+          this->self->snapshotAll ();
+
+          DynamicMesh& dMesh = state.scene ().newDynamicMesh (state.config (), mesh);
+
+          if (moveToCenter)
+          {
+            dMesh.translate (-center);
+            dMesh.normalize ();
+            dMesh.bufferData ();
+          }
+          ToolSculptAction::smoothMesh (dMesh);
+          state.scene ().deleteMesh (*sketch);
+          state.handleToolResponse (ToolResponse::Redraw);
         }
-      }
-      return distance;
-    };
-
-    sketch.optimizePaths ();
-    DynamicMesh mesh;
-    IsosurfaceExtraction::extract (getDistance, PrimAABox (min, max), this->resolution, mesh);
-
-    State& state = this->self->state ();
-    return state.scene ().newDynamicMesh (state.config (), mesh);
+      });
   }
 
   ToolResponse runReleaseEvent (const ViewPointingEvent& e)
   {
-    if (e.leftButton ())
+    if (e.leftButton () && this->extraction.isRunning () == false)
     {
       SketchMeshIntersection intersection;
       if (this->self->intersectsScene (e, intersection))
       {
-        SketchMesh& sMesh = intersection.mesh ();
-        glm::vec3   center = computeCenter (sMesh);
-
-        this->self->snapshotAll ();
-
-        DynamicMesh& dMesh = this->convert (sMesh);
-
-        if (this->moveToCenter)
-        {
-          dMesh.translate (-center);
-          dMesh.normalize ();
-          dMesh.bufferData ();
-        }
-        ToolSculptAction::smoothMesh (dMesh);
-        this->self->state ().scene ().deleteMesh (sMesh);
-        return ToolResponse::Redraw;
+        this->convert (intersection.mesh ());
       }
     }
     return ToolResponse::None;
   }
+
+  ToolResponse runCommit ()
+  {
+    this->extraction.cancel ();
+    return ToolResponse::None;
+  }
 };
 
 DELEGATE_TOOL (ToolConvertSketch)
 DELEGATE_TOOL_RUN_RELEASE_EVENT (ToolConvertSketch)
+DELEGATE_TOOL_RUN_COMMIT (ToolConvertSketch)
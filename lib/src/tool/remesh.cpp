@@ -2,21 +2,34 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
+#include <QCheckBox>
 #include <QPainter>
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
 #include "cache.hpp"
 #include "color.hpp"
 #include "config.hpp"
+#include "camera.hpp"
+#include "dynamic/faces.hpp"
 #include "dynamic/mesh-intersection.hpp"
 #include "dynamic/mesh.hpp"
+#include "dynamic/stitch.hpp"
 #include "isosurface-extraction.hpp"
 #include "maybe.hpp"
 #include "mesh.hpp"
 #include "primitive/aabox.hpp"
 #include "primitive/ray.hpp"
+#include "primitive/sphere.hpp"
+#include "primitive/triangle.hpp"
 #include "scene.hpp"
 #include "state.hpp"
 #include "tool/sculpt/util/action.hpp"
+#include "tool/util/extraction.hpp"
 #include "tools.hpp"
+#include "util.hpp"
+#include "view/cursor.hpp"
+#include "view/double-slider.hpp"
 #include "view/pointing-event.hpp"
 #include "view/resolution-slider.hpp"
 #include "view/tool-tip.hpp"
@@ -30,67 +43,92 @@ namespace
     Normal,
     Union,
     Difference,
-    Intersection
+    Intersection,
+    Local
   };
-}
 
-struct ToolRemesh::Impl
-{
-  ToolRemesh*       self;
-  float             resolution;
-  Mode              mode;
-  Maybe<glm::ivec2> pressPoint;
+  typedef DynamicStitch::Loop                    Loop;
+  typedef IsosurfaceExtraction::ProgressCallback ProgressCallback;
 
-  Impl (ToolRemesh* s)
-    : self (s)
-    , resolution (s->cache ().get<float> ("resolution", 0.06))
-    , mode (Mode (s->cache ().get<int> ("mode", int(Mode::Normal))))
+  // Copies vertices of one mesh to another mesh on first use.
+  struct VertexCopy
   {
-  }
+    const DynamicMesh&                             from;
+    DynamicMesh&                                   to;
+    std::unordered_map<unsigned int, unsigned int> indices;
 
-  void setupProperties ()
-  {
-    ViewTwoColumnGrid& properties = this->self->properties ();
+    VertexCopy (const DynamicMesh& f, DynamicMesh& t)
+      : from (f)
+      , to (t)
+    {
+    }
 
-    QButtonGroup& modeEdit =
-      ViewUtil::buttonGroup ({QObject::tr ("Normal"), QObject::tr ("Union"),
-                              QObject::tr ("Difference"), QObject::tr ("Intersection")});
-    ViewUtil::connect (modeEdit, int(this->mode), [this](int id) {
-      this->mode = Mode (id);
-      this->self->cache ().set ("mode", id);
-    });
-    properties.add (modeEdit);
+    unsigned int index (unsigned int i)
+    {
+      const auto it = this->indices.find (i);
+      if (it == this->indices.end ())
+      {
+        const unsigned int newIndex =
+          this->to.addVertex (this->from.vertex (i), this->from.vertexNormal (i));
+        this->indices.emplace (i, newIndex);
+        return newIndex;
+      }
+      else
+      {
+        return it->second;
+      }
+    }
 
-    ViewResolutionSlider& resolutionEdit =
-      ViewUtil::resolutionSlider (0.02f, this->resolution, 0.1f);
-    ViewUtil::connect (resolutionEdit, [this](float r) {
-      this->resolution = r;
-      this->self->cache ().set ("resolution", r);
-    });
-    properties.addStacked (QObject::tr ("Resolution"), resolutionEdit);
-  }
+    unsigned int addFace (unsigned int face)
+    {
+      unsigned int i1, i2, i3;
+      this->from.vertexIndices (face, i1, i2, i3);
+      return this->to.addFace (this->index (i1), this->index (i2), this->index (i3));
+    }
+  };
 
-  void setupToolTip ()
+  // Adds the faces of a patch to a mesh and stitches each hole loop of the mesh to its paired
+  // boundary loop of the patch.
+  void addPatch (DynamicMesh& mesh, const DynamicMesh& patch,
+                 const std::vector<unsigned int>& patchFaces, const std::vector<Loop>& holeLoops,
+                 const std::vector<Loop>& patchLoops, const std::vector<unsigned int>& pairs,
+                 DynamicFaces& newFaces)
   {
-    ViewToolTip toolTip;
-    toolTip.add (ViewInputEvent::MouseLeft, QObject::tr ("Remesh selection"));
-    this->self->state ().setToolTip (&toolTip);
-  }
+    VertexCopy copy (patch, mesh);
 
-  ToolResponse runInitialize ()
-  {
-    this->setupProperties ();
-    this->setupToolTip ();
+    for (unsigned int f : patchFaces)
+    {
+      newFaces.insert (copy.addFace (f));
+    }
 
-    return ToolResponse::None;
+    for (unsigned int i = 0; i < holeLoops.size (); i++)
+    {
+      Loop patchLoop;
+      for (unsigned int v : patchLoops[pairs[i]])
+      {
+        patchLoop.push_back (copy.index (v));
+      }
+      DynamicStitch::stitch (mesh, holeLoops[i], patchLoop, newFaces);
+    }
+    newFaces.commit ();
   }
 
-  ToolResponse runMoveEvent (const ViewPointingEvent&)
+  // Copies all faces that are not inside of the box.
+  void copyOutside (DynamicMesh& from, const PrimAABox& box, DynamicMesh& to)
   {
-    return this->mode == Mode::Normal ? ToolResponse::None : ToolResponse::Redraw;
+    VertexCopy copy (from, to);
+
+    from.forEachFace ([&from, &box, &copy](unsigned int i) {
+      if (box.contains (from.face (i)) == false)
+      {
+        copy.addFace (i);
+      }
+    });
   }
 
-  void remesh (DynamicMesh& mesh)
+  bool extractMesh (const DynamicMesh& mesh, const PrimAABox& bounds, float resolution,
+                    float tolerance, DynamicMesh& extractedMesh,
+                    const ProgressCallback& progress = nullptr)
   {
     const IsosurfaceExtraction::IntersectionCallback getIntersection =
       [&mesh](const PrimRay& ray, Intersection& intersection) {
@@ -104,26 +142,22 @@ struct ToolRemesh::Impl
         }
       };
 
-    const IsosurfaceExtraction::DistanceCallback getDistance = [&mesh](const glm::vec3& pos) {
-      return mesh.unsignedDistance (pos);
-    };
-
-    const PrimAABox bounds = mesh.mesh ().bounds ();
-    DynamicMesh     extractedMesh;
-    IsosurfaceExtraction::extract (getDistance, getIntersection, bounds, this->resolution,
-                                   extractedMesh);
+    const IsosurfaceExtraction::BatchDistanceCallback getDistances =
+      [&mesh](const std::vector<glm::vec3>& positions, std::vector<float>& distances) {
+        mesh.unsignedDistances (positions, distances);
+      };
 
-    State& state = this->self->state ();
-    state.scene ().deleteMesh (mesh);
-    DynamicMesh& dMesh = state.scene ().newDynamicMesh (state.config (), extractedMesh);
-    ToolSculptAction::smoothMesh (dMesh);
+    return IsosurfaceExtraction::extract (getDistances, getIntersection, bounds, resolution,
+                                          tolerance, extractedMesh, progress);
   }
 
-  void remesh (DynamicMesh& meshA, DynamicMesh& meshB)
+  bool extractMeshes (const DynamicMesh& meshA, const DynamicMesh& meshB, Mode mode,
+                      const PrimAABox& bounds, float resolution, float tolerance,
+                      DynamicMesh& extractedMesh, const ProgressCallback& progress = nullptr)
   {
     const IsosurfaceExtraction::IntersectionCallback getCommutativeIntersection =
-      [this, &meshA, &meshB](const PrimRay& ray, Intersection& intersection) {
-        assert (this->mode == Mode::Union || this->mode == Mode::Intersection);
+      [mode, &meshA, &meshB](const PrimRay& ray, Intersection& intersection) {
+        assert (mode == Mode::Union || mode == Mode::Intersection);
 
         Intersection intersectionA, intersectionB;
         meshA.intersects (ray, intersectionA, true);
@@ -144,26 +178,26 @@ struct ToolRemesh::Impl
           {
             // (B (A o-> A) B)
             // (A (B o-> A) B)
-            if (this->mode == Mode::Union)
+            if (mode == Mode::Union)
             {
               return IsosurfaceExtraction::Intersection::Continue;
             }
             else
             {
-              assert (this->mode == Mode::Intersection);
+              assert (mode == Mode::Intersection);
               return IsosurfaceExtraction::Intersection::Sample;
             }
           }
           else if (insideA && insideB == false)
           {
             // (A o-> A) (B B)
-            if (this->mode == Mode::Union)
+            if (mode == Mode::Union)
             {
               return IsosurfaceExtraction::Intersection::Sample;
             }
             else
             {
-              assert (this->mode == Mode::Intersection);
+              assert (mode == Mode::Intersection);
               return IsosurfaceExtraction::Intersection::Continue;
             }
           }
@@ -171,13 +205,13 @@ struct ToolRemesh::Impl
           {
             // (B o-> (A A) B)
             // (B o-> (A B) A)
-            if (this->mode == Mode::Union)
+            if (mode == Mode::Union)
             {
               return IsosurfaceExtraction::Intersection::Continue;
             }
             else
             {
-              assert (this->mode == Mode::Intersection);
+              assert (mode == Mode::Intersection);
               return IsosurfaceExtraction::Intersection::Sample;
             }
           }
@@ -186,13 +220,13 @@ struct ToolRemesh::Impl
             // o-> (A (B B) A)
             // o-> (A (B A) B)
             // o-> (A A) (B B)
-            if (this->mode == Mode::Union)
+            if (mode == Mode::Union)
             {
               return IsosurfaceExtraction::Intersection::Sample;
             }
             else
             {
-              assert (this->mode == Mode::Intersection);
+              assert (mode == Mode::Intersection);
               return IsosurfaceExtraction::Intersection::Continue;
             }
           }
@@ -200,13 +234,13 @@ struct ToolRemesh::Impl
         }
         else if (intersectsA)
         {
-          if (this->mode == Mode::Union)
+          if (mode == Mode::Union)
           {
             return IsosurfaceExtraction::Intersection::Sample;
           }
           else
           {
-            assert (this->mode == Mode::Intersection);
+            assert (mode == Mode::Intersection);
             return IsosurfaceExtraction::Intersection::Continue;
           }
         }
@@ -219,8 +253,8 @@ struct ToolRemesh::Impl
       };
 
     const IsosurfaceExtraction::IntersectionCallback getDifferenceIntersection =
-      [this, &meshA, &meshB](const PrimRay& ray, Intersection& intersection) {
-        assert (this->mode == Mode::Difference);
+      [mode, &meshA, &meshB](const PrimRay& ray, Intersection& intersection) {
+        assert (mode == Mode::Difference);
 
         Intersection intersectionA, intersectionB;
         const bool   intersectsA = meshA.intersects (ray, intersectionA, true);
@@ -299,43 +333,459 @@ struct ToolRemesh::Impl
         DILAY_IMPOSSIBLE
       };
 
-    const IsosurfaceExtraction::DistanceCallback getDistance = [&meshA,
-                                                                &meshB](const glm::vec3& pos) {
-      return glm::min (meshA.unsignedDistance (pos), meshB.unsignedDistance (pos));
-    };
+    const IsosurfaceExtraction::BatchDistanceCallback getDistances =
+      [&meshA, &meshB](const std::vector<glm::vec3>& positions, std::vector<float>& distances) {
+        std::vector<float> distancesB (positions.size ());
 
-    const PrimAABox boundsA = meshA.mesh ().bounds ();
-    const PrimAABox boundsB = meshB.mesh ().bounds ();
-    const glm::vec3 min = glm::min (boundsA.minimum (), boundsB.minimum ());
-    const glm::vec3 max = glm::max (boundsA.maximum (), boundsB.maximum ());
-    const PrimAABox bounds (min, max);
+        meshA.unsignedDistances (positions, distances);
+        meshB.unsignedDistances (positions, distancesB);
+
+        for (unsigned int i = 0; i < distances.size (); i++)
+        {
+          distances[i] = glm::min (distances[i], distancesB[i]);
+        }
+      };
+
+    if (mode == Mode::Difference)
+    {
+      return IsosurfaceExtraction::extract (getDistances, getDifferenceIntersection, bounds,
+                                            resolution, tolerance, extractedMesh, progress);
+    }
+    else
+    {
+      return IsosurfaceExtraction::extract (getDistances, getCommutativeIntersection, bounds,
+                                            resolution, tolerance, extractedMesh, progress);
+    }
+  }
+
+  // Faces of the mesh that lie inside of the sphere
+  std::vector<unsigned int> localRegion (const DynamicMesh& mesh, const PrimSphere& sphere)
+  {
+    DynamicFaces faces;
+    mesh.intersects (sphere, faces);
+    faces.filter ([&mesh, &sphere](unsigned int i) { return sphere.contains (mesh.face (i)); });
+
+    std::vector<unsigned int> region (faces.begin (), faces.end ());
+    std::sort (region.begin (), region.end ());
+    return region;
+  }
+
+  // margin of the overlap of two meshes in multiples of the resolution
+  static const float overlapMargin = 4.0f;
+}
+
+struct ToolRemesh::Impl
+{
+  ToolRemesh*        self;
+  float              resolution;
+  float              tolerance;
+  float              radius;
+  bool               restrictToOverlap;
+  Mode               mode;
+  Maybe<glm::ivec2>  pressPoint;
+  ViewCursor         cursor;
+  ToolUtilExtraction extraction;
+
+  Impl (ToolRemesh* s)
+    : self (s)
+    , resolution (s->cache ().get<float> ("resolution", 0.06))
+    , tolerance (s->cache ().get<float> ("tolerance", 0.0f))
+    , radius (s->cache ().get<float> ("radius", 0.2f))
+    , restrictToOverlap (s->cache ().get<bool> ("restrict-to-overlap", false))
+    , mode (Mode (s->cache ().get<int> ("mode", int(Mode::Normal))))
+  {
+  }
+
+  void setupProperties ()
+  {
+    ViewTwoColumnGrid& properties = this->self->properties ();
+
+    QButtonGroup& modeEdit =
+      ViewUtil::buttonGroup ({QObject::tr ("Normal"), QObject::tr ("Union"),
+                              QObject::tr ("Difference"), QObject::tr ("Intersection"),
+                              QObject::tr ("Local")});
+    ViewUtil::connect (modeEdit, int(this->mode), [this](int id) {
+      this->mode = Mode (id);
+      this->self->cache ().set ("mode", id);
+
+      if (this->mode != Mode::Local)
+      {
+        this->cursor.disable ();
+      }
+    });
+    properties.add (modeEdit);
+
+    ViewResolutionSlider& resolutionEdit =
+      ViewUtil::resolutionSlider (0.02f, this->resolution, 0.1f);
+    ViewUtil::connect (resolutionEdit, [this](float r) {
+      this->resolution = r;
+      this->self->cache ().set ("resolution", r);
+    });
+    properties.addStacked (QObject::tr ("Resolution"), resolutionEdit);
+
+    ViewDoubleSlider& toleranceEdit = ViewUtil::slider (2, 0.0f, this->tolerance, 1.0f);
+    ViewUtil::connect (toleranceEdit, [this](float t) {
+      this->tolerance = t;
+      this->self->cache ().set ("tolerance", t);
+    });
+    toleranceEdit.setToolTip (
+      QObject::tr ("Merges planar regions. Meshes that are very large relative to the resolution "
+                   "are extracted in slices and are never merged."));
+    properties.addStacked (QObject::tr ("Tolerance"), toleranceEdit);
+
+    ViewDoubleSlider& radiusEdit = ViewUtil::slider (2, 0.05f, this->radius, 1.0f);
+    ViewUtil::connect (radiusEdit, [this](float r) {
+      this->radius = r;
+      this->cursor.radius (r);
+      this->self->cache ().set ("radius", r);
+    });
+    properties.addStacked (QObject::tr ("Radius of local remeshing"), radiusEdit);
+
+    QCheckBox& overlapEdit =
+      ViewUtil::checkBox (QObject::tr ("Restrict to overlap"), this->restrictToOverlap);
+    ViewUtil::connect (overlapEdit, [this](bool r) {
+      this->restrictToOverlap = r;
+      this->self->cache ().set ("restrict-to-overlap", r);
+    });
+    properties.add (overlapEdit);
+
+    this->extraction.addProperties (properties);
+  }
+
+  void setupToolTip ()
+  {
+    ViewToolTip toolTip;
+    toolTip.add (ViewInputEvent::MouseLeft, QObject::tr ("Remesh selection"));
+    this->self->state ().setToolTip (&toolTip);
+  }
+
+  void setupCursor ()
+  {
+    this->cursor.disable ();
+    this->cursor.radius (this->radius);
+  }
+
+  ToolResponse runInitialize ()
+  {
+    this->setupProperties ();
+    this->setupToolTip ();
+    this->setupCursor ();
 
-    DynamicMesh extractedMesh;
-    if (this->mode == Mode::Difference)
+    return ToolResponse::None;
+  }
+
+  void runRender () const
+  {
+    if (this->cursor.isEnabled ())
     {
-      IsosurfaceExtraction::extract (getDistance, getDifferenceIntersection, bounds,
-                                     this->resolution, extractedMesh);
+      this->cursor.render (this->self->state ().camera ());
+    }
+  }
+
+  ToolResponse runMoveEvent (const ViewPointingEvent& e)
+  {
+    if (this->mode == Mode::Local)
+    {
+      DynamicMeshIntersection intersection;
+      if (this->self->intersectsScene (e.position (), intersection))
+      {
+        this->cursor.enable ();
+        this->cursor.position (intersection.position ());
+      }
+      else
+      {
+        this->cursor.disable ();
+      }
+      return ToolResponse::Redraw;
     }
     else
     {
-      IsosurfaceExtraction::extract (getDistance, getCommutativeIntersection, bounds,
-                                     this->resolution, extractedMesh);
+      return this->mode == Mode::Normal ? ToolResponse::None : ToolResponse::Redraw;
     }
+  }
+
+  // The result is dropped if the mesh was deleted or modified while it was remeshed
+  void remesh (DynamicMesh& mesh)
+  {
+    const std::shared_ptr<const DynamicMesh> copy = std::make_shared<const DynamicMesh> (mesh);
+    const PrimAABox                          bounds = mesh.mesh ().bounds ();
+    const float                              resolution = this->resolution;
+    const float                              tolerance = this->tolerance;
+    const unsigned int                       id = this->self->state ().scene ().id (mesh);
+    const unsigned int                       revision = mesh.revision ();
+
+    this->extraction.run (
+      [copy, bounds, resolution, tolerance](DynamicMesh& extractedMesh,
+                                            const ProgressCallback& progress) {
+        return extractMesh (*copy, bounds, resolution, tolerance, extractedMesh, progress);
+      },
+      [this, id, revision](DynamicMesh& extractedMesh) {
+        State&       state = this->self->state ();
+        DynamicMesh* mesh = state.scene ().dynamicMesh (id);
+
+        if (mesh && mesh->revision () == revision)
+        {
+          this->self->snapshotDynamicMeshes ();
+          state.scene ().deleteMesh (*mesh);
+          DynamicMesh& dMesh = state.scene ().newDynamicMesh (state.config (), extractedMesh);
+          ToolSculptAction::smoothMesh (dMesh);
+          state.handleToolResponse (ToolResponse::Redraw);
+        }
+      });
+  }
+
+  // Stitches a patch that has been extracted from the overlap of both meshes' bounds into the
+  // holes of the faces outside of the overlap. These faces keep their detail. The patch is cut
+  // back from the overlap's boundary. Fails without modifying the meshes if the topology of the
+  // patch does not match the holes.
+  bool stitchOverlap (DynamicMesh& meshA, DynamicMesh& meshB, Mode mode, const PrimAABox& overlap,
+                      float resolution, DynamicMesh& patch)
+  {
+    const glm::vec3 inset (2.0f * resolution);
+    const PrimAABox patchBounds (overlap.minimum () + inset, overlap.maximum () - inset);
+
+    DynamicMesh result;
+    if (mode == Mode::Union || mode == Mode::Difference)
+    {
+      copyOutside (meshA, overlap, result);
+    }
+    if (mode == Mode::Union)
+    {
+      copyOutside (meshB, overlap, result);
+    }
+
+    std::vector<unsigned int> resultFaces;
+    std::vector<Loop>         holeLoops;
+
+    result.forEachFace ([&resultFaces](unsigned int i) { resultFaces.push_back (i); });
+    if (DynamicStitch::boundaryLoops (result, resultFaces, holeLoops) == false)
+    {
+      return false;
+    }
+
+    // holes follow the orientation of the removed faces
+    for (Loop& loop : holeLoops)
+    {
+      std::reverse (loop.begin (), loop.end ());
+    }
+
+    std::vector<unsigned int> patchFaces;
+    std::vector<Loop>         patchLoops;
+    std::vector<unsigned int> pairs;
+
+    patch.forEachFace ([&patch, &patchBounds, &patchFaces](unsigned int i) {
+      if (patchBounds.contains (patch.face (i)))
+      {
+        patchFaces.push_back (i);
+      }
+    });
+
+    if (DynamicStitch::boundaryLoops (patch, patchFaces, patchLoops) == false ||
+        DynamicStitch::pairLoops (result, holeLoops, patch, patchLoops, pairs) == false)
+    {
+      return false;
+    }
+
+    DynamicFaces newFaces;
+    addPatch (result, patch, patchFaces, holeLoops, patchLoops, pairs, newFaces);
 
     State& state = this->self->state ();
+    this->self->snapshotDynamicMeshes ();
     state.scene ().deleteMesh (meshA);
     state.scene ().deleteMesh (meshB);
 
-    if (extractedMesh.isEmpty () == false)
+    if (result.isEmpty () == false)
     {
-      DynamicMesh& dMesh = state.scene ().newDynamicMesh (state.config (), extractedMesh);
-      ToolSculptAction::smoothMesh (dMesh);
+      DynamicMesh& dMesh = state.scene ().newDynamicMesh (state.config (), result);
+      ToolSculptAction::smoothMesh (dMesh, newFaces);
     }
+    return true;
+  }
+
+  // If `restrictToOverlap` is set and the bounds of both meshes overlap, only the overlap,
+  // expanded by a margin, is remeshed. Rays of the extraction start outside of the meshes, so
+  // the bounds span both meshes along z. If the patch can not be stitched, both meshes are
+  // remeshed entirely. The result is dropped if either mesh was deleted or modified meanwhile.
+  void remesh (DynamicMesh& meshA, DynamicMesh& meshB, bool restrictToOverlap)
+  {
+    const PrimAABox boundsA = meshA.mesh ().bounds ();
+    const PrimAABox boundsB = meshB.mesh ().bounds ();
+    const glm::vec3 min = glm::min (boundsA.minimum (), boundsB.minimum ());
+    const glm::vec3 max = glm::max (boundsA.maximum (), boundsB.maximum ());
+    const glm::vec3 overlapMin = glm::max (boundsA.minimum (), boundsB.minimum ());
+    const glm::vec3 overlapMax = glm::min (boundsA.maximum (), boundsB.maximum ());
+
+    Maybe<PrimAABox> overlap;
+    PrimAABox        bounds (min, max);
+
+    if (restrictToOverlap && glm::all (glm::lessThan (overlapMin, overlapMax)))
+    {
+      const glm::vec3 margin (overlapMargin * this->resolution);
+
+      overlap = PrimAABox (overlapMin - margin, overlapMax + margin);
+      bounds = PrimAABox (glm::vec3 (glm::vec2 (overlap->minimum ()), min.z),
+                          glm::vec3 (glm::vec2 (overlap->maximum ()), max.z));
+    }
+
+    const std::shared_ptr<const DynamicMesh> copyA = std::make_shared<const DynamicMesh> (meshA);
+    const std::shared_ptr<const DynamicMesh> copyB = std::make_shared<const DynamicMesh> (meshB);
+    const Mode                               mode = this->mode;
+    const float                              resolution = this->resolution;
+    const float                              tolerance = this->tolerance;
+    const unsigned int                       idA = this->self->state ().scene ().id (meshA);
+    const unsigned int                       idB = this->self->state ().scene ().id (meshB);
+    const unsigned int                       revisionA = meshA.revision ();
+    const unsigned int                       revisionB = meshB.revision ();
+
+    this->extraction.run (
+      [copyA, copyB, mode, bounds, resolution, tolerance](DynamicMesh& extractedMesh,
+                                                          const ProgressCallback& progress) {
+        return extractMeshes (*copyA, *copyB, mode, bounds, resolution, tolerance, extractedMesh,
+                              progress);
+      },
+      [this, idA, idB, revisionA, revisionB, mode, overlap,
+       resolution](DynamicMesh& extractedMesh) {
+        State&       state = this->self->state ();
+        DynamicMesh* meshA = state.scene ().dynamicMesh (idA);
+        DynamicMesh* meshB = state.scene ().dynamicMesh (idB);
+
+        if (meshA == nullptr || meshB == nullptr || meshA->revision () != revisionA ||
+            meshB->revision () != revisionB)
+        {
+          return;
+        }
+        else if (overlap)
+        {
+          const bool stitched =
+            this->stitchOverlap (*meshA, *meshB, mode, *overlap, resolution, extractedMesh);
+          if (stitched == false)
+          {
+            DILAY_INFO ("could not stitch the overlap: remeshing both meshes entirely");
+            this->remesh (*meshA, *meshB, false);
+            return;
+          }
+        }
+        else
+        {
+          this->self->snapshotDynamicMeshes ();
+          state.scene ().deleteMesh (*meshA);
+          state.scene ().deleteMesh (*meshB);
+
+          if (extractedMesh.isEmpty () == false)
+          {
+            DynamicMesh& dMesh = state.scene ().newDynamicMesh (state.config (), extractedMesh);
+            ToolSculptAction::smoothMesh (dMesh);
+          }
+        }
+        state.handleToolResponse (ToolResponse::Redraw);
+      });
+  }
+
+  // Remeshes all faces inside of the sphere in the background and stitches the extracted patch
+  // into the hole. Rays of the extraction start outside of the mesh, so the bounds span the
+  // whole mesh along z. The result is dropped if the extraction has been canceled, or if the
+  // mesh was deleted or modified meanwhile.
+  void remesh (DynamicMesh& mesh, const PrimSphere& sphere)
+  {
+    std::vector<Loop> holeLoops;
+    if (DynamicStitch::boundaryLoops (mesh, localRegion (mesh, sphere), holeLoops) == false ||
+        holeLoops.empty ())
+    {
+      return;
+    }
+
+    const PrimAABox meshBounds = mesh.mesh ().bounds ();
+    const glm::vec2 center (sphere.center ());
+    const glm::vec2 r (sphere.radius ());
+    const PrimAABox bounds (glm::vec3 (center - r, meshBounds.minimum ().z),
+                            glm::vec3 (center + r, meshBounds.maximum ().z));
+
+    const std::shared_ptr<const DynamicMesh> copy = std::make_shared<const DynamicMesh> (mesh);
+    const float                              resolution = this->resolution;
+    const float                              tolerance = this->tolerance;
+    const unsigned int                       id = this->self->state ().scene ().id (mesh);
+    const unsigned int                       revision = mesh.revision ();
+
+    this->extraction.run (
+      [copy, bounds, resolution, tolerance](DynamicMesh& patch, const ProgressCallback& progress) {
+        return extractMesh (*copy, bounds, resolution, tolerance, patch, progress);
+      },
+      [this, id, revision, sphere, resolution](DynamicMesh& patch) {
+        State&       state = this->self->state ();
+        DynamicMesh* mesh = state.scene ().dynamicMesh (id);
+
+        if (mesh && mesh->revision () == revision &&
+            this->stitchLocal (*mesh, sphere, resolution, patch))
+        {
+          state.handleToolResponse (ToolResponse::Redraw);
+        }
+      });
+  }
+
+  // Stitches a patch that has been extracted from the bounds of the sphere into the hole of the
+  // faces inside of the sphere. The patch is cut back by two cubes from the sphere's boundary
+  // where it is clipped by the bounds of the extraction. Fails without modifying the mesh if the
+  // topology of the patch does not match the topology of the hole.
+  bool stitchLocal (DynamicMesh& mesh, const PrimSphere& sphere, float resolution,
+                    DynamicMesh& patch)
+  {
+    const std::vector<unsigned int> region = localRegion (mesh, sphere);
+    std::vector<Loop>               holeLoops;
+
+    if (region.empty () || DynamicStitch::boundaryLoops (mesh, region, holeLoops) == false ||
+        holeLoops.empty ())
+    {
+      return false;
+    }
+
+    const float               patchRadius = sphere.radius () - (2.0f * resolution);
+    const PrimSphere          patchSphere (sphere.center (), patchRadius);
+    std::vector<unsigned int> patchFaces;
+    std::vector<Loop>         patchLoops;
+    std::vector<unsigned int> pairs;
+
+    patch.forEachFace ([&patch, &patchSphere, &patchFaces](unsigned int i) {
+      if (patchSphere.contains (patch.face (i)))
+      {
+        patchFaces.push_back (i);
+      }
+    });
+
+    if (patchRadius <= 0.0f || patchFaces.empty () ||
+        DynamicStitch::boundaryLoops (patch, patchFaces, patchLoops) == false ||
+        DynamicStitch::pairLoops (mesh, holeLoops, patch, patchLoops, pairs) == false)
+    {
+      return false;
+    }
+
+    this->self->snapshotDynamicMeshes ();
+
+    std::vector<unsigned int> regionVertices;
+    for (unsigned int f : region)
+    {
+      mesh.forEachVertexAdjacentToFace (
+        f, [&regionVertices](unsigned int v) { regionVertices.push_back (v); });
+      mesh.deleteFace (f);
+    }
+    for (unsigned int v : regionVertices)
+    {
+      if (mesh.isFreeVertex (v) == false && mesh.adjacentFaces (v).empty ())
+      {
+        mesh.deleteVertex (v);
+      }
+    }
+
+    DynamicFaces newFaces;
+    addPatch (mesh, patch, patchFaces, holeLoops, patchLoops, pairs, newFaces);
+
+    ToolSculptAction::smoothMesh (mesh, newFaces);
+    return true;
   }
 
   ToolResponse runPressEvent (const ViewPointingEvent& e)
   {
-    if (e.leftButton () == false || this->mode == Mode::Normal)
+    if (e.leftButton () == false || this->mode == Mode::Normal || this->mode == Mode::Local ||
+        this->extraction.isRunning ())
     {
       return ToolResponse::None;
     }
@@ -348,7 +798,7 @@ struct ToolRemesh::Impl
 
   ToolResponse runReleaseEvent (const ViewPointingEvent& e)
   {
-    if (e.leftButton () == false)
+    if (e.leftButton () == false || this->extraction.isRunning ())
     {
       return ToolResponse::None;
     }
@@ -359,14 +809,18 @@ struct ToolRemesh::Impl
         DynamicMeshIntersection intersection;
         if (this->self->intersectsScene (e.position (), intersection))
         {
-          this->self->snapshotDynamicMeshes ();
           this->remesh (intersection.mesh ());
-          return ToolResponse::Redraw;
         }
-        else
+        return ToolResponse::None;
+      }
+      else if (this->mode == Mode::Local)
+      {
+        DynamicMeshIntersection intersection;
+        if (this->self->intersectsScene (e.position (), intersection))
         {
-          return ToolResponse::None;
+          this->remesh (intersection.mesh (), PrimSphere (intersection.position (), this->radius));
         }
+        return ToolResponse::None;
       }
       else if (this->pressPoint)
       {
@@ -379,14 +833,13 @@ struct ToolRemesh::Impl
 
         if (intersectsA && intersectsB)
         {
-          this->self->snapshotDynamicMeshes ();
           if (&intersectionA.mesh () == &intersectionB.mesh ())
           {
             this->remesh (intersectionA.mesh ());
           }
           else
           {
-            this->remesh (intersectionA.mesh (), intersectionB.mesh ());
+            this->remesh (intersectionA.mesh (), intersectionB.mesh (), this->restrictToOverlap);
           }
           return ToolResponse::Redraw;
         }
@@ -404,7 +857,7 @@ struct ToolRemesh::Impl
 
   void runPaint (QPainter& painter) const
   {
-    if (this->mode != Mode::Normal && this->pressPoint)
+    if (this->pressPoint)
     {
       const QPoint cursorPos (ViewUtil::toQPoint (this->self->cursorPosition ()));
 
@@ -417,12 +870,23 @@ struct ToolRemesh::Impl
     }
   }
 
-  ToolResponse runCommit () { return ToolResponse::Redraw; }
+  ToolResponse runCommit ()
+  {
+    this->extraction.cancel ();
+    return ToolResponse::Redraw;
+  }
+
+  void runFromConfig ()
+  {
+    this->cursor.color (this->self->config ().get<Color> ("editor/tool/cursor-color"));
+  }
 };
 
 DELEGATE_TOOL (ToolRemesh)
+DELEGATE_TOOL_RUN_RENDER (ToolRemesh)
 DELEGATE_TOOL_RUN_MOVE_EVENT (ToolRemesh)
 DELEGATE_TOOL_RUN_PRESS_EVENT (ToolRemesh)
 DELEGATE_TOOL_RUN_RELEASE_EVENT (ToolRemesh)
 DELEGATE_TOOL_RUN_PAINT (ToolRemesh)
 DELEGATE_TOOL_RUN_COMMIT (ToolRemesh)
+DELEGATE_TOOL_RUN_FROM_CONFIG (ToolRemesh)
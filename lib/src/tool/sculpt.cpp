@@ -34,6 +34,7 @@ namespace
   {
     None,
     Started,
+    Recorded,
     Sculpted,
     Ended
   };
@@ -182,12 +183,12 @@ struct ToolSculpt::Impl
     {
       if (e.pressEvent ())
       {
-        this->self->snapshotDynamicMeshes ();
         this->sculptState = SculptState::Started;
       }
 
-      const bool doSculpt =
-        this->sculptState == SculptState::Started || this->sculptState == SculptState::Sculpted;
+      const bool doSculpt = this->sculptState == SculptState::Started ||
+                            this->sculptState == SculptState::Recorded ||
+                            this->sculptState == SculptState::Sculpted;
       if (doSculpt && this->self->runSculptPointingEvent (e))
       {
         this->sculptState = SculptState::Sculpted;
@@ -216,10 +217,14 @@ struct ToolSculpt::Impl
   {
     this->brush.resetPointOfAction ();
 
-    if (this->sculptState == SculptState::Started)
+    if (this->sculptState == SculptState::Recorded)
     {
       this->self->state ().history ().dropPastSnapshot ();
     }
+    else if (this->sculptState == SculptState::Sculpted)
+    {
+      this->self->state ().history ().stopRecording ();
+    }
     this->sculptState = SculptState::None;
     return ToolResponse::None;
   }
@@ -250,10 +255,25 @@ struct ToolSculpt::Impl
     }
   }
 
+  // Strokes only record the changes of sculpted meshes, i.e. starting a stroke does not depend on
+  // the size of a mesh. Strokes that intersect the mesh as it was before the stroke use the
+  // recorded states.
+  void recordStroke ()
+  {
+    if (this->sculptState == SculptState::Started)
+    {
+      this->self->state ().history ().recordDynamicMeshes ();
+      this->sculptState = SculptState::Recorded;
+    }
+  }
+
   void sculpt ()
   {
     assert (this->brush.hasPointOfAction ());
 
+    State& state = this->self->state ();
+
+    state.history ().recordDynamicMesh (state.scene (), this->brush.mesh ());
     ToolSculptAction::sculpt (this->brush);
     if (this->self->mirrorEnabled () && this->brush.mesh ().isEmpty () == false)
     {
@@ -264,7 +284,8 @@ struct ToolSculpt::Impl
 
     if (this->brush.mesh ().isEmpty ())
     {
-      this->self->state ().scene ().deleteEmptyMeshes ();
+      state.history ().snapshotRecordedMeshes (state.scene ());
+      state.scene ().deleteEmptyMeshes ();
       this->brush.resetPointOfAction ();
     }
   }
@@ -339,6 +360,8 @@ struct ToolSculpt::Impl
 
     if (this->setCursorByIntersection (e.position (), cursorIntersection) && e.leftButton ())
     {
+      this->recordStroke ();
+
       SBParameters& parameters = this->brush.parameters<SBParameters> ();
       const float   defaultIntesity = parameters.intensity ();
       const bool    doToggle = toggle && e.modifiers () == Qt::ShiftModifier;
@@ -407,6 +430,7 @@ struct ToolSculpt::Impl
       {
         if (this->setCursorByIntersection (e.position (), cursorIntersection))
         {
+          this->recordStroke ();
           this->brush.setPointOfAction (cursorIntersection.mesh (), cursorIntersection.position (),
                                         cursorIntersection.normal ());
           this->cursor.disable ();
@@ -769,7 +769,6 @@ namespace ToolSculptAction
 
         if (mesh.isEmpty ())
         {
-          mesh.reset ();
           return;
         }
         else
@@ -778,7 +777,8 @@ namespace ToolSculptAction
           smooth (mesh, faces);
           finalize (mesh, faces);
         }
-        assert (mesh.pruneAndCheckConsistency ());
+        // Pruning would invalidate the indices of recorded deltas
+        assert (mesh.checkConsistency ());
       }
       else
       {
@@ -825,6 +825,15 @@ namespace ToolSculptAction
     mesh.bufferData ();
   }
 
+  void smoothMesh (DynamicMesh& mesh, DynamicFaces& faces)
+  {
+    extendDomain (mesh, faces, 1);
+    relaxEdges (mesh, faces);
+    smooth (mesh, faces);
+    finalize (mesh, faces);
+    mesh.bufferData ();
+  }
+
   bool deleteFaces (DynamicMesh& mesh, DynamicFaces& faces)
   {
     bool collapsed = collapseAllEdges (mesh, faces);
@@ -5,6 +5,7 @@
 #ifndef DILAY_TOOL_SCULPT_ACTION
 #define DILAY_TOOL_SCULPT_ACTION
 
+class DynamicFaces;
 class DynamicMesh;
 class SculptBrush;
 
@@ -12,6 +13,7 @@ namespace ToolSculptAction
 {
   void sculpt (const SculptBrush&);
   void smoothMesh (DynamicMesh&);
+  void smoothMesh (DynamicMesh&, DynamicFaces&);
   bool deleteFaces (DynamicMesh&, DynamicFaces&);
 };
 
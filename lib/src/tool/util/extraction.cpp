@@ -0,0 +1,177 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QObject>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QTimer>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include "dynamic/mesh.hpp"
+#include "tool/util/extraction.hpp"
+#include "util.hpp"
+#include "view/two-column-grid.hpp"
+#include "view/util.hpp"
+
+namespace
+{
+  typedef IsosurfaceExtraction::Phase Phase;
+
+  // milliseconds between two updates of the progress
+  static const int pollInterval = 50;
+
+  QString phaseLabel (Phase phase)
+  {
+    switch (phase)
+    {
+      case Phase::Intersections:
+        return QObject::tr ("Intersections");
+      case Phase::Marking:
+        return QObject::tr ("Marking");
+      case Phase::Distances:
+        return QObject::tr ("Distances");
+      case Phase::CubeVertices:
+        return QObject::tr ("Vertices");
+      case Phase::Faces:
+        return QObject::tr ("Faces");
+    }
+    DILAY_IMPOSSIBLE
+  }
+}
+
+struct ToolUtilExtraction::Impl
+{
+  QProgressBar*                progressBar;
+  QPushButton*                 cancelButton;
+  QTimer                       timer;
+  std::thread                  thread;
+  std::atomic<bool>            isCanceled;
+  std::atomic<bool>            isFinished;
+  std::atomic<int>             phase;
+  std::atomic<float>           progress;
+  bool                         isComplete; // written by `thread`, read after joining it
+  std::unique_ptr<DynamicMesh> mesh;
+  Callback                     callback;
+
+  Impl ()
+    : progressBar (nullptr)
+    , cancelButton (nullptr)
+    , isCanceled (false)
+    , isFinished (false)
+    , phase (int(Phase::Intersections))
+    , progress (0.0f)
+    , isComplete (false)
+  {
+    QObject::connect (&this->timer, &QTimer::timeout, [this]() { this->poll (); });
+  }
+
+  // Widgets might have been deleted already, i.e. the job is only stopped.
+  ~Impl ()
+  {
+    if (this->isRunning ())
+    {
+      this->isCanceled = true;
+      this->thread.join ();
+    }
+  }
+
+  void addProperties (ViewTwoColumnGrid& properties)
+  {
+    this->progressBar = new QProgressBar;
+    this->progressBar->setRange (0, 100);
+
+    this->cancelButton = &ViewUtil::pushButton (QObject::tr ("Cancel"));
+    ViewUtil::connect (*this->cancelButton, [this]() { this->isCanceled = true; });
+
+    properties.add (*this->progressBar, *this->cancelButton);
+    this->resetView ();
+  }
+
+  bool isRunning () const { return this->thread.joinable (); }
+
+  void run (const Job& job, const Callback& c)
+  {
+    assert (this->progressBar && this->cancelButton);
+    assert (this->isRunning () == false);
+
+    this->isCanceled = false;
+    this->isFinished = false;
+    this->phase = int(Phase::Intersections);
+    this->progress = 0.0f;
+    this->isComplete = false;
+    this->callback = c;
+    this->mesh.reset (new DynamicMesh);
+
+    this->thread = std::thread ([this, job, mesh = this->mesh.get ()]() {
+      this->isComplete = job (*mesh, [this](Phase p, float f) {
+        this->phase = int(p);
+        this->progress = f;
+        return this->isCanceled == false;
+      });
+      this->isFinished = true;
+    });
+
+    this->cancelButton->setEnabled (true);
+    this->updateView ();
+    this->timer.start (pollInterval);
+  }
+
+  void cancel ()
+  {
+    if (this->isRunning ())
+    {
+      this->isCanceled = true;
+      this->stop ();
+    }
+  }
+
+  void stop ()
+  {
+    this->thread.join ();
+    this->timer.stop ();
+    this->resetView ();
+  }
+
+  // The callback might run another job, so the result is taken over before calling it.
+  void poll ()
+  {
+    if (this->isFinished)
+    {
+      this->stop ();
+
+      std::unique_ptr<DynamicMesh> result = std::move (this->mesh);
+      const Callback               callback = this->callback;
+
+      if (this->isComplete && this->isCanceled == false)
+      {
+        callback (*result);
+      }
+    }
+    else
+    {
+      this->updateView ();
+    }
+  }
+
+  void updateView ()
+  {
+    this->progressBar->setFormat (phaseLabel (Phase (this->phase.load ())) + " %p%");
+    this->progressBar->setValue (int(100.0f * this->progress));
+  }
+
+  void resetView ()
+  {
+    this->progressBar->reset ();
+    this->progressBar->setFormat (QString ());
+    this->cancelButton->setEnabled (false);
+  }
+};
+
+DELEGATE_BIG2 (ToolUtilExtraction)
+DELEGATE1 (void, ToolUtilExtraction, addProperties, ViewTwoColumnGrid&)
+DELEGATE_CONST (bool, ToolUtilExtraction, isRunning)
+DELEGATE2 (void, ToolUtilExtraction, run, const ToolUtilExtraction::Job&,
+           const ToolUtilExtraction::Callback&)
+DELEGATE (void, ToolUtilExtraction, cancel)
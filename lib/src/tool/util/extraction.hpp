@@ -0,0 +1,38 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_TOOL_UTIL_EXTRACTION
+#define DILAY_TOOL_UTIL_EXTRACTION
+
+#include <functional>
+#include "isosurface-extraction.hpp"
+#include "macro.hpp"
+
+class DynamicMesh;
+class ViewTwoColumnGrid;
+
+// `ToolUtilExtraction` runs an isosurface extraction in a background thread. Its progress and a
+// button to cancel it are shown in the tool's properties. Once the extraction is complete, the
+// extracted mesh is passed to the callback in the main thread. A job must not access any meshes
+// of the scene, i.e. it should work on copies.
+class ToolUtilExtraction
+{
+public:
+  typedef std::function<bool(DynamicMesh&, const IsosurfaceExtraction::ProgressCallback&)> Job;
+  typedef std::function<void(DynamicMesh&)> Callback;
+
+  DECLARE_BIG2 (ToolUtilExtraction)
+
+  void addProperties (ViewTwoColumnGrid&);
+  bool isRunning () const;
+  void run (const Job&, const Callback&);
+
+  // blocks until the job has been canceled
+  void cancel ();
+
+private:
+  IMPLEMENTATION
+};
+
+#endif
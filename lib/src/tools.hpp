@@ -29,7 +29,7 @@ DECLARE_TOOL (EditSketch, DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_PRESS_EVE
 
 DECLARE_TOOL (DeleteSketch, DECLARE_TOOL_RUN_RELEASE_EVENT)
 
-DECLARE_TOOL (ConvertSketch, DECLARE_TOOL_RUN_RELEASE_EVENT)
+DECLARE_TOOL (ConvertSketch, DECLARE_TOOL_RUN_RELEASE_EVENT DECLARE_TOOL_RUN_COMMIT)
 
 DECLARE_TOOL (SketchSpheres,
               DECLARE_TOOL_RUN_RENDER DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_PRESS_EVENT
@@ -39,8 +39,9 @@ DECLARE_TOOL (SketchSpheres,
 DECLARE_TOOL (TrimMesh, DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_RELEASE_EVENT
                           DECLARE_TOOL_RUN_PAINT DECLARE_TOOL_RUN_COMMIT)
 
-DECLARE_TOOL (Remesh,
-              DECLARE_TOOL_RUN_MOVE_EVENT DECLARE_TOOL_RUN_PRESS_EVENT
-                DECLARE_TOOL_RUN_RELEASE_EVENT DECLARE_TOOL_RUN_PAINT DECLARE_TOOL_RUN_COMMIT)
+DECLARE_TOOL (Remesh, DECLARE_TOOL_RUN_RENDER DECLARE_TOOL_RUN_MOVE_EVENT
+                        DECLARE_TOOL_RUN_PRESS_EVENT DECLARE_TOOL_RUN_RELEASE_EVENT
+                          DECLARE_TOOL_RUN_PAINT DECLARE_TOOL_RUN_COMMIT
+                            DECLARE_TOOL_RUN_FROM_CONFIG)
 
 #endif
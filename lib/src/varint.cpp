@@ -0,0 +1,48 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include "varint.hpp"
+
+void Varint::encode (std::vector<unsigned char>& bytes, unsigned int value)
+{
+  while (value >= 0x80u)
+  {
+    bytes.push_back (static_cast<unsigned char> ((value & 0x7fu) | 0x80u));
+    value >>= 7;
+  }
+  bytes.push_back (static_cast<unsigned char> (value));
+}
+
+void Varint::encodeSigned (std::vector<unsigned char>& bytes, int value)
+{
+  const unsigned int u = static_cast<unsigned int> (value);
+  Varint::encode (bytes, (u << 1) ^ (value < 0 ? ~0u : 0u));
+}
+
+bool Varint::decode (const unsigned char*& it, const unsigned char* end, unsigned int& value)
+{
+  value = 0;
+  for (unsigned int shift = 0; it != end && shift < 32; shift += 7)
+  {
+    const unsigned char byte = *it++;
+
+    value |= static_cast<unsigned int> (byte & 0x7fu) << shift;
+    if ((byte & 0x80u) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Varint::decodeSigned (const unsigned char*& it, const unsigned char* end, int& value)
+{
+  unsigned int u;
+  if (Varint::decode (it, end, u))
+  {
+    value = static_cast<int> ((u >> 1) ^ (~(u & 1u) + 1u));
+    return true;
+  }
+  return false;
+}
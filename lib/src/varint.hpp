@@ -0,0 +1,24 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#ifndef DILAY_VARINT
+#define DILAY_VARINT
+
+#include <vector>
+
+// `Varint` encodes integers with 7 bits per byte, least significant group first. The highest
+// bit of a byte is set if more bytes follow. Signed integers are zigzag encoded, i.e. values
+// close to zero take few bytes regardless of their sign.
+namespace Varint
+{
+  void encode (std::vector<unsigned char>&, unsigned int);
+  void encodeSigned (std::vector<unsigned char>&, int);
+
+  // Decodes the integer at the first iterator and advances it. Returns `false` if the input
+  // ends before the integer does.
+  bool decode (const unsigned char*&, const unsigned char*, unsigned int&);
+  bool decodeSigned (const unsigned char*&, const unsigned char*, int&);
+}
+
+#endif
@@ -24,7 +24,8 @@
 
 namespace
 {
-  const std::array<std::string, 1> requireRestart = {"editor/use-geometry-shader"};
+  const std::array<std::string, 2> requireRestart = {"editor/use-geometry-shader",
+                                                     "editor/use-core-profile"};
 
   struct DialogData
   {
@@ -211,6 +212,10 @@ namespace
     ViewTwoColumnGrid* grid = new ViewTwoColumnGrid;
 
     addIntEdit (data, *grid, "editor/undo-depth", QObject::tr ("Undo depth"), 1, Util::maxInt ());
+    addIntEdit (data, *grid, "editor/undo-memory", QObject::tr ("Undo memory (MiB)"), 1,
+                Util::maxInt ());
+    addIntEdit (data, *grid, "editor/autosave-interval",
+                QObject::tr ("Autosave interval (s, 0 disables)"), 0, Util::maxInt ());
     addIntEdit (data, *grid, "window/initial-width", QObject::tr ("Initial window width"), 1,
                 Util::maxInt ());
     addIntEdit (data, *grid, "window/initial-height", QObject::tr ("Initial window height"), 1,
@@ -226,6 +231,8 @@ namespace
                   QObject::tr ("Table pressure intensity"), Util::epsilon (), 10.0f);
 
     addBoolEdit (data, *grid, "editor/use-geometry-shader", QObject::tr ("Use geometry shader"));
+    addBoolEdit (data, *grid, "editor/use-core-profile",
+                 QObject::tr ("Use OpenGL 3.3 core profile"));
 
     grid->addStretcher ();
 
@@ -6,6 +6,7 @@
 #include <QMouseEvent>
 #include <QPainter>
 #include <glm/glm.hpp>
+#include "autosave.hpp"
 #include "camera.hpp"
 #include "config.hpp"
 #include "mesh-util.hpp"
@@ -120,17 +121,32 @@ struct ViewGlWidget::Impl
   void initializeScene ()
   {
     const QStringList arguments = QCoreApplication::arguments ();
-    if (arguments.size () > 1)
+    Autosave&         autosave = this->state ().autosave ();
+
+    if (autosave.canRecover () &&
+        ViewUtil::question (this->mainWindow, QObject::tr ("Recover autosaved scene?")))
     {
-      const std::string fileName = arguments.at (1).toStdString ();
-      if (this->state ().scene ().fromDlyFile (this->state ().config (), fileName) == false)
+      if (autosave.recover (this->state ().config (), this->state ().scene ()) == false)
       {
-        ViewUtil::error (this->mainWindow, QObject::tr ("Could not open file."));
+        ViewUtil::error (this->mainWindow, QObject::tr ("Could not recover autosaved scene."));
       }
     }
     else
     {
-      this->state ().scene ().newDynamicMesh (this->config, MeshUtil::icosphere (4));
+      autosave.discard ();
+
+      if (arguments.size () > 1)
+      {
+        const std::string fileName = arguments.at (1).toStdString ();
+        if (this->state ().scene ().fromDlyFile (this->state ().config (), fileName) == false)
+        {
+          ViewUtil::error (this->mainWindow, QObject::tr ("Could not open file."));
+        }
+      }
+      else
+      {
+        this->state ().scene ().newDynamicMesh (this->config, MeshUtil::icosphere (4));
+      }
     }
     this->mainWindow.infoPane ().scene ().updateInfo ();
   }
@@ -5,12 +5,16 @@
 #include <QTreeWidget>
 #include <QVBoxLayout>
 #include "../../scene.hpp"
+#include "camera.hpp"
 #include "dynamic/mesh.hpp"
+#include "history.hpp"
+#include "renderer.hpp"
 #include "sketch/mesh.hpp"
 #include "sketch/path.hpp"
 #include "state.hpp"
 #include "view/gl-widget.hpp"
 #include "view/info-pane/scene.hpp"
+#include "view/util.hpp"
 
 struct ViewInfoPaneScene::Impl
 {
@@ -36,6 +40,8 @@ struct ViewInfoPaneScene::Impl
 
       new QTreeWidgetItem (item, {QObject::tr ("Faces"), QString::number (mesh.numFaces ())});
       new QTreeWidgetItem (item, {QObject::tr ("Vertices"), QString::number (mesh.numVertices ())});
+      new QTreeWidgetItem (item, {QObject::tr ("GPU memory"),
+                                  ViewUtil::byteSize (mesh.bufferSize ())});
     };
 
     const auto showSketch = [this](const SketchMesh& sketch) {
@@ -50,9 +56,30 @@ struct ViewInfoPaneScene::Impl
       }
     };
 
+    const auto showHistory = [this](const History& history) {
+      QTreeWidgetItem* item = new QTreeWidgetItem (this->tree, {QObject::tr ("History")});
+
+      new QTreeWidgetItem (item,
+                           {QObject::tr ("Memory"), ViewUtil::byteSize (history.memorySize ())});
+      new QTreeWidgetItem (item, {QObject::tr ("Disk"), ViewUtil::byteSize (history.diskSize ())});
+    };
+
+    const auto showRendering = [this](const Renderer& renderer) {
+      QTreeWidgetItem* item = new QTreeWidgetItem (this->tree, {QObject::tr ("Last frame")});
+
+      new QTreeWidgetItem (item, {QObject::tr ("Draw calls"),
+                                  QString::number (renderer.numDrawCalls ())});
+      new QTreeWidgetItem (item, {QObject::tr ("State changes"),
+                                  QString::number (renderer.numStateChanges ())});
+      new QTreeWidgetItem (item, {QObject::tr ("Skipped state changes"),
+                                  QString::number (renderer.numSkippedStateChanges ())});
+    };
+
     this->tree->clear ();
     this->glWidget.state ().scene ().forEachConstMesh (showMesh);
     this->glWidget.state ().scene ().forEachConstMesh (showSketch);
+    showHistory (this->glWidget.state ().history ());
+    showRendering (this->glWidget.state ().camera ().renderer ());
     this->tree->expandAll ();
     this->tree->setItemsExpandable (false);
 
@@ -55,13 +55,20 @@ namespace
 
   QString filterDlyFiles () { return QObject::tr ("Dilay files (*.dly)"); }
 
+  QString filterDlbFiles () { return QObject::tr ("Binary Dilay files (*.dlb)"); }
+
   QString filterObjFiles () { return QObject::tr ("Wavefront files (*.obj)"); }
 
+  QString filterMeshFiles () { return QObject::tr ("STL and PLY files (*.stl *.ply)"); }
+
   QString fileDialogFilters ()
   {
-    return filterAllFiles () + ";;" + filterDlyFiles () + ";;" + filterObjFiles ();
+    return filterAllFiles () + ";;" + filterDlyFiles () + ";;" + filterDlbFiles () + ";;" +
+           filterObjFiles ();
   }
 
+  QString openFileDialogFilters () { return fileDialogFilters () + ";;" + filterMeshFiles (); }
+
   QString selectedFilter (const Scene& scene)
   {
     if (scene.hasFileName ())
@@ -70,6 +77,10 @@ namespace
       {
         return filterDlyFiles ();
       }
+      else if (Util::hasSuffix (scene.fileName (), ".dlb"))
+      {
+        return filterDlbFiles ();
+      }
       else if (Util::hasSuffix (scene.fileName (), ".obj"))
       {
         return filterObjFiles ();
@@ -92,7 +103,8 @@ void ViewMenuBar::setup (ViewMainWindow& mainWindow, ViewGlWidget& glWidget)
     QString           filter = filterAllFiles ();
     const std::string fileName =
       QFileDialog::getOpenFileName (&mainWindow, QObject::tr ("Open"), getFileDialogPath (scene),
-                                    fileDialogFilters (), &filter, QFileDialog::DontUseNativeDialog)
+                                    openFileDialogFilters (), &filter,
+                                    QFileDialog::DontUseNativeDialog)
         .toStdString ();
     if (fileName.empty () == false)
     {
@@ -121,26 +133,34 @@ void ViewMenuBar::setup (ViewMainWindow& mainWindow, ViewGlWidget& glWidget)
 
   QAction& saveAsAction = addAction (
     fileMenu, QObject::tr ("Save &as..."), QKeySequence::SaveAs, [&mainWindow, &glWidget]() {
-      Scene&            scene = glWidget.state ().scene ();
-      QString           filter = selectedFilter (scene);
-      const std::string fileName =
+      Scene&      scene = glWidget.state ().scene ();
+      QString     filter = selectedFilter (scene);
+      std::string fileName =
         QFileDialog::getSaveFileName (&mainWindow, QObject::tr ("Save as"),
                                       getFileDialogPath (scene), fileDialogFilters (), &filter,
                                       QFileDialog::DontUseNativeDialog)
           .toStdString ();
       if (fileName.empty () == false)
       {
-        const bool saveAsObj = Util::hasSuffix (fileName, ".obj") || filter == filterObjFiles ();
-
-        if (scene.toDlyFile (fileName, saveAsObj) == false)
+        // The binary format is chosen by suffix, cf. `ImportExport::toDlyFile`
+        if (filter == filterDlbFiles () && Util::hasSuffix (fileName, ".dlb") == false)
         {
-          ViewUtil::error (mainWindow, QObject::tr ("Could not save to file."));
-        }
-        else if (saveAsObj && scene.numSketchMeshes () > 0)
-        {
-          ViewUtil::info (mainWindow,
-                          QObject::tr ("Sketches are omitted when saving Wavefront files."));
+          fileName += ".dlb";
         }
+        const bool saveAsObj = Util::hasSuffix (fileName, ".obj") || filter == filterObjFiles ();
+        const bool omitsSketches = saveAsObj && scene.numSketchMeshes () > 0;
+
+        scene.toDlyFile (fileName, saveAsObj, [&mainWindow, omitsSketches](bool success) {
+          if (success == false)
+          {
+            ViewUtil::error (mainWindow, QObject::tr ("Could not save to file."));
+          }
+          else if (omitsSketches)
+          {
+            ViewUtil::info (mainWindow,
+                            QObject::tr ("Sketches are omitted when saving Wavefront files."));
+          }
+        });
       }
     });
 
@@ -151,10 +171,12 @@ void ViewMenuBar::setup (ViewMainWindow& mainWindow, ViewGlWidget& glWidget)
                {
                  const bool saveAsObj = Util::hasSuffix (scene.fileName (), ".obj");
 
-                 if (scene.toDlyFile (saveAsObj) == false)
-                 {
-                   ViewUtil::error (mainWindow, QObject::tr ("Could not save to file."));
-                 }
+                 scene.toDlyFile (saveAsObj, [&mainWindow](bool success) {
+                   if (success == false)
+                   {
+                     ViewUtil::error (mainWindow, QObject::tr ("Could not save to file."));
+                   }
+                 });
                }
                else
                {
@@ -182,6 +182,22 @@ QPoint ViewUtil::toQPoint (const glm::uvec2& p) { return QPoint (int(p.x), int(p
 
 QPoint ViewUtil::toQPoint (const glm::ivec2& p) { return QPoint (p.x, p.y); }
 
+QString ViewUtil::byteSize (unsigned long long bytes)
+{
+  if (bytes < 1024)
+  {
+    return QString::number (bytes) + " B";
+  }
+  else if (bytes < 1024 * 1024)
+  {
+    return QString::number (double(bytes) / 1024.0, 'f', 1) + " KiB";
+  }
+  else
+  {
+    return QString::number (double(bytes) / (1024.0 * 1024.0), 'f', 1) + " MiB";
+  }
+}
+
 void ViewUtil::connect (const QSpinBox& s, const std::function<void(int)>& f)
 {
   void (QSpinBox::*ptr) (int) = &QSpinBox::valueChanged;
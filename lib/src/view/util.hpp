@@ -50,6 +50,7 @@ namespace ViewUtil
   glm::ivec2            toIVec2 (const QPoint&);
   QPoint                toQPoint (const glm::uvec2&);
   QPoint                toQPoint (const glm::ivec2&);
+  QString               byteSize (unsigned long long);
   void                  connect (const QSpinBox&, const std::function<void(int)>&);
   void                  connect (const QDoubleSpinBox&, const std::function<void(double)>&);
   void                  connect (const QPushButton&, const std::function<void()>&);
@@ -2,19 +2,39 @@
  * Copyright © 2015-2018 Alexander Bau
  * Use and redistribute under the terms of the GNU General Public License
  */
-#include <QCoreApplication>
+#include <QGuiApplication>
 #include <iostream>
+#include "test-autosave.hpp"
 #include "test-bitset.hpp"
 #include "test-distance.hpp"
+#include "test-distance-tree.hpp"
+#include "test-dlb.hpp"
+#include "test-dynamic-mesh.hpp"
+#include "test-dynamic-stitch.hpp"
+#include "test-export-job.hpp"
+#include "test-history.hpp"
+#include "test-import-export.hpp"
 #include "test-intersection.hpp"
+#include "test-isosurface-extraction.hpp"
 #include "test-maybe.hpp"
 #include "test-misc.hpp"
 #include "test-octree.hpp"
+#include "test-opengl.hpp"
+#include "test-ply.hpp"
 #include "test-prune.hpp"
+#include "test-stl.hpp"
+#include "test-task-pool.hpp"
 #include "test-tree.hpp"
+#include "test-varint.hpp"
 
-int main ()
+int main (int argc, char* argv[])
 {
+  // `TestOpenGL` only renders into offscreen surfaces, i.e. the tests need no window system
+  if (qEnvironmentVariableIsEmpty ("QT_QPA_PLATFORM"))
+  {
+    qputenv ("QT_QPA_PLATFORM", "offscreen");
+  }
+  QGuiApplication app (argc, argv);
   QCoreApplication::setApplicationName ("dilay");
 
   TestIntersection::test1 ();
@@ -30,6 +50,27 @@ int main ()
   TestMisc::test ();
   TestDistance::test ();
   TestPrune::test ();
+  TestDlb::test ();
+  TestStl::test ();
+  TestPly::test ();
+  TestVarint::test ();
+  TestDynamicMesh::test1 ();
+  TestDynamicMesh::test2 ();
+  TestDynamicStitch::test1 ();
+  TestDynamicStitch::test2 ();
+  TestImportExport::test1 ();
+  TestImportExport::test2 ();
+  TestDistanceTree::test ();
+  TestTaskPool::test ();
+  TestIsosurfaceExtraction::test1 ();
+  TestIsosurfaceExtraction::test2 ();
+  TestIsosurfaceExtraction::test3 ();
+  TestIsosurfaceExtraction::test4 ();
+  TestHistory::test1 ();
+  TestHistory::test2 ();
+  TestExportJob::test ();
+  TestAutosave::test ();
+  TestOpenGL::test ();
 
   std::cout << "all tests ran successfully\n";
   return 0;
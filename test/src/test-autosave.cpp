@@ -0,0 +1,260 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QDir>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QStandardPaths>
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <functional>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+#include "autosave.hpp"
+#include "config.hpp"
+#include "dynamic/mesh.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "opengl.hpp"
+#include "scene.hpp"
+#include "sketch/mesh.hpp"
+#include "test-autosave.hpp"
+#include "util.hpp"
+
+namespace
+{
+  typedef std::map<std::string, std::string> Files;
+
+  // Scenes buffer the data of their meshes, i.e. the test needs an OpenGL context, cf.
+  // `TestHistory`
+  void withContext (const char* name, const std::function<void()>& test)
+  {
+    OpenGL::setDefaultFormat (false);
+
+    QOffscreenSurface surface;
+    surface.create ();
+
+    QOpenGLContext context;
+    context.setFormat (QSurfaceFormat::defaultFormat ());
+
+    if (context.create () == false || context.makeCurrent (&surface) == false)
+    {
+      std::cout << "skipping " << name << ": no OpenGL context available\n";
+      return;
+    }
+    OpenGL::initializeFunctions (false);
+    test ();
+    context.doneCurrent ();
+  }
+
+  DynamicMesh makeMesh (const glm::vec3& center)
+  {
+    const Mesh  mesh = MeshUtil::icosphere (1);
+    DynamicMesh dynamicMesh;
+
+    for (unsigned int i = 0; i < mesh.numVertices (); i++)
+    {
+      dynamicMesh.addVertex (center + mesh.vertex (i), mesh.normal (i));
+    }
+    for (unsigned int i = 0; i < mesh.numIndices (); i += 3)
+    {
+      dynamicMesh.addFace (mesh.index (i + 0), mesh.index (i + 1), mesh.index (i + 2));
+    }
+    return dynamicMesh;
+  }
+
+  std::string filePath (const std::string& directory, const std::string& fileName)
+  {
+    return QDir (QString::fromStdString (directory))
+      .filePath (QString::fromStdString (fileName))
+      .toStdString ();
+  }
+
+  std::string readFile (const std::string& filePath)
+  {
+    std::ifstream file (filePath, std::ios::binary);
+    return std::string ((std::istreambuf_iterator<char> (file)), std::istreambuf_iterator<char> ());
+  }
+
+  void writeFile (const std::string& filePath, const std::string& bytes)
+  {
+    std::ofstream file (filePath, std::ios::binary);
+    file.write (bytes.data (), bytes.size ());
+  }
+
+  // Files that are found on startup are written while no `Autosave` exists, since the directory
+  // is removed when `Autosave` is destroyed
+  void writeFiles (const std::string& directory, const Files& files)
+  {
+    QDir (QString::fromStdString (directory)).mkpath (".");
+
+    for (const auto& f : files)
+    {
+      writeFile (filePath (directory, f.first), f.second);
+    }
+  }
+
+  // all files in the directory of an autosave except the manifest
+  Files readFiles (const std::string& directory)
+  {
+    const QDir dir (QString::fromStdString (directory));
+    Files      files;
+
+    for (const QString& name : dir.entryList (QDir::Files | QDir::NoDotAndDotDot))
+    {
+      if (name.toStdString () != "manifest")
+      {
+        files[name.toStdString ()] = readFile (filePath (directory, name.toStdString ()));
+      }
+    }
+    return files;
+  }
+
+  std::vector<std::string> readManifest (const std::string& directory)
+  {
+    std::ifstream            file (filePath (directory, "manifest"));
+    std::vector<std::string> fileNames;
+    std::string              fileName;
+
+    while (std::getline (file, fileName))
+    {
+      fileNames.push_back (fileName);
+    }
+    return fileNames;
+  }
+
+  // The files of an autosave are exactly the files of its manifest
+  std::vector<std::string> assertManifest (const Autosave& autosave, unsigned int numFiles)
+  {
+    const std::vector<std::string> fileNames = readManifest (autosave.directory ());
+    const Files                    files = readFiles (autosave.directory ());
+
+    assert (fileNames.size () == numFiles);
+    assert (files.size () == numFiles);
+
+    for (const std::string& n : fileNames)
+    {
+      assert (files.count (n) == 1);
+      unused (n);
+    }
+    unused (numFiles);
+    unused (files);
+    return fileNames;
+  }
+}
+
+void TestAutosave::test ()
+{
+  // files are written to a test location instead of the user's data directory
+  QStandardPaths::setTestModeEnabled (true);
+
+  withContext ("TestAutosave::test", []() {
+    Config config;
+    config.set ("editor/autosave-interval", 0);
+
+    Scene        scene (config);
+    DynamicMesh& mesh1 = scene.newDynamicMesh (config, makeMesh (glm::vec3 (0.0f)));
+    scene.newDynamicMesh (config, makeMesh (glm::vec3 (3.0f, 0.0f, 0.0f)));
+
+    SketchTree tree;
+    tree.emplaceRoot (PrimSphere (glm::vec3 (0.0f, 3.0f, 0.0f), 1.0f));
+    scene.newSketchMesh (config, tree);
+
+    const glm::vec3 vertex (0.0f, -2.0f, 0.0f);
+    std::string     directory;
+    std::string     meshBytes;
+    Files           crashedFiles;
+
+    // files of an aborted run of the test are removed when `Autosave` is destroyed
+    {
+      const Autosave autosave (scene, config);
+    }
+    {
+      Autosave autosave (scene, config);
+      assert (autosave.canRecover () == false);
+
+      directory = autosave.directory ();
+      autosave.autosave ();
+      autosave.wait ();
+
+      const std::vector<std::string> fileNames1 = assertManifest (autosave, 3);
+
+      // Only the changed mesh is written, i.e. the file of the unchanged mesh keeps a marker that
+      // would be overwritten otherwise. Files that are not listed by the manifest are removed.
+      const std::string unchangedFilePath = filePath (directory, fileNames1[1]);
+      const std::string unchangedBytes = readFile (unchangedFilePath);
+
+      writeFile (unchangedFilePath, "unchanged");
+      writeFile (filePath (directory, "mesh-stale.dlb"), unchangedBytes);
+      mesh1.vertex (0, vertex);
+
+      autosave.autosave ();
+      autosave.wait ();
+
+      const std::vector<std::string> fileNames2 = assertManifest (autosave, 3);
+      const bool                     isUnchanged = readFile (unchangedFilePath) == "unchanged";
+
+      assert (fileNames2[0] != fileNames1[0]);
+      assert (fileNames2[1] == fileNames1[1]);
+      assert (fileNames2[2] == fileNames1[2]);
+      assert (isUnchanged);
+      unused (isUnchanged);
+
+      writeFile (unchangedFilePath, unchangedBytes);
+      meshBytes = unchangedBytes;
+      crashedFiles = readFiles (directory);
+      crashedFiles["manifest"] = readFile (filePath (directory, "manifest"));
+    }
+
+    // An incomplete autosave leaves files that are not listed by a manifest
+    const Files incompleteFiles = {{"mesh-incomplete.dlb", meshBytes}};
+
+    writeFiles (directory, incompleteFiles);
+    {
+      const Autosave autosave (scene, config);
+      assert (autosave.canRecover () == false);
+    }
+
+    crashedFiles.insert (incompleteFiles.begin (), incompleteFiles.end ());
+    writeFiles (directory, crashedFiles);
+    {
+      Scene    recovered (config);
+      Autosave autosave (recovered, config);
+      assert (autosave.canRecover ());
+
+      const bool success = autosave.recover (config, recovered);
+      assert (success);
+      assert (autosave.canRecover () == false);
+      assert (recovered.numDynamicMeshes () == 2);
+      assert (recovered.numSketchMeshes () == 1);
+      unused (success);
+
+      unsigned int numMeshes = 0;
+      recovered.forEachConstMesh ([&vertex, &numMeshes](const DynamicMesh& m) {
+        assert ((m.vertex (0) == vertex) == (numMeshes == 0));
+        numMeshes++;
+      });
+      unused (vertex);
+
+      // The next autosave removes the recovered files. Only the sketches keep their file name
+      // since it depends on their encoding.
+      autosave.autosave ();
+      autosave.wait ();
+
+      const std::vector<std::string> fileNames = assertManifest (autosave, 3);
+      const long                     numRecoveredFiles =
+        std::count_if (fileNames.begin (), fileNames.end (), [&crashedFiles](const std::string& n) {
+          return crashedFiles.count (n) > 0;
+        });
+
+      assert (numRecoveredFiles == 1);
+      unused (numRecoveredFiles);
+    }
+  });
+}
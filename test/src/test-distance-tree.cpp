@@ -0,0 +1,121 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cassert>
+#include <glm/glm.hpp>
+#include <random>
+#include <vector>
+#include "distance.hpp"
+#include "primitive/cone-sphere.hpp"
+#include "sketch/distance-tree.hpp"
+#include "sketch/path.hpp"
+#include "test-distance-tree.hpp"
+#include "util.hpp"
+
+namespace
+{
+  // Node spheres other than the root are part of the cone spheres of their bones
+  float bruteForceDistance (const SketchTree& tree, const SketchPaths& paths, const glm::vec3& p)
+  {
+    float d = Util::maxFloat ();
+
+    tree.root ().forEachConstNode ([&d, &p](const SketchNode& node) {
+      if (node.parent ())
+      {
+        const PrimConeSphere coneSphere (node.data (), node.parent ()->data ());
+        d = glm::min (d, Distance::distance (coneSphere, p));
+      }
+      else
+      {
+        d = glm::min (d, Distance::distance (node.data (), p));
+      }
+    });
+    for (const SketchPath& path : paths)
+    {
+      for (const PrimSphere& s : path.spheres ())
+      {
+        d = glm::min (d, Distance::distance (s, p));
+      }
+    }
+    return d;
+  }
+}
+
+void TestDistanceTree::test ()
+{
+  std::default_random_engine            gen;
+  std::uniform_real_distribution<float> offsetDist (-1.0f, 1.0f);
+  std::uniform_real_distribution<float> radiusDist (0.05f, 0.5f);
+  std::uniform_real_distribution<float> positionDist (-8.0f, 8.0f);
+
+  const auto randomVec3 = [&gen](std::uniform_real_distribution<float>& dist) {
+    return glm::vec3 (dist (gen), dist (gen), dist (gen));
+  };
+
+  assert (SketchDistanceTree (SketchTree (), SketchPaths ()).isEmpty ());
+
+  SketchTree               tree;
+  std::vector<SketchNode*> nodes;
+
+  nodes.push_back (&tree.emplaceRoot (PrimSphere (glm::vec3 (0.0f), 1.0f)));
+  for (unsigned int i = 1; i < 200; i++)
+  {
+    SketchNode&      parent = *nodes[std::uniform_int_distribution<unsigned int> (0, i - 1) (gen)];
+    const glm::vec3  center = parent.data ().center () + randomVec3 (offsetDist);
+    const PrimSphere sphere (center, radiusDist (gen));
+
+    nodes.push_back (&parent.emplaceChild (sphere));
+  }
+
+  SketchPaths paths (2);
+  for (SketchPath& path : paths)
+  {
+    glm::vec3 center = randomVec3 (positionDist);
+    for (unsigned int i = 0; i < 20; i++)
+    {
+      center += 0.25f * randomVec3 (offsetDist);
+      path.addSphere (center, center, radiusDist (gen));
+    }
+  }
+
+  std::vector<glm::vec3> positions;
+  for (const SketchNode* node : nodes)
+  {
+    const PrimSphere& s = node->data ();
+    const glm::vec3   direction = glm::normalize (randomVec3 (offsetDist));
+
+    positions.push_back (s.center ());
+    positions.push_back (s.center () + (0.5f * s.radius () * direction));
+    positions.push_back (s.center () + (s.radius () * direction));
+  }
+  for (const SketchPath& path : paths)
+  {
+    for (const PrimSphere& s : path.spheres ())
+    {
+      positions.push_back (s.center ());
+      positions.push_back (s.center () + glm::vec3 (s.radius (), 0.0f, 0.0f));
+    }
+  }
+  for (unsigned int i = 0; i < 2000; i++)
+  {
+    positions.push_back (randomVec3 (positionDist));
+  }
+  positions.push_back (glm::vec3 (100.0f, -200.0f, 300.0f));
+
+  const SketchDistanceTree distanceTree (tree, paths);
+  std::vector<float>       distances;
+
+  assert (distanceTree.isEmpty () == false);
+  distanceTree.distances (positions, distances);
+  assert (distances.size () == positions.size ());
+
+  for (unsigned int i = 0; i < positions.size (); i++)
+  {
+    const float expected = bruteForceDistance (tree, paths, positions[i]);
+
+    assert (distances[i] == expected);
+    assert (distanceTree.distance (positions[i]) == expected);
+    unused (expected);
+  }
+}
@@ -0,0 +1,125 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cassert>
+#include <glm/glm.hpp>
+#include <sstream>
+#include <vector>
+#include "dlb.hpp"
+#include "mesh.hpp"
+#include "sketch/path.hpp"
+#include "test-dlb.hpp"
+#include "util.hpp"
+
+namespace
+{
+  bool equalSpheres (const PrimSphere& a, const PrimSphere& b)
+  {
+    return a.center () == b.center () && a.radius () == b.radius ();
+  }
+
+  bool equalTrees (const SketchTree& a, const SketchTree& b)
+  {
+    std::vector<const SketchNode*> nodesA, nodesB;
+
+    a.root ().forEachConstNode ([&nodesA](const SketchNode& n) { nodesA.push_back (&n); });
+    b.root ().forEachConstNode ([&nodesB](const SketchNode& n) { nodesB.push_back (&n); });
+
+    if (nodesA.size () != nodesB.size ())
+    {
+      return false;
+    }
+    for (unsigned int i = 0; i < nodesA.size (); i++)
+    {
+      if (equalSpheres (nodesA[i]->data (), nodesB[i]->data ()) == false ||
+          nodesA[i]->numChildren () != nodesB[i]->numChildren ())
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+void TestDlb::test ()
+{
+  Mesh mesh;
+  mesh.addVertex (glm::vec3 (0.0f, 0.0f, 0.0f), glm::vec3 (0.0f, 0.0f, 1.0f));
+  mesh.addVertex (glm::vec3 (1.0f, -0.1f, 1.0e-7f), glm::vec3 (0.0f, 1.0f, 0.0f));
+  mesh.addVertex (glm::vec3 (-3.0e8f, 0.3f, 1.0f / 3.0f), glm::vec3 (1.0f, 0.0f, 0.0f));
+  mesh.addIndex (0);
+  mesh.addIndex (1);
+  mesh.addIndex (2);
+  mesh.addIndex (2);
+  mesh.addIndex (1);
+  mesh.addIndex (0);
+
+  SketchTree  tree;
+  SketchNode& root = tree.emplaceRoot (PrimSphere (glm::vec3 (0.0f), 1.0f));
+  root.emplaceChild (PrimSphere (glm::vec3 (1.0f, 2.0f, 3.0f), 0.5f))
+    .emplaceChild (PrimSphere (glm::vec3 (0.1f, 0.2f, 0.3f), 0.25f));
+  root.emplaceChild (PrimSphere (glm::vec3 (-1.0f), 0.75f));
+
+  SketchPaths paths (2);
+  paths[0].addSphere (glm::vec3 (0.1f), glm::vec3 (0.0f), 0.25f);
+  paths[0].addSphere (glm::vec3 (0.7f), glm::vec3 (1.0f), 0.125f);
+  paths[1].addSphere (glm::vec3 (-0.2f), glm::vec3 (2.0f), 0.5f);
+
+  std::ostringstream stream;
+  Dlb::writeHeader (stream);
+  Dlb::writeMesh (stream, mesh);
+  Dlb::writeSketch (stream, tree, paths);
+
+  const std::string    bytes = stream.str ();
+  const unsigned char* data = reinterpret_cast<const unsigned char*> (bytes.data ());
+
+  assert (Dlb::isDlb (data, bytes.size ()));
+
+  unsigned int numMeshes = 0;
+  unsigned int numSketches = 0;
+
+  const bool success = Dlb::read (
+    data, bytes.size (),
+    [&mesh, &numMeshes](Mesh&& m) {
+      assert (m.numVertices () == mesh.numVertices ());
+      assert (m.numIndices () == mesh.numIndices ());
+
+      for (unsigned int i = 0; i < m.numVertices (); i++)
+      {
+        assert (m.vertex (i) == mesh.vertex (i));
+        assert (m.normal (i) == mesh.normal (i));
+      }
+      for (unsigned int i = 0; i < m.numIndices (); i++)
+      {
+        assert (m.index (i) == mesh.index (i));
+      }
+      numMeshes++;
+    },
+    [&tree, &paths, &numSketches](const SketchTree& t, const SketchPaths& ps) {
+      assert (equalTrees (t, tree));
+      assert (ps.size () == paths.size ());
+
+      for (unsigned int i = 0; i < ps.size (); i++)
+      {
+        assert (ps[i].intersectionFirst () == paths[i].intersectionFirst ());
+        assert (ps[i].intersectionLast () == paths[i].intersectionLast ());
+        assert (ps[i].spheres ().size () == paths[i].spheres ().size ());
+
+        for (unsigned int j = 0; j < ps[i].spheres ().size (); j++)
+        {
+          assert (equalSpheres (ps[i].spheres ()[j], paths[i].spheres ()[j]));
+        }
+      }
+      numSketches++;
+    });
+
+  assert (success);
+  assert (numMeshes == 1);
+  assert (numSketches == 1);
+
+  // Truncated data is rejected
+  assert (Dlb::read (data, bytes.size () - 1, [](Mesh&&) {},
+                     [](const SketchTree&, const SketchPaths&) {}) == false);
+  unused (success);
+}
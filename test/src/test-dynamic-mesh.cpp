@@ -0,0 +1,168 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <cassert>
+#include <glm/glm.hpp>
+#include <vector>
+#include "dynamic/mesh.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "test-dynamic-mesh.hpp"
+#include "util.hpp"
+
+namespace
+{
+  // Meshes are built element by element since `DynamicMesh (const Mesh&)` buffers its data
+  DynamicMesh makeMesh ()
+  {
+    const Mesh  mesh = MeshUtil::icosphere (2);
+    DynamicMesh dynamicMesh;
+
+    for (unsigned int i = 0; i < mesh.numVertices (); i++)
+    {
+      dynamicMesh.addVertex (mesh.vertex (i), mesh.normal (i));
+    }
+    for (unsigned int i = 0; i < mesh.numIndices (); i += 3)
+    {
+      dynamicMesh.addFace (mesh.index (i + 0), mesh.index (i + 1), mesh.index (i + 2));
+    }
+    return dynamicMesh;
+  }
+
+  std::vector<unsigned int> sorted (std::vector<unsigned int> indices)
+  {
+    std::sort (indices.begin (), indices.end ());
+    return indices;
+  }
+
+  // Normals are not compared since they are recomputed when decoding
+  void assertEqual (const DynamicMesh& a, const DynamicMesh& b)
+  {
+    assert (a.mesh ().numVertices () == b.mesh ().numVertices ());
+    assert (a.mesh ().numIndices () == b.mesh ().numIndices ());
+    assert (a.numVertices () == b.numVertices ());
+    assert (a.numFaces () == b.numFaces ());
+    assert (a.freeVertexIndices () == b.freeVertexIndices ());
+    assert (a.freeFaceIndices () == b.freeFaceIndices ());
+
+    for (unsigned int i = 0; i < a.mesh ().numVertices (); i++)
+    {
+      assert (a.isFreeVertex (i) == b.isFreeVertex (i));
+
+      if (a.isFreeVertex (i) == false)
+      {
+        assert (a.vertex (i) == b.vertex (i));
+        assert (sorted (a.adjacentFaces (i)) == sorted (b.adjacentFaces (i)));
+      }
+    }
+    for (unsigned int i = 0; i < a.mesh ().numIndices () / 3; i++)
+    {
+      assert (a.isFreeFace (i) == b.isFreeFace (i));
+
+      if (a.isFreeFace (i) == false)
+      {
+        unsigned int a1, a2, a3, b1, b2, b3;
+        a.vertexIndices (i, a1, a2, a3);
+        b.vertexIndices (i, b1, b2, b3);
+
+        assert (a1 == b1 && a2 == b2 && a3 == b3);
+      }
+    }
+  }
+
+  void assertEqualNormals (const DynamicMesh& a, const DynamicMesh& b)
+  {
+    for (unsigned int i = 0; i < a.mesh ().numVertices (); i++)
+    {
+      if (a.isFreeVertex (i) == false)
+      {
+        assert (a.vertexNormal (i) == b.vertexNormal (i));
+      }
+    }
+  }
+
+  void assertRoundTrip (const DynamicMesh& mesh)
+  {
+    std::vector<unsigned char> bytes;
+    mesh.toBytes (bytes);
+
+    DynamicMesh decoded;
+    const bool  success = decoded.fromBytes (bytes);
+    assert (success);
+    assertEqual (mesh, decoded);
+    assert (decoded.revision () == mesh.revision ());
+
+    bytes.pop_back ();
+    const bool successTruncated = decoded.fromBytes (bytes);
+    assert (successTruncated == false);
+    assert (decoded.isEmpty ());
+    unused (success);
+    unused (successTruncated);
+  }
+}
+
+void TestDynamicMesh::test1 ()
+{
+  DynamicMesh pruned = makeMesh ();
+  assert (pruned.checkConsistency ());
+  pruned.vertex (3, glm::vec3 (-0.0f, 1.0e-30f, -3.0e8f));
+  assertRoundTrip (pruned);
+
+  DynamicMesh unpruned = makeMesh ();
+  unpruned.deleteFace (7);
+  unpruned.deleteVertex (11);
+  unpruned.deleteFace (2);
+  assert (unpruned.freeVertexIndices ().empty () == false);
+  assert (unpruned.freeFaceIndices ().size () > 2);
+  assert (unpruned.checkConsistency () == false);
+  assertRoundTrip (unpruned);
+}
+
+void TestDynamicMesh::test2 ()
+{
+  DynamicMesh mesh = makeMesh ();
+  mesh.deleteFace (30);
+  mesh.deleteVertex (11);
+
+  const DynamicMesh original (mesh);
+  DynamicMeshDelta  delta;
+
+  mesh.record (delta);
+
+  mesh.vertex (0, mesh.vertex (0) + glm::vec3 (0.1f, 0.2f, 0.3f));
+  mesh.vertex (1, glm::vec3 (1.0f, 2.0f, 3.0f));
+  mesh.vertexNormal (1, glm::vec3 (0.0f, 1.0f, 0.0f));
+  mesh.deleteFace (mesh.adjacentFaces (5).front ());
+
+  // reuses the free vertex and all free faces before faces are appended
+  const unsigned int numFreeFaces = mesh.freeFaceIndices ().size ();
+  const unsigned int v = mesh.addVertex (glm::vec3 (2.0f), glm::vec3 (1.0f, 0.0f, 0.0f));
+  assert (v == 11);
+
+  for (unsigned int i = 0; i <= numFreeFaces; i++)
+  {
+    mesh.addFace (v, i + 20, i + 21);
+  }
+  assert (mesh.freeVertexIndices ().empty ());
+  assert (mesh.freeFaceIndices ().empty ());
+  assert (mesh.mesh ().numIndices () == original.mesh ().numIndices () + 3);
+
+  mesh.stopRecording ();
+  assert (delta.isEmpty () == false);
+
+  const DynamicMesh edited (mesh);
+
+  mesh.applyDelta (delta);
+  assertEqual (mesh, original);
+  assertEqualNormals (mesh, original);
+  assert (mesh.freeVertexIndices ().size () == 1);
+  assert (mesh.freeFaceIndices ().size () == numFreeFaces - 1);
+
+  mesh.applyDelta (delta);
+  assertEqual (mesh, edited);
+  assertEqualNormals (mesh, edited);
+  assert (mesh.freeVertexIndices ().empty ());
+  assert (mesh.freeFaceIndices ().empty ());
+}
@@ -0,0 +1,184 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cassert>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <vector>
+#include "dynamic/mesh.hpp"
+#include "dynamic/stitch.hpp"
+#include "test-dynamic-stitch.hpp"
+#include "util.hpp"
+
+namespace
+{
+  typedef DynamicStitch::Loop Loop;
+
+  // Adds an annulus with `n` segments in the plane z = 0. Its faces face +z unless they are
+  // flipped. An inner radius of zero yields a disc. Returns the indices of the added faces.
+  std::vector<unsigned int> addAnnulus (DynamicMesh& mesh, const glm::vec3& center,
+                                        float innerRadius, float outerRadius, unsigned int n,
+                                        bool flip = false)
+  {
+    const glm::vec3           normal (0.0f, 0.0f, flip ? -1.0f : 1.0f);
+    std::vector<unsigned int> inner;
+    std::vector<unsigned int> outer;
+    std::vector<unsigned int> faces;
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+      const float     angle = 2.0f * glm::pi<float> () * float(i) / float(n);
+      const glm::vec3 direction (glm::cos (angle), glm::sin (angle), 0.0f);
+
+      outer.push_back (mesh.addVertex (center + (outerRadius * direction), normal));
+      if (innerRadius > 0.0f)
+      {
+        inner.push_back (mesh.addVertex (center + (innerRadius * direction), normal));
+      }
+    }
+    if (inner.empty ())
+    {
+      inner.push_back (mesh.addVertex (center, normal));
+    }
+
+    const auto addFace = [&mesh, &faces, flip](unsigned int i1, unsigned int i2,
+                                               unsigned int i3) {
+      faces.push_back (flip ? mesh.addFace (i1, i3, i2) : mesh.addFace (i1, i2, i3));
+    };
+
+    for (unsigned int i = 0; i < n; i++)
+    {
+      const unsigned int j = (i + 1) % n;
+
+      if (innerRadius > 0.0f)
+      {
+        addFace (inner[i], outer[i], outer[j]);
+        addFace (inner[i], outer[j], inner[j]);
+      }
+      else
+      {
+        addFace (inner[0], outer[i], outer[j]);
+      }
+    }
+    return faces;
+  }
+
+  std::vector<Loop> boundaryLoops (const DynamicMesh& mesh, const std::vector<unsigned int>& faces)
+  {
+    std::vector<Loop> loops;
+    const bool        success = DynamicStitch::boundaryLoops (mesh, faces, loops);
+    assert (success);
+    unused (success);
+    return loops;
+  }
+
+  std::vector<unsigned int> concat (std::vector<unsigned int> a, const std::vector<unsigned int>& b)
+  {
+    a.insert (a.end (), b.begin (), b.end ());
+    return a;
+  }
+}
+
+// Two disjoint loops are paired with the loops of a patch that are listed in reverse order
+void TestDynamicStitch::test1 ()
+{
+  const glm::vec3 left (-2.0f, 0.0f, 0.0f);
+  const glm::vec3 right (2.0f, 0.0f, 0.0f);
+
+  DynamicMesh               hole;
+  std::vector<unsigned int> holeFaces = addAnnulus (hole, left, 0.0f, 1.0f, 16);
+  holeFaces = concat (holeFaces, addAnnulus (hole, right, 0.0f, 1.0f, 16));
+
+  DynamicMesh               patch;
+  std::vector<unsigned int> patchFaces = addAnnulus (patch, right, 0.0f, 0.9f, 12);
+  patchFaces = concat (patchFaces, addAnnulus (patch, left, 0.0f, 0.9f, 12));
+
+  const std::vector<Loop> holeLoops = boundaryLoops (hole, holeFaces);
+  const std::vector<Loop> patchLoops = boundaryLoops (patch, patchFaces);
+  assert (holeLoops.size () == 2 && holeLoops[0].size () == 16);
+  assert (patchLoops.size () == 2 && patchLoops[0].size () == 12);
+
+  std::vector<unsigned int> pairs;
+
+  const bool success = DynamicStitch::pairLoops (hole, holeLoops, patch, patchLoops, pairs);
+  assert (success);
+  assert (pairs.size () == 2);
+  unused (success);
+
+  for (unsigned int i = 0; i < 2; i++)
+  {
+    const float holeX = hole.vertex (holeLoops[i][0]).x;
+    const float patchX = patch.vertex (patchLoops[pairs[i]][0]).x;
+    assert ((holeX < 0.0f) == (patchX < 0.0f));
+    unused (holeX);
+    unused (patchX);
+  }
+
+  // loops of a patch that is oriented oppositely are not paired
+  DynamicMesh               flipped;
+  std::vector<unsigned int> flippedFaces = addAnnulus (flipped, right, 0.0f, 0.9f, 12);
+  flippedFaces = concat (flippedFaces, addAnnulus (flipped, left, 0.0f, 0.9f, 12, true));
+
+  pairs.clear ();
+  const std::vector<Loop> flippedLoops = boundaryLoops (flipped, flippedFaces);
+  const bool              isFlippedPaired =
+    DynamicStitch::pairLoops (hole, holeLoops, flipped, flippedLoops, pairs);
+  assert (isFlippedPaired == false);
+  unused (isFlippedPaired);
+
+  // loops are not paired if their numbers differ
+  DynamicMesh                     single;
+  const std::vector<unsigned int> singleFaces = addAnnulus (single, left, 0.0f, 0.9f, 12);
+
+  pairs.clear ();
+  const std::vector<Loop> singleLoops = boundaryLoops (single, singleFaces);
+  const bool              isSinglePaired =
+    DynamicStitch::pairLoops (hole, holeLoops, single, singleLoops, pairs);
+  assert (isSinglePaired == false);
+  unused (isSinglePaired);
+}
+
+// Nested loops share their centroids, i.e. they are paired by the distances of their vertices
+void TestDynamicStitch::test2 ()
+{
+  const glm::vec3 center (0.1f, 0.2f, 0.3f);
+
+  DynamicMesh                     hole;
+  const std::vector<unsigned int> holeFaces = addAnnulus (hole, center, 1.0f, 2.0f, 24);
+  const std::vector<Loop>         holeLoops = boundaryLoops (hole, holeFaces);
+  assert (holeLoops.size () == 2);
+
+  DynamicMesh                     patch;
+  const std::vector<unsigned int> patchFaces = addAnnulus (patch, center, 1.1f, 1.9f, 20);
+  const std::vector<Loop>         patchLoops = boundaryLoops (patch, patchFaces);
+  assert (patchLoops.size () == 2);
+
+  std::vector<unsigned int> pairs;
+
+  const bool success = DynamicStitch::pairLoops (hole, holeLoops, patch, patchLoops, pairs);
+  assert (success);
+  assert (pairs.size () == 2);
+  unused (success);
+
+  for (unsigned int i = 0; i < 2; i++)
+  {
+    const bool isOuterHole = glm::distance (hole.vertex (holeLoops[i][0]), center) > 1.5f;
+    const bool isOuterPatch = glm::distance (patch.vertex (patchLoops[pairs[i]][0]), center) > 1.5f;
+    assert (isOuterHole == isOuterPatch);
+    unused (isOuterHole);
+    unused (isOuterPatch);
+  }
+
+  // The inner loop of this patch is nearer to the outer loop of the hole than to its inner
+  // loop, i.e. the inner loop of the hole is not paired mutually
+  DynamicMesh                     thin;
+  const std::vector<unsigned int> thinFaces = addAnnulus (thin, center, 1.6f, 1.9f, 20);
+
+  pairs.clear ();
+  const std::vector<Loop> thinLoops = boundaryLoops (thin, thinFaces);
+  const bool              isThinPaired =
+    DynamicStitch::pairLoops (hole, holeLoops, thin, thinLoops, pairs);
+  assert (isThinPaired == false);
+  unused (isThinPaired);
+}
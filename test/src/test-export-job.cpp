@@ -0,0 +1,212 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QTemporaryDir>
+#include <cassert>
+#include <fstream>
+#include <functional>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include "config.hpp"
+#include "dynamic/mesh.hpp"
+#include "export-job.hpp"
+#include "mesh.hpp"
+#include "opengl.hpp"
+#include "scene.hpp"
+#include "sketch/mesh.hpp"
+#include "sketch/path.hpp"
+#include "test-export-job.hpp"
+#include "util.hpp"
+
+namespace
+{
+  // Scenes buffer the data of their meshes, i.e. the test needs an OpenGL context, cf.
+  // `TestHistory`
+  void withContext (const char* name, const std::function<void()>& test)
+  {
+    OpenGL::setDefaultFormat (false);
+
+    QOffscreenSurface surface;
+    surface.create ();
+
+    QOpenGLContext context;
+    context.setFormat (QSurfaceFormat::defaultFormat ());
+
+    if (context.create () == false || context.makeCurrent (&surface) == false)
+    {
+      std::cout << "skipping " << name << ": no OpenGL context available\n";
+      return;
+    }
+    OpenGL::initializeFunctions (false);
+    test ();
+    context.doneCurrent ();
+  }
+
+  std::ostream& operator<< (std::ostream& os, const glm::vec3& v)
+  {
+    os << v.x << " " << v.y << " " << v.z;
+    return os;
+  }
+
+  // The text writer of the scene before files were written by `ExportJob`. Its output equals the
+  // output of `ExportJob` as long as all coordinates have at most 6 significant digits and no
+  // exponent, i.e. as long as `std::ostream` writes them exactly.
+  unsigned int legacyDlyText (std::ostream& stream, const SketchNode& node,
+                              unsigned int parentIndex, unsigned nodeIndex)
+  {
+    stream << "dly_sketch_node " << nodeIndex << " " << parentIndex << " " << node.data ().center ()
+           << " " << node.data ().radius () << std::endl;
+
+    unsigned int childIndex = nodeIndex;
+
+    node.forEachConstChild ([&stream, nodeIndex, &childIndex](const SketchNode& child) {
+      childIndex = legacyDlyText (stream, child, nodeIndex, childIndex + 1);
+    });
+    return childIndex;
+  }
+
+  std::string legacyDlyText (const Scene& scene, bool isObjFile)
+  {
+    std::ostringstream stream;
+
+    scene.forEachConstMesh ([&stream](const DynamicMesh& dynamicMesh) {
+      DynamicMesh pruned (dynamicMesh);
+      pruned.prune ();
+
+      const Mesh& mesh = pruned.mesh ();
+
+      stream << "o\n";
+      for (unsigned int i = 0; i < mesh.numVertices (); i++)
+      {
+        stream << "v " << mesh.vertex (i) << std::endl;
+      }
+      for (unsigned int i = 0; i < mesh.numIndices (); i += 3)
+      {
+        stream << "f " << mesh.index (i + 0) + 1 << " " << mesh.index (i + 1) + 1 << " "
+               << mesh.index (i + 2) + 1 << std::endl;
+      }
+    });
+
+    if (isObjFile == false)
+    {
+      scene.forEachConstMesh ([&stream](const SketchMesh& mesh) {
+        if (mesh.isEmpty () == false)
+        {
+          stream << "dly_sketch_mesh\n";
+
+          if (mesh.tree ().hasRoot ())
+          {
+            legacyDlyText (stream, mesh.tree ().root (), Util::invalidIndex (), 0);
+          }
+
+          for (const SketchPath& p : mesh.paths ())
+          {
+            if (p.isEmpty () == false)
+            {
+              stream << "dly_sketch_path"
+                     << " " << p.intersectionFirst () << " " << p.intersectionLast ()
+                     << std::endl;
+
+              for (const PrimSphere& s : p.spheres ())
+              {
+                stream << "dly_sketch_sphere"
+                       << " " << s.center () << " " << s.radius () << std::endl;
+              }
+            }
+          }
+        }
+      });
+    }
+    return stream.str ();
+  }
+
+  std::string readFile (const std::string& fileName)
+  {
+    std::ifstream file (fileName);
+    return std::string ((std::istreambuf_iterator<char> (file)), std::istreambuf_iterator<char> ());
+  }
+
+  // Octahedron whose coordinates are written exactly by `std::ostream`, cf. `legacyDlyText`
+  DynamicMesh makeMesh (const glm::vec3& center, float radius)
+  {
+    DynamicMesh mesh;
+
+    for (unsigned int i = 0; i < 6; i++)
+    {
+      glm::vec3 normal (0.0f);
+      normal[i / 2] = (i % 2 == 0) ? 1.0f : -1.0f;
+
+      mesh.addVertex (center + (radius * normal), normal);
+    }
+    const unsigned int indices[] = {0, 2, 4, 2, 1, 4, 1, 3, 4, 3, 0, 4,
+                                    2, 0, 5, 1, 2, 5, 3, 1, 5, 0, 3, 5};
+
+    for (unsigned int i = 0; i < 24; i += 3)
+    {
+      mesh.addFace (indices[i + 0], indices[i + 1], indices[i + 2]);
+    }
+    return mesh;
+  }
+}
+
+void TestExportJob::test ()
+{
+  withContext ("TestExportJob::test", []() {
+    Config config;
+    Scene  scene (config);
+
+    // free elements are pruned when writing, i.e. the remaining elements are moved
+    DynamicMesh& mesh1 = scene.newDynamicMesh (config, makeMesh (glm::vec3 (0.5f), 1.0f));
+    mesh1.deleteVertex (1);
+    mesh1.deleteFace (0);
+    scene.newDynamicMesh (config, makeMesh (glm::vec3 (-2.0f, 0.25f, 3.0f), 0.125f));
+
+    SketchTree  tree;
+    SketchNode& root = tree.emplaceRoot (PrimSphere (glm::vec3 (0.0f), 1.0f));
+    root.emplaceChild (PrimSphere (glm::vec3 (1.0f, 2.0f, 3.0f), 0.5f))
+      .emplaceChild (PrimSphere (glm::vec3 (0.125f, -0.25f, 12.5f), 0.25f));
+    root.emplaceChild (PrimSphere (glm::vec3 (-1.0f), 0.75f));
+
+    SketchPath path;
+    path.addSphere (glm::vec3 (0.5f), glm::vec3 (0.0f), 0.25f);
+    path.addSphere (glm::vec3 (1.5f), glm::vec3 (1.0f), 0.125f);
+
+    SketchMesh& sketch = scene.newSketchMesh (config, tree);
+    sketch.addPath (path);
+
+    // empty sketches are not written
+    scene.newSketchMesh (config, SketchTree ());
+
+    QTemporaryDir dir;
+    assert (dir.isValid ());
+
+    for (const bool isObjFile : {false, true})
+    {
+      const std::string fileName =
+        dir.filePath (isObjFile ? "scene.obj" : "scene.dly").toStdString ();
+
+      ExportJob job;
+      bool      success = false;
+
+      job.run (scene, fileName, isObjFile, [&success](bool s) { success = s; });
+      job.wait ();
+
+      const std::string expected = legacyDlyText (scene, isObjFile);
+      const bool        hasSketches = expected.find ("dly_sketch_sphere") != std::string::npos;
+      const bool        isIdentical = readFile (fileName) == expected;
+
+      assert (success);
+      assert (hasSketches != isObjFile);
+      assert (isIdentical);
+      unused (success);
+      unused (hasSketches);
+      unused (isIdentical);
+    }
+  });
+}
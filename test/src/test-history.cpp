@@ -0,0 +1,273 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <glm/glm.hpp>
+#include <iostream>
+#include "config.hpp"
+#include "dynamic/mesh.hpp"
+#include "history.hpp"
+#include "intersection.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "opengl.hpp"
+#include "primitive/ray.hpp"
+#include "scene.hpp"
+#include "test-history.hpp"
+#include "util.hpp"
+
+namespace
+{
+  // Scenes buffer the data of their meshes, i.e. the tests need an OpenGL context. Without a
+  // context the tests are skipped, cf. `TestOpenGL`.
+  void withContext (const char* name, const std::function<void()>& test)
+  {
+    OpenGL::setDefaultFormat (false);
+
+    QOffscreenSurface surface;
+    surface.create ();
+
+    QOpenGLContext context;
+    context.setFormat (QSurfaceFormat::defaultFormat ());
+
+    if (context.create () == false || context.makeCurrent (&surface) == false)
+    {
+      std::cout << "skipping " << name << ": no OpenGL context available\n";
+      return;
+    }
+    OpenGL::initializeFunctions (false);
+    test ();
+    context.doneCurrent ();
+  }
+
+  // Meshes are built element by element since `DynamicMesh (const Mesh&)` buffers its data
+  DynamicMesh makeMesh (unsigned int numSubdivisions)
+  {
+    const Mesh  mesh = MeshUtil::icosphere (numSubdivisions);
+    DynamicMesh dynamicMesh;
+
+    for (unsigned int i = 0; i < mesh.numVertices (); i++)
+    {
+      dynamicMesh.addVertex (mesh.vertex (i), mesh.normal (i));
+    }
+    for (unsigned int i = 0; i < mesh.numIndices (); i += 3)
+    {
+      dynamicMesh.addFace (mesh.index (i + 0), mesh.index (i + 1), mesh.index (i + 2));
+    }
+    return dynamicMesh;
+  }
+
+  // Pushes all vertices with a positive x coordinate outwards and deletes a face, like a brush
+  // stroke that is followed by a topological change
+  void sculpt (DynamicMesh& mesh, float factor)
+  {
+    for (unsigned int i = 0; i < mesh.mesh ().numVertices (); i++)
+    {
+      if (mesh.isFreeVertex (i) == false && mesh.vertex (i).x > 0.0f)
+      {
+        mesh.vertex (i, mesh.vertex (i) * glm::vec3 (factor, 1.0f, 1.0f));
+        mesh.vertexNormal (i, glm::normalize (mesh.vertexNormal (i) + glm::vec3 (0.1f)));
+      }
+    }
+    mesh.deleteFace (mesh.adjacentFaces (0).front ());
+  }
+
+  bool isIdentical (const glm::vec3& a, const glm::vec3& b)
+  {
+    return std::memcmp (&a, &b, sizeof (glm::vec3)) == 0;
+  }
+
+  // Positions are compared bitwise. Revisions are not compared since applying a delta assigns a
+  // new revision.
+  void assertIdentical (const DynamicMesh& a, const DynamicMesh& b)
+  {
+    assert (a.mesh ().numVertices () == b.mesh ().numVertices ());
+    assert (a.mesh ().numIndices () == b.mesh ().numIndices ());
+    assert (a.freeVertexIndices () == b.freeVertexIndices ());
+    assert (a.freeFaceIndices () == b.freeFaceIndices ());
+
+    for (unsigned int i = 0; i < a.mesh ().numVertices (); i++)
+    {
+      assert (a.isFreeVertex (i) == b.isFreeVertex (i));
+
+      if (a.isFreeVertex (i) == false)
+      {
+        assert (isIdentical (a.vertex (i), b.vertex (i)));
+      }
+    }
+    for (unsigned int i = 0; i < a.mesh ().numIndices () / 3; i++)
+    {
+      assert (a.isFreeFace (i) == b.isFreeFace (i));
+
+      if (a.isFreeFace (i) == false)
+      {
+        unsigned int a1, a2, a3, b1, b2, b3;
+        a.vertexIndices (i, a1, a2, a3);
+        b.vertexIndices (i, b1, b2, b3);
+
+        assert (a1 == b1 && a2 == b2 && a3 == b3);
+      }
+    }
+    unused (a);
+    unused (b);
+  }
+
+  // Normals are only restored bitwise by deltas since they are recomputed when decompressing
+  void assertIdenticalNormals (const DynamicMesh& a, const DynamicMesh& b)
+  {
+    for (unsigned int i = 0; i < a.mesh ().numVertices (); i++)
+    {
+      if (a.isFreeVertex (i) == false)
+      {
+        assert (isIdentical (a.vertexNormal (i), b.vertexNormal (i)));
+      }
+    }
+    unused (a);
+    unused (b);
+  }
+
+  const PrimRay ray (glm::vec3 (5.0f, 0.01f, 0.02f), glm::vec3 (-1.0f, 0.0f, 0.0f));
+
+  // x coordinate of the intersection of `ray` with the recent state of the scene's meshes
+  float intersectRecent (const History& history, const Scene& scene)
+  {
+    Intersection intersection;
+    const bool   intersects = history.intersectsRecentDynamicMesh (scene, ray, intersection);
+    assert (intersects);
+    unused (intersects);
+    return intersection.position ().x;
+  }
+}
+
+// A recorded sculpt delta is undone and redone bit-identically. While recording and after a
+// snapshot, the recent state is intersected instead of the sculpted one.
+void TestHistory::test1 ()
+{
+  withContext ("TestHistory::test1", []() {
+    Config  config;
+    History history (config);
+    Scene   scene (config);
+
+    DynamicMesh&      mesh = scene.newDynamicMesh (config, makeMesh (3));
+    const DynamicMesh original (mesh);
+
+    Intersection intersection;
+    const bool   intersects = original.intersects (ray, intersection);
+    const float  originalX = intersection.position ().x;
+    assert (intersects);
+    unused (intersects);
+
+    history.recordDynamicMeshes ();
+    history.recordDynamicMesh (scene, mesh);
+    sculpt (mesh, 1.5f);
+    assert (history.hasRecentDynamicMesh ());
+    assert (intersectRecent (history, scene) == originalX);
+    history.stopRecording ();
+
+    const DynamicMesh sculpted (mesh);
+
+    history.undo (scene, config);
+    assertIdentical (mesh, original);
+    assertIdenticalNormals (mesh, original);
+
+    history.redo (scene, config);
+    assertIdentical (mesh, sculpted);
+    assertIdenticalNormals (mesh, sculpted);
+
+    history.snapshotDynamicMeshes (scene);
+    sculpt (mesh, 2.0f);
+    assert (history.hasRecentDynamicMesh ());
+    assert (intersectRecent (history, scene) > originalX);
+    assert (intersectRecent (history, scene) < 2.0f);
+
+    history.undo (scene, config);
+    scene.forEachConstMesh ([&sculpted](const DynamicMesh& m) { assertIdentical (m, sculpted); });
+
+    history.undo (scene, config);
+    scene.forEachConstMesh ([&original](const DynamicMesh& m) { assertIdentical (m, original); });
+
+    unused (originalX);
+  });
+}
+
+// Two meshes with the same revision share their state. Undo and redo restore the geometry of
+// both meshes while older states are still compressed in the background or have been spilled to
+// disk.
+void TestHistory::test2 ()
+{
+  withContext ("TestHistory::test2", []() {
+    Config config;
+    config.set ("editor/undo-memory", 0);
+
+    History history (config);
+    Scene   scene (config);
+
+    // revisions are assigned on demand, i.e. before copying so that both copies share it
+    DynamicMesh mesh = makeMesh (5);
+    mesh.revision ();
+
+    scene.newDynamicMesh (config, mesh);
+    scene.newDynamicMesh (config, mesh);
+
+    const std::function<std::vector<DynamicMesh> ()> copyScene = [&scene]() {
+      std::vector<DynamicMesh> copies;
+      scene.forEachConstMesh ([&copies](const DynamicMesh& m) { copies.emplace_back (m); });
+      return copies;
+    };
+    const std::function<void(const std::vector<DynamicMesh>&)> assertScene =
+      [&scene](const std::vector<DynamicMesh>& copies) {
+        unsigned int i = 0;
+        scene.forEachConstMesh ([&copies, &i](const DynamicMesh& m) {
+          assert (i < copies.size ());
+          assertIdentical (m, copies[i++]);
+        });
+        assert (i == copies.size ());
+        unused (i);
+      };
+
+    history.suspendCompression (true);
+
+    std::vector<std::vector<DynamicMesh>> states;
+    states.push_back (copyScene ());
+    assert (states[0][0].revision () == states[0][1].revision ());
+
+    // Each snapshot queues the compression of states that are no longer recent. Without a memory
+    // budget, compressed states are spilled to disk.
+    for (unsigned int i = 0; i < 3; i++)
+    {
+      history.snapshotDynamicMeshes (scene);
+
+      unsigned int j = 0;
+      scene.forEachMesh ([i, &j](DynamicMesh& m) {
+        if (j++ == i % 2)
+        {
+          sculpt (m, 1.1f);
+        }
+      });
+      states.push_back (copyScene ());
+    }
+
+    // Compressions are pending while suspended. Once resumed, some states are compressed or
+    // spilled before they are restored.
+    for (bool isSuspended : {true, false})
+    {
+      history.suspendCompression (isSuspended);
+
+      for (unsigned int i = 3; i > 0; i--)
+      {
+        history.undo (scene, config);
+        assertScene (states[i - 1]);
+      }
+      for (unsigned int i = 1; i <= 3; i++)
+      {
+        history.redo (scene, config);
+        assertScene (states[i]);
+      }
+    }
+  });
+}
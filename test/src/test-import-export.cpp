@@ -0,0 +1,216 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "import-export.hpp"
+#include "mesh.hpp"
+#include "primitive/sphere.hpp"
+#include "sketch/path.hpp"
+#include "test-import-export.hpp"
+#include "tree.hpp"
+#include "util.hpp"
+
+namespace
+{
+  // Each object is followed by a sketch, i.e. the text spans several chunks which are split within
+  // lines, cf. `minChunkSize`
+  const unsigned int numObjects = 8;
+  const unsigned int numQuads = 2000;
+
+  glm::vec3 objectVertex (unsigned int object, unsigned int i)
+  {
+    return glm::vec3 (float(i), 0.5f * float(object), -0.25f * float(i % 8));
+  }
+
+  std::string objectsAndSketches ()
+  {
+    std::ostringstream text;
+
+    for (unsigned int o = 0; o < numObjects; o++)
+    {
+      text << "o\n";
+      for (unsigned int i = 0; i < 4 * numQuads; i++)
+      {
+        const glm::vec3 v = objectVertex (o, i);
+        text << "v " << v.x << ' ' << v.y << ' ' << v.z << '\n';
+      }
+      for (unsigned int i = 1; i <= 4 * numQuads; i += 4)
+      {
+        text << "f " << i << '/' << i << '/' << i << ' ' << i + 1 << '/' << i + 1 << '/' << i + 1
+             << ' ' << i + 2 << "//" << i + 2 << ' ' << i + 3 << "/1 \r\n";
+      }
+      text << "f 1 2 3\n";
+      text << "dly_sketch_mesh\n";
+      text << "dly_sketch_node 0 " << Util::invalidIndex () << ' ' << o << " 0 0 " << o + 1
+           << '\n';
+      text << "dly_sketch_node 1 0 0 1 0 0.5\n";
+      text << "dly_sketch_path 0 0 0 1 1 1\n";
+      text << "dly_sketch_sphere 0.5 0.5 0.5 0.25\n";
+    }
+    return text.str ();
+  }
+
+  bool read (const std::string& text, unsigned int* errorLine = nullptr)
+  {
+    return ImportExport::readDlyText (text.data (), text.size (), [](Mesh&&) {},
+                                      [](const SketchTree&, const SketchPaths&) {}, errorLine);
+  }
+
+  void assertErrorLine (const std::string& text, unsigned int lineNumber)
+  {
+    unsigned int errorLine = 0;
+    const bool   success = read (text, &errorLine);
+
+    assert (success == false);
+    assert (errorLine == lineNumber);
+    unused (success);
+    unused (lineNumber);
+  }
+}
+
+void TestImportExport::test1 ()
+{
+  const std::string text = objectsAndSketches ();
+  unsigned int      numMeshes = 0;
+  unsigned int      numSketches = 0;
+
+  const bool success = ImportExport::readDlyText (
+    text.data (), text.size (),
+    [&numMeshes](Mesh&& mesh) {
+      assert (mesh.numVertices () == 4 * numQuads);
+      assert (mesh.numIndices () == (6 * numQuads) + 3);
+
+      for (unsigned int i = 0; i < mesh.numVertices (); i++)
+      {
+        assert (mesh.vertex (i) == objectVertex (numMeshes, i));
+      }
+      for (unsigned int i = 0; i < numQuads; i++)
+      {
+        const unsigned int v = 4 * i;
+        const unsigned int indices[] = {v, v + 1, v + 2, v + 3, v, v + 2};
+
+        for (unsigned int j = 0; j < 6; j++)
+        {
+          assert (mesh.index ((6 * i) + j) == indices[j]);
+        }
+        unused (indices);
+      }
+      assert (mesh.index (6 * numQuads) == 0);
+      assert (mesh.index ((6 * numQuads) + 2) == 2);
+      numMeshes++;
+    },
+    [&numSketches](const SketchTree& tree, const SketchPaths& paths) {
+      assert (tree.hasRoot ());
+      assert (tree.root ().data ().center () == glm::vec3 (float(numSketches), 0.0f, 0.0f));
+      assert (tree.root ().data ().radius () == float(numSketches + 1));
+      assert (tree.root ().numNodes () == 2);
+      assert (paths.size () == 1);
+      assert (paths[0].spheres ().size () == 1);
+      assert (paths[0].spheres ()[0].radius () == 0.25f);
+      numSketches++;
+    });
+
+  assert (success);
+  assert (numMeshes == numObjects);
+  assert (numSketches == numObjects);
+  unused (success);
+
+  const unsigned int numLines = (unsigned int) (std::count (text.begin (), text.end (), '\n'));
+
+  assertErrorLine (text + "f 1 2\n", numLines + 1);
+
+  // a malformed line in the middle of the text is reported with the lines of preceding chunks
+  std::string  broken = text;
+  std::size_t  position = 0;
+  unsigned int numPrecedingLines = 0;
+
+  while (numPrecedingLines < numLines / 2)
+  {
+    position = broken.find ('\n', position) + 1;
+    numPrecedingLines++;
+  }
+  broken.insert (position, "v 1 2\n");
+  assertErrorLine (broken, numPrecedingLines + 1);
+  assertErrorLine (text + "dly_sketch_node 3 0 0 0 0 1\n", numLines + 1);
+  assertErrorLine ("o\nv 0 0 0\nv 0 x 0\nv 1 1 1\n", 3);
+  assertErrorLine ("o\nv 0 0 0\ndly_sketch_sphere 0 0 0 1\n", 3);
+}
+
+void TestImportExport::test2 ()
+{
+  std::default_random_engine                  gen;
+  std::uniform_int_distribution<unsigned int> dist;
+
+  std::vector<float> values = {0.0f,
+                               -0.0f,
+                               1.0f,
+                               0.1f,
+                               -1.0f / 3.0f,
+                               1.0e-7f,
+                               123456789.0f,
+                               16777217.0f,
+                               std::numeric_limits<float>::max (),
+                               std::numeric_limits<float>::lowest (),
+                               std::numeric_limits<float>::min (),
+                               std::numeric_limits<float>::denorm_min (),
+                               -std::numeric_limits<float>::denorm_min ()};
+
+  while (values.size () < 30000)
+  {
+    const unsigned int bits = dist (gen);
+    float              value;
+    std::memcpy (&value, &bits, sizeof (float));
+
+    if (std::isfinite (value))
+    {
+      values.push_back (value);
+    }
+  }
+
+  // vertices are written by `formatFloat` and read by `LineScanner::floating`
+  Mesh mesh;
+  for (unsigned int i = 0; i + 2 < values.size (); i += 3)
+  {
+    mesh.addVertex (glm::vec3 (values[i], values[i + 1], values[i + 2]));
+  }
+
+  ImportExport::SceneCopy scene;
+  scene.meshes.push_back (ImportExport::MeshCopy{mesh, {}, {}});
+
+  std::ostringstream stream;
+  ImportExport::toDlyFile (stream, scene, true);
+
+  const std::string text = stream.str ();
+  unsigned int      numMeshes = 0;
+
+  const bool success = ImportExport::readDlyText (
+    text.data (), text.size (),
+    [&mesh, &numMeshes](Mesh&& m) {
+      assert (m.numVertices () == mesh.numVertices ());
+
+      for (unsigned int i = 0; i < m.numVertices (); i++)
+      {
+        for (unsigned int j = 0; j < 3; j++)
+        {
+          assert (m.vertex (i)[j] == mesh.vertex (i)[j]);
+          assert (std::signbit (m.vertex (i)[j]) == std::signbit (mesh.vertex (i)[j]));
+        }
+      }
+      numMeshes++;
+    },
+    [](const SketchTree&, const SketchPaths&) { assert (false); });
+
+  assert (success);
+  assert (numMeshes == 1);
+  unused (success);
+}
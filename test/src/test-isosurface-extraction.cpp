@@ -0,0 +1,309 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <atomic>
+#include <cassert>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+#include "dynamic/mesh.hpp"
+#include "intersection.hpp"
+#include "isosurface-extraction.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "primitive/aabox.hpp"
+#include "primitive/ray.hpp"
+#include "primitive/sphere.hpp"
+#include "task-pool.hpp"
+#include "test-isosurface-extraction.hpp"
+#include "util.hpp"
+
+namespace
+{
+  typedef IsosurfaceExtraction::ProgressCallback ProgressCallback;
+
+  const float resolution = 0.05f;
+
+  std::atomic<unsigned int> numTwoSpheresDistances (0);
+
+  // union of two overlapping spheres, which never overestimates distances
+  float twoSpheres (const glm::vec3& p)
+  {
+    numTwoSpheresDistances++;
+    return glm::min (glm::length (p) - 0.8f, glm::length (p - glm::vec3 (0.7f, 0.3f, 0.1f)) - 0.5f);
+  }
+
+  const PrimAABox twoSpheresBounds (glm::vec3 (-0.8f), glm::vec3 (1.2f, 0.8f, 0.8f));
+
+  // Meshes are built element by element since `DynamicMesh (const Mesh&)` buffers its data
+  DynamicMesh makeSphereMesh ()
+  {
+    const Mesh  mesh = MeshUtil::icosphere (3);
+    DynamicMesh dynamicMesh;
+
+    for (unsigned int i = 0; i < mesh.numVertices (); i++)
+    {
+      dynamicMesh.addVertex (mesh.vertex (i), mesh.normal (i));
+    }
+    for (unsigned int i = 0; i < mesh.numIndices (); i += 3)
+    {
+      dynamicMesh.addFace (mesh.index (i + 0), mesh.index (i + 1), mesh.index (i + 2));
+    }
+    return dynamicMesh;
+  }
+
+  const PrimAABox sphereMeshBounds (glm::vec3 (0.0f), 2.0f);
+
+  // Extracts the distance field of `twoSpheres`
+  DynamicMesh extract (float tolerance, const ProgressCallback& progress = nullptr)
+  {
+    DynamicMesh mesh;
+    const bool  success = IsosurfaceExtraction::extract (twoSpheres, twoSpheresBounds, resolution,
+                                                         tolerance, mesh, progress);
+    assert (success);
+    assert (mesh.isEmpty () == false);
+    unused (success);
+    return mesh;
+  }
+
+  // Extracts the given mesh like the remesh tool does, i.e. with an intersection callback
+  DynamicMesh extract (const DynamicMesh& sphere, float tolerance,
+                       const ProgressCallback& progress = nullptr)
+  {
+    const IsosurfaceExtraction::IntersectionCallback getIntersection =
+      [&sphere](const PrimRay& ray, Intersection& intersection) {
+        return sphere.intersects (ray, intersection, true)
+                 ? IsosurfaceExtraction::Intersection::Sample
+                 : IsosurfaceExtraction::Intersection::None;
+      };
+
+    const IsosurfaceExtraction::BatchDistanceCallback getDistances =
+      [&sphere](const std::vector<glm::vec3>& positions, std::vector<float>& distances) {
+        sphere.unsignedDistances (positions, distances);
+      };
+
+    DynamicMesh mesh;
+    const bool  success = IsosurfaceExtraction::extract (getDistances, getIntersection,
+                                                         sphereMeshBounds, resolution, tolerance,
+                                                         mesh, progress);
+    assert (success);
+    assert (mesh.isEmpty () == false);
+    unused (success);
+    return mesh;
+  }
+
+  // An analytic sphere that is not centered on the grid, i.e. no column of samples is tangent
+  const PrimSphere sphere (glm::vec3 (0.013f, 0.027f, 0.011f), 0.77f);
+  const PrimAABox  sphereBounds (glm::vec3 (0.0f), 2.0f);
+
+  // Extracts `sphere` from its signed distances, which are sampled densely
+  DynamicMesh extractSphere ()
+  {
+    const IsosurfaceExtraction::DistanceCallback getDistance = [](const glm::vec3& p) {
+      return glm::distance (p, sphere.center ()) - sphere.radius ();
+    };
+
+    DynamicMesh mesh;
+    const bool  success =
+      IsosurfaceExtraction::extract (getDistance, sphereBounds, resolution, 0.0f, mesh);
+    assert (success);
+    unused (success);
+    return mesh;
+  }
+
+  // Extracts `sphere` from intersections and its unsigned distances, which are sampled near the
+  // surface only
+  DynamicMesh extractSphereWithIntersections ()
+  {
+    const IsosurfaceExtraction::IntersectionCallback getIntersection =
+      [](const PrimRay& ray, Intersection& intersection) {
+        float t;
+        if (IntersectionUtil::intersects (ray, sphere, &t))
+        {
+          const glm::vec3 position = ray.pointAt (t);
+          intersection.update (t, position, glm::normalize (position - sphere.center ()));
+          return IsosurfaceExtraction::Intersection::Sample;
+        }
+        else
+        {
+          return IsosurfaceExtraction::Intersection::None;
+        }
+      };
+
+    const IsosurfaceExtraction::DistanceCallback getDistance = [](const glm::vec3& p) {
+      return glm::abs (glm::distance (p, sphere.center ()) - sphere.radius ());
+    };
+
+    DynamicMesh mesh;
+    const bool  success = IsosurfaceExtraction::extract (getDistance, getIntersection,
+                                                         sphereBounds, resolution, 0.0f, mesh);
+    assert (success);
+    unused (success);
+    return mesh;
+  }
+
+  // Extracts the given signed distance field within `sphereBounds`
+  DynamicMesh extract (const IsosurfaceExtraction::DistanceCallback& getDistance, float tolerance)
+  {
+    DynamicMesh mesh;
+    const bool  success =
+      IsosurfaceExtraction::extract (getDistance, sphereBounds, resolution, tolerance, mesh);
+    assert (success);
+    assert (mesh.isEmpty () == false);
+    unused (success);
+    return mesh;
+  }
+
+  float boxDistance (const glm::vec3& p, const glm::vec3& halfWidth)
+  {
+    const glm::vec3 q = glm::abs (p) - halfWidth;
+    return glm::length (glm::max (q, glm::vec3 (0.0f))) +
+           glm::min (glm::max (q.x, glm::max (q.y, q.z)), 0.0f);
+  }
+
+  // A box that is not centered on the grid
+  float box (const glm::vec3& p)
+  {
+    return boxDistance (p - glm::vec3 (0.01f, 0.02f, 0.03f), glm::vec3 (0.6f, 0.5f, 0.4f));
+  }
+
+  // A thin plate that is tilted against the grid, i.e. its large faces are planes that are not
+  // aligned with any axis
+  float plane (const glm::vec3& p)
+  {
+    static const glm::mat3x3 rotation = glm::mat3x3 (
+      glm::rotate (glm::mat4x4 (1.0f), 0.3f, glm::normalize (glm::vec3 (1.0f, 2.0f, 3.0f))));
+
+    return boxDistance (rotation * p, glm::vec3 (0.7f, 0.7f, 0.15f));
+  }
+
+  // Streaming extractions report the progress of slices of distances only. Progress is reported
+  // concurrently.
+  struct StreamingProgress
+  {
+    std::atomic<bool> isStreaming;
+
+    StreamingProgress ()
+      : isStreaming (true)
+    {
+    }
+
+    ProgressCallback callback ()
+    {
+      return [this](IsosurfaceExtraction::Phase phase, float) {
+        if (phase == IsosurfaceExtraction::Phase::CubeVertices)
+        {
+          this->isStreaming = false;
+        }
+        return true;
+      };
+    }
+  };
+
+  // Extracted meshes are never pruned, i.e. their vertex and index arrays are compared
+  void assertEqual (const DynamicMesh& a, const DynamicMesh& b)
+  {
+    assert (a.freeVertexIndices ().empty () && b.freeVertexIndices ().empty ());
+    assert (a.freeFaceIndices ().empty () && b.freeFaceIndices ().empty ());
+    assert (a.mesh ().numVertices () == b.mesh ().numVertices ());
+    assert (a.mesh ().numIndices () == b.mesh ().numIndices ());
+
+    for (unsigned int i = 0; i < a.mesh ().numVertices (); i++)
+    {
+      assert (a.vertex (i) == b.vertex (i));
+    }
+    for (unsigned int i = 0; i < a.mesh ().numIndices (); i++)
+    {
+      assert (a.mesh ().index (i) == b.mesh ().index (i));
+    }
+    unused (a);
+    unused (b);
+  }
+}
+
+// Meshes extracted by a single thread equal meshes extracted by all threads of `TaskPool`
+void TestIsosurfaceExtraction::test1 ()
+{
+  const DynamicMesh sphere = makeSphereMesh ();
+
+  for (float tolerance : {0.0f, 0.1f})
+  {
+    TaskPool::setMaxNumThreads (1);
+    const DynamicMesh serial = extract (tolerance);
+    const DynamicMesh serialSphere = extract (sphere, tolerance);
+
+    TaskPool::setMaxNumThreads (0);
+    assertEqual (serial, extract (tolerance));
+    assertEqual (serialSphere, extract (sphere, tolerance));
+  }
+}
+
+// Streaming extractions equal dense extractions of uniform meshes, including the marking of
+// samples of the next slice when extracting with an intersection callback
+void TestIsosurfaceExtraction::test2 ()
+{
+  const DynamicMesh sphere = makeSphereMesh ();
+  StreamingProgress denseProgress, denseSphereProgress, progress, sphereProgress;
+
+  const DynamicMesh dense = extract (0.0f, denseProgress.callback ());
+  const DynamicMesh denseSphere = extract (sphere, 0.0f, denseSphereProgress.callback ());
+  assert (denseProgress.isStreaming == false);
+  assert (denseSphereProgress.isStreaming == false);
+
+  IsosurfaceExtraction::setMaxNumDenseSamples (1);
+  assertEqual (dense, extract (0.0f, progress.callback ()));
+  assertEqual (denseSphere, extract (sphere, 0.0f, sphereProgress.callback ()));
+  assert (progress.isStreaming);
+  assert (sphereProgress.isStreaming);
+  IsosurfaceExtraction::setMaxNumDenseSamples (0);
+}
+
+// Sparsely sampled extractions equal densely sampled extractions
+void TestIsosurfaceExtraction::test3 ()
+{
+  IsosurfaceExtraction::setSparseSampling (false);
+  numTwoSpheresDistances = 0;
+  const DynamicMesh  dense = extract (0.0f);
+  const unsigned int numDenseDistances = numTwoSpheresDistances;
+  const DynamicMesh  denseMerged = extract (0.1f);
+  const DynamicMesh  denseSphere = extractSphere ();
+
+  IsosurfaceExtraction::setSparseSampling (true);
+  numTwoSpheresDistances = 0;
+  assertEqual (dense, extract (0.0f));
+  assert (numTwoSpheresDistances < numDenseDistances);
+  assertEqual (denseMerged, extract (0.1f));
+  unused (numDenseDistances);
+
+  // samples that are marked as inside or outside are only sampled near the surface
+  assertEqual (denseSphere, extractSphereWithIntersections ());
+}
+
+// Merged meshes are consistent, have fewer faces than uniform meshes, and their vertices lie on
+// uniform meshes within the tolerance
+void TestIsosurfaceExtraction::test4 ()
+{
+  const std::vector<IsosurfaceExtraction::DistanceCallback> fields = {
+    [](const glm::vec3& p) { return glm::distance (p, sphere.center ()) - sphere.radius (); },
+    box, plane};
+
+  for (const IsosurfaceExtraction::DistanceCallback& field : fields)
+  {
+    const DynamicMesh uniform = extract (field, 0.0f);
+
+    for (float tolerance : {0.05f, 0.1f, 0.2f})
+    {
+      const DynamicMesh merged = extract (field, tolerance);
+
+      assert (merged.checkConsistency ());
+      assert (merged.numFaces () < uniform.numFaces ());
+
+      // extracted meshes have no free vertices
+      for (unsigned int i = 0; i < merged.mesh ().numVertices (); i++)
+      {
+        assert (uniform.unsignedDistance (merged.vertex (i)) <= tolerance * resolution);
+      }
+    }
+  }
+}
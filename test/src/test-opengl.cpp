@@ -0,0 +1,81 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <QImage>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <cassert>
+#include <glm/glm.hpp>
+#include <iostream>
+#include "camera.hpp"
+#include "config.hpp"
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "opengl.hpp"
+#include "render-mode.hpp"
+#include "renderer.hpp"
+#include "test-opengl.hpp"
+#include "util.hpp"
+
+// Renders a mesh once through the 3.3 core profile path, i.e. with a vertex array object per
+// mesh and the core geometry shader. The test needs an OpenGL driver but no GPU: Mesa's llvmpipe
+// provides a 3.3 core profile context, e.g. `LIBGL_ALWAYS_SOFTWARE=1 xvfb-run ./run-tests`.
+// Without a suitable context the test is skipped.
+void TestOpenGL::test ()
+{
+  OpenGL::setDefaultFormat (true);
+
+  QOffscreenSurface surface;
+  surface.create ();
+
+  QOpenGLContext context;
+  context.setFormat (QSurfaceFormat::defaultFormat ());
+
+  if (context.create () == false || context.makeCurrent (&surface) == false ||
+      context.format ().profile () != QSurfaceFormat::CoreProfile ||
+      context.format ().version () < qMakePair (3, 3))
+  {
+    std::cout << "skipping OpenGL test: no 3.3 core profile context available\n";
+    return;
+  }
+  OpenGL::initializeFunctions (true);
+  assert (OpenGL::isCoreProfile ());
+  assert (OpenGL::hasGeometryShader ());
+
+  {
+    const unsigned int       size = 64;
+    QOpenGLFramebufferObject framebuffer (size, size,
+                                          QOpenGLFramebufferObject::CombinedDepthStencil);
+    framebuffer.bind ();
+
+    Config config;
+    Camera camera (config);
+    camera.updateResolution (glm::uvec2 (size, size));
+
+    Mesh mesh = MeshUtil::icosphere (2);
+    mesh.bufferData ();
+
+    OpenGL::clearError ();
+    OpenGL::glViewport (0, 0, size, size);
+    camera.renderer ().setupRendering ();
+    mesh.render (camera);
+
+    mesh.renderMode ().renderWireframe (true);
+    mesh.render (camera);
+    camera.renderer ().shutdownRendering ();
+
+    const bool hasError = OpenGL::hasError ();
+    assert (hasError == false);
+    assert (camera.renderer ().numDrawCalls () == 2);
+    unused (hasError);
+
+    const QImage image = framebuffer.toImage ();
+    assert (image.pixel (size / 2, size / 2) != image.pixel (0, 0));
+    unused (image);
+
+    framebuffer.release ();
+  }
+  context.doneCurrent ();
+}
@@ -0,0 +1,182 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "ply.hpp"
+#include "test-ply.hpp"
+#include "util.hpp"
+
+namespace
+{
+  // A unit cube of quads with outward facing orientation
+  const unsigned int cubeQuads[6][4] = {{0, 2, 3, 1}, {4, 5, 7, 6}, {0, 1, 5, 4},
+                                        {2, 6, 7, 3}, {0, 4, 6, 2}, {1, 3, 7, 5}};
+
+  glm::vec3 cubeVertex (unsigned int i)
+  {
+    return glm::vec3 (float(i & 1), float((i >> 1) & 1), float((i >> 2) & 1));
+  }
+
+  void appendBits (std::string& bytes, uint64_t bits, std::size_t size, bool isBigEndian)
+  {
+    for (std::size_t i = 0; i < size; i++)
+    {
+      const std::size_t shift = isBigEndian ? size - i - 1 : i;
+      bytes.push_back (char(bits >> (8 * shift)));
+    }
+  }
+
+  void appendFloat (std::string& bytes, float value, bool isBigEndian)
+  {
+    uint32_t bits;
+    std::memcpy (&bits, &value, sizeof (float));
+    appendBits (bytes, bits, sizeof (float), isBigEndian);
+  }
+
+  void appendDouble (std::string& bytes, double value, bool isBigEndian)
+  {
+    uint64_t bits;
+    std::memcpy (&bits, &value, sizeof (double));
+    appendBits (bytes, bits, sizeof (double), isBigEndian);
+  }
+
+  // Little-endian files store vertices as floats and faces as lists with `uchar` counts, whereas
+  // big-endian files store vertices as doubles and faces as lists with `int` counts. Both have a
+  // property that is not used by the reader.
+  std::string cubeFile (bool isBigEndian)
+  {
+    std::string bytes =
+      isBigEndian ? "ply\n"
+                    "format binary_big_endian 1.0\n"
+                    "element vertex 8\n"
+                    "property double x\n"
+                    "property double y\n"
+                    "property double z\n"
+                    "element face 6\n"
+                    "property list int uint vertex_indices\n"
+                    "property ushort flags\n"
+                    "end_header\n"
+                  : "ply\r\n"
+                    "format binary_little_endian 1.0\r\n"
+                    "comment written by a test\r\n"
+                    "element vertex 8\r\n"
+                    "property float x\r\n"
+                    "property float y\r\n"
+                    "property float z\r\n"
+                    "property uchar red\r\n"
+                    "element face 6\r\n"
+                    "property list uchar int vertex_indices\r\n"
+                    "end_header\r\n";
+
+    for (unsigned int i = 0; i < 8; i++)
+    {
+      const glm::vec3 v = cubeVertex (i);
+
+      for (unsigned int c = 0; c < 3; c++)
+      {
+        if (isBigEndian)
+        {
+          appendDouble (bytes, double(v[c]), true);
+        }
+        else
+        {
+          appendFloat (bytes, v[c], false);
+        }
+      }
+      if (isBigEndian == false)
+      {
+        appendBits (bytes, 255, 1, false);
+      }
+    }
+    for (const auto& quad : cubeQuads)
+    {
+      appendBits (bytes, 4, isBigEndian ? 4 : 1, isBigEndian);
+      for (unsigned int i : quad)
+      {
+        appendBits (bytes, i, 4, isBigEndian);
+      }
+      if (isBigEndian)
+      {
+        appendBits (bytes, 7, 2, true);
+      }
+    }
+    return bytes;
+  }
+
+  bool read (const std::string& bytes, Mesh& mesh)
+  {
+    return Ply::read (reinterpret_cast<const unsigned char*> (bytes.data ()), bytes.size (), mesh);
+  }
+
+  void testCube (bool isBigEndian)
+  {
+    const std::string bytes = cubeFile (isBigEndian);
+    Mesh              mesh;
+
+    assert (Ply::isPly (reinterpret_cast<const unsigned char*> (bytes.data ()), bytes.size ()));
+
+    const bool success = read (bytes, mesh);
+    assert (success);
+    assert (mesh.numVertices () == 8);
+    assert (mesh.numIndices () == 6 * 2 * 3);
+    assert (MeshUtil::checkConsistency (mesh));
+
+    // quads are triangulated as fans
+    for (unsigned int i = 0; i < 6; i++)
+    {
+      const unsigned int* q = cubeQuads[i];
+      const unsigned int  triangles[] = {q[0], q[1], q[2], q[0], q[2], q[3]};
+
+      for (unsigned int j = 0; j < 6; j++)
+      {
+        assert (mesh.vertex (mesh.index ((6 * i) + j)) == cubeVertex (triangles[j]));
+      }
+      unused (triangles);
+    }
+
+    Mesh       truncated;
+    const bool successTruncated = read (bytes.substr (0, bytes.size () - 1), truncated);
+    assert (successTruncated == false);
+
+    unused (success);
+    unused (successTruncated);
+  }
+}
+
+void TestPly::test ()
+{
+  testCube (false);
+  testCube (true);
+
+  const std::string ascii = "ply\n"
+                            "format ascii 1.0\n"
+                            "element vertex 3\n"
+                            "property float x\n"
+                            "property float y\n"
+                            "property float z\n"
+                            "element face 1\n"
+                            "property list uchar int vertex_indices\n"
+                            "end_header\n"
+                            "0 0 0\n"
+                            "1 0 0\n"
+                            "0 1 0\n"
+                            "3 0 1 2\n";
+  Mesh       mesh;
+  const bool successAscii = read (ascii, mesh);
+  assert (successAscii == false);
+
+  const std::string truncatedHeader = "ply\nformat binary_little_endian 1.0\nelement vertex 3\n";
+  const bool        successTruncatedHeader = read (truncatedHeader, mesh);
+  assert (successTruncatedHeader == false);
+
+  unused (successAscii);
+  unused (successTruncatedHeader);
+}
@@ -0,0 +1,69 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cassert>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <string>
+#include "mesh-util.hpp"
+#include "mesh.hpp"
+#include "stl.hpp"
+#include "test-stl.hpp"
+#include "util.hpp"
+
+namespace
+{
+  void appendUnsignedInt (std::string& bytes, unsigned int value)
+  {
+    for (unsigned int i = 0; i < 4; i++)
+    {
+      bytes.push_back (char(value >> (8 * i)));
+    }
+  }
+
+  void appendVec3 (std::string& bytes, const glm::vec3& v)
+  {
+    for (unsigned int i = 0; i < 3; i++)
+    {
+      unsigned int bits;
+      std::memcpy (&bits, &v[i], sizeof (float));
+      appendUnsignedInt (bytes, bits);
+    }
+  }
+}
+
+void TestStl::test ()
+{
+  const Mesh  mesh = MeshUtil::icosphere (2);
+  std::string bytes (80, ' ');
+
+  appendUnsignedInt (bytes, mesh.numIndices () / 3);
+  for (unsigned int i = 0; i < mesh.numIndices (); i += 3)
+  {
+    appendVec3 (bytes, glm::vec3 (0.0f));
+    appendVec3 (bytes, mesh.vertex (mesh.index (i + 0)));
+    appendVec3 (bytes, mesh.vertex (mesh.index (i + 1)));
+    appendVec3 (bytes, mesh.vertex (mesh.index (i + 2)));
+    bytes.append (2, '\0');
+  }
+
+  const unsigned char* data = reinterpret_cast<const unsigned char*> (bytes.data ());
+  Mesh                 welded;
+
+  assert (Stl::isStl (data, bytes.size ()));
+  assert (Stl::isStl (data, bytes.size () - 1) == false);
+
+  const bool success = Stl::read (data, bytes.size (), welded);
+  assert (success);
+
+  assert (welded.numVertices () == mesh.numVertices ());
+  assert (welded.numIndices () == mesh.numIndices ());
+  assert (MeshUtil::checkConsistency (welded));
+
+  for (unsigned int i = 0; i < mesh.numIndices (); i++)
+  {
+    assert (welded.vertex (welded.index (i)) == mesh.vertex (mesh.index (i)));
+  }
+  unused (success);
+}
@@ -0,0 +1,120 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "task-pool.hpp"
+#include "test-task-pool.hpp"
+#include "util.hpp"
+
+namespace
+{
+  void assertEachIndexOnce (unsigned int n)
+  {
+    std::vector<std::atomic<unsigned int>> calls (n);
+    for (std::atomic<unsigned int>& c : calls)
+    {
+      c = 0;
+    }
+    TaskPool::parallelFor (n, [&calls](unsigned int i) { calls[i]++; });
+
+    for (const std::atomic<unsigned int>& c : calls)
+    {
+      assert (c == 1);
+      unused (c);
+    }
+  }
+
+  std::string failingParallelFor (unsigned int n, const TaskPool::IndexTask& task)
+  {
+    try
+    {
+      TaskPool::parallelFor (n, task);
+    }
+    catch (const std::runtime_error& e)
+    {
+      return e.what ();
+    }
+    return "";
+  }
+}
+
+void TestTaskPool::test ()
+{
+  assertEachIndexOnce (0);
+  assertEachIndexOnce (1);
+  assertEachIndexOnce (10000);
+
+  // a single failing task
+  std::atomic<unsigned int> numCalls (0);
+  const std::string         what1 = failingParallelFor (10000, [&numCalls](unsigned int i) {
+    numCalls++;
+    if (i == 100)
+    {
+      throw std::runtime_error ("100");
+    }
+  });
+  assert (what1 == "100");
+  assert (numCalls <= 10000);
+  unused (what1);
+
+  // every task fails
+  const std::string what2 = failingParallelFor (
+    10000, [](unsigned int) -> void { throw std::runtime_error ("all"); });
+  assert (what2 == "all");
+  unused (what2);
+
+  // only workers fail: the calling thread waits for a worker's failure within its first task
+  if (TaskPool::numThreads () > 1)
+  {
+    const std::thread::id caller = std::this_thread::get_id ();
+    std::atomic<bool>     workerFailed (false);
+
+    const std::string what3 = failingParallelFor (100, [caller, &workerFailed](unsigned int) {
+      if (std::this_thread::get_id () == caller)
+      {
+        while (workerFailed == false)
+        {
+          std::this_thread::yield ();
+        }
+      }
+      else
+      {
+        workerFailed = true;
+        throw std::runtime_error ("worker");
+      }
+    });
+    assert (what3 == "worker");
+    unused (what3);
+  }
+
+  // the pool is still usable after failures
+  assertEachIndexOnce (10000);
+
+  // limited pools run tasks on fewer threads
+  for (unsigned int maxNumThreads : {1u, 2u})
+  {
+    std::mutex                mutex;
+    std::set<std::thread::id> threads;
+
+    TaskPool::setMaxNumThreads (maxNumThreads);
+    assert (TaskPool::numThreads () <= maxNumThreads);
+
+    TaskPool::parallelFor (10000, [&mutex, &threads](unsigned int) {
+      std::lock_guard<std::mutex> lock (mutex);
+      threads.insert (std::this_thread::get_id ());
+    });
+    assert (threads.size () <= maxNumThreads);
+    assert (maxNumThreads > 1 || *threads.begin () == std::this_thread::get_id ());
+    unused (threads);
+  }
+  TaskPool::setMaxNumThreads (0);
+  assertEachIndexOnce (10000);
+}
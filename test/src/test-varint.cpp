@@ -0,0 +1,78 @@
+/* This file is part of Dilay
+ * Copyright © 2015-2018 Alexander Bau
+ * Use and redistribute under the terms of the GNU General Public License
+ */
+#include <cassert>
+#include <limits>
+#include <vector>
+#include "test-varint.hpp"
+#include "util.hpp"
+#include "varint.hpp"
+
+namespace
+{
+  void assertRoundTrip (unsigned int value, std::size_t size)
+  {
+    std::vector<unsigned char> bytes;
+    Varint::encode (bytes, value);
+    assert (bytes.size () == size);
+
+    const unsigned char* it = bytes.data ();
+    unsigned int         decoded;
+    const bool           success = Varint::decode (it, bytes.data () + bytes.size (), decoded);
+    assert (success);
+    assert (decoded == value);
+    assert (it == bytes.data () + bytes.size ());
+    unused (size);
+    unused (success);
+
+    // every proper prefix is truncated
+    for (std::size_t n = 0; n < bytes.size (); n++)
+    {
+      const unsigned char* prefixIt = bytes.data ();
+      const bool successTruncated = Varint::decode (prefixIt, bytes.data () + n, decoded);
+      assert (successTruncated == false);
+      unused (successTruncated);
+    }
+  }
+
+  void assertRoundTripSigned (int value)
+  {
+    std::vector<unsigned char> bytes;
+    Varint::encodeSigned (bytes, value);
+
+    const unsigned char* it = bytes.data ();
+    int                  decoded;
+    const bool success = Varint::decodeSigned (it, bytes.data () + bytes.size (), decoded);
+    assert (success);
+    assert (decoded == value);
+    unused (success);
+  }
+}
+
+void TestVarint::test ()
+{
+  assertRoundTrip (0, 1);
+  assertRoundTrip (1, 1);
+  assertRoundTrip (127, 1);
+  assertRoundTrip (128, 2);
+  assertRoundTrip (16383, 2);
+  assertRoundTrip (16384, 3);
+  assertRoundTrip (std::numeric_limits<unsigned int>::max (), 5);
+
+  assertRoundTripSigned (0);
+  assertRoundTripSigned (1);
+  assertRoundTripSigned (-1);
+  assertRoundTripSigned (64);
+  assertRoundTripSigned (-65);
+  assertRoundTripSigned (std::numeric_limits<int>::max ());
+  assertRoundTripSigned (std::numeric_limits<int>::min ());
+
+  // integers take at most five bytes
+  const std::vector<unsigned char> tooLong = {0x80, 0x80, 0x80, 0x80, 0x80, 0x01};
+  const unsigned char*             it = tooLong.data ();
+  unsigned int                     decoded;
+  const bool success = Varint::decode (it, tooLong.data () + tooLong.size (), decoded);
+  assert (success == false);
+  unused (success);
+}
@@ -8,24 +8,52 @@ INCLUDEPATH    += src $$PWD/../lib/src
 
 SOURCES += \
            src/main.cpp \
+           src/test-autosave.cpp \
            src/test-bitset.cpp \
            src/test-distance.cpp \
+           src/test-distance-tree.cpp \
+           src/test-dlb.cpp \
+           src/test-dynamic-mesh.cpp \
+           src/test-dynamic-stitch.cpp \
+           src/test-export-job.cpp \
+           src/test-history.cpp \
+           src/test-import-export.cpp \
            src/test-intersection.cpp \
+           src/test-isosurface-extraction.cpp \
            src/test-maybe.cpp \
            src/test-misc.cpp \
            src/test-octree.cpp \
+           src/test-opengl.cpp \
+           src/test-ply.cpp \
            src/test-prune.cpp \
-           src/test-tree.cpp
+           src/test-stl.cpp \
+           src/test-task-pool.cpp \
+           src/test-tree.cpp \
+           src/test-varint.cpp
 
 HEADERS += \
+           src/test-autosave.hpp \
            src/test-bitset.hpp \
            src/test-distance.hpp \
+           src/test-distance-tree.hpp \
+           src/test-dlb.hpp \
+           src/test-dynamic-mesh.hpp \
+           src/test-dynamic-stitch.hpp \
+           src/test-export-job.hpp \
+           src/test-history.hpp \
+           src/test-import-export.hpp \
            src/test-intersection.hpp \
+           src/test-isosurface-extraction.hpp \
            src/test-maybe.hpp \
            src/test-misc.hpp \
            src/test-octree.hpp \
+           src/test-opengl.hpp \
+           src/test-ply.hpp \
            src/test-prune.hpp \
-           src/test-tree.hpp
+           src/test-stl.hpp \
+           src/test-task-pool.hpp \
+           src/test-tree.hpp \
+           src/test-varint.hpp
 
 win32:CONFIG(release, debug|release):    LIBS += -L$$OUT_PWD/../lib/release/ -ldilay
 else:win32:CONFIG(debug, debug|release): LIBS += -L$$OUT_PWD/../lib/debug/ -ldilay